@@ -0,0 +1,75 @@
+#include "stdafx.h"
+
+#include "CommandBuffer.h"
+#include "Graphics.h"
+
+#include <cassert>
+
+namespace eae6320
+{
+namespace Graphics
+{
+
+void CommandBuffer::use_effect(Effect & effect)
+{
+	Command command = { UseEffect, 0, 0, &effect };
+	commands.push_back(command);
+}
+
+void CommandBuffer::params(Material & material, bool instanced)
+{
+	Command command = { Params, instanced ? 1u : 0u, 0, &material };
+	commands.push_back(command);
+}
+
+void CommandBuffer::draw(Mesh & mesh, const Matrix4 & local2world)
+{
+	Command command = { Draw, 1, static_cast<uint32_t>(matrices.size()), &mesh };
+	commands.push_back(command);
+	matrices.push_back(local2world);
+}
+
+Matrix4 * CommandBuffer::draw_instanced(Mesh & mesh, uint32_t count)
+{
+	size_t first = matrices.size();
+	Command command = { DrawInstanced, count, static_cast<uint32_t>(first), &mesh };
+	commands.push_back(command);
+	matrices.resize(first + count);
+	return matrices.data() + first;
+}
+
+void CommandBuffer::clear()
+{
+	commands.clear();
+	matrices.clear();
+}
+
+Effect * CommandBuffer::execute(Camera & camera, Effect * effect) const
+{
+	for (const Command & command : commands)
+	{
+		switch (command.op)
+		{
+		case UseEffect:
+			effect = static_cast<Effect *>(command.object);
+			SetEffect(*effect);
+			SetCamera(*effect, camera);
+			break;
+		case Params:
+			static_cast<Material *>(command.object)->SetParams(command.count != 0);
+			break;
+		case Draw:
+			assert(effect);
+			SetTransform(*effect, matrices[command.matrix]);
+			DrawMesh(*static_cast<Mesh *>(command.object));
+			break;
+		case DrawInstanced:
+			DrawMeshInstanced(*static_cast<Mesh *>(command.object), &matrices[command.matrix], command.count);
+			break;
+		}
+	}
+	return effect;
+}
+
+}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Effect.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "Camera.h"
+#include "../Math/Matrix4.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace eae6320
+{
+namespace Graphics
+{
+// draw calls written down for later. recording touches no graphics API, so any thread
+// can fill its own buffer; execute() replays them on the thread that owns the device,
+// which for GL and D3D9 is the only one that may.
+struct CommandBuffer
+{
+	enum Op : uint8_t
+	{
+		UseEffect,		// SetEffect, then SetCamera
+		Params,			// Material::SetParams; count is 1 for the instanced params
+		Draw,			// SetTransform with matrix, then DrawMesh
+		DrawInstanced,	// DrawMeshInstanced with count matrices from matrix
+	};
+
+	struct Command
+	{
+		Op op;
+		uint32_t count;
+		uint32_t matrix;
+		void * object;
+	};
+
+	std::vector<Command> commands;
+	std::vector<Matrix4> matrices;
+
+	void use_effect(Effect & effect);
+	void params(Material & material, bool instanced);
+	void draw(Mesh & mesh, const Matrix4 & local2world);
+	// count matrices are reserved for the caller to fill
+	Matrix4 * draw_instanced(Mesh & mesh, uint32_t count);
+
+	void clear();
+
+	// effect is the one in use when the buffer starts; returns the one in use at its end
+	Effect * execute(Camera & camera, Effect * effect) const;
+};
+}
+}
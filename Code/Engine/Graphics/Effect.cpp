@@ -4,16 +4,22 @@
 #include <sstream>
 #include <fstream>
 #include <cassert>
-#include "../Windows/WindowsFunctions.h"
 #include "../Debug_Runtime/UserOutput.h"
 #include "Graphics.h"
 
 #if defined ( EAE6320_PLATFORM_GL )
+#include "../Windows/WindowsFunctions.h"
 #include <gl/GLU.h>
 #include "OpenGlExtensions/OpenGlExtensions.h"
 #elif defined ( EAE6320_PLATFORM_D3D )
+#include "../Windows/WindowsFunctions.h"
+#elif defined ( EAE6320_PLATFORM_NULL )
+#include "NullDevice.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
 #else
-#error "one of EAE6320_PLATFORM_GL or EAE6320_PLATFORM_D3D must be defined."
+#error "one of EAE6320_PLATFORM_GL, EAE6320_PLATFORM_D3D or EAE6320_PLATFORM_NULL must be defined."
 #endif
 
 namespace
@@ -43,7 +49,7 @@ namespace Graphics
 {
 	Effect * Effect::FromFile(
 		const char * effectPath,
-		Parent parent)
+		Parent)
 	{
 		std::ifstream infile(effectPath, std::ifstream::binary);
 
@@ -76,6 +82,20 @@ namespace Graphics
 		spec.fragment_shd_path = buf;
 		delete[] buf;
 
+		// older builds end here, without the instanced shader
+		if (infile.peek() != std::ifstream::traits_type::eof())
+		{
+			uint16_t instanced_path_len;
+			infile.read(reinterpret_cast<char *>(&instanced_path_len), sizeof(uint16_t));
+			if (instanced_path_len > 0)
+			{
+				buf = new char[instanced_path_len];
+				infile.read(buf, instanced_path_len);
+				spec.instanced_vertex_shd_path = buf;
+				delete[] buf;
+			}
+		}
+
 		infile.close();
 
 		if (infile.fail())
@@ -129,6 +149,22 @@ namespace Graphics
 
 		effect->render_state = spec.flags;
 
+		if (!spec.instanced_vertex_shd_path.empty())
+		{
+			Effect::Spec instanced_spec;
+			instanced_spec.vertex_shd_path = spec.instanced_vertex_shd_path;
+			instanced_spec.fragment_shd_path = spec.fragment_shd_path;
+			instanced_spec.flags = spec.flags;
+
+			// a GL program links a single vertex shader, so the variant gets its own
+			effect->instanced = Effect::FromSpec(instanced_spec);
+			if (!effect->instanced)
+			{
+				delete effect;
+				return NULL;
+			}
+		}
+
 		return effect;
 	}
 
@@ -155,6 +191,8 @@ namespace Graphics
 		PFNGLUNIFORM4FVPROC procs[4] = { glUniform1fv, glUniform2fv, glUniform3fv, glUniform4fv };
 		assert(len > 0 && len < 4);
 
+		if (!GetStateCache().uniform(this->parent, handle, data, len * sizeof(float)))
+			return true;
 		procs[len - 1](handle, 1, data);
 		GLenum error = glGetError();
 		assert(error == GL_NO_ERROR);
@@ -163,6 +201,7 @@ namespace Graphics
 
 	Effect::~Effect()
 	{
+		delete instanced;
 		if (parent != 0)
 		{
 			glDeleteProgram(parent);
@@ -202,6 +241,8 @@ namespace Graphics
 			? this->vertex_shader.second
 			: this->fragment_shader.second;
 
+		if (!GetStateCache().uniform(reinterpret_cast<uintptr_t>(table), UHANDLE2DIFF(handle), data, len * sizeof(float)))
+			return true;
 		HRESULT result = table->SetFloatArray(this->parent, handle, data, len);
 		assert(SUCCEEDED(result));
 		return SUCCEEDED(result);
@@ -209,6 +250,7 @@ namespace Graphics
 
 	Effect::~Effect()
 	{
+		delete instanced;
 		if (vertex_shader.second) // constant table
 			vertex_shader.second->Release();
 		if (vertex_shader.first) // shader
@@ -218,12 +260,69 @@ namespace Graphics
 		if (fragment_shader.first) // shader
 			fragment_shader.first->Release();
 	}
+#elif defined ( EAE6320_PLATFORM_NULL )
+	Effect::UniformHandle Effect::GetUniformHandle(
+		const char * uniformName, ShaderType)
+	{
+		// there's no compiled shader to ask, so uniforms are numbered by the hash of their name
+		return static_cast<UniformHandle>(std::hash<std::string>()(uniformName) | 1);
+	}
+
+	bool Effect::SetVec(UniformHandle handle, ShaderType, float * data, uint8_t len)
+	{
+		assert(len > 0 && len <= 4);
+
+		// the rasterizer stands in for the fragment shaders, which all take these. every
+		// material sets them, so they're kept whether or not the cache skips the call
+		NullDevice & device = GetNullDevice();
+		static const UniformHandle tint = GetUniformHandle("g_tint", Fragment);
+		static const UniformHandle alpha = GetUniformHandle("g_alpha", Fragment);
+		if (handle == tint && len >= 3)
+			std::copy(data, data + 3, device.shading.tint);
+		else if (handle == alpha)
+			device.shading.alpha = data[0];
+
+		if (!GetStateCache().uniform(this->parent, handle, data, len * sizeof(float)))
+			return true;
+		device.record(NullDevice::SetUniform, this->parent, len);
+		++device.counters.uniforms;
+		return true;
+	}
+
+	Effect::~Effect()
+	{
+		delete instanced;
+	}
 #endif
 }
 }
 
 namespace
 {
+#if defined ( EAE6320_PLATFORM_NULL )
+	// reads the shader only to check that it was built
+	char * LoadAndAllocateShaderProgram(
+		const char* i_path,
+		size_t& o_size,
+		std::string& o_errorMessage)
+	{
+		std::ifstream infile(i_path, std::ifstream::binary | std::ifstream::ate);
+		if (infile.fail())
+		{
+			std::stringstream errorMessage;
+			errorMessage << "Failed to open the shader file " << i_path;
+			o_errorMessage = errorMessage.str();
+			return NULL;
+		}
+
+		o_size = static_cast<size_t>(infile.tellg()) + 1;
+		char * o_shader = static_cast<char *>(malloc(o_size));
+		infile.seekg(0);
+		infile.read(o_shader, o_size - 1);
+		o_shader[o_size - 1] = '\0';
+		return o_shader;
+	}
+#else
 	char * LoadAndAllocateShaderProgram(
 		const char* i_path,
 		size_t& o_size,
@@ -331,6 +430,7 @@ namespace
 
 		return o_shader;
 	}
+#endif
 
 #if defined ( EAE6320_PLATFORM_GL )
 
@@ -668,13 +768,14 @@ namespace
 
 			GLint uniform_handle_1, uniform_handle_2, uniform_handle_3;
 			{
+				// instanced shaders take g_local2world per instance, but still need the camera
 				uniform_handle_1 = glGetUniformLocation(effect->parent, "g_local2world");
-				if (uniform_handle_1 == -1)
+				uniform_handle_2 = glGetUniformLocation(effect->parent, "g_world2view");
+				if (uniform_handle_1 == -1 && uniform_handle_2 == -1)
 				{
 					//eae6320::UserOutput::Print("No g_local2world uniform found");
 					return true;
 				}
-				uniform_handle_2 = glGetUniformLocation(effect->parent, "g_world2view");
 				if (uniform_handle_2 == -1)
 				{
 					eae6320::UserOutput::Print("No g_world2view uniform found");
@@ -769,14 +870,15 @@ namespace
 	{
 		D3DXHANDLE uniform_handle_1, uniform_handle_2, uniform_handle_3;
 		ID3DXConstantTable * constants = effect->vertex_shader.second;
+		// instanced shaders take g_local2world per instance, but still need the camera
 		uniform_handle_1 = constants->GetConstantByName(NULL, "g_local2world");
-		if (!uniform_handle_1)
+		uniform_handle_2 = constants->GetConstantByName(NULL, "g_world2view");
+		if (!uniform_handle_1 && !uniform_handle_2)
 		{
 			//eae6320::UserOutput::Print("No g_local2world uniform found");
 			return true;
 		}
 		effect->uni_local2world = uniform_handle_1;
-		uniform_handle_2 = constants->GetConstantByName(NULL, "g_world2view");
 		if (!uniform_handle_2)
 		{
 			eae6320::UserOutput::Print("No g_world2view uniform found");
@@ -792,5 +894,81 @@ namespace
 		effect->uni_view2screen = uniform_handle_3;
 		return true;
 	}
+#elif defined ( EAE6320_PLATFORM_NULL )
+
+	// the transform uniforms a shader names. GLSL source has them as text, and a compiled
+	// Direct3D shader keeps them in its constant table, so either can be searched
+	enum NamedTransforms : uint32_t
+	{
+		Local2World = 1 << 0,
+		World2View = 1 << 1,
+		View2Screen = 1 << 2,
+	};
+
+	bool Names(const char * shaderStr, size_t size, const std::string & name)
+	{
+		return std::search(shaderStr, shaderStr + size, name.begin(), name.end()) != shaderStr + size;
+	}
+
+	eae6320::Graphics::Effect::Parent CreateParent()
+	{
+		return eae6320::Graphics::GetNullDevice().next_id();
+	}
+
+	eae6320::Graphics::Effect::CompiledShader CompileShader(
+		eae6320::Graphics::Effect::Parent,
+		const char * shaderStr,
+		size_t size,
+		eae6320::Graphics::Effect::ShaderType,
+		const char *)
+	{
+		uint32_t named = 0;
+		if (Names(shaderStr, size, "g_local2world"))
+			named |= Local2World;
+		if (Names(shaderStr, size, "g_world2view"))
+			named |= World2View;
+		if (Names(shaderStr, size, "g_view2screen"))
+			named |= View2Screen;
+		free(const_cast<char *>(shaderStr));
+		return named;
+	}
+
+	eae6320::Graphics::Effect::VertexShader LoadVertexShader(
+		eae6320::Graphics::Effect::Parent,
+		eae6320::Graphics::Effect::CompiledShader compiledShader)
+	{
+		return compiledShader;
+	}
+
+	eae6320::Graphics::Effect::FragmentShader LoadFragmentShader(
+		eae6320::Graphics::Effect::Parent,
+		eae6320::Graphics::Effect::CompiledShader compiledShader)
+	{
+		return compiledShader;
+	}
+
+	bool FinishUp(eae6320::Graphics::Effect * effect)
+	{
+		using eae6320::Graphics::Effect;
+		uint32_t named = effect->vertex_shader;
+		// instanced shaders take g_local2world per instance, but still need the camera
+		if (!(named & (Local2World | World2View)))
+			return true;
+		if (named & Local2World)
+			effect->uni_local2world = effect->GetUniformHandle("g_local2world", Effect::Vertex);
+		if (!(named & World2View))
+		{
+			eae6320::UserOutput::Print("No g_world2view uniform found");
+			return false;
+		}
+		effect->uni_world2view = effect->GetUniformHandle("g_world2view", Effect::Vertex);
+		if (!(named & View2Screen))
+		{
+			eae6320::UserOutput::Print("No g_view2screen uniform found");
+			return false;
+		}
+		effect->uni_view2screen = effect->GetUniformHandle("g_view2screen", Effect::Vertex);
+		return true;
+	}
 #endif
 }
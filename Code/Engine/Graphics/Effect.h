@@ -13,8 +13,14 @@
 
 #define UHANDLE2DIFF(x) (reinterpret_cast<ptrdiff_t>(x))
 #define DIFF2UHANDLE(x) (reinterpret_cast<eae6320::Graphics::Effect::UniformHandle>(x))
+#elif defined ( EAE6320_PLATFORM_NULL )
+#include <cstddef>
+#include <cstdint>
+
+#define UHANDLE2DIFF(x) (static_cast<ptrdiff_t>(x))
+#define DIFF2UHANDLE(x) (static_cast<eae6320::Graphics::Effect::UniformHandle>(x))
 #else
-#error "one of EAE6320_PLATFORM_GL or EAE6320_PLATFORM_D3D must be defined."
+#error "one of EAE6320_PLATFORM_GL, EAE6320_PLATFORM_D3D or EAE6320_PLATFORM_NULL must be defined."
 #endif
 
 #include <string>
@@ -40,6 +46,8 @@ namespace Graphics
 			GLuint
 #elif defined ( EAE6320_PLATFORM_D3D )
 			LPDIRECT3DDEVICE9
+#elif defined ( EAE6320_PLATFORM_NULL )
+			uint32_t
 #endif
 			Parent;
 
@@ -48,6 +56,8 @@ namespace Graphics
 			GLint
 #elif defined ( EAE6320_PLATFORM_D3D )
 			std::pair<LPDIRECT3DVERTEXSHADER9, LPD3DXCONSTANTTABLE>
+#elif defined ( EAE6320_PLATFORM_NULL )
+			uint32_t
 #endif
 			VertexShader;
 
@@ -56,6 +66,8 @@ namespace Graphics
 			GLint
 #elif defined ( EAE6320_PLATFORM_D3D )
 			std::pair<LPDIRECT3DPIXELSHADER9, LPD3DXCONSTANTTABLE>
+#elif defined ( EAE6320_PLATFORM_NULL )
+			uint32_t
 #endif
 			FragmentShader;
 
@@ -64,6 +76,8 @@ namespace Graphics
 			GLuint
 #elif defined ( EAE6320_PLATFORM_D3D )
 			std::pair<const DWORD *, LPD3DXCONSTANTTABLE>
+#elif defined ( EAE6320_PLATFORM_NULL )
+			uint32_t
 #endif
 			CompiledShader;
 
@@ -72,6 +86,8 @@ namespace Graphics
 			GLint
 #elif defined ( EAE6320_PLATFORM_D3D )
 			D3DXHANDLE
+#elif defined ( EAE6320_PLATFORM_NULL )
+			intptr_t
 #endif
 			UniformHandle;
 
@@ -79,6 +95,8 @@ namespace Graphics
 #define INVALID_UNIFORM_HANDLE (-1)
 #elif defined ( EAE6320_PLATFORM_D3D )
 #define INVALID_UNIFORM_HANDLE NULL
+#elif defined ( EAE6320_PLATFORM_NULL )
+#define INVALID_UNIFORM_HANDLE 0
 #endif
 
 		enum ShaderType
@@ -100,6 +118,8 @@ namespace Graphics
 		{
 			std::string vertex_shd_path;
 			std::string fragment_shd_path;
+			// optional; takes g_local2world per instance instead of as a uniform
+			std::string instanced_vertex_shd_path;
 			RenderState flags;
 		};
 
@@ -107,12 +127,14 @@ namespace Graphics
 		//   composing both of the compiled shaders together.
 		// for Direct3d, parent is the device (IDirect3DDevice9 *),
 		//   which is necessary for most API functions.
+		// for the null backend, parent is a number for the effect.
 		Parent parent;
 
 		// for OpenGL, the shader IDs are only stored temporarily,
 		//   then loaded into the program (parent) and zeroed out.
 		// for Direct3D, these hold the actual pointers
 		//   to the compiled and loaded shaders.
+		// for the null backend, these are the transform uniforms each shader names.
 		VertexShader vertex_shader;
 		FragmentShader fragment_shader;
 
@@ -120,6 +142,10 @@ namespace Graphics
 
 		bool usesTransform = false;
 
+		// the same effect with the instanced vertex shader, if the spec has one;
+		// the render queue draws runs of one mesh and material with it
+		Effect * instanced = NULL;
+
 		// this is a handle on the vertex shader's "g_position" uniform
 		UniformHandle uni_local2world, uni_world2view, uni_view2screen;
 
@@ -7,6 +7,7 @@ namespace Graphics
 {
 
 	const float float_cam_radius = 3.0f, float_cam_height = 1.0f;
+	const float float_cam_clearance = 0.3f;
 	const float tangent_x = 0.32f, tangent_y = 0.16f;
 	const float tangent_speed = 10.0f, max_speed = 3.0f;
 	const uint16_t buffer_length = 10;
@@ -15,7 +16,7 @@ void FloatCamera::update(Physics::Terrain & terrain, float dt)
 {
 	Vector3 float_dir = (target - position).normalize();
 	Vector3 float_dir_xz = Vector3(float_dir.x, 0, float_dir.z).normalize();
-	Vector3 float_target = target - float_dir_xz * float_cam_radius + Vector3::J * float_cam_height;
+	Vector3 float_target = Vector3::madd2(target, float_dir_xz, -float_cam_radius, Vector3::J, float_cam_height);
 	Vector3 target_disp = float_target - position;
 
 	velocity += target_disp.clip(max_speed);
@@ -33,10 +34,22 @@ void FloatCamera::update(Physics::Terrain & terrain, float dt)
 	Vector3 down_right = up + right;
 	Vector3 down_left = up - right;
 
-	float t_up = fminf(1, terrain.intersect_ray(target + up, offset + up));
-	float t_down = fminf(1, terrain.intersect_ray(target - up, offset - up));
-	float t_right = fminf(1, terrain.intersect_ray(target + right, offset + right));
-	float t_left = fminf(1, terrain.intersect_ray(target - right, offset - right));
+	// how far the view from the target gets along each side of the camera
+	float t_up, t_down, t_right, t_left;
+	if (field != NULL)
+	{
+		t_up = field->march(target + up, offset + up);
+		t_down = field->march(target - up, offset - up);
+		t_right = field->march(target + right, offset + right);
+		t_left = field->march(target - right, offset - right);
+	}
+	else
+	{
+		t_up = fminf(1, terrain.intersect_ray(target + up, offset + up));
+		t_down = fminf(1, terrain.intersect_ray(target - up, offset - up));
+		t_right = fminf(1, terrain.intersect_ray(target + right, offset + right));
+		t_left = fminf(1, terrain.intersect_ray(target - right, offset - right));
+	}
 
 	tangent_velocity.x += tangent_speed * (t_right - t_left);
 	tangent_velocity.y += tangent_speed * (t_up - t_down);
@@ -52,6 +65,15 @@ void FloatCamera::update(Physics::Terrain & terrain, float dt)
 		pos_sum += v;
 	position = pos_sum / (uint16_t) position_buffer.size();
 
+	// the probes above steer around occluders; this only stops the camera clipping into walls
+	if (field != NULL)
+	{
+		Vector3 away;
+		float distance = field->distance(position, &away);
+		if (distance < float_cam_clearance && away != Vector3::Zero)
+			position += away.normalize() * (float_cam_clearance - distance);
+	}
+
 	tangent_velocity = Vector2::Zero;
 	velocity /= 2;
 }
@@ -2,6 +2,7 @@
 
 #include "Camera.h"
 #include "../Physics/Terrain.h"
+#include "../Physics/DistanceField.h"
 #include "../Math/Vector3.h"
 #include "../Math/Vector2.h"
 
@@ -24,6 +25,9 @@ struct FloatCamera : public Camera
 
 	const Vector3 & target;
 
+	// optional; keeps the camera out of walls, and answers its occlusion probes instead of terrain rays
+	const Physics::DistanceField * field = NULL;
+
 	void update(Physics::Terrain & terrain, float dt);
 
 	FloatCamera(const Vector3 & target);
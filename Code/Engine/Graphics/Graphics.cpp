@@ -16,11 +16,9 @@ void eae6320::Graphics::DrawWireframe(Wireframe & wireframe, Camera & camera)
 
 void eae6320::Graphics::DrawModel(Model & model, Camera & camera)
 {
-	Matrix4 local2world = Matrix4::rotation_q(model.rotation);
-	local2world = local2world.dot(Matrix4::scale(model.scale));
-	local2world.vec3(3) = model.position;
+	Affine3 local2world = Affine3::create_RST(model.rotation, model.scale, model.position);
 	Graphics::SetMaterial(*model.mat);
-	Graphics::SetTransform(*model.mat->effect, local2world);
+	Graphics::SetTransform(*model.mat->effect, Matrix4(local2world));
 	Graphics::SetCamera(*model.mat->effect, camera);
 	Graphics::DrawMesh(*model.mesh);
 }
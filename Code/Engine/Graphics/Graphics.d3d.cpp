@@ -7,6 +7,7 @@
 
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <d3d9.h>
 #include <d3dx9shader.h>
 #include <d3dx9core.h>
@@ -24,7 +25,29 @@ namespace
 	IDirect3DDevice9* s_direct3dDevice = NULL;
 	IDirect3DVertexDeclaration9* s_standardVertexFormat = NULL;
 	IDirect3DVertexBuffer9* s_spriteVertexBuffer = NULL;
+	// instanced draws read the mesh from stream 0 and a transform per instance from stream 1
+	IDirect3DVertexDeclaration9* s_instancedVertexFormat = NULL;
+	IDirect3DVertexBuffer9* s_instanceBuffer = NULL;
+	// the buffer is filled front to back through a frame, and discarded once it is full
+	const unsigned int s_maxInstances = 4096;
+	unsigned int s_instancesUsed = 0;
 	ID3DXFont* s_debugFont = NULL;
+	eae6320::Graphics::StateCache s_stateCache(false);
+
+	// the projection changes only with the viewport, so it is built once a frame;
+	// the view only with the camera, so once per camera. draws set neither
+	struct FrameConstants
+	{
+		float width, height;
+		eae6320::Matrix4 view2screen;
+	} s_frameConstants;
+	struct ViewConstants
+	{
+		bool valid;
+		eae6320::Vector3 position;
+		eae6320::Versor rotation;
+		eae6320::Matrix4 world2view;
+	} s_viewConstants;
 }
 
 // Helper Function Declarations
@@ -44,6 +67,8 @@ namespace
 	HRESULT GetVertexProcessingUsage( DWORD& o_usage );
 	bool LoadFragmentShader();
 	bool LoadVertexShader();
+	void UpdateFrameConstants();
+	void UpdateViewConstants( const Camera & i_camera );
 }
 
 // Interface
@@ -53,6 +78,11 @@ Effect::Parent eae6320::Graphics::GetDevice()
 	return s_direct3dDevice;
 }
 
+StateCache & eae6320::Graphics::GetStateCache()
+{
+	return s_stateCache;
+}
+
 bool eae6320::Graphics::LoadMesh(Mesh & output, Mesh::Data & input)
 {
 	return CreateVertexBuffer(output, input)
@@ -128,6 +158,37 @@ bool eae6320::Graphics::Initialize( const HWND i_renderingWindow )
 		}
 	}
 
+	// Initialize the instanced vertex format
+	{
+		D3DVERTEXELEMENT9 vertexElements[] =
+		{
+			// Stream 0, as in the standard vertex format
+			{ 0, 0, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
+			{ 0, 12, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_NORMAL, 0 },
+			{ 0, 24, D3DDECLTYPE_D3DCOLOR, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_COLOR, 0 },
+			{ 0, 28, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+
+			// Stream 1
+
+			// TEXCOORDS1-4, the rows of local2world
+			// 4 floats == 16 bytes each
+			// Offset = 0, 16, 32, 48
+			{ 1, 0, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1 },
+			{ 1, 16, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 2 },
+			{ 1, 32, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 3 },
+			{ 1, 48, D3DDECLTYPE_FLOAT4, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 4 },
+
+			D3DDECL_END()
+		};
+
+		HRESULT result = s_direct3dDevice->CreateVertexDeclaration(vertexElements, &s_instancedVertexFormat);
+		if (!SUCCEEDED(result))
+		{
+			eae6320::UserOutput::Print("Direct3D failed to create the instanced vertex declaration");
+			return false;
+		}
+	}
+
 	// Set the vertex declaration for all meshes
 	{
 		HRESULT result = s_direct3dDevice->SetVertexDeclaration(s_standardVertexFormat);
@@ -169,6 +230,34 @@ bool eae6320::Graphics::Initialize( const HWND i_renderingWindow )
 		}
 	}
 
+	// Create vertex buffer for instance transforms:
+	{
+		DWORD usage = 0;
+		{
+			const HRESULT result = GetVertexProcessingUsage(usage);
+			if (FAILED(result))
+			{
+				return false;
+			}
+			usage |= D3DUSAGE_DYNAMIC;
+			usage |= D3DUSAGE_WRITEONLY;
+		}
+
+		const unsigned int bufferSize = sizeof(Matrix4) * s_maxInstances;
+		{
+			const DWORD useSeparateVertexDeclaration = 0;
+			const D3DPOOL useDefaultPool = D3DPOOL_DEFAULT;
+			HANDLE* const notUsed = NULL;
+			const HRESULT result = s_direct3dDevice->CreateVertexBuffer(bufferSize,
+				usage, useSeparateVertexDeclaration, useDefaultPool, &s_instanceBuffer, notUsed);
+			if (FAILED(result))
+			{
+				eae6320::UserOutput::Print("Direct3D failed to create the instance buffer");
+				return false;
+			}
+		}
+	}
+
 #ifdef _DEBUG
 	{
 		const HRESULT result = D3DXCreateFont(s_direct3dDevice
@@ -209,10 +298,14 @@ void eae6320::Graphics::DrawMesh( Mesh & mesh )
 		const unsigned int bufferOffset = 0;
 		// The "stride" defines how large a single vertex is in the stream of data
 		const unsigned int bufferStride = sizeof(Mesh::Vertex);
-		HRESULT result = s_direct3dDevice->SetStreamSource(streamIndex, mesh.vertex_buffer, bufferOffset, bufferStride);
-		assert(SUCCEEDED(result));
+		if (s_stateCache.vertices(reinterpret_cast<uintptr_t>(mesh.vertex_buffer)))
+		{
+			HRESULT result = s_direct3dDevice->SetStreamSource(streamIndex, mesh.vertex_buffer, bufferOffset, bufferStride);
+			assert(SUCCEEDED(result));
+		}
 	}
 	// Bind a specific index buffer to the device as a data source
+	if (s_stateCache.indices(reinterpret_cast<uintptr_t>(mesh.index_buffer)))
 	{
 		HRESULT result = s_direct3dDevice->SetIndices(mesh.index_buffer);
 		assert(SUCCEEDED(result));
@@ -236,16 +329,86 @@ void eae6320::Graphics::DrawMesh( Mesh & mesh )
 	}
 }
 
+void eae6320::Graphics::DrawMeshInstanced( Mesh & mesh, const Matrix4 * local2worlds, uint32_t count )
+{
+	HRESULT result = s_direct3dDevice->SetVertexDeclaration(s_instancedVertexFormat);
+	assert(SUCCEEDED(result));
+
+	// Bind the mesh's buffers as in DrawMesh
+	if (s_stateCache.vertices(reinterpret_cast<uintptr_t>(mesh.vertex_buffer)))
+	{
+		result = s_direct3dDevice->SetStreamSource(0, mesh.vertex_buffer, 0, sizeof(Mesh::Vertex));
+		assert(SUCCEEDED(result));
+	}
+	if (s_stateCache.indices(reinterpret_cast<uintptr_t>(mesh.index_buffer)))
+	{
+		result = s_direct3dDevice->SetIndices(mesh.index_buffer);
+		assert(SUCCEEDED(result));
+	}
+
+	// one draw per buffer's worth of instances
+	while (count > 0)
+	{
+		unsigned int batch = count < s_maxInstances ? count : s_maxInstances;
+
+		// Append the transforms after the ones already drawn this frame, which the GPU
+		// may still be reading; start a new buffer when they don't fit
+		{
+			DWORD lockingBehavior = D3DLOCK_NOOVERWRITE;
+			if (s_instancesUsed + batch > s_maxInstances)
+			{
+				lockingBehavior = D3DLOCK_DISCARD;
+				s_instancesUsed = 0;
+			}
+
+			void * instanceData;
+			result = s_instanceBuffer->Lock(s_instancesUsed * sizeof(Matrix4), batch * sizeof(Matrix4),
+				&instanceData, lockingBehavior);
+			assert(SUCCEEDED(result));
+			memcpy(instanceData, local2worlds, batch * sizeof(Matrix4));
+			result = s_instanceBuffer->Unlock();
+			assert(SUCCEEDED(result));
+		}
+		// Stream 0 repeats for each instance, and stream 1 steps once per instance
+		{
+			result = s_direct3dDevice->SetStreamSource(1, s_instanceBuffer, s_instancesUsed * sizeof(Matrix4), sizeof(Matrix4));
+			assert(SUCCEEDED(result));
+			result = s_direct3dDevice->SetStreamSourceFreq(0, D3DSTREAMSOURCE_INDEXEDDATA | batch);
+			assert(SUCCEEDED(result));
+			result = s_direct3dDevice->SetStreamSourceFreq(1, D3DSTREAMSOURCE_INSTANCEDATA | 1);
+			assert(SUCCEEDED(result));
+		}
+		{
+			result = s_direct3dDevice->DrawIndexedPrimitive(D3DPT_TRIANGLELIST,
+				0, 0, mesh.num_vertices, 0, mesh.num_triangles);
+			assert(SUCCEEDED(result));
+		}
+
+		s_instancesUsed += batch;
+		local2worlds += batch;
+		count -= batch;
+	}
+
+	// Back to the single stream every other draw expects
+	{
+		result = s_direct3dDevice->SetStreamSourceFreq(0, 1);
+		assert(SUCCEEDED(result));
+		result = s_direct3dDevice->SetStreamSourceFreq(1, 1);
+		assert(SUCCEEDED(result));
+		result = s_direct3dDevice->SetStreamSource(1, NULL, 0, 0);
+		assert(SUCCEEDED(result));
+		result = s_direct3dDevice->SetVertexDeclaration(s_standardVertexFormat);
+		assert(SUCCEEDED(result));
+	}
+}
+
 void eae6320::Graphics::DrawSpriteQuad(Sprite & sprite)
 {
 	// Normalize sprite coordinates to the narrower viewport dimension
 	// i.e. ensure that [-1,1] in x and y is always visible and square
 	Sprite::Rect xy = sprite.xy, & uv = sprite.uv;
-	D3DVIEWPORT9 viewport;
-	HRESULT result = sprite.mat->effect->parent->GetViewport(&viewport);
-	assert(SUCCEEDED(result));
-	float w = static_cast<float>(viewport.Width);
-	float h = static_cast<float>(viewport.Height);
+	float w = s_frameConstants.width;
+	float h = s_frameConstants.height;
 	if (w > h)
 	{
 		float aspect = h / w;
@@ -307,8 +470,11 @@ void eae6320::Graphics::DrawSpriteQuad(Sprite & sprite)
 		const unsigned int bufferOffset = 0;
 		// The "stride" defines how large a single vertex is in the stream of data
 		const unsigned int bufferStride = sizeof(Mesh::Vertex);
-		HRESULT result = s_direct3dDevice->SetStreamSource(streamIndex, s_spriteVertexBuffer, bufferOffset, bufferStride);
-		assert(SUCCEEDED(result));
+		if (s_stateCache.vertices(reinterpret_cast<uintptr_t>(s_spriteVertexBuffer)))
+		{
+			HRESULT result = s_direct3dDevice->SetStreamSource(streamIndex, s_spriteVertexBuffer, bufferOffset, bufferStride);
+			assert(SUCCEEDED(result));
+		}
 	}
 	// Render objects from the current streams
 	{
@@ -414,8 +580,11 @@ void eae6320::Graphics::DrawWireMesh(Mesh & mesh)
 		const unsigned int bufferOffset = 0;
 		// The "stride" defines how large a single vertex is in the stream of data
 		const unsigned int bufferStride = sizeof(Mesh::Vertex);
-		HRESULT result = s_direct3dDevice->SetStreamSource(streamIndex, mesh.vertex_buffer, bufferOffset, bufferStride);
-		assert(SUCCEEDED(result));
+		if (s_stateCache.vertices(reinterpret_cast<uintptr_t>(mesh.vertex_buffer)))
+		{
+			HRESULT result = s_direct3dDevice->SetStreamSource(streamIndex, mesh.vertex_buffer, bufferOffset, bufferStride);
+			assert(SUCCEEDED(result));
+		}
 	}
 	// Render objects from the current streams
 	{
@@ -455,74 +624,102 @@ int eae6320::Graphics::DrawDebugText(int x, int y, std::string & text)
 		DT_LEFT | DT_NOCLIP, // format
 		0xffccff66); // color
 
+	// D3DX sets its own shaders and render states to draw the text
+	s_stateCache.invalidate();
+
 	return text_height;
 }
 #endif
 
 void eae6320::Graphics::SetCamera( Effect & effect, Camera & camera )
 {
-	HRESULT result;
-	Matrix4 viewmat = Matrix4::Identity;
-	viewmat.vec3(3) = -camera.position;
-	viewmat = viewmat.dot(Matrix4::rotation_q(camera.rotation.inverse()));
-	const D3DXMATRIX * mat2 = reinterpret_cast<const D3DXMATRIX *>(&viewmat);
-	LPD3DXCONSTANTTABLE table = effect.vertex_shader.second;
-	result = table->SetMatrixTranspose(s_direct3dDevice, effect.uni_world2view, mat2);
-	assert(SUCCEEDED(result));
-}
+	UpdateViewConstants(camera);
 
-void eae6320::Graphics::SetRenderState( Effect::RenderState render_state )
-{
 	HRESULT result;
+	LPD3DXCONSTANTTABLE table = effect.vertex_shader.second;
 
-	if (render_state.alpha)
-	{
-		result = s_direct3dDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
-		assert(SUCCEEDED(result));
-		result = s_direct3dDevice->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
-		assert(SUCCEEDED(result));
-		result = s_direct3dDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
-		assert(SUCCEEDED(result));
-	}
-	else
+	const Matrix4 & viewmat = s_viewConstants.world2view;
+	if (s_stateCache.uniform(reinterpret_cast<uintptr_t>(table), UHANDLE2DIFF(effect.uni_world2view), &viewmat, sizeof(viewmat)))
 	{
-		result = s_direct3dDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+		const D3DXMATRIX * mat2 = reinterpret_cast<const D3DXMATRIX *>(&viewmat);
+		result = table->SetMatrixTranspose(s_direct3dDevice, effect.uni_world2view, mat2);
 		assert(SUCCEEDED(result));
 	}
 
-	if (render_state.z_test)
+	const Matrix4 & screenmat = s_frameConstants.view2screen;
+	if (s_stateCache.uniform(reinterpret_cast<uintptr_t>(table), UHANDLE2DIFF(effect.uni_view2screen), &screenmat, sizeof(screenmat)))
 	{
-		result = s_direct3dDevice->SetRenderState(D3DRS_ZENABLE, D3DZB_TRUE);
-		assert(SUCCEEDED(result));
-		result = s_direct3dDevice->SetRenderState(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
-		assert(SUCCEEDED(result));
-	}
-	else
-	{
-		result = s_direct3dDevice->SetRenderState(D3DRS_ZENABLE, D3DZB_FALSE);
+		const D3DXMATRIX * mat3 = reinterpret_cast<const D3DXMATRIX *>(&screenmat);
+		result = table->SetMatrixTranspose(s_direct3dDevice, effect.uni_view2screen, mat3);
 		assert(SUCCEEDED(result));
 	}
+}
+
+void eae6320::Graphics::SetRenderState( Effect::RenderState render_state )
+{
+	HRESULT result;
+	uint8_t changes = s_stateCache.render_state(render_state);
 
-	if (render_state.z_write)
+	if (changes & StateCache::Alpha)
 	{
-		result = s_direct3dDevice->SetRenderState(D3DRS_ZWRITEENABLE, TRUE);
-		assert(SUCCEEDED(result));
+		if (render_state.alpha)
+		{
+			result = s_direct3dDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+			assert(SUCCEEDED(result));
+			result = s_direct3dDevice->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+			assert(SUCCEEDED(result));
+			result = s_direct3dDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+			assert(SUCCEEDED(result));
+		}
+		else
+		{
+			result = s_direct3dDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+			assert(SUCCEEDED(result));
+		}
 	}
-	else
+
+	if (changes & StateCache::ZTest)
 	{
-		result = s_direct3dDevice->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
-		assert(SUCCEEDED(result));
+		if (render_state.z_test)
+		{
+			result = s_direct3dDevice->SetRenderState(D3DRS_ZENABLE, D3DZB_TRUE);
+			assert(SUCCEEDED(result));
+			result = s_direct3dDevice->SetRenderState(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
+			assert(SUCCEEDED(result));
+		}
+		else
+		{
+			result = s_direct3dDevice->SetRenderState(D3DRS_ZENABLE, D3DZB_FALSE);
+			assert(SUCCEEDED(result));
+		}
 	}
 
-	if (render_state.cull_back)
+	if (changes & StateCache::ZWrite)
 	{
-		result = s_direct3dDevice->SetRenderState(D3DRS_CULLMODE, D3DCULL_CCW);
-		assert(SUCCEEDED(result));
+		if (render_state.z_write)
+		{
+			result = s_direct3dDevice->SetRenderState(D3DRS_ZWRITEENABLE, TRUE);
+			assert(SUCCEEDED(result));
+		}
+		else
+		{
+			result = s_direct3dDevice->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
+			assert(SUCCEEDED(result));
+		}
 	}
-	else
+
+	if (changes & StateCache::CullBack)
 	{
-		result = s_direct3dDevice->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
-		assert(SUCCEEDED(result));
+		if (render_state.cull_back)
+		{
+			result = s_direct3dDevice->SetRenderState(D3DRS_CULLMODE, D3DCULL_CCW);
+			assert(SUCCEEDED(result));
+		}
+		else
+		{
+			result = s_direct3dDevice->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+			assert(SUCCEEDED(result));
+		}
 	}
 }
 
@@ -532,6 +729,8 @@ void eae6320::Graphics::SetEffect(Effect & effect)
 
 	SetRenderState(effect.render_state);
 
+	if (!s_stateCache.program(reinterpret_cast<uintptr_t>(&effect)))
+		return;
 	result = s_direct3dDevice->SetVertexShader(effect.vertex_shader.first);
 	assert(SUCCEEDED(result));
 	result = s_direct3dDevice->SetPixelShader(effect.fragment_shader.first);
@@ -540,22 +739,13 @@ void eae6320::Graphics::SetEffect(Effect & effect)
 
 void eae6320::Graphics::SetTransform(Effect & effect, const Matrix4 local2world)
 {
-	HRESULT result;
 	LPD3DXCONSTANTTABLE table = effect.vertex_shader.second;
-
-	const D3DXMATRIX * mat1 = reinterpret_cast<const D3DXMATRIX *>(&local2world);
-	result = table->SetMatrixTranspose(s_direct3dDevice, effect.uni_local2world, mat1);
-	assert(SUCCEEDED(result));
-
-	D3DVIEWPORT9 viewport;
-	result = effect.parent->GetViewport(&viewport);
-	assert(SUCCEEDED(result));
-	float fov = std::atanf(1) * 4 / 3;
-	float aspect = static_cast<float>(viewport.Width) / static_cast<float>(viewport.Height);
-	Matrix4 screenmat = ScreenTransform(fov, aspect, 0.1f, 100.0f);
-	const D3DXMATRIX * mat3 = reinterpret_cast<const D3DXMATRIX *>(&screenmat);
-	result = table->SetMatrixTranspose(s_direct3dDevice, effect.uni_view2screen, mat3);
-	assert(SUCCEEDED(result));
+	if (s_stateCache.uniform(reinterpret_cast<uintptr_t>(table), UHANDLE2DIFF(effect.uni_local2world), &local2world, sizeof(local2world)))
+	{
+		const D3DXMATRIX * mat1 = reinterpret_cast<const D3DXMATRIX *>(&local2world);
+		HRESULT result = table->SetMatrixTranspose(s_direct3dDevice, effect.uni_local2world, mat1);
+		assert(SUCCEEDED(result));
+	}
 }
 
 void eae6320::Graphics::Clear()
@@ -567,6 +757,11 @@ void eae6320::Graphics::Clear()
 
 void eae6320::Graphics::BeginFrame()
 {
+	s_stateCache.begin_frame();
+	UpdateFrameConstants();
+	// last frame's instances are discarded with the next lock
+	s_instancesUsed = s_maxInstances;
+
 	HRESULT result = s_direct3dDevice->BeginScene();
 	assert(SUCCEEDED(result));
 }
@@ -601,6 +796,17 @@ bool eae6320::Graphics::ShutDown()
 	}
 #endif
 
+	if (s_instanceBuffer)
+	{
+		s_instanceBuffer->Release();
+		s_instanceBuffer = NULL;
+	}
+	if (s_instancedVertexFormat)
+	{
+		s_instancedVertexFormat->Release();
+		s_instancedVertexFormat = NULL;
+	}
+
 	if ( s_direct3dInterface )
 	{
 		if ( s_direct3dDevice )
@@ -636,6 +842,37 @@ namespace
 			0.0f, 0.0f, i_z_nearPlane * zDistanceScale, 0.0f);
 	}
 
+	void UpdateFrameConstants()
+	{
+		D3DVIEWPORT9 viewport;
+		HRESULT result = s_direct3dDevice->GetViewport(&viewport);
+		assert(SUCCEEDED(result));
+		float width = static_cast<float>(viewport.Width);
+		float height = static_cast<float>(viewport.Height);
+		if (width == s_frameConstants.width && height == s_frameConstants.height)
+			return;
+
+		s_frameConstants.width = width;
+		s_frameConstants.height = height;
+		float fov = std::atanf(1) * 4 / 3;
+		s_frameConstants.view2screen = ScreenTransform(fov, width / height, 0.1f, 100.0f);
+	}
+
+	void UpdateViewConstants( const Camera & i_camera )
+	{
+		const eae6320::Versor & q = i_camera.rotation, & known = s_viewConstants.rotation;
+		if (s_viewConstants.valid && i_camera.position == s_viewConstants.position
+			&& q.x == known.x && q.y == known.y && q.z == known.z && q.w == known.w)
+			return;
+
+		eae6320::Matrix4 viewmat = eae6320::Matrix4::Identity;
+		viewmat.vec3(3) = -i_camera.position;
+		s_viewConstants.world2view = viewmat.dot(eae6320::Matrix4::rotation_q(i_camera.rotation.inverse()));
+		s_viewConstants.position = i_camera.position;
+		s_viewConstants.rotation = i_camera.rotation;
+		s_viewConstants.valid = true;
+	}
+
 	bool CreateDevice()
 	{
 		const UINT useDefaultDevice = D3DADAPTER_DEFAULT;
@@ -25,6 +25,24 @@ namespace
 	HWND s_renderingWindow = NULL;
 	HDC s_deviceContext = NULL;
 	HGLRC s_openGlRenderingContext = NULL;
+	eae6320::Graphics::StateCache s_stateCache(true);
+	// the transforms of the instanced draw in flight, re-specified for every draw
+	GLuint s_instanceBufferId = 0;
+
+	// the projection changes only with the viewport, so it is built once a frame;
+	// the view only with the camera, so once per camera. draws set neither
+	struct FrameConstants
+	{
+		int width, height;
+		eae6320::Matrix4 view2screen;
+	} s_frameConstants;
+	struct ViewConstants
+	{
+		bool valid;
+		eae6320::Vector3 position;
+		eae6320::Versor rotation;
+		eae6320::Matrix4 world2view;
+	} s_viewConstants;
 }
 
 // Helper Function Declarations
@@ -40,6 +58,8 @@ namespace
 
 	bool CreateRenderingContext();
 	bool CreateVertexArray( Mesh & mesh, Mesh::Data & data );
+	void UpdateFrameConstants();
+	void UpdateViewConstants( const Camera & i_camera );
 
 	// This helper struct exists to be able to dynamically allocate memory to get "log info"
 	// which will automatically be freed when the struct goes out of scope
@@ -59,8 +79,15 @@ Effect::Parent eae6320::Graphics::GetDevice()
 	return 0;
 }
 
+StateCache & eae6320::Graphics::GetStateCache()
+{
+	return s_stateCache;
+}
+
 bool eae6320::Graphics::LoadMesh(Mesh & output, Mesh::Data & input)
 {
+	// creating the vertex array binds it
+	s_stateCache.invalidate();
 	return CreateVertexArray(output, input);
 }
 
@@ -84,6 +111,21 @@ bool eae6320::Graphics::Initialize( const HWND i_renderingWindow )
 		}
 	}
 
+	// Create the buffer for instance transforms
+	{
+		const GLsizei bufferCount = 1;
+		glGenBuffers( bufferCount, &s_instanceBufferId );
+		const GLenum errorCode = glGetError();
+		if ( errorCode != GL_NO_ERROR )
+		{
+			std::stringstream errorMessage;
+			errorMessage << "OpenGL failed to get an unused instance buffer ID: " <<
+				reinterpret_cast<const char*>( gluErrorString( errorCode ) );
+			UserOutput::Print( errorMessage.str() );
+			goto OnError;
+		}
+	}
+
 	// don't draw tris that aren't facing camera
 	{
 		const GLenum errorCode = glGetError();
@@ -116,6 +158,7 @@ OnError:
 void eae6320::Graphics::DrawMesh( Mesh & mesh )
 {
 	// Bind a specific vertex buffer to the device as a data source
+	if (s_stateCache.vertices(mesh.gl_id))
 	{
 		glBindVertexArray(mesh.gl_id);
 		assert(glGetError() == GL_NO_ERROR);
@@ -141,85 +184,159 @@ void eae6320::Graphics::DrawMesh( Mesh & mesh )
 	}
 }
 
-
-void eae6320::Graphics::SetCamera( Effect & effect, Camera & camera )
+void eae6320::Graphics::DrawMeshInstanced( Mesh & mesh, const Matrix4 * local2worlds, uint32_t count )
 {
-	Matrix4 viewmat = Matrix4::Identity;
-	viewmat.vec3(3) = camera.position;
-	viewmat = viewmat.dot(Matrix4::rotation_q(camera.rotation));
-	const GLfloat * mat2 = reinterpret_cast<const GLfloat *>(&viewmat);
-	glUniformMatrix4fv(effect.uni_world2view, 1, false, mat2);
-	GLenum error = glGetError();
-	assert(error == GL_NO_ERROR);
-}
+	// Bind a specific vertex buffer to the device as a data source
+	if (s_stateCache.vertices(mesh.gl_id))
+	{
+		glBindVertexArray(mesh.gl_id);
+		assert(glGetError() == GL_NO_ERROR);
+	}
+	// Add the transforms to the mesh's vertex array, a row per attribute,
+	// each advancing once per instance. shaders that don't read them ignore them
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, s_instanceBufferId);
+		// a new store each time, so that the driver never waits on the last draw to finish with it
+		glBufferData(GL_ARRAY_BUFFER, count * sizeof(Matrix4), local2worlds, GL_STREAM_DRAW);
+		assert(glGetError() == GL_NO_ERROR);
 
-void eae6320::Graphics::SetRenderState( Effect::RenderState render_state )
-{
-	if (render_state.alpha)
+		const GLsizei stride = sizeof(Matrix4);
+		for (GLuint row = 0; row < 4; ++row)
+		{
+			// Rows of local2world (3 to 6)
+			// 4 floats == 16 bytes
+			// Offset = 16 * row
+			const GLuint vertexElementLocation = 3 + row;
+			const GLint elementCount = 4;
+			const GLboolean notNormalized = GL_FALSE;
+			GLvoid * offset = reinterpret_cast<GLvoid *>(row * 4 * sizeof(float));
+			glVertexAttribPointer(vertexElementLocation, elementCount, GL_FLOAT, notNormalized, stride, offset);
+			glEnableVertexAttribArray(vertexElementLocation);
+			glVertexAttribDivisor(vertexElementLocation, 1);
+		}
+		assert(glGetError() == GL_NO_ERROR);
+	}
+	// Render every instance from the current streams
 	{
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		const GLenum mode = GL_TRIANGLES;
+		const GLenum indexType = GL_UNSIGNED_INT;
+		const GLvoid* const offset = 0;
+		const GLsizei vertexCountToRender = mesh.num_triangles * 3;
+		glDrawElementsInstanced(mode, vertexCountToRender, indexType, offset, static_cast<GLsizei>(count));
+		const GLenum errorCode = glGetError();
+		assert(errorCode == GL_NO_ERROR);
 	}
-	else
+	// Take the transforms back off the mesh's vertex array, so that its plain draws
+	// don't keep reading a buffer the next instanced draw replaces
 	{
-		glDisable(GL_BLEND);
+		for (GLuint row = 0; row < 4; ++row)
+		{
+			const GLuint vertexElementLocation = 3 + row;
+			glVertexAttribDivisor(vertexElementLocation, 0);
+			glDisableVertexAttribArray(vertexElementLocation);
+		}
+		assert(glGetError() == GL_NO_ERROR);
 	}
-	assert(glGetError() == GL_NO_ERROR);
+}
+
 
-	if (render_state.z_test)
+void eae6320::Graphics::SetCamera( Effect & effect, Camera & camera )
+{
+	UpdateViewConstants(camera);
+
+	const Matrix4 & viewmat = s_viewConstants.world2view;
+	if (s_stateCache.uniform(effect.parent, effect.uni_world2view, &viewmat, sizeof(viewmat)))
 	{
-		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(GL_LEQUAL);
+		const GLfloat * mat2 = reinterpret_cast<const GLfloat *>(&viewmat);
+		glUniformMatrix4fv(effect.uni_world2view, 1, false, mat2);
+		assert(glGetError() == GL_NO_ERROR);
 	}
-	else
+
+	const Matrix4 & screenmat = s_frameConstants.view2screen;
+	if (s_stateCache.uniform(effect.parent, effect.uni_view2screen, &screenmat, sizeof(screenmat)))
 	{
-		glDisable(GL_DEPTH_TEST);
+		const GLfloat * mat3 = reinterpret_cast<const GLfloat *>(&screenmat);
+		glUniformMatrix4fv(effect.uni_view2screen, 1, false, mat3);
+		assert(glGetError() == GL_NO_ERROR);
 	}
-	assert(glGetError() == GL_NO_ERROR);
+}
+
+void eae6320::Graphics::SetRenderState( Effect::RenderState render_state )
+{
+	uint8_t changes = s_stateCache.render_state(render_state);
 
-	if (render_state.z_write)
+	if (changes & StateCache::Alpha)
 	{
-		glDepthMask(GL_TRUE);
+		if (render_state.alpha)
+		{
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		}
+		else
+		{
+			glDisable(GL_BLEND);
+		}
+		assert(glGetError() == GL_NO_ERROR);
 	}
-	else
+
+	if (changes & StateCache::ZTest)
 	{
-		glDepthMask(GL_FALSE);
+		if (render_state.z_test)
+		{
+			glEnable(GL_DEPTH_TEST);
+			glDepthFunc(GL_LEQUAL);
+		}
+		else
+		{
+			glDisable(GL_DEPTH_TEST);
+		}
+		assert(glGetError() == GL_NO_ERROR);
 	}
-	assert(glGetError() == GL_NO_ERROR);
 
-	if (render_state.cull_back)
+	if (changes & StateCache::ZWrite)
 	{
-		glEnable(GL_CULL_FACE);
-		glFrontFace(GL_CCW);
+		if (render_state.z_write)
+		{
+			glDepthMask(GL_TRUE);
+		}
+		else
+		{
+			glDepthMask(GL_FALSE);
+		}
+		assert(glGetError() == GL_NO_ERROR);
 	}
-	else
+
+	if (changes & StateCache::CullBack)
 	{
-		glDisable(GL_CULL_FACE);
+		if (render_state.cull_back)
+		{
+			glEnable(GL_CULL_FACE);
+			glFrontFace(GL_CCW);
+		}
+		else
+		{
+			glDisable(GL_CULL_FACE);
+		}
+		assert(glGetError() == GL_NO_ERROR);
 	}
-	assert(glGetError() == GL_NO_ERROR);
 }
 
 void eae6320::Graphics::SetEffect(Effect & effect)
 {
 	SetRenderState(effect.render_state);
 
-	glUseProgram(effect.parent);
+	if (s_stateCache.program(effect.parent))
+		glUseProgram(effect.parent);
 }
 
 void eae6320::Graphics::SetTransform( Effect & effect, const Matrix4 local2world )
 {
-	const GLfloat * mat1 = reinterpret_cast<const GLfloat *>(&local2world);
-	glUniformMatrix4fv(effect.uni_local2world, 1, false, mat1);
-	assert(glGetError() == GL_NO_ERROR);
-
-	int viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
-	float aspect = static_cast<float>(viewport[2]) / static_cast<float>(viewport[3]);
-	float fov = std::atan(1.0f) * 4 / 3;
-	Matrix4 screenmat = ScreenTransform(fov, aspect, 0.1f, 100.0f);
-	const GLfloat * mat3 = reinterpret_cast<const GLfloat *>(&screenmat);
-	glUniformMatrix4fv(effect.uni_view2screen, 1, false, mat3);
-	assert(glGetError() == GL_NO_ERROR);
+	if (s_stateCache.uniform(effect.parent, effect.uni_local2world, &local2world, sizeof(local2world)))
+	{
+		const GLfloat * mat1 = reinterpret_cast<const GLfloat *>(&local2world);
+		glUniformMatrix4fv(effect.uni_local2world, 1, false, mat1);
+		assert(glGetError() == GL_NO_ERROR);
+	}
 }
 
 void eae6320::Graphics::Clear()
@@ -236,6 +353,8 @@ void eae6320::Graphics::Clear()
 
 void eae6320::Graphics::BeginFrame()
 {
+	s_stateCache.begin_frame();
+	UpdateFrameConstants();
 }
 
 void eae6320::Graphics::EndFrame()
@@ -248,6 +367,13 @@ bool eae6320::Graphics::ShutDown()
 {
 	bool wereThereErrors = false;
 
+	if ( s_instanceBufferId != 0 )
+	{
+		const GLsizei bufferCount = 1;
+		glDeleteBuffers( bufferCount, &s_instanceBufferId );
+		s_instanceBufferId = 0;
+	}
+
 	if ( s_openGlRenderingContext != NULL )
 	{
 		if ( wglMakeCurrent( s_deviceContext, NULL ) != FALSE )
@@ -301,6 +427,35 @@ namespace
 			0.0f, 0.0f, (2.0f * i_z_nearPlane * i_z_farPlane) * zDistanceScale, 0.0f);
 	}
 
+	void UpdateFrameConstants()
+	{
+		int viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		if (viewport[2] == s_frameConstants.width && viewport[3] == s_frameConstants.height)
+			return;
+
+		s_frameConstants.width = viewport[2];
+		s_frameConstants.height = viewport[3];
+		float aspect = static_cast<float>(viewport[2]) / static_cast<float>(viewport[3]);
+		float fov = std::atan(1.0f) * 4 / 3;
+		s_frameConstants.view2screen = ScreenTransform(fov, aspect, 0.1f, 100.0f);
+	}
+
+	void UpdateViewConstants( const Camera & i_camera )
+	{
+		const eae6320::Versor & q = i_camera.rotation, & known = s_viewConstants.rotation;
+		if (s_viewConstants.valid && i_camera.position == s_viewConstants.position
+			&& q.x == known.x && q.y == known.y && q.z == known.z && q.w == known.w)
+			return;
+
+		eae6320::Matrix4 viewmat = eae6320::Matrix4::Identity;
+		viewmat.vec3(3) = i_camera.position;
+		s_viewConstants.world2view = viewmat.dot(eae6320::Matrix4::rotation_q(i_camera.rotation));
+		s_viewConstants.position = i_camera.position;
+		s_viewConstants.rotation = i_camera.rotation;
+		s_viewConstants.valid = true;
+	}
+
 	bool CreateRenderingContext()
 	{
 		// A "device context" can be thought of an abstraction that Windows uses
@@ -8,14 +8,20 @@
 // Header Files
 //=============
 
+#if defined ( EAE6320_PLATFORM_NULL ) && !defined ( _WIN32 )
+// the null backend has no window to draw into
+typedef void * HWND;
+#else
 #include "../Windows/WindowsIncludes.h"
+#endif
 #include "Mesh.h"
 #include "Effect.h"
 #include "Model.h"
 #include "Camera.h"
 #include "Wireframe.h"
 #include "Sprite.h"
-#include "../Math/Matrix4.h"
+#include "StateCache.h"
+#include "../Math/Affine3.h"
 
 // Interface
 //==========
@@ -25,17 +31,22 @@ namespace eae6320
 	namespace Graphics
 	{
 		Effect::Parent GetDevice(); // used within Effect
+		StateCache & GetStateCache(); // used within Effect and Material; has the call counters
 
 		// must be called at startup
 		bool Initialize( const HWND i_renderingWindow );
 
 		/* used internally */
+		// the view and projection; both are rebuilt only when the camera or viewport changes
 		void SetCamera(Effect & effect, Camera & camera);
 		void SetRenderState(Effect::RenderState render_state);
 		void SetEffect(Effect & effect);
 		void SetMaterial(Material & material);
+		// the model transform alone; SetCamera sets the rest
 		void SetTransform(Effect & effect, const Matrix4 local2world);
 		void DrawMesh( Mesh & mesh );
+		// one draw of count copies of mesh, for an effect's instanced vertex shader
+		void DrawMeshInstanced( Mesh & mesh, const Matrix4 * local2worlds, uint32_t count );
 		bool LoadMesh( Mesh & output, Mesh::Data & input );
 		void DrawSprite(Sprite & sprite);
 		void DrawSpriteQuad(Sprite & sprite);
@@ -0,0 +1,310 @@
+// Header Files
+//=============
+
+#include "stdafx.h"
+
+#include "Graphics.h"
+#include "NullDevice.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+// Static Data Initialization
+//===========================
+
+namespace
+{
+	eae6320::Graphics::NullDevice s_device;
+	// uniforms are kept per effect, as by GL programs
+	eae6320::Graphics::StateCache s_stateCache(true);
+
+	// the projection changes only with the viewport, so it is built once a frame;
+	// the view only with the camera, so once per camera. draws set neither
+	struct FrameConstants
+	{
+		uint32_t width, height;
+		eae6320::Matrix4 view2screen;
+	} s_frameConstants;
+	struct ViewConstants
+	{
+		bool valid;
+		eae6320::Vector3 position;
+		eae6320::Versor rotation;
+		eae6320::Matrix4 world2view;
+	} s_viewConstants;
+	// what the shaders would be given, for the rasterizer
+	eae6320::Matrix4 s_local2world;
+}
+
+// Helper Function Declarations
+//=============================
+
+namespace
+{
+	using namespace eae6320::Graphics;
+
+	eae6320::Matrix4 ScreenTransform(
+		const float i_fieldOfView_y, const float i_aspectRatio,
+		const float i_z_nearPlane, const float i_z_farPlane);
+	void SetMatrix(Effect & effect, Effect::UniformHandle handle, const eae6320::Matrix4 & matrix);
+	void UpdateFrameConstants();
+	void UpdateViewConstants( const Camera & i_camera );
+}
+
+// Interface
+//==========
+
+eae6320::Graphics::NullDevice::NullDevice()
+	: recording(false), counters(), width(1280), height(720), rasterizer(NULL),
+	world2screen(Matrix4::Identity), last_id(0)
+{
+}
+
+uint32_t eae6320::Graphics::NullDevice::next_id()
+{
+	return ++last_id;
+}
+
+void eae6320::Graphics::NullDevice::record(Op op, uint32_t object, uint32_t count)
+{
+	if (!recording)
+		return;
+	Command command = { op, object, count };
+	commands.push_back(command);
+}
+
+void eae6320::Graphics::NullDevice::clear()
+{
+	commands.clear();
+	counters = Counters();
+}
+
+NullDevice & eae6320::Graphics::GetNullDevice()
+{
+	return s_device;
+}
+
+Effect::Parent eae6320::Graphics::GetDevice()
+{
+	return 0;
+}
+
+StateCache & eae6320::Graphics::GetStateCache()
+{
+	return s_stateCache;
+}
+
+bool eae6320::Graphics::LoadMesh(Mesh & output, Mesh::Data & input)
+{
+	output.null_id = s_device.next_id();
+	output.num_vertices = input.num_vertices;
+	output.num_triangles = input.num_triangles;
+
+	delete[] output.null_vertices;
+	delete[] output.null_indices;
+	output.null_vertices = new Mesh::Vertex[input.num_vertices];
+	output.null_indices = new Mesh::Index[3 * input.num_triangles];
+	std::copy(input.vertices, input.vertices + input.num_vertices, output.null_vertices);
+	std::copy(input.indices, input.indices + 3 * input.num_triangles, output.null_indices);
+	s_device.record(NullDevice::LoadMesh, output.null_id, output.num_triangles);
+	return true;
+}
+
+bool eae6320::Graphics::Initialize( const HWND )
+{
+	s_stateCache.invalidate();
+	s_viewConstants.valid = false;
+	return true;
+}
+
+void eae6320::Graphics::DrawMesh( Mesh & mesh )
+{
+	s_stateCache.vertices(mesh.null_id);
+	s_device.record(NullDevice::DrawMesh, mesh.null_id, mesh.num_triangles);
+	++s_device.counters.draws;
+	s_device.counters.triangles += mesh.num_triangles;
+
+	if (s_device.rasterizer)
+		s_device.rasterizer->draw(mesh.null_vertices, mesh.num_vertices, mesh.null_indices, mesh.num_triangles,
+			s_local2world.dot(s_device.world2screen), s_device.shading);
+}
+
+void eae6320::Graphics::DrawMeshInstanced( Mesh & mesh, const Matrix4 * local2worlds, uint32_t count )
+{
+	s_stateCache.vertices(mesh.null_id);
+	s_device.record(NullDevice::DrawMeshInstanced, mesh.null_id, count);
+	++s_device.counters.draws;
+	s_device.counters.instances += count;
+	s_device.counters.triangles += mesh.num_triangles * count;
+
+	if (s_device.rasterizer)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			s_device.rasterizer->draw(mesh.null_vertices, mesh.num_vertices, mesh.null_indices, mesh.num_triangles,
+				local2worlds[i].dot(s_device.world2screen), s_device.shading);
+	}
+}
+
+void eae6320::Graphics::DrawSpriteQuad(Sprite &)
+{
+	s_device.record(NullDevice::DrawSprite);
+	++s_device.counters.draws;
+	s_device.counters.triangles += 2;
+}
+
+#ifdef _DEBUG
+bool eae6320::Graphics::InitWireframe(Wireframe & wireframe)
+{
+	wireframe.mesh->null_id = s_device.next_id();
+	wireframe.mesh->num_vertices = 0;
+	return true;
+}
+
+bool eae6320::Graphics::BufferWireframe(Wireframe & wireframe)
+{
+	Mesh & mesh = *wireframe.mesh;
+	mesh.num_triangles = static_cast<uint32_t>(wireframe.num_lines);
+	mesh.num_vertices = static_cast<uint32_t>(2 * wireframe.num_lines);
+	return true;
+}
+
+void eae6320::Graphics::DrawWireMesh(Mesh & mesh)
+{
+	s_stateCache.vertices(mesh.null_id);
+	s_device.record(NullDevice::DrawWireMesh, mesh.null_id, mesh.num_triangles);
+	++s_device.counters.draws;
+}
+
+int eae6320::Graphics::DrawDebugText(int, int, std::string &)
+{
+	return 0;
+}
+#endif
+
+void eae6320::Graphics::SetCamera( Effect & effect, Camera & camera )
+{
+	UpdateViewConstants(camera);
+	s_device.world2screen = s_viewConstants.world2view.dot(s_frameConstants.view2screen);
+	SetMatrix(effect, effect.uni_world2view, s_viewConstants.world2view);
+	SetMatrix(effect, effect.uni_view2screen, s_frameConstants.view2screen);
+}
+
+void eae6320::Graphics::SetRenderState( Effect::RenderState render_state )
+{
+	s_device.shading.state = render_state;
+	uint8_t changes = s_stateCache.render_state(render_state);
+	if (changes)
+		s_device.record(NullDevice::SetRenderState, 0, changes);
+}
+
+void eae6320::Graphics::SetEffect(Effect & effect)
+{
+	SetRenderState(effect.render_state);
+
+	if (s_stateCache.program(effect.parent))
+		s_device.record(NullDevice::SetEffect, effect.parent);
+}
+
+void eae6320::Graphics::SetTransform( Effect & effect, const Matrix4 local2world )
+{
+	s_local2world = local2world;
+	SetMatrix(effect, effect.uni_local2world, local2world);
+}
+
+void eae6320::Graphics::Clear()
+{
+	s_device.record(NullDevice::Clear);
+	if (s_device.rasterizer)
+		s_device.rasterizer->clear(0xff000000);
+}
+
+void eae6320::Graphics::BeginFrame()
+{
+	s_stateCache.begin_frame();
+	if (s_device.rasterizer)
+	{
+		s_device.width = s_device.rasterizer->width;
+		s_device.height = s_device.rasterizer->height;
+	}
+	UpdateFrameConstants();
+	s_device.record(NullDevice::BeginFrame);
+}
+
+void eae6320::Graphics::EndFrame()
+{
+	s_device.record(NullDevice::EndFrame);
+	++s_device.counters.frames;
+	if (s_device.rasterizer)
+		s_device.rasterizer->flush();
+}
+
+bool eae6320::Graphics::ShutDown()
+{
+	s_device.clear();
+	s_device.shading = Rasterizer::Shading();
+	s_device.textures.clear();
+	return true;
+}
+
+// Helper Function Definitions
+//============================
+
+namespace
+{
+	eae6320::Matrix4 ScreenTransform(
+		const float i_fieldOfView_y, const float i_aspectRatio,
+		const float i_z_nearPlane, const float i_z_farPlane)
+	{
+		const float yScale = 1.0f / std::tan(i_fieldOfView_y * 0.5f);
+		const float xScale = yScale / i_aspectRatio;
+		const float zDistanceScale = i_z_farPlane / (i_z_nearPlane - i_z_farPlane);
+		return eae6320::Matrix4(
+			xScale, 0.0f, 0.0f, 0.0f,
+			0.0f, yScale, 0.0f, 0.0f,
+			0.0f, 0.0f, zDistanceScale, -1.0f,
+			0.0f, 0.0f, i_z_nearPlane * zDistanceScale, 0.0f);
+	}
+
+	void SetMatrix(Effect & effect, Effect::UniformHandle handle, const eae6320::Matrix4 & matrix)
+	{
+		// as GL ignores location -1: sprites have no transforms, instanced effects no local2world
+		if (handle == INVALID_UNIFORM_HANDLE)
+			return;
+		if (s_stateCache.uniform(effect.parent, handle, &matrix, sizeof(matrix)))
+		{
+			s_device.record(NullDevice::SetUniform, effect.parent, 16);
+			++s_device.counters.uniforms;
+		}
+	}
+
+	void UpdateFrameConstants()
+	{
+		uint32_t width = s_device.width;
+		uint32_t height = s_device.height;
+		if (width == s_frameConstants.width && height == s_frameConstants.height)
+			return;
+
+		s_frameConstants.width = width;
+		s_frameConstants.height = height;
+		float fov = std::atan(1.0f) * 4 / 3;
+		s_frameConstants.view2screen = ScreenTransform(fov,
+			static_cast<float>(width) / static_cast<float>(height), 0.1f, 100.0f);
+	}
+
+	void UpdateViewConstants( const Camera & i_camera )
+	{
+		const eae6320::Versor & q = i_camera.rotation, & known = s_viewConstants.rotation;
+		if (s_viewConstants.valid && i_camera.position == s_viewConstants.position
+			&& q.x == known.x && q.y == known.y && q.z == known.z && q.w == known.w)
+			return;
+
+		eae6320::Matrix4 viewmat = eae6320::Matrix4::Identity;
+		viewmat.vec3(3) = -i_camera.position;
+		s_viewConstants.world2view = viewmat.dot(eae6320::Matrix4::rotation_q(i_camera.rotation.inverse()));
+		s_viewConstants.position = i_camera.position;
+		s_viewConstants.rotation = i_camera.rotation;
+		s_viewConstants.valid = true;
+	}
+}
@@ -1,15 +1,23 @@
 #include "stdafx.h"
 #include "Material.h"
+#include "Graphics.h"
 
 #include <stdio.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sstream>
+#include <fstream>
+#include <cstring>
+#include <vector>
 #include <assert.h>
 #include <algorithm>
 #include "../Debug_Runtime/UserOutput.h"
+#if defined( EAE6320_PLATFORM_NULL )
+#include "NullDevice.h"
+#else
 #include "../Windows/WindowsFunctions.h"
+#endif
 
 namespace
 {
@@ -17,7 +25,7 @@ namespace
 		const char * texture_path,
 		eae6320::Graphics::Effect::Parent parent = 0);
 	eae6320::Graphics::Material::Sampler GetSampler(
-		eae6320::Graphics::Material & material,
+		eae6320::Graphics::Effect & effect,
 		eae6320::Graphics::Effect::UniformHandle handle);
 }
 
@@ -25,22 +33,32 @@ namespace eae6320
 {
 namespace Graphics
 {
-	bool Material::SetParams()
+	bool Material::SetParams(bool instanced)
 	{
+		assert(!instanced || instanced_params);
+		Effect & target = instanced ? *effect->instanced : *effect;
+		UniformParameter * values = instanced ? instanced_params : params;
+#if defined( EAE6320_PLATFORM_NULL )
+		// a material that leaves out g_tint, g_alpha or g_tex doesn't take the last one's
+		Rasterizer::Shading & shading = GetNullDevice().shading;
+		shading.tint[0] = shading.tint[1] = shading.tint[2] = shading.alpha = 1.0f;
+		shading.texture = NULL;
+#endif
+
 		for (size_t i = 0; i < num_params; ++i) {
-			if (params[i].vec_length == 0)
+			if (values[i].vec_length == 0)
 			{
-				Sampler samp = *reinterpret_cast<Sampler *>(&params[i].handle);
-				TextureHandle tex = *reinterpret_cast<TextureHandle *>(params[i].vec);
-				TextureUnit unit = *reinterpret_cast<TextureUnit *>(params[i].vec + 2);
+				Sampler samp = *reinterpret_cast<Sampler *>(&values[i].handle);
+				TextureHandle tex = *reinterpret_cast<TextureHandle *>(values[i].vec);
+				TextureUnit unit = *reinterpret_cast<TextureUnit *>(values[i].vec + 2);
 
-				SetTexture(samp, tex, unit);
+				SetTexture(target, samp, tex, unit);
 			}
-			else if (!effect->SetVec(
-					params[i].handle,
-					params[i].shaderType,
-					params[i].vec,
-					params[i].vec_length))
+			else if (!target.SetVec(
+					values[i].handle,
+					values[i].shaderType,
+					values[i].vec,
+					values[i].vec_length))
 				return false;
 		}
 
@@ -49,10 +67,9 @@ namespace Graphics
 
 	Material * Material::FromFile(const char * materialPath, Effect::Parent parent)
 	{
-		HANDLE infile = CreateFile(materialPath, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, 0);
-		FILE_STANDARD_INFO info;
+		std::ifstream infile(materialPath, std::ifstream::binary | std::ifstream::ate);
 
-		if (infile == INVALID_HANDLE_VALUE)
+		if (infile.fail())
 		{
 			std::stringstream errstr;
 			errstr << "Could not open path " << materialPath << "\n";
@@ -60,32 +77,21 @@ namespace Graphics
 			return NULL;
 		}
 
-		if (!GetFileInformationByHandleEx(infile, FileStandardInfo, &info, sizeof(info)))
-		{
-			std::stringstream errstr;
-			errstr << "Failed to get file info for " << materialPath << ": "
-				<< GetLastError() << "\n";
-			UserOutput::Print(errstr.str(), __FILE__);
-			return NULL;
-		}
-
-		DWORD total_bytes = static_cast<DWORD>(info.EndOfFile.QuadPart);
-		DWORD bytes_read;
+		std::vector<char> buf(static_cast<size_t>(infile.tellg()));
+		infile.seekg(0);
+		infile.read(buf.data(), buf.size());
 
-		char * buf = new char[total_bytes];
-
-		if (!ReadFile(infile, buf, total_bytes, &bytes_read, NULL)
-			|| bytes_read != total_bytes)
+		if (infile.fail())
 		{
 			std::stringstream errstr;
-			errstr << "Failed to read " << materialPath << ": "
-				<< GetLastError() << "\n";
+			errstr << "Failed to read " << materialPath << "\n";
 			UserOutput::Print(errstr.str(), __FILE__);
 			return NULL;
 		}
 
 		Material * mat = new Material();
-		char * scanptr = buf;
+		char * scanptr = buf.data();
+		unsigned int texture_unit = 0;
 
 		uint16_t effect_path_len = *reinterpret_cast<uint16_t *>(scanptr);
 		scanptr += sizeof(effect_path_len);
@@ -106,7 +112,12 @@ namespace Graphics
 		memcpy(mat->params, scanptr, num_params * sizeof(Material::UniformParameter));
 		scanptr += num_params * sizeof(Material::UniformParameter);
 
-		unsigned int texture_unit = 0;
+		if (mat->effect->instanced)
+		{
+			mat->instanced_params = new Material::UniformParameter[num_params];
+			memcpy(mat->instanced_params, mat->params, num_params * sizeof(Material::UniformParameter));
+		}
+
 		for (size_t i = 0; i < num_params; ++i)
 		{
 			Material::UniformParameter & param = mat->params[i];
@@ -127,10 +138,26 @@ namespace Graphics
 				// but it easily allows for multiple samplers
 				*reinterpret_cast<TextureHandle *>(mat->params[i].vec) = LoadTexture(texture_path, parent);
 				*reinterpret_cast<TextureUnit *>(mat->params[i].vec + 2) = texture_unit++;
-				*reinterpret_cast<Sampler *>(&mat->params[i].handle) = GetSampler(*mat, handle);
+				*reinterpret_cast<Sampler *>(&mat->params[i].handle) = GetSampler(*mat->effect, handle);
 			}
 			else
 				mat->params[i].handle = handle;
+
+			if (mat->instanced_params)
+			{
+				// same values and textures, looked up in the other program
+				Material::UniformParameter & instanced = mat->instanced_params[i];
+				handle = mat->effect->instanced->GetUniformHandle(param_name, param.shaderType);
+
+				if (handle == INVALID_UNIFORM_HANDLE)
+					goto OnError;
+
+				memcpy(instanced.vec, param.vec, sizeof(param.vec));
+				if (param.vec_length == 0)
+					*reinterpret_cast<Sampler *>(&instanced.handle) = GetSampler(*mat->effect->instanced, handle);
+				else
+					instanced.handle = handle;
+			}
 		}
 
 		return mat;
@@ -140,33 +167,59 @@ namespace Graphics
 		return NULL;
 	}
 
-	bool eae6320::Graphics::Material::SetTexture(Sampler samp, TextureHandle tex, TextureUnit unit)
+	bool eae6320::Graphics::Material::SetTexture(Effect & target, Sampler samp, TextureHandle tex, TextureUnit unit)
 	{
+		StateCache & cache = GetStateCache();
 #if defined( EAE6320_PLATFORM_GL )
-		GLenum error;
-
-		glActiveTexture(GL_TEXTURE0 + unit);
-		error = glGetError();
-		assert(error == GL_NO_ERROR);
-		if (error != GL_NO_ERROR)
-			return false;
-
-		glBindTexture(GL_TEXTURE_2D, tex);
-		error = glGetError();
-		assert(error == GL_NO_ERROR);
-		if (error != GL_NO_ERROR)
-			return false;
-
-		glUniform1i(samp, unit);
-		error = glGetError();
-		assert(error == GL_NO_ERROR);
-		if (error != GL_NO_ERROR)
-			return false;
+		// one error check covers whichever calls were made
+		bool issued = false;
+
+		if (cache.texture(unit, tex))
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(GL_TEXTURE_2D, tex);
+			issued = true;
+		}
+
+		GLint sampler_unit = static_cast<GLint>(unit);
+		if (cache.uniform(target.parent, samp, &sampler_unit, sizeof(sampler_unit)))
+		{
+			glUniform1i(samp, sampler_unit);
+			issued = true;
+		}
+
+		if (issued)
+		{
+			GLenum error = glGetError();
+			assert(error == GL_NO_ERROR);
+			if (error != GL_NO_ERROR)
+				return false;
+		}
 #elif defined( EAE6320_PLATFORM_D3D )
-		HRESULT result = this->effect->parent->SetTexture(samp, tex);
-		assert(SUCCEEDED(result));
-		if (!SUCCEEDED(result))
-			return false;
+		if (cache.texture(samp, reinterpret_cast<uintptr_t>(tex)))
+		{
+			HRESULT result = target.parent->SetTexture(samp, tex);
+			assert(SUCCEEDED(result));
+			if (!SUCCEEDED(result))
+				return false;
+		}
+#elif defined( EAE6320_PLATFORM_NULL )
+		// there's no program for the sampler uniform to be set on
+		(void)target;
+		(void)samp;
+		NullDevice & device = GetNullDevice();
+		// every shader samples only g_tex
+		if (unit == 0)
+		{
+			auto found = device.textures.find(tex);
+			device.shading.texture = found != device.textures.end() ? &found->second : NULL;
+		}
+
+		if (cache.texture(unit, tex))
+		{
+			device.record(NullDevice::SetTexture, tex, unit);
+			++device.counters.textures;
+		}
 #endif
 		return true;
 	}
@@ -175,6 +228,7 @@ namespace Graphics
 	{
 		delete effect;
 		delete[] params;
+		delete[] instanced_params;
 	}
 }
 }
@@ -269,6 +323,8 @@ namespace
 			{
 				// This code only supports 2D textures;
 				// if you want to support other types you will need to improve this code.
+				// binding it replaces whatever the cache thinks the active unit holds
+				eae6320::Graphics::GetStateCache().invalidate();
 				glBindTexture(GL_TEXTURE_2D, o_texture);
 				const GLenum errorCode = glGetError();
 				if (errorCode != GL_NO_ERROR)
@@ -439,7 +495,7 @@ namespace
 		return o_texture;
 	}
 
-	GLint GetSampler(eae6320::Graphics::Material & material, GLint handle)
+	GLint GetSampler(eae6320::Graphics::Effect & effect, GLint handle)
 	{
 		return handle;
 	}
@@ -469,9 +525,40 @@ namespace
 		return handle;
 	}
 
-	DWORD GetSampler(eae6320::Graphics::Material & material, D3DXHANDLE handle)
+	DWORD GetSampler(eae6320::Graphics::Effect & effect, D3DXHANDLE handle)
+	{
+		return effect.fragment_shader.second->GetSamplerIndex(handle);
+	}
+
+#elif defined ( EAE6320_PLATFORM_NULL )
+	uint32_t LoadTexture(
+		const char * texture_path,
+		uint32_t)
+	{
+		eae6320::Graphics::NullDevice & device = eae6320::Graphics::GetNullDevice();
+		uint32_t texture = device.next_id();
+		device.record(eae6320::Graphics::NullDevice::LoadTexture, texture);
+
+		if (device.rasterizer)
+		{
+			std::ifstream infile(texture_path, std::ifstream::binary | std::ifstream::ate);
+			std::vector<char> contents(infile.fail() ? 0 : static_cast<size_t>(infile.tellg()));
+			infile.seekg(0);
+			infile.read(contents.data(), contents.size());
+			if (!device.textures[texture].FromDds(contents.data(), contents.size()))
+			{
+				std::stringstream ss;
+				ss << "The texture file \"" << texture_path << "\" couldn't be decoded; it will draw as white";
+				eae6320::UserOutput::Print(ss.str().c_str(), __FILE__);
+				device.textures.erase(texture);
+			}
+		}
+		return texture;
+	}
+
+	uint32_t GetSampler(eae6320::Graphics::Effect &, intptr_t handle)
 	{
-		return material.effect->fragment_shader.second->GetSamplerIndex(handle);
+		return static_cast<uint32_t>(handle);
 	}
 #endif
 }
\ No newline at end of file
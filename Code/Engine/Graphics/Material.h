@@ -14,6 +14,8 @@ namespace Graphics
 			GLuint
 #elif defined( EAE6320_PLATFORM_D3D )
 			LPDIRECT3DTEXTURE9
+#elif defined( EAE6320_PLATFORM_NULL )
+			uint32_t
 #endif
 			TextureHandle;
 
@@ -22,6 +24,8 @@ namespace Graphics
 			GLint
 #elif defined( EAE6320_PLATFORM_D3D )
 			DWORD
+#elif defined( EAE6320_PLATFORM_NULL )
+			uint32_t
 #endif
 			Sampler;
 
@@ -47,11 +51,14 @@ namespace Graphics
 
 		Effect * effect;
 		UniformParameter * params;
+		// params resolved against effect->instanced, whose handles differ; NULL without it
+		UniformParameter * instanced_params;
 		uint16_t num_params;
 
 		static Material * FromFile(const char * materialPath, Effect::Parent parent = 0);
-		bool SetParams();
-		bool SetTexture(Sampler samp, TextureHandle tex, TextureUnit unit);
+		// sets the params of effect, or of effect->instanced
+		bool SetParams(bool instanced = false);
+		bool SetTexture(Effect & target, Sampler samp, TextureHandle tex, TextureUnit unit);
 
 		~Material();
 	};
@@ -95,7 +95,7 @@ namespace {
 			float y = static_cast<float>(xyz[1]);
 			vertices[i].position.y = y;
 			if (y < data->bounds.vmin.y) data->bounds.vmin.y = y;
-			if (x > data->bounds.vmax.y) data->bounds.vmax.y = y;
+			if (y > data->bounds.vmax.y) data->bounds.vmax.y = y;
 
 			float z = static_cast<float>(xyz[2]);
 			vertices[i].position.z = z;
@@ -245,6 +245,7 @@ namespace {
 		assert(indices == NULL);
 
 		int numIndices = -1;
+		int numPolygons;
 		int depth = 0;
 
 		char const * const key = "indices";
@@ -260,7 +261,7 @@ namespace {
 			goto OnExit;
 		}
 
-		const int numPolygons = luaL_len(&luaState, -1);
+		numPolygons = luaL_len(&luaState, -1);
 		numIndices = numPolygons * numVerticesPerPolygon;
 		indices = new Mesh::Index[numIndices];
 
@@ -408,6 +409,7 @@ namespace Graphics
 	Mesh::Data * Mesh::Data::FromLuaFile(const char* path)
 	{
 		Mesh::Data * meshData = NULL;
+		int depth = 0; // depth of stack, how many things to pop
 
 		// Create a new Lua state
 		lua_State* luaState = NULL;
@@ -420,8 +422,6 @@ namespace Graphics
 			}
 		}
 
-		int depth = 0; // depth of stack, how many things to pop
-
 		// Load the asset file as a "chunk",
 		// meaning there will be a callable function at the top of the stack
 		{
@@ -519,6 +519,12 @@ namespace Graphics
 			}
 		}
 	}
+#elif defined ( EAE6320_PLATFORM_NULL )
+	Mesh::~Mesh()
+	{
+		delete[] null_vertices;
+		delete[] null_indices;
+	}
 #endif
 }
 }
\ No newline at end of file
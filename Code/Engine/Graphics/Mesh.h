@@ -13,8 +13,9 @@
 #include "OpenGLExtensions\OpenGlExtensions.h"
 #elif defined ( EAE6320_PLATFORM_D3D )
 #include <d3d9.h>
+#elif defined ( EAE6320_PLATFORM_NULL )
 #else
-#error "one of EAE6320_PLATFORM_GL or EAE6320_PLATFORM_D3D must be defined."
+#error "one of EAE6320_PLATFORM_GL, EAE6320_PLATFORM_D3D or EAE6320_PLATFORM_NULL must be defined."
 #endif
 #include <cstdint>
 
@@ -39,7 +40,7 @@ namespace Graphics
 			// Offset = 24
 #if defined ( EAE6320_PLATFORM_GL )
 			uint8_t r, g, b, a; // OpenGL expects the byte layout of a color to be pretty much what you'd expect
-#elif defined ( EAE6320_PLATFORM_D3D )
+#elif defined ( EAE6320_PLATFORM_D3D ) || defined ( EAE6320_PLATFORM_NULL )
 			uint8_t b, g, r, a;	// Direct3D expects the byte layout of a color to be different from what you might expect
 #endif
 			// TEXCOORDS0
@@ -76,6 +77,11 @@ namespace Graphics
 #elif defined ( EAE6320_PLATFORM_D3D )
 		IDirect3DVertexBuffer9 * vertex_buffer;
 		IDirect3DIndexBuffer9 * index_buffer;
+#elif defined ( EAE6320_PLATFORM_NULL )
+		uint32_t null_id;
+		// copies, for a rasterizer to draw from
+		Vertex * null_vertices;
+		Index * null_indices;
 #endif
 
 		~Mesh();
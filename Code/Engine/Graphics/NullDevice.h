@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Rasterizer.h"
+#include "../Math/Matrix4.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace eae6320
+{
+namespace Graphics
+{
+// what the null backend (EAE6320_PLATFORM_NULL, Graphics.null.cpp) was asked to do, in place
+// of a GPU. everything above the device calls runs as with GL or D3D, so the CPU cost of
+// rendering can be measured and checked without a window or a graphics API.
+// it reads assets built for Direct3D: the same vertex colors and material handle size.
+// with a rasterizer attached, draws are also rendered by it.
+struct NullDevice
+{
+	enum Op : uint8_t
+	{
+		LoadMesh,			// object is the mesh, count its triangles
+		LoadTexture,		// object is the texture
+		BeginFrame,
+		Clear,
+		SetEffect,			// object is the effect
+		SetRenderState,		// count is the changed StateCache::RenderFlags
+		SetUniform,			// object is the effect, count the floats set
+		SetTexture,			// object is the texture, count the unit
+		DrawMesh,			// object is the mesh, count its triangles
+		DrawMeshInstanced,	// object is the mesh, count the instances
+		DrawSprite,
+		DrawWireMesh,		// count is the lines
+		EndFrame,
+	};
+
+	struct Command
+	{
+		Op op;
+		uint32_t object;
+		uint32_t count;
+	};
+
+	struct Counters
+	{
+		uint32_t frames, draws, instances, triangles, uniforms, textures;
+	};
+
+	// kept only while recording, for a test to look through; the counters always are
+	bool recording;
+	std::vector<Command> commands;
+	Counters counters;
+
+	// the viewport the projection is built for; the rasterizer's size, when there is one
+	uint32_t width, height;
+
+	// not owned. meshes are drawn into it, cleared by Clear() and flushed by EndFrame();
+	// textures are decoded for it only if it's attached when they load
+	Rasterizer * rasterizer;
+	// what the fragment shaders would have: g_tex's texture, g_tint, g_alpha and the render state
+	Rasterizer::Shading shading;
+	std::unordered_map<uint32_t, Rasterizer::Texture> textures;
+	// the last camera's, for Rasterizer::visible()
+	Matrix4 world2screen;
+
+	// numbers meshes, textures and effects as they're created; 0 is none
+	uint32_t next_id();
+	void record(Op op, uint32_t object = 0, uint32_t count = 0);
+	void clear();
+
+	NullDevice();
+
+private:
+	uint32_t last_id;
+};
+
+NullDevice & GetNullDevice();
+}
+}
@@ -0,0 +1,921 @@
+#include "stdafx.h"
+
+#include "Rasterizer.h"
+#include "../Math/Parallel.h"
+#include "../Math/Simd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace eae6320
+{
+namespace Graphics
+{
+
+namespace
+{
+	const int32_t SUBPIXEL = 16;
+	// triangles are clipped this many pixels from the screen's center, which with MAXSIZE
+	// keeps snapped coordinates within 2^17 subpixels and a tile's edge values within 2^30
+	const float GUARDBAND = 4096.0f;
+
+	enum Outcode : uint8_t
+	{
+		Left = 1 << 0,
+		Right = 1 << 1,
+		Bottom = 1 << 2,
+		Top = 1 << 3,
+		Near = 1 << 4,
+		Far = 1 << 5,
+		Guard = 1 << 6,
+		Frustum = Left | Right | Bottom | Top | Near | Far,
+	};
+
+	// Direct3D clip space: x and y within w, z within 0 and w
+	uint8_t outcode(const Vector4 & p, float guard_x, float guard_y)
+	{
+		uint8_t code = 0;
+		if (p.x < -p.w)
+			code |= Left;
+		if (p.x > p.w)
+			code |= Right;
+		if (p.y < -p.w)
+			code |= Bottom;
+		if (p.y > p.w)
+			code |= Top;
+		if (p.z < 0.0f)
+			code |= Near;
+		if (p.z > p.w)
+			code |= Far;
+		if (fabsf(p.x) > guard_x * p.w || fabsf(p.y) > guard_y * p.w)
+			code |= Guard;
+		return code;
+	}
+
+	int32_t floor_div(int32_t n, int32_t d)
+	{
+		return n >= 0 ? n / d : -((-n + d - 1) / d);
+	}
+
+	uint32_t pack(float r, float g, float b, float a)
+	{
+		uint32_t r8 = static_cast<uint32_t>(std::min(std::max(r, 0.0f), 1.0f) * 255.0f + 0.5f);
+		uint32_t g8 = static_cast<uint32_t>(std::min(std::max(g, 0.0f), 1.0f) * 255.0f + 0.5f);
+		uint32_t b8 = static_cast<uint32_t>(std::min(std::max(b, 0.0f), 1.0f) * 255.0f + 0.5f);
+		uint32_t a8 = static_cast<uint32_t>(std::min(std::max(a, 0.0f), 1.0f) * 255.0f + 0.5f);
+		return (a8 << 24) | (r8 << 16) | (g8 << 8) | b8;
+	}
+
+	// rgba, 0 to 1
+	void unpack(uint32_t color, float * out)
+	{
+		const float scale = 1.0f / 255.0f;
+		out[0] = ((color >> 16) & 0xff) * scale;
+		out[1] = ((color >> 8) & 0xff) * scale;
+		out[2] = (color & 0xff) * scale;
+		out[3] = (color >> 24) * scale;
+	}
+
+	// bilinear, wrapping
+	void sample(const Rasterizer::Texture & texture, float u, float v, float * out)
+	{
+		if (!(u == u && v == v))
+			u = v = 0.0f;
+		float x = (u - floorf(u)) * texture.width - 0.5f;
+		float y = (v - floorf(v)) * texture.height - 0.5f;
+		float fx = floorf(x), fy = floorf(y);
+		float wx = x - fx, wy = y - fy;
+
+		int32_t w = static_cast<int32_t>(texture.width), h = static_cast<int32_t>(texture.height);
+		int32_t x0 = static_cast<int32_t>(fx), y0 = static_cast<int32_t>(fy);
+		int32_t x1 = x0 + 1, y1 = y0 + 1;
+		x0 = x0 < 0 ? w - 1 : x0;
+		y0 = y0 < 0 ? h - 1 : y0;
+		x1 = x1 >= w ? 0 : x1;
+		y1 = y1 >= h ? 0 : y1;
+
+		float t00[4], t10[4], t01[4], t11[4];
+		unpack(texture.texels[y0 * w + x0], t00);
+		unpack(texture.texels[y0 * w + x1], t10);
+		unpack(texture.texels[y1 * w + x0], t01);
+		unpack(texture.texels[y1 * w + x1], t11);
+		for (size_t i = 0; i < 4; ++i)
+		{
+			float top = t00[i] + (t10[i] - t00[i]) * wx;
+			float bottom = t01[i] + (t11[i] - t01[i]) * wx;
+			out[i] = top + (bottom - top) * wy;
+		}
+	}
+
+	// the fragment shaders' texture * vertex color * tint, blended over dst when alpha is on
+	uint32_t shade(const Rasterizer::Shading & shading, float u, float v, const float * color, uint32_t dst)
+	{
+		float texel[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		if (shading.texture)
+			sample(*shading.texture, u, v, texel);
+
+		float r = texel[0] * color[0] * shading.tint[0];
+		float g = texel[1] * color[1] * shading.tint[1];
+		float b = texel[2] * color[2] * shading.tint[2];
+		if (!shading.state.alpha)
+			return pack(r, g, b, 1.0f);
+
+		// src alpha, inverse src alpha
+		float a = texel[3] * color[3] * shading.alpha;
+		float old[4];
+		unpack(dst, old);
+		return pack(
+			r * a + old[0] * (1.0f - a), g * a + old[1] * (1.0f - a),
+			b * a + old[2] * (1.0f - a), a * a + old[3] * (1.0f - a));
+	}
+
+	// a 5:6:5 color to 0xFFRRGGBB
+	uint32_t expand565(uint32_t c)
+	{
+		uint32_t r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+		return 0xff000000 | (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+	}
+
+	// each channel of a * wa + b * wb, over wa + wb
+	uint32_t mix(uint32_t a, uint32_t b, uint32_t wa, uint32_t wb)
+	{
+		uint32_t result = 0;
+		for (uint32_t shift = 0; shift < 32; shift += 8)
+		{
+			uint32_t ca = (a >> shift) & 0xff, cb = (b >> shift) & 0xff;
+			result |= ((ca * wa + cb * wb) / (wa + wb)) << shift;
+		}
+		return result;
+	}
+
+	// a DXT1 color block; DXT5 blocks always use the four color mode
+	void decode_colors(const uint8_t * block, bool four_colors, uint32_t * out)
+	{
+		uint32_t c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8);
+		uint32_t palette[4] = { expand565(c0), expand565(c1) };
+		if (four_colors || c0 > c1)
+		{
+			palette[2] = mix(palette[0], palette[1], 2, 1);
+			palette[3] = mix(palette[0], palette[1], 1, 2);
+		}
+		else
+		{
+			palette[2] = mix(palette[0], palette[1], 1, 1);
+			palette[3] = 0;
+		}
+
+		uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+		for (size_t i = 0; i < 16; ++i)
+			out[i] = palette[(indices >> (2 * i)) & 3];
+	}
+
+	void decode_alphas(const uint8_t * block, uint32_t * out)
+	{
+		uint32_t a0 = block[0], a1 = block[1];
+		uint32_t palette[8] = { a0, a1 };
+		if (a0 > a1)
+		{
+			for (uint32_t i = 1; i < 7; ++i)
+				palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+		}
+		else
+		{
+			for (uint32_t i = 1; i < 5; ++i)
+				palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t indices = 0;
+		for (size_t i = 0; i < 6; ++i)
+			indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+		for (size_t i = 0; i < 16; ++i)
+			out[i] = (out[i] & 0x00ffffff) | (palette[(indices >> (3 * i)) & 7] << 24);
+	}
+}
+
+Rasterizer::Shading::Shading()
+	: texture(NULL), alpha(1.0f), state()
+{
+	tint[0] = tint[1] = tint[2] = 1.0f;
+}
+
+Rasterizer::Rasterizer(uint32_t width, uint32_t height)
+	: stats(), width(0), height(0), frame()
+{
+	resize(width, height);
+}
+
+void Rasterizer::resize(uint32_t width, uint32_t height)
+{
+	assert(width > 0 && height > 0 && width <= MAXSIZE && height <= MAXSIZE);
+
+	this->width = width;
+	this->height = height;
+	// whole groups of four pixels, so a row's last group needs no mask
+	stride = (width + 3) & ~3u;
+	tiles_x = (width + TILE - 1) / TILE;
+	tiles_y = (height + TILE - 1) / TILE;
+
+	color_buffer.assign(stride * height, 0);
+	depth_buffer.assign(stride * height, 1.0f);
+	tile_depths.assign(tiles_x * tiles_y, 1.0f);
+	bins.assign(tiles_x * tiles_y, std::vector<uint32_t>());
+	triangles.clear();
+	shadings.clear();
+	frame = Stats();
+}
+
+void Rasterizer::clear(uint32_t color, float depth)
+{
+	std::fill(color_buffer.begin(), color_buffer.end(), color);
+	std::fill(depth_buffer.begin(), depth_buffer.end(), depth);
+	std::fill(tile_depths.begin(), tile_depths.end(), depth);
+	for (std::vector<uint32_t> & bin : bins)
+		bin.clear();
+	triangles.clear();
+	shadings.clear();
+	frame = Stats();
+}
+
+void Rasterizer::draw(const Mesh::Vertex * vertices, uint32_t num_vertices,
+	const Mesh::Index * indices, uint32_t num_triangles,
+	const Matrix4 & local2screen, const Shading & shading)
+{
+	if (num_triangles == 0)
+		return;
+
+	uint32_t shading_index = static_cast<uint32_t>(shadings.size());
+	shadings.push_back(shading);
+
+	const float guard_x = 2.0f * GUARDBAND / width, guard_y = 2.0f * GUARDBAND / height;
+
+	// each vertex once, however many triangles share it
+	clip_positions.resize(num_vertices);
+	outcodes.resize(num_vertices);
+	for (uint32_t i = 0; i < num_vertices; ++i)
+	{
+		clip_positions[i] = local2screen.predot(Vector4(vertices[i].position, 1.0f));
+		outcodes[i] = outcode(clip_positions[i], guard_x, guard_y);
+	}
+
+	for (uint32_t t = 0; t < num_triangles; ++t)
+	{
+		const Mesh::Index * corners = indices + 3 * t;
+		assert(corners[0] < num_vertices && corners[1] < num_vertices && corners[2] < num_vertices);
+
+		uint8_t all = outcodes[corners[0]] & outcodes[corners[1]] & outcodes[corners[2]];
+		uint8_t any = outcodes[corners[0]] | outcodes[corners[1]] | outcodes[corners[2]];
+		if (all & Frustum)
+		{
+			++frame.culled;
+			continue;
+		}
+
+		ClipVertex polygon[MAXCLIPVERTICES];
+		for (size_t i = 0; i < 3; ++i)
+		{
+			const Mesh::Vertex & vertex = vertices[corners[i]];
+			const Vector4 & p = clip_positions[corners[i]];
+			ClipVertex & out = polygon[i];
+			out.x = p.x;
+			out.y = p.y;
+			out.z = p.z;
+			out.w = p.w;
+			out.r = vertex.r / 255.0f;
+			out.g = vertex.g / 255.0f;
+			out.b = vertex.b / 255.0f;
+			out.a = vertex.a / 255.0f;
+			out.u = vertex.u;
+			out.v = vertex.v;
+		}
+
+		size_t count = 3;
+		if (any & (Near | Guard))
+		{
+			++frame.clipped;
+			count = clip(polygon, count, any & (Near | Guard), guard_x, guard_y);
+		}
+		for (size_t i = 2; i < count; ++i)
+			setup(polygon[0], polygon[i - 1], polygon[i], shading.state.cull_back, shading_index);
+	}
+}
+
+size_t Rasterizer::clip(ClipVertex * polygon, size_t count, uint8_t planes, float guard_x, float guard_y)
+{
+	ClipVertex scratch[MAXCLIPVERTICES];
+	ClipVertex * in = polygon, * out = scratch;
+
+	// the near plane, then the guard band's four
+	for (int plane = 0; plane < 5; ++plane)
+	{
+		if (!(planes & (plane == 0 ? Near : Guard)))
+			continue;
+
+		size_t clipped = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const ClipVertex & a = in[i], & b = in[(i + 1) % count];
+			float da, db;
+			switch (plane)
+			{
+			case 0: da = a.z; db = b.z; break;
+			case 1: da = guard_x * a.w - a.x; db = guard_x * b.w - b.x; break;
+			case 2: da = guard_x * a.w + a.x; db = guard_x * b.w + b.x; break;
+			case 3: da = guard_y * a.w - a.y; db = guard_y * b.w - b.y; break;
+			default: da = guard_y * a.w + a.y; db = guard_y * b.w + b.y; break;
+			}
+
+			if (da >= 0.0f)
+				out[clipped++] = a;
+			if ((da >= 0.0f) != (db >= 0.0f))
+			{
+				// everything is linear in clip space
+				float t = da / (da - db);
+				const float * fa = &a.x, * fb = &b.x;
+				float * f = &out[clipped++].x;
+				for (size_t k = 0; k < sizeof(ClipVertex) / sizeof(float); ++k)
+					f[k] = fa[k] + (fb[k] - fa[k]) * t;
+			}
+		}
+		assert(clipped <= MAXCLIPVERTICES);
+
+		std::swap(in, out);
+		count = clipped;
+		if (count < 3)
+			return 0;
+	}
+
+	if (in != polygon)
+		std::copy(in, in + count, polygon);
+	return count;
+}
+
+void Rasterizer::setup(const ClipVertex & v0, const ClipVertex & v1, const ClipVertex & v2, bool cull_back, uint32_t shading)
+{
+	const ClipVertex * v[3] = { &v0, &v1, &v2 };
+	int32_t x[3], y[3];
+	float inv_w[3];
+	for (size_t i = 0; i < 3; ++i)
+	{
+		// to pixels, y down, snapped to subpixels
+		inv_w[i] = 1.0f / v[i]->w;
+		float sx = (v[i]->x * inv_w[i] * 0.5f + 0.5f) * width;
+		float sy = (0.5f - v[i]->y * inv_w[i] * 0.5f) * height;
+		x[i] = static_cast<int32_t>(floorf(sx * SUBPIXEL + 0.5f));
+		y[i] = static_cast<int32_t>(floorf(sy * SUBPIXEL + 0.5f));
+	}
+
+	// counter-clockwise in clip space, the front, is negative with y down
+	int64_t area = static_cast<int64_t>(x[1] - x[0]) * (y[2] - y[0]) - static_cast<int64_t>(x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0 || (cull_back && area > 0))
+	{
+		++frame.culled;
+		return;
+	}
+	if (area < 0)
+	{
+		std::swap(v[1], v[2]);
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(inv_w[1], inv_w[2]);
+	}
+
+	Triangle triangle;
+
+	// the pixels whose centers may be inside
+	int32_t min_x = std::min(x[0], std::min(x[1], x[2])), max_x = std::max(x[0], std::max(x[1], x[2]));
+	int32_t min_y = std::min(y[0], std::min(y[1], y[2])), max_y = std::max(y[0], std::max(y[1], y[2]));
+	triangle.x0 = std::max(0, -floor_div(-(min_x - SUBPIXEL / 2), SUBPIXEL));
+	triangle.y0 = std::max(0, -floor_div(-(min_y - SUBPIXEL / 2), SUBPIXEL));
+	triangle.x1 = std::min(static_cast<int32_t>(width) - 1, floor_div(max_x - SUBPIXEL / 2, SUBPIXEL));
+	triangle.y1 = std::min(static_cast<int32_t>(height) - 1, floor_div(max_y - SUBPIXEL / 2, SUBPIXEL));
+	if (triangle.x0 > triangle.x1 || triangle.y0 > triangle.y1)
+	{
+		++frame.culled;
+		return;
+	}
+
+	for (size_t i = 0; i < 3; ++i)
+	{
+		size_t j = (i + 1) % 3;
+		int32_t dx = x[j] - x[i], dy = y[j] - y[i];
+		triangle.a[i] = -dy;
+		triangle.b[i] = dx;
+		triangle.c[i] = -(static_cast<int64_t>(triangle.a[i]) * x[i] + static_cast<int64_t>(triangle.b[i]) * y[i]);
+		// pixel centers exactly on an edge belong to the triangle only on its top and left edges
+		bool top_left = dy < 0 || (dy == 0 && dx > 0);
+		if (!top_left)
+			triangle.c[i] -= 1;
+	}
+
+	// attribute planes over pixel coordinates, from the snapped positions
+	double px[3], py[3];
+	for (size_t i = 0; i < 3; ++i)
+	{
+		px[i] = static_cast<double>(x[i]) / SUBPIXEL;
+		py[i] = static_cast<double>(y[i]) / SUBPIXEL;
+	}
+	double dx1 = px[1] - px[0], dy1 = py[1] - py[0], dx2 = px[2] - px[0], dy2 = py[2] - py[0];
+	double det = dx1 * dy2 - dx2 * dy1;
+	for (size_t attribute = 0; attribute < NUMATTRIBUTES; ++attribute)
+	{
+		double q[3];
+		for (size_t i = 0; i < 3; ++i)
+		{
+			switch (attribute)
+			{
+			case Depth: q[i] = v[i]->z * inv_w[i]; break;
+			case InvW: q[i] = inv_w[i]; break;
+			case U: q[i] = v[i]->u * inv_w[i]; break;
+			case V: q[i] = v[i]->v * inv_w[i]; break;
+			case R: q[i] = v[i]->r * inv_w[i]; break;
+			case G: q[i] = v[i]->g * inv_w[i]; break;
+			case B: q[i] = v[i]->b * inv_w[i]; break;
+			default: q[i] = v[i]->a * inv_w[i]; break;
+			}
+		}
+		double dqdx = ((q[1] - q[0]) * dy2 - (q[2] - q[0]) * dy1) / det;
+		double dqdy = ((q[2] - q[0]) * dx1 - (q[1] - q[0]) * dx2) / det;
+		Plane & plane = triangle.planes[attribute];
+		plane.dx = static_cast<float>(dqdx);
+		plane.dy = static_cast<float>(dqdy);
+		plane.c = static_cast<float>(q[0] - dqdx * px[0] - dqdy * py[0]);
+	}
+
+	triangle.shading = shading;
+	triangles.push_back(triangle);
+	++frame.triangles;
+	bin(static_cast<uint32_t>(triangles.size() - 1));
+}
+
+void Rasterizer::bin(uint32_t index)
+{
+	const Triangle & triangle = triangles[index];
+	for (uint32_t ty = triangle.y0 / TILE; ty <= triangle.y1 / TILE; ++ty)
+	{
+		for (uint32_t tx = triangle.x0 / TILE; tx <= triangle.x1 / TILE; ++tx)
+		{
+			bins[ty * tiles_x + tx].push_back(index);
+			++frame.bins;
+		}
+	}
+}
+
+void Rasterizer::flush(size_t threads)
+{
+	if (triangles.empty())
+	{
+		stats = frame;
+		return;
+	}
+
+	if (threads == 0)
+		threads = parallel_threads();
+	threads = std::max<size_t>(1, std::min(std::min(threads, static_cast<size_t>(MAXTHREADS)), bins.size()));
+
+	// tiles go to whichever thread is free; each is drawn whole by one
+	std::atomic<size_t> next_tile(0);
+	std::vector<Stats> thread_stats(threads, Stats());
+	parallel(threads, [&](size_t t)
+	{
+		for (size_t tile = next_tile++; tile < bins.size(); tile = next_tile++)
+			raster(static_cast<uint32_t>(tile), thread_stats[t]);
+	});
+
+	stats = frame;
+	for (const Stats & thread : thread_stats)
+		stats.pixels += thread.pixels;
+
+	for (std::vector<uint32_t> & bin : bins)
+		bin.clear();
+	triangles.clear();
+	shadings.clear();
+	frame = Stats();
+}
+
+void Rasterizer::raster(uint32_t tile, Stats & tile_stats)
+{
+	const std::vector<uint32_t> & bin = bins[tile];
+	if (bin.empty())
+		return;
+
+	int32_t tile_x0 = (tile % tiles_x) * TILE, tile_y0 = (tile / tiles_x) * TILE;
+	int32_t tile_x1 = std::min(tile_x0 + static_cast<int32_t>(TILE), static_cast<int32_t>(width)) - 1;
+	int32_t tile_y1 = std::min(tile_y0 + static_cast<int32_t>(TILE), static_cast<int32_t>(height)) - 1;
+
+	for (uint32_t index : bin)
+	{
+		const Triangle & triangle = triangles[index];
+		// out to whole groups of four, which the stride leaves room for. raster() masks
+		// off the pixels past width, in the last group of a row
+		int32_t x0 = std::max(triangle.x0, tile_x0) & ~3, x1 = std::min(triangle.x1, tile_x1) | 3;
+		int32_t y0 = std::max(triangle.y0, tile_y0), y1 = std::min(triangle.y1, tile_y1);
+		raster(triangle, x0, y0, x1, y1, tile_stats);
+	}
+
+	float farthest = 0.0f;
+	for (int32_t y = tile_y0; y <= tile_y1; ++y)
+	{
+		const float * row = &depth_buffer[y * stride];
+		for (int32_t x = tile_x0; x <= tile_x1; ++x)
+			farthest = std::max(farthest, row[x]);
+	}
+	tile_depths[tile] = farthest;
+}
+
+void Rasterizer::raster(const Triangle & triangle, int32_t x0, int32_t y0, int32_t x1, int32_t y1, Stats & tile_stats)
+{
+	const Shading & shading = shadings[triangle.shading];
+	const Plane * planes = triangle.planes;
+
+	// each edge at the first pixel center. an edge that's inside over the whole
+	// region is left at 0, and one outside over all of it rejects the triangle
+	int32_t edges[3], steps_x[3], steps_y[3];
+	for (size_t i = 0; i < 3; ++i)
+	{
+		int64_t e = static_cast<int64_t>(triangle.a[i]) * (x0 * SUBPIXEL + SUBPIXEL / 2) +
+			static_cast<int64_t>(triangle.b[i]) * (y0 * SUBPIXEL + SUBPIXEL / 2) + triangle.c[i];
+		int64_t across = static_cast<int64_t>(triangle.a[i]) * SUBPIXEL * (x1 - x0);
+		int64_t down = static_cast<int64_t>(triangle.b[i]) * SUBPIXEL * (y1 - y0);
+		int64_t lowest = e + std::min<int64_t>(across, 0) + std::min<int64_t>(down, 0);
+		int64_t highest = e + std::max<int64_t>(across, 0) + std::max<int64_t>(down, 0);
+		if (highest < 0)
+			return;
+		if (lowest >= 0)
+		{
+			edges[i] = steps_x[i] = steps_y[i] = 0;
+			continue;
+		}
+		edges[i] = static_cast<int32_t>(e);
+		steps_x[i] = triangle.a[i] * SUBPIXEL;
+		steps_y[i] = triangle.b[i] * SUBPIXEL;
+	}
+
+	uint64_t pixels = 0;
+#if defined(EAE6320_SSE)
+	const __m128 lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	// the lanes of the stride's last group that are on screen
+	const int32_t last_group = static_cast<int32_t>(stride) - 4;
+	const __m128 last_lanes = _mm_castsi128_ps(_mm_cmplt_epi32(_mm_setr_epi32(0, 1, 2, 3),
+		_mm_set1_epi32(static_cast<int32_t>(width) - last_group)));
+	__m128i rows[3], groups_x[3], rows_y[3];
+	for (size_t i = 0; i < 3; ++i)
+	{
+		rows[i] = _mm_setr_epi32(edges[i], edges[i] + steps_x[i], edges[i] + 2 * steps_x[i], edges[i] + 3 * steps_x[i]);
+		groups_x[i] = _mm_set1_epi32(4 * steps_x[i]);
+		rows_y[i] = _mm_set1_epi32(steps_y[i]);
+	}
+
+	for (int32_t y = y0; y <= y1; ++y)
+	{
+		__m128i e0 = rows[0], e1 = rows[1], e2 = rows[2];
+		float fy = y + 0.5f;
+		__m128 plane_rows[NUMATTRIBUTES], plane_dx[NUMATTRIBUTES];
+		for (size_t attribute = 0; attribute < NUMATTRIBUTES; ++attribute)
+		{
+			plane_rows[attribute] = _mm_set1_ps(planes[attribute].dy * fy + planes[attribute].c);
+			plane_dx[attribute] = _mm_set1_ps(planes[attribute].dx);
+		}
+
+		for (int32_t x = x0; x <= x1; x += 4)
+		{
+			__m128i any = _mm_or_si128(_mm_or_si128(e0, e1), e2);
+			e0 = _mm_add_epi32(e0, groups_x[0]);
+			e1 = _mm_add_epi32(e1, groups_x[1]);
+			e2 = _mm_add_epi32(e2, groups_x[2]);
+
+			// inside where no edge is negative
+			__m128 inside = _mm_castsi128_ps(_mm_cmpgt_epi32(any, _mm_set1_epi32(-1)));
+			if (x == last_group)
+				inside = _mm_and_ps(inside, last_lanes);
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+
+			size_t index = y * stride + x;
+			__m128 fx = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+			__m128 z = Simd::madd(plane_dx[Depth], fx, plane_rows[Depth]);
+			__m128 depth = _mm_loadu_ps(&depth_buffer[index]);
+			__m128 write = _mm_and_ps(inside, _mm_cmple_ps(z, one));
+			if (shading.state.z_test)
+				write = _mm_and_ps(write, _mm_cmple_ps(z, depth));
+			int mask = _mm_movemask_ps(write);
+			if (mask == 0)
+				continue;
+
+			if (shading.state.z_write)
+				_mm_storeu_ps(&depth_buffer[index], _mm_or_ps(_mm_and_ps(write, z), _mm_andnot_ps(write, depth)));
+
+			// perspective correct, by dividing out the interpolated 1/w
+			__m128 w = _mm_div_ps(one, Simd::madd(plane_dx[InvW], fx, plane_rows[InvW]));
+			float values[NUMATTRIBUTES][4];
+			for (size_t attribute = U; attribute < NUMATTRIBUTES; ++attribute)
+				_mm_storeu_ps(values[attribute], _mm_mul_ps(w, Simd::madd(plane_dx[attribute], fx, plane_rows[attribute])));
+
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				if (!(mask & (1 << lane)))
+					continue;
+				float color[4] = { values[R][lane], values[G][lane], values[B][lane], values[A][lane] };
+				color_buffer[index + lane] = shade(shading, values[U][lane], values[V][lane], color, color_buffer[index + lane]);
+				++pixels;
+			}
+		}
+
+		rows[0] = _mm_add_epi32(rows[0], rows_y[0]);
+		rows[1] = _mm_add_epi32(rows[1], rows_y[1]);
+		rows[2] = _mm_add_epi32(rows[2], rows_y[2]);
+	}
+#else
+	x1 = std::min(x1, static_cast<int32_t>(width) - 1);
+	for (int32_t y = y0; y <= y1; ++y)
+	{
+		int32_t e[3] = { edges[0], edges[1], edges[2] };
+		float fy = y + 0.5f;
+		for (int32_t x = x0; x <= x1; ++x)
+		{
+			bool inside = (e[0] | e[1] | e[2]) >= 0;
+			e[0] += steps_x[0];
+			e[1] += steps_x[1];
+			e[2] += steps_x[2];
+			if (!inside)
+				continue;
+
+			size_t index = y * stride + x;
+			float fx = x + 0.5f;
+			float z = planes[Depth].dx * fx + planes[Depth].dy * fy + planes[Depth].c;
+			if (z > 1.0f || (shading.state.z_test && z > depth_buffer[index]))
+				continue;
+			if (shading.state.z_write)
+				depth_buffer[index] = z;
+
+			float w = 1.0f / (planes[InvW].dx * fx + planes[InvW].dy * fy + planes[InvW].c);
+			float values[NUMATTRIBUTES];
+			for (size_t attribute = U; attribute < NUMATTRIBUTES; ++attribute)
+				values[attribute] = w * (planes[attribute].dx * fx + planes[attribute].dy * fy + planes[attribute].c);
+			color_buffer[index] = shade(shading, values[U], values[V], values + R, color_buffer[index]);
+			++pixels;
+		}
+
+		edges[0] += steps_y[0];
+		edges[1] += steps_y[1];
+		edges[2] += steps_y[2];
+	}
+#endif
+	tile_stats.pixels += pixels;
+}
+
+bool Rasterizer::visible(const AABB3 & box, const Matrix4 & world2screen) const
+{
+	float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX, nearest = FLT_MAX;
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		Vector3 p(
+			corner & 1 ? box.vmax.x : box.vmin.x,
+			corner & 2 ? box.vmax.y : box.vmin.y,
+			corner & 4 ? box.vmax.z : box.vmin.z);
+		Vector4 clip = world2screen.predot(Vector4(p, 1.0f));
+		if (clip.z < 0.0f)
+			return true;
+
+		float inv_w = 1.0f / clip.w;
+		float sx = (clip.x * inv_w * 0.5f + 0.5f) * width;
+		float sy = (0.5f - clip.y * inv_w * 0.5f) * height;
+		min_x = std::min(min_x, sx);
+		max_x = std::max(max_x, sx);
+		min_y = std::min(min_y, sy);
+		max_y = std::max(max_y, sy);
+		nearest = std::min(nearest, clip.z * inv_w);
+	}
+
+	if (nearest > 1.0f || max_x < 0.0f || max_y < 0.0f || min_x >= width || min_y >= height)
+		return false;
+	int32_t x0 = std::max(0, static_cast<int32_t>(floorf(min_x)));
+	int32_t y0 = std::max(0, static_cast<int32_t>(floorf(min_y)));
+	int32_t x1 = std::min(static_cast<int32_t>(width) - 1, static_cast<int32_t>(floorf(max_x)));
+	int32_t y1 = std::min(static_cast<int32_t>(height) - 1, static_cast<int32_t>(floorf(max_y)));
+
+	for (int32_t ty = y0 / TILE; ty <= y1 / static_cast<int32_t>(TILE); ++ty)
+	{
+		for (int32_t tx = x0 / TILE; tx <= x1 / static_cast<int32_t>(TILE); ++tx)
+		{
+			// nothing in the tile is as far as the box
+			if (tile_depths[ty * tiles_x + tx] < nearest)
+				continue;
+
+			int32_t px0 = std::max(x0, tx * static_cast<int32_t>(TILE)), px1 = std::min(x1, (tx + 1) * static_cast<int32_t>(TILE) - 1);
+			int32_t py0 = std::max(y0, ty * static_cast<int32_t>(TILE)), py1 = std::min(y1, (ty + 1) * static_cast<int32_t>(TILE) - 1);
+			for (int32_t y = py0; y <= py1; ++y)
+			{
+				const float * row = &depth_buffer[y * stride];
+				for (int32_t x = px0; x <= px1; ++x)
+				{
+					if (nearest <= row[x])
+						return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+bool Rasterizer::WriteTga(const char * path) const
+{
+	std::ofstream outfile(path, std::ofstream::binary);
+	if (outfile.fail())
+		return false;
+
+	uint8_t header[18] = {};
+	// uncompressed true color, 32 bits with 8 of alpha, rows from the top
+	header[2] = 2;
+	header[12] = width & 0xff;
+	header[13] = (width >> 8) & 0xff;
+	header[14] = height & 0xff;
+	header[15] = (height >> 8) & 0xff;
+	header[16] = 32;
+	header[17] = 0x28;
+	outfile.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+	// 0xAARRGGBB is the B, G, R, A bytes TGA wants
+	for (uint32_t y = 0; y < height; ++y)
+		outfile.write(reinterpret_cast<const char *>(&color_buffer[y * stride]), width * sizeof(uint32_t));
+	return !outfile.fail();
+}
+
+bool Rasterizer::Texture::FromDds(const void * data, size_t size)
+{
+	// as in Dds.h, after the "DDS " four CC
+	struct DdsHeader
+	{
+		char magic[4];
+		uint32_t structSize;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		uint32_t pixelFormatSize;
+		uint32_t pixelFormatFlags;
+		char fourCc[4];
+		uint32_t rgbBitCount;
+		uint32_t bitMasks[4];
+		uint32_t caps[4];
+		uint32_t reserved2;
+	} header;
+
+	if (size < sizeof(header))
+		return false;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, "DDS ", 4) != 0)
+		return false;
+	bool dxt5 = memcmp(header.fourCc, "DXT5", 4) == 0;
+	if (!dxt5 && memcmp(header.fourCc, "DXT1", 4) != 0)
+		return false;
+
+	uint32_t blocks_x = (header.width + 3) / 4, blocks_y = (header.height + 3) / 4;
+	size_t block_size = dxt5 ? 16 : 8;
+	if (header.width == 0 || header.height == 0 || size < sizeof(header) + blocks_x * blocks_y * block_size)
+		return false;
+
+	width = header.width;
+	height = header.height;
+	texels.assign(width * height, 0);
+
+	const uint8_t * block = static_cast<const uint8_t *>(data) + sizeof(header);
+	for (uint32_t by = 0; by < blocks_y; ++by)
+	{
+		for (uint32_t bx = 0; bx < blocks_x; ++bx, block += block_size)
+		{
+			uint32_t decoded[16];
+			if (dxt5)
+			{
+				decode_colors(block + 8, true, decoded);
+				decode_alphas(block, decoded);
+			}
+			else
+				decode_colors(block, false, decoded);
+
+			for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+			{
+				for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x)
+					texels[(by * 4 + y) * width + bx * 4 + x] = decoded[y * 4 + x];
+			}
+		}
+	}
+	return true;
+}
+
+#ifdef _DEBUG
+void Rasterizer::test()
+{
+	// Direct3D clip space, with w 1
+	const Matrix4 identity = Matrix4::Identity;
+	Mesh::Vertex quad[4] = {};
+	const float corners[4][2] = { { -0.53f, -0.41f }, { 0.47f, -0.5f }, { 0.61f, 0.57f }, { -0.45f, 0.49f } };
+	for (size_t i = 0; i < 4; ++i)
+	{
+		quad[i].position = Vector3(corners[i][0], corners[i][1], 0.5f);
+		quad[i].r = quad[i].g = quad[i].b = quad[i].a = 255;
+	}
+	const Mesh::Index front[6] = { 0, 1, 2, 0, 2, 3 }, back[6] = { 0, 2, 1, 0, 3, 2 };
+
+	Rasterizer rasterizer(100, 70);
+
+	// half alpha over black: a pixel drawn twice, on the shared edge, would be brighter
+	Shading blend;
+	blend.alpha = 0.5f;
+	blend.state.alpha = blend.state.cull_back = true;
+	rasterizer.clear(0);
+	rasterizer.draw(quad, 4, front, 2, identity, blend);
+	rasterizer.draw(quad, 4, back, 2, identity, blend);
+	rasterizer.flush(1);
+	assert(rasterizer.stats.triangles == 2 && rasterizer.stats.culled == 2);
+	const uint32_t once = rasterizer.colors()[35 * rasterizer.pitch() + 50];
+	assert(once != 0);
+	uint64_t covered = 0;
+	for (uint32_t y = 0; y < rasterizer.height; ++y)
+	{
+		for (uint32_t x = 0; x < rasterizer.width; ++x)
+		{
+			uint32_t color = rasterizer.colors()[y * rasterizer.pitch() + x];
+			assert(color == 0 || color == once);
+			covered += color == once;
+		}
+	}
+	assert(covered == rasterizer.stats.pixels);
+
+	// the same frame from any number of threads
+	std::vector<uint32_t> single(rasterizer.colors(), rasterizer.colors() + rasterizer.pitch() * rasterizer.height);
+	rasterizer.clear(0);
+	rasterizer.draw(quad, 4, front, 2, identity, blend);
+	rasterizer.flush(4);
+	assert(memcmp(single.data(), rasterizer.colors(), single.size() * sizeof(uint32_t)) == 0);
+
+	// a nearer quad hides a farther one drawn after it, and what's behind it
+	Shading opaque;
+	opaque.state.z_test = opaque.state.z_write = true;
+	Shading red = opaque;
+	red.tint[1] = red.tint[2] = 0.0f;
+	Mesh::Vertex far_quad[4];
+	std::copy(quad, quad + 4, far_quad);
+	for (size_t i = 0; i < 4; ++i)
+		far_quad[i].position.z = 0.75f;
+	rasterizer.clear(0);
+	rasterizer.draw(quad, 4, front, 2, identity, red);
+	rasterizer.draw(far_quad, 4, front, 2, identity, opaque);
+	rasterizer.flush();
+	assert(rasterizer.colors()[35 * rasterizer.pitch() + 50] == 0xffff0000);
+	assert(!rasterizer.visible(AABB3(Vector3(-0.1f, -0.1f, 0.6f), Vector3(0.1f, 0.1f, 0.9f)), identity));
+	assert(rasterizer.visible(AABB3(Vector3(-0.1f, -0.1f, 0.2f), Vector3(0.1f, 0.1f, 0.3f)), identity));
+	assert(rasterizer.visible(AABB3(Vector3(0.8f, 0.8f, 0.6f), Vector3(0.9f, 0.9f, 0.9f)), identity));
+	assert(!rasterizer.visible(AABB3(Vector3(1.5f, 0.0f, 0.2f), Vector3(1.9f, 0.1f, 0.3f)), identity));
+
+	// a triangle reaching behind the eye is clipped by the near plane, at z 0.1, and still drawn
+	const Matrix4 perspective(
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 1.0f,
+		0.0f, 0.0f, -0.1f, 0.0f);
+	Mesh::Vertex through[3];
+	std::copy(quad, quad + 3, through);
+	through[0].position = Vector3(-1.0f, -1.0f, 2.0f);
+	through[1].position = Vector3(1.0f, -1.0f, 2.0f);
+	through[2].position = Vector3(0.0f, 1.0f, -1.0f);
+	rasterizer.clear(0);
+	rasterizer.draw(through, 3, front, 1, perspective, opaque);
+	rasterizer.flush();
+	assert(rasterizer.stats.clipped == 1 && rasterizer.stats.triangles >= 1);
+	assert(rasterizer.colors()[35 * rasterizer.pitch() + 50] == 0xffffffff);
+
+	// a width that isn't a multiple of four: the row padding is never drawn or counted
+	Rasterizer narrow(102, 10);
+	Mesh::Vertex cover[3];
+	std::copy(quad, quad + 3, cover);
+	cover[0].position = Vector3(-1.0f, -1.0f, 0.5f);
+	cover[1].position = Vector3(3.0f, -1.0f, 0.5f);
+	cover[2].position = Vector3(-1.0f, 3.0f, 0.5f);
+	narrow.clear(0);
+	narrow.draw(cover, 3, front, 1, identity, opaque);
+	narrow.flush();
+	assert(narrow.stats.pixels == 102 * 10);
+	for (uint32_t y = 0; y < narrow.height; ++y)
+	{
+		for (uint32_t x = 0; x < narrow.pitch(); ++x)
+		{
+			assert(narrow.colors()[y * narrow.pitch() + x] == (x < narrow.width ? 0xffffffff : 0));
+			assert(narrow.depths()[y * narrow.pitch() + x] == (x < narrow.width ? 0.5f : 1.0f));
+		}
+	}
+}
+#endif
+
+}
+}
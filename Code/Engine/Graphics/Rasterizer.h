@@ -0,0 +1,160 @@
+#pragma once
+
+#include "Effect.h"
+#include "Mesh.h"
+#include "../Math/AABB3.h"
+#include "../Math/Matrix4.h"
+#include "../Math/Vector4.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace eae6320
+{
+namespace Graphics
+{
+// draws meshes into a color and depth buffer on the CPU, for reference frames and for
+// occlusion and visibility tests where there's no GPU. the null backend feeds one when it's
+// attached to the NullDevice.
+// draw() transforms and clips a mesh's triangles, snaps them to 1/16 pixel and bins them
+// to the TILE x TILE pixel tiles they may touch. flush() rasterizes the tiles on up to
+// MAXTHREADS threads, four pixels at a time with integer edge functions, so neighbouring
+// triangles share their edge pixels exactly once. each tile is drawn by one thread, in draw
+// order, so frames are the same whatever the number of threads.
+// there are no shaders: a pixel is texture * vertex color * tint, with alpha the texture's *
+// the vertex's * alpha, as every fragment shader of ours computes it.
+struct Rasterizer
+{
+	static const uint32_t TILE = 64;
+	static const size_t MAXTHREADS = 16;
+	// the largest width and height; keeps the edge functions within 32 bits
+	static const uint32_t MAXSIZE = 4096;
+
+	struct Texture
+	{
+		uint32_t width, height;
+		// 0xAARRGGBB, rows from the top
+		std::vector<uint32_t> texels;
+
+		// decodes the top level of a DXT1 or DXT5 DDS, the formats TextureBuilder writes
+		bool FromDds(const void * data, size_t size);
+	};
+
+	// what the fragment shader would have been given
+	struct Shading
+	{
+		// NULL samples as white
+		const Texture * texture;
+		float tint[3];
+		float alpha;
+		Effect::RenderState state;
+
+		Shading();
+	};
+
+	// what the last flush() drew
+	struct Stats
+	{
+		// triangles counts the ones binned, after culling and clipping; bins the
+		// triangle and tile pairs; pixels the ones written
+		uint32_t triangles, culled, clipped, bins;
+		uint64_t pixels;
+	};
+	Stats stats;
+
+	uint32_t width, height;
+
+	void resize(uint32_t width, uint32_t height);
+	// also drops whatever was drawn since the last flush()
+	void clear(uint32_t color, float depth = 1.0f);
+	// local2screen takes the mesh to Direct3D clip space, as local2world * world2view * view2screen
+	void draw(const Mesh::Vertex * vertices, uint32_t num_vertices,
+		const Mesh::Index * indices, uint32_t num_triangles,
+		const Matrix4 & local2screen, const Shading & shading);
+	// threads 0 is as many as parallel() has
+	void flush(size_t threads = 0);
+
+	// after flush(), whether any of box could be seen past the depth buffer.
+	// conservative: true whenever the box reaches the near plane
+	bool visible(const AABB3 & box, const Matrix4 & world2screen) const;
+
+	// rows from the top, pitch pixels apart
+	const uint32_t * colors() const { return color_buffer.data(); }
+	const float * depths() const { return depth_buffer.data(); }
+	uint32_t pitch() const { return stride; }
+
+	// an uncompressed 32-bit TGA
+	bool WriteTga(const char * path) const;
+
+	Rasterizer(uint32_t width, uint32_t height);
+
+	// coverage of shared edges, depth and visibility
+	static void test()
+#ifdef _DEBUG
+		;
+#else
+	{}
+#endif
+
+private:
+	// one attribute as a function of the pixel center: dx * x + dy * y + c
+	struct Plane
+	{
+		float dx, dy, c;
+	};
+
+	enum Attribute
+	{
+		Depth,
+		InvW,
+		U, V,
+		R, G, B, A,
+		NUMATTRIBUTES,
+	};
+
+	// a triangle set up for the tiles. edge i is a * x + b * y + c over pixel centers in 1/16
+	// pixel, at least 0 inside; the top-left rule is folded into c
+	struct Triangle
+	{
+		int32_t a[3], b[3];
+		int64_t c[3];
+		// inclusive pixels
+		int32_t x0, y0, x1, y1;
+		// attributes after Depth are divided by w, so they interpolate linearly on screen
+		Plane planes[NUMATTRIBUTES];
+		uint32_t shading;
+	};
+
+	struct ClipVertex
+	{
+		float x, y, z, w;
+		float r, g, b, a;
+		float u, v;
+	};
+	// a triangle clipped by the near plane and the four guard band planes
+	static const size_t MAXCLIPVERTICES = 3 + 5;
+
+	// clips polygon in place against planes (Outcodes); returns how many vertices are left
+	static size_t clip(ClipVertex * polygon, size_t count, uint8_t planes, float guard_x, float guard_y);
+	void setup(const ClipVertex & v0, const ClipVertex & v1, const ClipVertex & v2, bool cull_back, uint32_t shading);
+	void bin(uint32_t triangle);
+	void raster(uint32_t tile, Stats & tile_stats);
+	void raster(const Triangle & triangle, int32_t x0, int32_t y0, int32_t x1, int32_t y1, Stats & tile_stats);
+
+	uint32_t stride, tiles_x, tiles_y;
+	std::vector<uint32_t> color_buffer;
+	std::vector<float> depth_buffer;
+	// the farthest depth in each tile, for visible()
+	std::vector<float> tile_depths;
+
+	std::vector<Triangle> triangles;
+	std::vector<Shading> shadings;
+	std::vector<std::vector<uint32_t>> bins;
+	// draw()'s counts, until flush() adds the pixels
+	Stats frame;
+	std::vector<Vector4> clip_positions;
+	std::vector<uint8_t> outcodes;
+};
+}
+}
@@ -0,0 +1,219 @@
+#include "stdafx.h"
+
+#include "RenderQueue.h"
+#include "Graphics.h"
+#include "../Math/Parallel.h"
+#include "../Math/SpatialKey.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace eae6320
+{
+namespace Graphics
+{
+
+RenderQueue::RenderQueue()
+	: stats()
+{
+}
+
+uint64_t RenderQueue::key(Pass pass, uint32_t effect, uint32_t material, uint32_t mesh, float depth)
+{
+	assert(effect < MAXEFFECTS && material < MAXMATERIALS && mesh < MAXMESHES);
+	assert(depth >= 0.0f);
+
+	uint32_t depth_bits;
+	memcpy(&depth_bits, &depth, sizeof(depth_bits));
+	uint64_t state = (static_cast<uint64_t>(effect) << 23) | (material << 13) | mesh;
+
+	if (pass == Alpha)
+		return (1ull << 63) | (static_cast<uint64_t>(~depth_bits) << 31) | state;
+	return (state << 32) | depth_bits;
+}
+
+uint32_t RenderQueue::id(Ids & ids, const void * p, uint32_t max)
+{
+	auto found = ids.find(p);
+	if (found != ids.end())
+		return found->second;
+
+	uint32_t next = static_cast<uint32_t>(ids.size());
+	// raise the limit; a release build degrades to fewer sorted states instead
+	assert(next < max);
+	if (next >= max)
+		next = max - 1;
+	ids[p] = next;
+	return next;
+}
+
+void RenderQueue::add(Model & model)
+{
+	models.push_back(&model);
+}
+
+void RenderQueue::submit(Camera & camera)
+{
+	size_t count = models.size();
+	keys.resize(count);
+	order.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Model & model = *models[i];
+		Effect * effect = model.mat->effect;
+		Pass pass = effect->render_state.alpha ? Alpha : Opaque;
+		keys[i] = key(pass,
+			id(effect_ids, effect, MAXEFFECTS),
+			id(material_ids, model.mat, MAXMATERIALS),
+			id(mesh_ids, model.mesh, MAXMESHES),
+			(model.position - camera.position).norm_sq());
+		order[i] = static_cast<uint32_t>(i);
+	}
+	SpatialKey::sort(keys.data(), order.data(), count);
+
+	runs.clear();
+	for (uint32_t i = 0, end; i < count; i = end)
+	{
+		const Model & model = *models[order[i]];
+		for (end = i + 1; end < count; ++end)
+		{
+			const Model & next = *models[order[end]];
+			if (next.mat != model.mat || next.mesh != model.mesh)
+				break;
+		}
+		Run run = { i, end, model.mat->effect->instanced && end - i >= MININSTANCES };
+		runs.push_back(run);
+	}
+
+	// slices of about equal draws, cut between runs
+	size_t threads = std::min(parallel_threads(), static_cast<size_t>(MAXTHREADS));
+	threads = std::max<size_t>(std::min(threads, count / MINTHREADDRAWS), 1);
+	recordings.resize(threads);
+	size_t slice = (count + threads - 1) / threads, r = 0;
+	for (size_t t = 0; t < threads; ++t)
+	{
+		recordings[t].first_run = r;
+		while (r < runs.size() && (t + 1 == threads || runs[r].begin < (t + 1) * slice))
+			++r;
+		recordings[t].last_run = r;
+	}
+
+	parallel(threads, [this](size_t t)
+	{
+		record(recordings[t]);
+	});
+
+	stats = Stats();
+	Effect * effect = NULL;
+	for (const Recording & recording : recordings)
+	{
+		effect = recording.buffer.execute(camera, effect);
+		stats.draws += recording.stats.draws;
+		stats.effects += recording.stats.effects;
+		stats.materials += recording.stats.materials;
+		stats.meshes += recording.stats.meshes;
+		stats.instances += recording.stats.instances;
+	}
+
+	models.clear();
+}
+
+Effect * RenderQueue::effect(const Run & run) const
+{
+	Effect * effect = models[order[run.begin]]->mat->effect;
+	return run.instanced ? effect->instanced : effect;
+}
+
+void RenderQueue::record(Recording & recording) const
+{
+	recording.buffer.clear();
+	recording.stats = Stats();
+	Stats & stats = recording.stats;
+
+	// a new effect loses the shader constants of the last, so the camera and the
+	// material go back on with it. the state starts as the run before left it
+	Effect * effect = NULL;
+	Material * material = NULL;
+	Mesh * mesh = NULL;
+	if (recording.first_run > 0)
+	{
+		const Run & before = runs[recording.first_run - 1];
+		const Model & model = *models[order[before.begin]];
+		effect = this->effect(before);
+		material = model.mat;
+		mesh = model.mesh;
+	}
+
+	for (size_t r = recording.first_run; r < recording.last_run; ++r)
+	{
+		const Run & run = runs[r];
+		Model & model = *models[order[run.begin]];
+
+		Effect * target = this->effect(run);
+		if (target != effect)
+		{
+			effect = target;
+			recording.buffer.use_effect(*effect);
+			material = NULL;
+			++stats.effects;
+		}
+		if (model.mat != material)
+		{
+			material = model.mat;
+			recording.buffer.params(*material, run.instanced);
+			++stats.materials;
+		}
+		if (model.mesh != mesh)
+		{
+			mesh = model.mesh;
+			++stats.meshes;
+		}
+
+		if (run.instanced)
+		{
+			Matrix4 * local2worlds = recording.buffer.draw_instanced(*model.mesh, run.end - run.begin);
+			for (uint32_t i = run.begin; i < run.end; ++i)
+			{
+				const Model & copy = *models[order[i]];
+				*local2worlds++ = Matrix4(Affine3::create_RST(copy.rotation, copy.scale, copy.position));
+			}
+			++stats.draws;
+			stats.instances += run.end - run.begin;
+		}
+		else
+		{
+			for (uint32_t i = run.begin; i < run.end; ++i)
+			{
+				const Model & single = *models[order[i]];
+				Affine3 local2world = Affine3::create_RST(single.rotation, single.scale, single.position);
+				recording.buffer.draw(*single.mesh, Matrix4(local2world));
+				++stats.draws;
+			}
+		}
+	}
+}
+
+#ifdef _DEBUG
+void RenderQueue::test()
+{
+	// every opaque draw before every alpha one
+	assert(key(Opaque, MAXEFFECTS - 1, MAXMATERIALS - 1, MAXMESHES - 1, 1e30f) < key(Alpha, 0, 0, 0, 0.0f));
+
+	// opaque: state first, then near to far
+	assert(key(Opaque, 0, 5, 5, 100.0f) < key(Opaque, 1, 0, 0, 1.0f));
+	assert(key(Opaque, 1, 0, 5, 100.0f) < key(Opaque, 1, 1, 0, 1.0f));
+	assert(key(Opaque, 1, 1, 0, 100.0f) < key(Opaque, 1, 1, 1, 1.0f));
+	assert(key(Opaque, 1, 1, 1, 1.0f) < key(Opaque, 1, 1, 1, 2.0f));
+	assert(key(Opaque, 1, 1, 1, 0.0f) < key(Opaque, 1, 1, 1, 1e-30f));
+
+	// alpha: far to near whatever the state, then state at equal depth
+	assert(key(Alpha, 7, 7, 7, 100.0f) < key(Alpha, 0, 0, 0, 99.0f));
+	assert(key(Alpha, 0, 0, 0, 1e30f) < key(Alpha, 0, 0, 0, 0.0f));
+	assert(key(Alpha, 0, 1, 0, 5.0f) < key(Alpha, 1, 0, 0, 5.0f));
+	assert(key(Alpha, 1, 0, 1, 5.0f) < key(Alpha, 1, 1, 0, 5.0f));
+}
+#endif
+
+}
+}
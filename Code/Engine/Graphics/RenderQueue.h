@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Model.h"
+#include "Camera.h"
+#include "CommandBuffer.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace eae6320
+{
+namespace Graphics
+{
+// a frame's model draws, each as a 64-bit sort key. submit() radix sorts the keys
+// and draws in key order, switching effect, material and camera only when they change.
+//   opaque: pass 1 | effect 8 | material 10 | mesh 13 | depth 32, front to back within a state
+//   alpha:  pass 1 | ~depth 32 | effect 8 | material 10 | mesh 13, back to front
+// depth is the squared distance from the camera, whose float bits sort as integers.
+// effects, materials and meshes are numbered as the queue first sees them.
+// a run of MININSTANCES or more draws of one material and mesh is drawn as one instanced
+// draw, if the material's effect has an instanced variant.
+// large queues are recorded by up to MAXTHREADS threads, each into its own CommandBuffer
+// over a slice of the sorted runs, and the buffers are executed in order on the calling
+// thread. every slice starts from the state the slice before ends in, so the calls made
+// are the same whatever the number of threads.
+struct RenderQueue
+{
+	enum Pass
+	{
+		Opaque,
+		Alpha,
+	};
+
+	static const uint32_t MAXEFFECTS = 1 << 8, MAXMATERIALS = 1 << 10, MAXMESHES = 1 << 13;
+	static const size_t MININSTANCES = 2;
+	// each recording thread gets at least MINTHREADDRAWS draws, or the work isn't worth a thread
+	static const size_t MAXTHREADS = 8, MINTHREADDRAWS = 1024;
+
+	// what the last submit() did
+	struct Stats
+	{
+		// instances counts the models drawn by instanced draws
+		uint32_t draws, effects, materials, meshes, instances;
+	};
+	Stats stats;
+
+	static uint64_t key(Pass pass, uint32_t effect, uint32_t material, uint32_t mesh, float depth);
+
+	void add(Model & model);
+	// draws everything added since the last submit, then empties the queue
+	void submit(Camera & camera);
+
+	RenderQueue();
+
+	// key order: passes, states, and depth in each pass
+	static void test()
+#ifdef _DEBUG
+		;
+#else
+	{}
+#endif
+
+private:
+	typedef std::unordered_map<const void *, uint32_t> Ids;
+
+	// draws of one material and mesh, next to each other in sorted order
+	struct Run
+	{
+		uint32_t begin, end;
+		bool instanced;
+	};
+
+	// one thread's share of the runs
+	struct Recording
+	{
+		size_t first_run, last_run;
+		CommandBuffer buffer;
+		Stats stats;
+	};
+
+	// a number below max for p, the same each time. past max everything shares max - 1:
+	// those draws sort together by depth, and state still switches on their real effect and material
+	static uint32_t id(Ids & ids, const void * p, uint32_t max);
+
+	Effect * effect(const Run & run) const;
+	void record(Recording & recording) const;
+
+	Ids effect_ids, material_ids, mesh_ids;
+	std::vector<Model *> models;
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> order;
+	std::vector<Run> runs;
+	std::vector<Recording> recordings;
+};
+}
+}
@@ -0,0 +1,114 @@
+#include "stdafx.h"
+
+#include "StateCache.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace eae6320
+{
+namespace Graphics
+{
+
+namespace
+{
+	// no real program, texture or buffer has this handle
+	const uintptr_t UNKNOWN = ~static_cast<uintptr_t>(0);
+}
+
+StateCache::StateCache(bool uniforms_per_program)
+	: frame(), last_frame(), uniforms_per_program(uniforms_per_program)
+{
+	invalidate();
+}
+
+bool StateCache::changed(bool changed)
+{
+	if (changed)
+		++frame.issued;
+	else
+		++frame.skipped;
+	return changed;
+}
+
+bool StateCache::set(uintptr_t & known, uintptr_t value)
+{
+	if (!changed(known != value))
+		return false;
+	known = value;
+	return true;
+}
+
+bool StateCache::program(uintptr_t program)
+{
+	if (!set(bound_program, program))
+		return false;
+	if (!uniforms_per_program)
+		uniforms.clear();
+	return true;
+}
+
+uint8_t StateCache::render_state(Effect::RenderState state)
+{
+	uint8_t flags =
+		(state.alpha ? Alpha : 0) | (state.z_test ? ZTest : 0) |
+		(state.z_write ? ZWrite : 0) | (state.cull_back ? CullBack : 0);
+	uint8_t known =
+		(render_state_bits.alpha ? Alpha : 0) | (render_state_bits.z_test ? ZTest : 0) |
+		(render_state_bits.z_write ? ZWrite : 0) | (render_state_bits.cull_back ? CullBack : 0);
+	uint8_t changes = render_state_known ? flags ^ known : Alpha | ZTest | ZWrite | CullBack;
+
+	for (uint8_t flag = Alpha; flag <= CullBack; flag <<= 1)
+		changed((changes & flag) != 0);
+
+	render_state_known = true;
+	render_state_bits = state;
+	return changes;
+}
+
+bool StateCache::texture(uint32_t unit, uintptr_t texture)
+{
+	assert(unit < MAXTEXTUREUNITS);
+	return set(textures[unit], texture);
+}
+
+bool StateCache::vertices(uintptr_t buffer)
+{
+	return set(bound_vertices, buffer);
+}
+
+bool StateCache::indices(uintptr_t buffer)
+{
+	return set(bound_indices, buffer);
+}
+
+bool StateCache::uniform(uintptr_t owner, intptr_t handle, const void * values, size_t size)
+{
+	assert(size <= MAXUNIFORMSIZE);
+
+	Uniform & known = uniforms[std::make_pair(owner, handle)];
+	if (!changed(known.size != size || memcmp(known.bytes, values, size) != 0))
+		return false;
+	known.size = size;
+	memcpy(known.bytes, values, size);
+	return true;
+}
+
+void StateCache::begin_frame()
+{
+	last_frame = frame;
+	frame = Counters();
+}
+
+void StateCache::invalidate()
+{
+	render_state_known = false;
+	render_state_bits = Effect::RenderState();
+	bound_program = bound_vertices = bound_indices = UNKNOWN;
+	for (uint32_t i = 0; i < MAXTEXTUREUNITS; ++i)
+		textures[i] = UNKNOWN;
+	uniforms.clear();
+}
+
+}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Effect.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+
+namespace eae6320
+{
+namespace Graphics
+{
+// the device state the backend last set. before each state call the backend asks whether
+// the call would change anything, and skips it if not. anything that changes device state
+// behind the backend's back (D3DX text, mesh loading, texture loading) must invalidate() it.
+struct StateCache
+{
+	static const uint32_t MAXTEXTUREUNITS = 16;
+	static const size_t MAXUNIFORMSIZE = 16 * sizeof(float);
+
+	// the render state flags, each set with its own calls
+	enum RenderFlag
+	{
+		Alpha = 1 << 0,
+		ZTest = 1 << 1,
+		ZWrite = 1 << 2,
+		CullBack = 1 << 3,
+	};
+
+	struct Counters
+	{
+		uint32_t issued, skipped;
+	};
+	// this frame's so far, and all of the last frame's
+	Counters frame, last_frame;
+
+	// each returns whether the call has to be made, records the new state if so,
+	// and counts the call as issued or skipped.
+	// program is the GL program or the D3D effect
+	bool program(uintptr_t program);
+	// returns the RenderFlags that changed; each flag counts as one call
+	uint8_t render_state(Effect::RenderState state);
+	bool texture(uint32_t unit, uintptr_t texture);
+	bool vertices(uintptr_t buffer);
+	bool indices(uintptr_t buffer);
+	// owner is the GL program or the D3D constant table; values up to MAXUNIFORMSIZE bytes
+	bool uniform(uintptr_t owner, intptr_t handle, const void * values, size_t size);
+
+	void begin_frame();
+	// forgets everything, so that the next call of each kind is made
+	void invalidate();
+
+	// D3D9 shader constants are registers of the device, which the next program's constants
+	// overwrite; GL keeps uniform values with each program
+	explicit StateCache(bool uniforms_per_program);
+
+private:
+	struct Uniform
+	{
+		size_t size;
+		unsigned char bytes[MAXUNIFORMSIZE];
+	};
+
+	bool changed(bool changed);
+	bool set(uintptr_t & known, uintptr_t value);
+
+	bool uniforms_per_program;
+	bool render_state_known;
+	Effect::RenderState render_state_bits;
+	uintptr_t bound_program, bound_vertices, bound_indices;
+	uintptr_t textures[MAXTEXTUREUNITS];
+	std::map<std::pair<uintptr_t, intptr_t>, Uniform> uniforms;
+};
+}
+}
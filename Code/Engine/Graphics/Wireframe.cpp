@@ -2,6 +2,8 @@
 
 #ifdef _DEBUG
 #include "Wireframe.h"
+#include "../Math/Batch.h"
+#include "../Math/FastMath.h"
 #include <math.h>
 
 namespace eae6320
@@ -87,42 +89,39 @@ void Wireframe::addSphere(Vector3 center, float radius, uint8_t resolution, Colo
 	static const float pi = acos(-1.0f);
 	float dphi = pi / resolution;
 	float dtheta = dphi;
-
-	for (int i = 1; i < resolution; i++) {
-		float phi = i * dphi;
-		float phi_1 = (i - 1) * dphi;
-
-		for (int j = 0; j < resolution * 2; j++) {
-			float theta = j * dtheta;
-			float theta_1 = (j - 1) * dtheta;
-			float ctheta = cos(theta), cphi = cos(phi);
-			float stheta = sin(theta), sphi = sin(phi);
-			float ctheta_1 = cos(theta_1), cphi_1 = cos(phi_1);
-			float stheta_1 = sin(theta_1), sphi_1 = sin(phi_1);
-
-			Vector3 p0 = center + Vector3(radius * ctheta * sphi, radius * stheta * sphi, radius * cphi);
-			Vector3 p1 = center + Vector3(radius * ctheta * sphi_1, radius * stheta * sphi_1, radius * cphi_1);
-			Vector3 p2 = center + Vector3(radius * ctheta_1 * sphi, radius * stheta_1 * sphi, radius * cphi);
-
-			addLine(p0, color, p1, color);
-			addLine(p0, color, p2, color);
-		}
+	int columns = resolution * 2;
+
+	// each ring's angle, then each column's; lines need only coarse sines
+	std::vector<float> angles(resolution + 1 + columns), sines(angles.size()), cosines(angles.size());
+	for (int i = 0; i <= resolution; i++)
+		angles[i] = i * dphi;
+	for (int j = 0; j < columns; j++)
+		angles[resolution + 1 + j] = j * dtheta;
+	FastMath::sincos<FastMath::Coarse>(angles.data(), sines.data(), cosines.data(), angles.size());
+	const float * cos_theta = cosines.data() + resolution + 1, * sin_theta = sines.data() + resolution + 1;
+
+	// rings of the unit sphere from pole to pole, placed all at once
+	std::vector<Vector3> grid((resolution + 1) * columns);
+	for (int i = 0; i <= resolution; i++) {
+		float cphi = cosines[i], sphi = sines[i];
+
+		for (int j = 0; j < columns; j++)
+			grid[i * columns + j] = Vector3(cos_theta[j] * sphi, sin_theta[j] * sphi, cphi);
 	}
-	
-	float phi = (resolution - 1) * dphi;
-
-	Vector3 p1 = center + Vector3(0, 0, -radius);
 
-	for (int j = 0; j < resolution * 2; j++) {
-		float theta = j * dtheta;
-		float theta_1 = (j + 1) * dtheta;
+	Matrix4 place = Matrix4::scale(radius, radius, radius);
+	place.vec3(3) = center;
+	Batch::transform_points(place, grid.data(), grid.data(), grid.size());
 
-		float ctheta = cos(theta), cphi = cos(phi);
-		float stheta = sin(theta), sphi = sin(phi);
+	for (int i = 1; i <= resolution; i++) {
+		for (int j = 0; j < columns; j++) {
+			const Vector3 & p0 = grid[i * columns + j];
+			addLine(p0, color, grid[(i - 1) * columns + j], color);
 
-		Vector3 p0 = center + Vector3(radius * ctheta * sphi, radius * stheta * sphi, radius * cphi);
-
-		addLine(p0, color, p1, color);
+			// the last ring is the pole
+			if (i < resolution)
+				addLine(p0, color, grid[i * columns + (j + columns - 1) % columns], color);
+		}
 	}
 }
 
@@ -134,25 +133,32 @@ void Wireframe::addCylinder(Vector3 center, float radius, float extent, uint8_t
 	Vector3 center1 = center + Vector3::J * extent;
 	Vector3 center2 = center - Vector3::J * extent;
 
+	std::vector<float> angles(resolution), sines(resolution), cosines(resolution);
+	for (int i = 0; i < resolution; i++)
+		angles[i] = i * dtheta;
+	FastMath::sincos<FastMath::Coarse>(angles.data(), sines.data(), cosines.data(), resolution);
+
+	// a unit circle for each cap, placed all at once
+	std::vector<Vector3> rings(resolution * 2);
+	for (int i = 0; i < resolution; i++)
+		rings[i] = rings[resolution + i] = Vector3(cosines[i], 0, sines[i]);
+
+	Matrix4 place = Matrix4::scale(radius, 1.0f, radius);
+	place.vec3(3) = center1;
+	Batch::transform_points(place, rings.data(), rings.data(), resolution);
+	place.vec3(3) = center2;
+	Batch::transform_points(place, rings.data() + resolution, rings.data() + resolution, resolution);
+
+	const Vector3 * top = rings.data();
+	const Vector3 * bottom = rings.data() + resolution;
 	for (int i = 0; i < resolution; i++) {
-		float theta = i * dtheta;
-		float theta_1 = (i + 1) * dtheta;
-		float ctheta = cos(theta), ctheta_1 = cos(theta_1);
-		float stheta = sin(theta), stheta_1 = sin(theta_1);
-
-		Vector3 leg0 = Vector3(ctheta, 0, stheta) * radius;
-		Vector3 leg1 = Vector3(ctheta_1, 0, stheta_1) * radius;
-
-		Vector3 p0 = center1 + leg0;
-		Vector3 p1 = center1 + leg1;
-		Vector3 p2 = center2 + leg0;
-		Vector3 p3 = center2 + leg1;
-
-		addLine(center1, color, p0, color);
-		addLine(p0, color, p1, color);
-		addLine(p1, color, p3, color);
-		addLine(p3, color, p2, color);
-		addLine(p2, color, center2, color);
+		int i_1 = (i + 1) % resolution;
+
+		addLine(center1, color, top[i], color);
+		addLine(top[i], color, top[i_1], color);
+		addLine(top[i_1], color, bottom[i_1], color);
+		addLine(bottom[i_1], color, bottom[i], color);
+		addLine(bottom[i], color, center2, color);
 	}
 }
 
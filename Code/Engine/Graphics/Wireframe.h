@@ -46,7 +46,6 @@ struct Wireframe
 	void addAABB(Vector3 center, Vector3 extents, Color color) {}
 	void addAABB(AABB3 box, Color color) {}
 	void addSphere(Vector3 center, float radius, uint8_t resolution, Color color) {}
-	void addSphere(Vector3 center, float radius, uint8_t resolution, Color color) {}
 	void addCylinder(Vector3 center, float radius, float extent, uint8_t resolution, Color color) {}
 
 	void clear() {}
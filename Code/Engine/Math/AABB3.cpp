@@ -25,9 +25,9 @@ namespace eae6320
 
 	bool AABB3::intersects(const Segment3 & ray) const
 	{
-		Vector3 c = (vmin + vmax) / 2; // Box center-point
+		Vector3 c = Vector3::midpoint(vmin, vmax); // Box center-point
 		Vector3 e = vmax - c; // Box halflength extents
-		Vector3 m = (ray.a + ray.b) / 2; // Segment midpoint
+		Vector3 m = Vector3::midpoint(ray.a, ray.b); // Segment midpoint
 		Vector3 d = ray.b - m; // Segment halflength vector
 		m = m - c; // Segment midpoint relative to box center
 
@@ -50,11 +50,41 @@ namespace eae6320
 		return true;
 	}
 
+	bool AABB3::intersects(const Triangle3 & tri) const
+	{
+		// Box face normals as separating axes are just a box-box test
+		if (!tri.box.intersects(*this))
+			return false;
+
+		Vector3 c = Vector3::midpoint(vmin, vmax); // Box center-point
+		Vector3 e = vmax - c; // Box halflength extents
+
+		// Triangle relative to box center, and its edges
+		Vector3 v[3] = { tri.a - c, tri.b - c, tri.c - c };
+		Vector3 f[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+
+		// Try cross products of coordinate axes with triangle edges
+		const Vector3 * axes[3] = { &Vector3::I, &Vector3::J, &Vector3::K };
+		for (uint8_t i = 0; i < 3; ++i)
+			for (uint8_t j = 0; j < 3; ++j)
+			{
+				Vector3 axis = axes[i]->cross(f[j]);
+				float p0 = v[0].dot(axis), p1 = v[1].dot(axis), p2 = v[2].dot(axis);
+				float r = e.dot(axis.abs());
+				if (fmaxf(fmaxf(p0, p1), p2) < -r || fminf(fminf(p0, p1), p2) > r)
+					return false;
+			}
+
+		// Try the triangle's plane normal
+		Vector3 n = f[0].cross(f[1]);
+		return fabsf(n.dot(v[0])) <= e.dot(n.abs());
+	}
+
 	AABB3 AABB3::octant(uint8_t n) const
 	{
 		AABB3 subbox(*this);
 
-		Vector3 center = (vmin + vmax) / 2;
+		Vector3 center = Vector3::midpoint(vmin, vmax);
 
 		if (n & 1) subbox.vmax.x = center.x;
 		else subbox.vmin.x = center.x;
@@ -5,6 +5,8 @@
 
 namespace eae6320
 {
+	struct Triangle3;
+
 	struct AABB3
 	{
 		Vector3 vmin, vmax;
@@ -22,6 +24,7 @@ namespace eae6320
 		bool contains(const AABB3 &) const;
 		bool intersects(const AABB3 &) const;
 		bool intersects(const Segment3 &) const;
+		bool intersects(const Triangle3 &) const;
 
 		AABB3 octant(uint8_t n) const;
 		AABB3 square() const;
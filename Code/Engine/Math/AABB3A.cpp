@@ -0,0 +1,88 @@
+#include "AABB3A.h"
+#include "Triangle3.h"
+
+#ifdef _DEBUG
+#include <cassert>
+#include <cstdlib>
+#endif
+
+namespace eae6320
+{
+	bool AABB3A::intersects(const Triangle3 & tri) const
+	{
+		// the triangle is stored unaligned anyway
+		return AABB3(*this).intersects(tri);
+	}
+
+	AABB3A AABB3A::octant(uint8_t n) const
+	{
+		Vector3A center = (vmin + vmax) * 0.5f;
+
+#if defined(EAE6320_SSE)
+		// lanes whose bit is set take the lower half
+		__m128i bits = _mm_and_si128(_mm_set1_epi32(n), _mm_setr_epi32(1, 2, 4, 0));
+		__m128 lower = _mm_castsi128_ps(_mm_cmpgt_epi32(bits, _mm_setzero_si128()));
+		return AABB3A(
+			Vector3A(_mm_or_ps(_mm_and_ps(lower, vmin.v), _mm_andnot_ps(lower, center.v))),
+			Vector3A(_mm_or_ps(_mm_and_ps(lower, center.v), _mm_andnot_ps(lower, vmax.v))));
+#else
+		AABB3A subbox(*this);
+
+		if (n & 1) subbox.vmax.x = center.x;
+		else subbox.vmin.x = center.x;
+		if (n & 2) subbox.vmax.y = center.y;
+		else subbox.vmin.y = center.y;
+		if (n & 4) subbox.vmax.z = center.z;
+		else subbox.vmin.z = center.z;
+
+		return subbox;
+#endif
+	}
+
+	AABB3A AABB3A::square() const
+	{
+		Vector3A extents = (vmax - vmin) / 2;
+
+		float max_extent = extents.max_dim();
+
+		Vector3A diff = Vector3A(max_extent, max_extent, max_extent) - extents;
+
+		return AABB3A(vmin - diff, vmax + diff);
+	}
+
+#ifdef _DEBUG
+	namespace
+	{
+		Vector3 random_point()
+		{
+			return Vector3(
+				20.0f * rand() / RAND_MAX - 10.0f,
+				20.0f * rand() / RAND_MAX - 10.0f,
+				20.0f * rand() / RAND_MAX - 10.0f);
+		}
+	}
+
+	void AABB3A::test()
+	{
+		for (int n = 0; n < 10000; ++n)
+		{
+			Vector3 p = random_point(), q = random_point(), r = random_point(), s = random_point();
+			AABB3 box(Vector3::min3(p, q), Vector3::max3(p, q));
+			AABB3 other(Vector3::min3(r, s), Vector3::max3(r, s));
+			Segment3 segment(random_point(), random_point());
+			AABB3A box_a(box), other_a(other);
+
+			assert(box_a.contains(other_a) == box.contains(other));
+			assert(box_a.intersects(other_a) == box.intersects(other));
+			assert(box_a.intersects(segment) == box.intersects(segment));
+
+			uint8_t i = static_cast<uint8_t>(n & 7);
+			AABB3 sub = box.octant(i), sub_a = AABB3(box_a.octant(i));
+			assert(sub.vmin == sub_a.vmin && sub.vmax == sub_a.vmax);
+
+			AABB3 square = box.square(), square_a = AABB3(box_a.square());
+			assert(square.vmin == square_a.vmin && square.vmax == square_a.vmax);
+		}
+	}
+#endif
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "AABB3.h"
+#include "Vector3A.h"
+
+namespace eae6320
+{
+	// AABB3 with both corners in SIMD registers; see Vector3A
+	struct alignas(16) AABB3A
+	{
+		Vector3A vmin, vmax;
+
+		AABB3A() {}
+		AABB3A(const AABB3A & other) : vmin(other.vmin), vmax(other.vmax) {}
+		AABB3A(Vector3A vmin, Vector3A vmax) : vmin(vmin), vmax(vmax) {}
+		explicit AABB3A(const AABB3 & other) : vmin(other.vmin), vmax(other.vmax) {}
+		explicit operator AABB3() const { return AABB3(Vector3(vmin), Vector3(vmax)); }
+		~AABB3A() {}
+
+		AABB3A & operator=(const AABB3A & other)
+		{
+			vmin = other.vmin;
+			vmax = other.vmax;
+			return *this;
+		}
+
+		AABB3A scale(const Vector3A & rhs) const
+		{
+			return AABB3A(vmin.scale(rhs), vmax.scale(rhs));
+		}
+
+		bool contains(const AABB3A &) const;
+		bool intersects(const AABB3A &) const;
+		bool intersects(const Segment3 &) const;
+		// the segment from a to b, for callers testing one segment against many boxes
+		bool intersects(const Vector3A & a, const Vector3A & b) const;
+		bool intersects(const Triangle3 &) const;
+
+		AABB3A octant(uint8_t n) const;
+		AABB3A square() const;
+
+		// compares against the AABB3 versions
+		static void test()
+#ifdef _DEBUG
+		;
+#else
+		{}
+#endif
+	};
+
+	// the hot tests are inline
+
+#if defined(EAE6320_SSE)
+
+	inline bool AABB3A::contains(const AABB3A & other) const
+	{
+		__m128 outside = _mm_or_ps(_mm_cmpgt_ps(vmin.v, other.vmin.v), _mm_cmplt_ps(vmax.v, other.vmax.v));
+		return (_mm_movemask_ps(outside) & 0x7) == 0;
+	}
+
+	inline bool AABB3A::intersects(const AABB3A & other) const
+	{
+		__m128 apart = _mm_or_ps(_mm_cmpgt_ps(vmin.v, other.vmax.v), _mm_cmplt_ps(vmax.v, other.vmin.v));
+		return (_mm_movemask_ps(apart) & 0x7) == 0;
+	}
+
+	inline bool AABB3A::intersects(const Vector3A & a, const Vector3A & b) const
+	{
+		// AABB3's separating axis test with every length doubled, which saves the halving
+		__m128 e = _mm_sub_ps(vmax.v, vmin.v);
+		__m128 m = _mm_sub_ps(_mm_add_ps(a.v, b.v), _mm_add_ps(vmin.v, vmax.v));
+		__m128 d = _mm_sub_ps(b.v, a.v);
+
+		// world coordinate axes
+		__m128 ad = Simd::abs(d);
+		if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(ad, e), Simd::abs(m))) & 0x7)
+			return false;
+
+		// cross products of the segment direction with the axes,
+		// padded for segments (near) parallel to an axis
+		ad = _mm_add_ps(ad, _mm_set1_ps(1e-9f));
+		__m128 r = _mm_add_ps(
+			_mm_mul_ps(EAE6320_SWIZZLE(e, 1, 2, 0, 3), EAE6320_SWIZZLE(ad, 2, 0, 1, 3)),
+			_mm_mul_ps(EAE6320_SWIZZLE(e, 2, 0, 1, 3), EAE6320_SWIZZLE(ad, 1, 2, 0, 3)));
+		return (_mm_movemask_ps(_mm_cmpgt_ps(Simd::abs(Simd::cross(m, d)), r)) & 0x7) == 0;
+	}
+
+#else
+
+	inline bool AABB3A::contains(const AABB3A & other) const
+	{
+		return vmin.x <= other.vmin.x && vmin.y <= other.vmin.y && vmin.z <= other.vmin.z
+			&& vmax.x >= other.vmax.x && vmax.y >= other.vmax.y && vmax.z >= other.vmax.z;
+	}
+
+	inline bool AABB3A::intersects(const AABB3A & other) const
+	{
+		return vmin.x <= other.vmax.x && vmin.y <= other.vmax.y && vmin.z <= other.vmax.z
+			&& vmax.x >= other.vmin.x && vmax.y >= other.vmin.y && vmax.z >= other.vmin.z;
+	}
+
+	inline bool AABB3A::intersects(const Vector3A & a, const Vector3A & b) const
+	{
+		Vector3A e = vmax - vmin;
+		Vector3A m = (a + b) - (vmin + vmax);
+		Vector3A d = b - a;
+
+		Vector3A ad = d.abs();
+		Vector3A check = ad + e - m.abs();
+		if (check.x < 0 || check.y < 0 || check.z < 0)
+			return false;
+
+		ad += Vector3A(1e-9f, 1e-9f, 1e-9f);
+
+		if (fabsf(m.y * d.z - m.z * d.y) > e.y * ad.z + e.z * ad.y) return false;
+		if (fabsf(m.z * d.x - m.x * d.z) > e.x * ad.z + e.z * ad.x) return false;
+		if (fabsf(m.x * d.y - m.y * d.x) > e.x * ad.y + e.y * ad.x) return false;
+
+		return true;
+	}
+
+#endif
+
+	inline bool AABB3A::intersects(const Segment3 & segment) const
+	{
+		return intersects(Vector3A(segment.a), Vector3A(segment.b));
+	}
+}
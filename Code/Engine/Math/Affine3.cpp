@@ -0,0 +1,144 @@
+#include "Affine3.h"
+#include <cmath>
+
+#ifdef _DEBUG
+#include <cassert>
+#include <cstdlib>
+#endif
+
+namespace eae6320
+{
+	namespace
+	{
+		// not from Matrix4::Identity, which may not be constructed yet
+		Affine3 identity()
+		{
+			Affine3 result;
+			for (size_t j = 0; j < 3; ++j)
+				result.m[j][j] = 1.0f;
+			return result;
+		}
+	}
+
+	const Affine3 Affine3::Identity = identity();
+
+	Affine3 Affine3::create_RST(Versor const & q, Vector3 const & s, Vector3 const & p)
+	{
+		// Matrix4::rotation_q(q).dot(Matrix4::scale(s)) with p in the last row,
+		// which scales column j of the rotation by s[j]
+		Matrix4 r = Matrix4::rotation_q(q);
+		const float scale[3] = { s.x, s.y, s.z }, position[3] = { p.x, p.y, p.z };
+		Affine3 result;
+		for (size_t j = 0; j < 3; ++j)
+		{
+			for (size_t i = 0; i < 3; ++i)
+				result.m[j][i] = r.m[i][j] * scale[j];
+			result.m[j][3] = position[j];
+		}
+		return result;
+	}
+
+	Affine3 Affine3::inverse() const
+	{
+		// rows of the linear part's inverse are cross products of its columns,
+		// and the translation is carried back through it
+#if defined(EAE6320_SSE)
+		__m128 c0 = _mm_loadu_ps(m[0]), c1 = _mm_loadu_ps(m[1]), c2 = _mm_loadu_ps(m[2]);
+		__m128 r0 = Simd::cross(c1, c2), r1 = Simd::cross(c2, c0), r2 = Simd::cross(c0, c1);
+		__m128 rdet = _mm_div_ps(_mm_set1_ps(1.0f), Simd::sum(_mm_mul_ps(c0, r0)));
+		r0 = _mm_mul_ps(r0, rdet);
+		r1 = _mm_mul_ps(r1, rdet);
+		r2 = _mm_mul_ps(r2, rdet);
+
+		// the translation is the columns' w lanes
+		__m128 t = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(c0, c1, c2, t);
+		__m128 r3 = _mm_sub_ps(_mm_setzero_ps(), Simd::predot(t, r0, r1, r2, _mm_setzero_ps()));
+
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		Affine3 result;
+		_mm_storeu_ps(result.m[0], r0);
+		_mm_storeu_ps(result.m[1], r1);
+		_mm_storeu_ps(result.m[2], r2);
+		return result;
+#else
+		Vector3 c0(m[0][0], m[0][1], m[0][2]), c1(m[1][0], m[1][1], m[1][2]), c2(m[2][0], m[2][1], m[2][2]);
+		Vector3 r[3] = { c1.cross(c2), c2.cross(c0), c0.cross(c1) };
+		float rdet = 1.0f / c0.dot(r[0]);
+		for (size_t i = 0; i < 3; ++i)
+			r[i] *= rdet;
+		Vector3 t = -(m[0][3] * r[0] + m[1][3] * r[1] + m[2][3] * r[2]);
+
+		return Affine3(Matrix4(
+			r[0].x, r[0].y, r[0].z, 0,
+			r[1].x, r[1].y, r[1].z, 0,
+			r[2].x, r[2].y, r[2].z, 0,
+			t.x, t.y, t.z, 1));
+#endif
+	}
+
+#ifdef _DEBUG
+	namespace
+	{
+		float random_unit()
+		{
+			return 2.0f * rand() / RAND_MAX - 1.0f;
+		}
+
+		bool close(Matrix4 const & a, Matrix4 const & b, float tolerance)
+		{
+			for (size_t i = 0; i < 4; ++i)
+				for (size_t j = 0; j < 4; ++j)
+					if (fabsf(a.m[i][j] - b.m[i][j]) > tolerance * (1.0f + fabsf(a.m[i][j]) + fabsf(b.m[i][j])))
+						return false;
+			return true;
+		}
+
+		bool close(Vector3 const & a, Vector4 const & b, float tolerance)
+		{
+			return (Vector4(a, b.w) - b).norm() <= tolerance * (1.0f + b.norm());
+		}
+
+		Matrix4 random_affine()
+		{
+			Matrix4 a = Matrix4::Identity;
+			for (size_t i = 0; i < 4; ++i)
+				for (size_t j = 0; j < 3; ++j)
+					a.m[i][j] = random_unit();
+			return a;
+		}
+	}
+
+	void Affine3::test()
+	{
+		const float tolerance = 1e-5f;
+
+		for (int n = 0; n < 1000; ++n)
+		{
+			Matrix4 a = random_affine(), b = random_affine();
+			Affine3 a3(a), b3(b);
+			Vector3 v(random_unit(), random_unit(), random_unit());
+
+			assert(close(Matrix4(a3), a, 0.0f));
+			assert(close(Matrix4(a3.dot(b3)), a.dot(b), tolerance));
+			assert(close(a3.transform_point(v), a.predot1(v), tolerance));
+			assert(close(a3.transform_vector(v), a.predot0(v), tolerance));
+
+			// skip the nearly singular draws, where neither path is accurate
+			if (fabsf(a.determinant()) > 0.05f)
+				assert(close(Matrix4(a3.inverse()), a.inverse_affine(), 1e-4f));
+
+			Versor q = Versor(Vector4(random_unit(), random_unit(), random_unit(), random_unit())).normalize();
+			Vector3 s(random_unit() + 2.0f, random_unit() + 2.0f, random_unit() + 2.0f);
+			Matrix4 model = Matrix4::rotation_q(q).dot(Matrix4::scale(s));
+			model.m[3][0] = v.x;
+			model.m[3][1] = v.y;
+			model.m[3][2] = v.z;
+			assert(close(Matrix4(create_RST(q, s, v)), model, tolerance));
+		}
+
+		assert(close(Matrix4(Identity), Matrix4::Identity, 0.0f));
+		assert(close(Matrix4(Identity.inverse()), Matrix4::Identity, 0.0f));
+	}
+#endif
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Matrix4.h"
+
+namespace eae6320
+{
+	// a Matrix4 whose last column is always (0, 0, 0, 1), which is every
+	// model and camera transform: p * linear + translation for row vectors p.
+	// stored as its first three columns, so each one fills a SIMD register
+	// and the whole thing is 12 floats instead of 16.
+	struct Affine3
+	{
+		static const Affine3 Identity;
+
+		Affine3();
+		Affine3(Affine3 const &);
+		// drops m's last column, which should be (0, 0, 0, 1)
+		explicit Affine3(Matrix4 const & m);
+		// for uploading to shaders
+		explicit operator Matrix4() const;
+
+		// rotation, then scale, then translation; what Graphics::DrawModel draws
+		static Affine3 create_RST(Versor const & q, Vector3 const & s, Vector3 const & p);
+
+		Affine3 & operator=(Affine3 const & rhs);
+
+		Vector3 translation() const;
+
+		// this transform, then rhs
+		Affine3 dot(Affine3 const & rhs) const;
+		// the same as Matrix4::predot1 and predot0, without w
+		Vector3 transform_point(Vector3 const & p) const;
+		Vector3 transform_vector(Vector3 const & v) const;
+
+		Affine3 inverse() const;
+
+		// compares against Matrix4
+		static void test()
+#ifdef _DEBUG
+		;
+#else
+		{}
+#endif
+
+		// m[j] is column j: (linear[0][j], linear[1][j], linear[2][j], translation[j])
+		float m[3][4];
+	};
+
+	inline Affine3 operator*(Affine3 const & lhs, Affine3 const & rhs);
+	inline Affine3 & operator*=(Affine3 & lhs, Affine3 const & rhs);
+
+#include "Affine3.inl"
+}
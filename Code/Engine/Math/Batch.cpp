@@ -0,0 +1,507 @@
+#include "Batch.h"
+
+#ifdef _DEBUG
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+#endif
+
+namespace eae6320
+{
+	namespace
+	{
+		// p * linear + translation for row vectors p
+		struct Affine
+		{
+			float linear[3][3];
+			float translation[3];
+		};
+
+		Affine to_affine(const Matrix4 & m, bool translate)
+		{
+			Affine a;
+			for (size_t i = 0; i < 3; ++i)
+			{
+				for (size_t j = 0; j < 3; ++j)
+					a.linear[i][j] = m.m[i][j];
+				a.translation[i] = translate ? m.m[3][i] : 0.0f;
+			}
+			return a;
+		}
+
+		Affine to_affine(const Versor & q)
+		{
+			// the rows are where q takes each axis
+			Vector3 rows[3] = { q.rotate(Vector3::I), q.rotate(Vector3::J), q.rotate(Vector3::K) };
+			Affine a;
+			for (size_t i = 0; i < 3; ++i)
+			{
+				a.linear[i][0] = rows[i].x;
+				a.linear[i][1] = rows[i].y;
+				a.linear[i][2] = rows[i].z;
+				a.translation[i] = 0.0f;
+			}
+			return a;
+		}
+
+		inline void transform(const Affine & a, float & x, float & y, float & z)
+		{
+			float px = x, py = y, pz = z;
+			x = px * a.linear[0][0] + py * a.linear[1][0] + pz * a.linear[2][0] + a.translation[0];
+			y = px * a.linear[0][1] + py * a.linear[1][1] + pz * a.linear[2][1] + a.translation[1];
+			z = px * a.linear[0][2] + py * a.linear[1][2] + pz * a.linear[2][2] + a.translation[2];
+		}
+
+		void transform(const Affine & a, const Vector3 * in, Vector3 * out, size_t count)
+		{
+			size_t i = 0;
+#if defined(EAE6320_SSE)
+			__m128 m[3][3], t[3];
+			for (size_t r = 0; r < 3; ++r)
+			{
+				for (size_t c = 0; c < 3; ++c)
+					m[r][c] = _mm_set1_ps(a.linear[r][c]);
+				t[r] = _mm_set1_ps(a.translation[r]);
+			}
+
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 x, y, z;
+				Simd::load_xyz4(&in[i].x, x, y, z);
+				__m128 ox = Simd::madd(x, m[0][0], Simd::madd(y, m[1][0], Simd::madd(z, m[2][0], t[0])));
+				__m128 oy = Simd::madd(x, m[0][1], Simd::madd(y, m[1][1], Simd::madd(z, m[2][1], t[1])));
+				__m128 oz = Simd::madd(x, m[0][2], Simd::madd(y, m[1][2], Simd::madd(z, m[2][2], t[2])));
+				Simd::store_xyz4(&out[i].x, ox, oy, oz);
+			}
+#endif
+			for (; i < count; ++i)
+			{
+				out[i] = in[i];
+				transform(a, out[i].x, out[i].y, out[i].z);
+			}
+		}
+
+		void transform(const Affine & a, Vector3SoA in, Vector3SoA out, size_t count)
+		{
+			size_t i = 0;
+#if defined(EAE6320_AVX)
+			__m256 m[3][3], t[3];
+			for (size_t r = 0; r < 3; ++r)
+			{
+				for (size_t c = 0; c < 3; ++c)
+					m[r][c] = _mm256_set1_ps(a.linear[r][c]);
+				t[r] = _mm256_set1_ps(a.translation[r]);
+			}
+
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256 x = _mm256_loadu_ps(in.x + i), y = _mm256_loadu_ps(in.y + i), z = _mm256_loadu_ps(in.z + i);
+				_mm256_storeu_ps(out.x + i, Simd::madd(x, m[0][0], Simd::madd(y, m[1][0], Simd::madd(z, m[2][0], t[0]))));
+				_mm256_storeu_ps(out.y + i, Simd::madd(x, m[0][1], Simd::madd(y, m[1][1], Simd::madd(z, m[2][1], t[1]))));
+				_mm256_storeu_ps(out.z + i, Simd::madd(x, m[0][2], Simd::madd(y, m[1][2], Simd::madd(z, m[2][2], t[2]))));
+			}
+#elif defined(EAE6320_SSE)
+			__m128 m[3][3], t[3];
+			for (size_t r = 0; r < 3; ++r)
+			{
+				for (size_t c = 0; c < 3; ++c)
+					m[r][c] = _mm_set1_ps(a.linear[r][c]);
+				t[r] = _mm_set1_ps(a.translation[r]);
+			}
+
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 x = _mm_loadu_ps(in.x + i), y = _mm_loadu_ps(in.y + i), z = _mm_loadu_ps(in.z + i);
+				_mm_storeu_ps(out.x + i, Simd::madd(x, m[0][0], Simd::madd(y, m[1][0], Simd::madd(z, m[2][0], t[0]))));
+				_mm_storeu_ps(out.y + i, Simd::madd(x, m[0][1], Simd::madd(y, m[1][1], Simd::madd(z, m[2][1], t[1]))));
+				_mm_storeu_ps(out.z + i, Simd::madd(x, m[0][2], Simd::madd(y, m[1][2], Simd::madd(z, m[2][2], t[2]))));
+			}
+#endif
+			for (; i < count; ++i)
+			{
+				float x = in.x[i], y = in.y[i], z = in.z[i];
+				transform(a, x, y, z);
+				out.x[i] = x;
+				out.y[i] = y;
+				out.z[i] = z;
+			}
+		}
+
+#if defined(EAE6320_SSE)
+		// four Versors, one register per component
+		struct Versor4
+		{
+			__m128 x, y, z, w;
+		};
+
+		inline Versor4 load4(const Versor * q)
+		{
+			Versor4 r = { _mm_loadu_ps(&q[0].x), _mm_loadu_ps(&q[1].x), _mm_loadu_ps(&q[2].x), _mm_loadu_ps(&q[3].x) };
+			_MM_TRANSPOSE4_PS(r.x, r.y, r.z, r.w);
+			return r;
+		}
+
+		inline void store4(Versor * q, Versor4 r)
+		{
+			_MM_TRANSPOSE4_PS(r.x, r.y, r.z, r.w);
+			_mm_storeu_ps(&q[0].x, r.x);
+			_mm_storeu_ps(&q[1].x, r.y);
+			_mm_storeu_ps(&q[2].x, r.z);
+			_mm_storeu_ps(&q[3].x, r.w);
+		}
+
+		inline __m128 dot4(const Versor4 & a, const Versor4 & b)
+		{
+			return Simd::madd(a.x, b.x, Simd::madd(a.y, b.y, Simd::madd(a.z, b.z, _mm_mul_ps(a.w, b.w))));
+		}
+
+		inline __m128 select(__m128 mask, __m128 a, __m128 b)
+		{
+			return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+		}
+
+		// as Vector4::normalize, zero lanes stay zero
+		inline Versor4 normalize4(const Versor4 & q)
+		{
+			__m128 n = _mm_sqrt_ps(dot4(q, q));
+			n = select(_mm_cmpeq_ps(n, _mm_setzero_ps()), _mm_set1_ps(1.0f), n);
+			Versor4 r = { _mm_div_ps(q.x, n), _mm_div_ps(q.y, n), _mm_div_ps(q.z, n), _mm_div_ps(q.w, n) };
+			return r;
+		}
+
+		// negates the lanes of b facing away from a, returning a . b after the flip
+		inline __m128 nearer4(const Versor4 & a, Versor4 & b)
+		{
+			__m128 d = dot4(a, b);
+			__m128 flip = _mm_and_ps(_mm_cmplt_ps(d, _mm_setzero_ps()), _mm_set1_ps(-0.0f));
+			b.x = _mm_xor_ps(b.x, flip);
+			b.y = _mm_xor_ps(b.y, flip);
+			b.z = _mm_xor_ps(b.z, flip);
+			b.w = _mm_xor_ps(b.w, flip);
+			return _mm_xor_ps(d, flip);
+		}
+
+		// a * wa + b * wb, lane by lane
+		inline Versor4 blend4(const Versor4 & a, __m128 wa, const Versor4 & b, __m128 wb)
+		{
+			Versor4 r = {
+				Simd::madd(a.x, wa, _mm_mul_ps(b.x, wb)), Simd::madd(a.y, wa, _mm_mul_ps(b.y, wb)),
+				Simd::madd(a.z, wa, _mm_mul_ps(b.z, wb)), Simd::madd(a.w, wa, _mm_mul_ps(b.w, wb)) };
+			return r;
+		}
+#endif
+	}
+
+	void Batch::transform_points(const Matrix4 & m, const Vector3 * in, Vector3 * out, size_t count)
+	{
+		transform(to_affine(m, true), in, out, count);
+	}
+
+	void Batch::transform_points(const Matrix4 & m, Vector3SoA in, Vector3SoA out, size_t count)
+	{
+		transform(to_affine(m, true), in, out, count);
+	}
+
+	void Batch::transform_vectors(const Matrix4 & m, const Vector3 * in, Vector3 * out, size_t count)
+	{
+		transform(to_affine(m, false), in, out, count);
+	}
+
+	void Batch::transform_vectors(const Matrix4 & m, Vector3SoA in, Vector3SoA out, size_t count)
+	{
+		transform(to_affine(m, false), in, out, count);
+	}
+
+	void Batch::scale(Vector3 s, const Vector3 * in, Vector3 * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		// four points are three registers, each with its own rotation of (sx, sy, sz)
+		__m128 s0 = _mm_setr_ps(s.x, s.y, s.z, s.x);
+		__m128 s1 = _mm_setr_ps(s.y, s.z, s.x, s.y);
+		__m128 s2 = _mm_setr_ps(s.z, s.x, s.y, s.z);
+		for (; i + 4 <= count; i += 4)
+		{
+			const float * src = &in[i].x;
+			float * dst = &out[i].x;
+			__m128 a = _mm_loadu_ps(src), b = _mm_loadu_ps(src + 4), c = _mm_loadu_ps(src + 8);
+			_mm_storeu_ps(dst, _mm_mul_ps(a, s0));
+			_mm_storeu_ps(dst + 4, _mm_mul_ps(b, s1));
+			_mm_storeu_ps(dst + 8, _mm_mul_ps(c, s2));
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = in[i].scale(s);
+	}
+
+	void Batch::scale(Vector3 s, Vector3SoA in, Vector3SoA out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_AVX)
+		__m256 sx = _mm256_set1_ps(s.x), sy = _mm256_set1_ps(s.y), sz = _mm256_set1_ps(s.z);
+		for (; i + 8 <= count; i += 8)
+		{
+			_mm256_storeu_ps(out.x + i, _mm256_mul_ps(_mm256_loadu_ps(in.x + i), sx));
+			_mm256_storeu_ps(out.y + i, _mm256_mul_ps(_mm256_loadu_ps(in.y + i), sy));
+			_mm256_storeu_ps(out.z + i, _mm256_mul_ps(_mm256_loadu_ps(in.z + i), sz));
+		}
+#elif defined(EAE6320_SSE)
+		__m128 sx = _mm_set1_ps(s.x), sy = _mm_set1_ps(s.y), sz = _mm_set1_ps(s.z);
+		for (; i + 4 <= count; i += 4)
+		{
+			_mm_storeu_ps(out.x + i, _mm_mul_ps(_mm_loadu_ps(in.x + i), sx));
+			_mm_storeu_ps(out.y + i, _mm_mul_ps(_mm_loadu_ps(in.y + i), sy));
+			_mm_storeu_ps(out.z + i, _mm_mul_ps(_mm_loadu_ps(in.z + i), sz));
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			out.x[i] = in.x[i] * s.x;
+			out.y[i] = in.y[i] * s.y;
+			out.z[i] = in.z[i] * s.z;
+		}
+	}
+
+	void Batch::rotate(const Versor & q, const Vector3 * in, Vector3 * out, size_t count)
+	{
+		transform(to_affine(q), in, out, count);
+	}
+
+	void Batch::rotate(const Versor & q, Vector3SoA in, Vector3SoA out, size_t count)
+	{
+		transform(to_affine(q), in, out, count);
+	}
+
+	void Batch::rotate(const Versor * q, const Vector3 * in, Vector3 * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		__m128 two = _mm_set1_ps(2.0f);
+		for (; i + 4 <= count; i += 4)
+		{
+			Versor4 u = load4(q + i);
+			__m128 x, y, z;
+			Simd::load_xyz4(&in[i].x, x, y, z);
+
+			// as Versor::rotate: v + w t + u x t, with t = 2 u x v
+			__m128 tx = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(u.y, z), _mm_mul_ps(u.z, y)));
+			__m128 ty = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(u.z, x), _mm_mul_ps(u.x, z)));
+			__m128 tz = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(u.x, y), _mm_mul_ps(u.y, x)));
+			x = _mm_add_ps(Simd::madd(u.w, tx, x), _mm_sub_ps(_mm_mul_ps(u.y, tz), _mm_mul_ps(u.z, ty)));
+			y = _mm_add_ps(Simd::madd(u.w, ty, y), _mm_sub_ps(_mm_mul_ps(u.z, tx), _mm_mul_ps(u.x, tz)));
+			z = _mm_add_ps(Simd::madd(u.w, tz, z), _mm_sub_ps(_mm_mul_ps(u.x, ty), _mm_mul_ps(u.y, tx)));
+			Simd::store_xyz4(&out[i].x, x, y, z);
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = q[i].rotate(in[i]);
+	}
+
+	void Batch::compose(const Versor * lhs, const Versor * rhs, Versor * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			Versor4 l = load4(lhs + i), r = load4(rhs + i);
+			Versor4 q = {
+				_mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(l.w, r.x), _mm_mul_ps(l.x, r.w)), _mm_mul_ps(l.y, r.z)), _mm_mul_ps(l.z, r.y)),
+				_mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(l.w, r.y), _mm_mul_ps(l.y, r.w)), _mm_mul_ps(l.z, r.x)), _mm_mul_ps(l.x, r.z)),
+				_mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(l.w, r.z), _mm_mul_ps(l.z, r.w)), _mm_mul_ps(l.x, r.y)), _mm_mul_ps(l.y, r.x)),
+				_mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(l.w, r.w), _mm_mul_ps(l.x, r.x)), _mm_mul_ps(l.y, r.y)), _mm_mul_ps(l.z, r.z)) };
+			store4(out + i, q);
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = lhs[i] * rhs[i];
+	}
+
+	void Batch::normalize(const Versor * in, Versor * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+			store4(out + i, normalize4(load4(in + i)));
+#endif
+		for (; i < count; ++i)
+		{
+			out[i] = in[i];
+			out[i].normalize();
+		}
+	}
+
+	void Batch::nlerp(const Versor * a, const Versor * b, float t, Versor * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		__m128 wa = _mm_set1_ps(1.0f - t), wb = _mm_set1_ps(t);
+		for (; i + 4 <= count; i += 4)
+		{
+			Versor4 from = load4(a + i), to = load4(b + i);
+			nearer4(from, to);
+			store4(out + i, normalize4(blend4(from, wa, to, wb)));
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = Versor::nlerp(a[i], b[i], t);
+	}
+
+	void Batch::slerp(const Versor * a, const Versor * b, float t, Versor * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			Versor4 from = load4(a + i), to = load4(b + i);
+			__m128 d = nearer4(from, to);
+
+			// there is no vector acos or sin, so only the weights are per lane
+			alignas(16) float dots[4], weight_a[4], weight_b[4];
+			_mm_store_ps(dots, d);
+			for (size_t lane = 0; lane < 4; ++lane)
+			{
+				float theta = acos(dots[lane]), s = sin(theta);
+				weight_a[lane] = sin((1.0f - t) * theta) / s;
+				weight_b[lane] = sin(t * theta) / s;
+			}
+
+			// nearly equal lanes fall back to nlerp, as in Versor::slerp
+			__m128 equal = _mm_cmpgt_ps(d, _mm_set1_ps(0.9995f));
+			__m128 wa = select(equal, _mm_set1_ps(1.0f - t), _mm_load_ps(weight_a));
+			__m128 wb = select(equal, _mm_set1_ps(t), _mm_load_ps(weight_b));
+			Versor4 q = blend4(from, wa, to, wb), unit = normalize4(q);
+			q.x = select(equal, unit.x, q.x);
+			q.y = select(equal, unit.y, q.y);
+			q.z = select(equal, unit.z, q.z);
+			q.w = select(equal, unit.w, q.w);
+			store4(out + i, q);
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = Versor::slerp(a[i], b[i], t);
+	}
+
+#ifdef _DEBUG
+	namespace
+	{
+		float random_unit()
+		{
+			return 2.0f * rand() / RAND_MAX - 1.0f;
+		}
+
+		bool close(Vector3 a, Vector3 b)
+		{
+			return (a - b).norm() <= 1e-5f * (1.0f + a.norm());
+		}
+
+		bool close(Versor a, Versor b)
+		{
+			return (a - b).norm() <= 1e-5f;
+		}
+
+		Versor random_versor()
+		{
+			return Versor(Vector4(random_unit(), random_unit(), random_unit(), random_unit())).normalize();
+		}
+	}
+
+	void Batch::test()
+	{
+		Matrix4 m;
+		for (size_t i = 0; i < 4; ++i)
+			for (size_t j = 0; j < 4; ++j)
+				m.m[i][j] = random_unit();
+		Versor q = random_versor();
+		Vector3 s(random_unit(), random_unit(), random_unit());
+
+		// every count up to a few full iterations, to cover each remainder
+		for (size_t count = 0; count < 20; ++count)
+		{
+			std::vector<Vector3> in(count), out(count);
+			std::vector<float> x(count), y(count), z(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				in[i] = Vector3(random_unit(), random_unit(), random_unit()) * 10.0f;
+				x[i] = in[i].x;
+				y[i] = in[i].y;
+				z[i] = in[i].z;
+			}
+			Vector3SoA soa = { x.data(), y.data(), z.data() };
+
+			transform_points(m, in.data(), out.data(), count);
+			for (size_t i = 0; i < count; ++i)
+				assert(close(out[i], m.predot1(in[i]).xyz()));
+
+			transform_vectors(m, in.data(), out.data(), count);
+			for (size_t i = 0; i < count; ++i)
+				assert(close(out[i], m.predot0(in[i]).xyz()));
+
+			scale(s, in.data(), out.data(), count);
+			for (size_t i = 0; i < count; ++i)
+				assert(out[i] == in[i].scale(s));
+
+			rotate(q, in.data(), out.data(), count);
+			for (size_t i = 0; i < count; ++i)
+				assert(close(out[i], q.rotate(in[i])));
+
+			// SoA in place, so each step reads the last one's output
+			std::vector<Vector3> expected(in);
+			transform_points(m, soa, soa, count);
+			transform_vectors(m, soa, soa, count);
+			scale(s, soa, soa, count);
+			rotate(q, soa, soa, count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				expected[i] = q.rotate(m.predot0(m.predot1(in[i]).xyz()).xyz().scale(s));
+				assert(close(Vector3(x[i], y[i], z[i]), expected[i]));
+			}
+
+			// and AoS in place
+			transform_points(m, in.data(), in.data(), count);
+			transform_vectors(m, in.data(), in.data(), count);
+			scale(s, in.data(), in.data(), count);
+			rotate(q, in.data(), in.data(), count);
+			for (size_t i = 0; i < count; ++i)
+				assert(close(in[i], expected[i]));
+		}
+
+		for (size_t count = 0; count < 20; ++count)
+		{
+			std::vector<Versor> a(count), b(count), out(count);
+			std::vector<Vector3> v(count), rotated(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				a[i] = random_versor();
+				// some pairs nearly equal, to take slerp's nlerp fallback
+				b[i] = i % 3 ? random_versor() : Versor(a[i] + Vector4(1e-3f, 0.0f, 0.0f, 0.0f)).normalize();
+				v[i] = Vector3(random_unit(), random_unit(), random_unit());
+			}
+
+			rotate(a.data(), v.data(), rotated.data(), count);
+			for (size_t i = 0; i < count; ++i)
+				assert(close(rotated[i], a[i].rotate(v[i])));
+
+			compose(a.data(), b.data(), out.data(), count);
+			for (size_t i = 0; i < count; ++i)
+				assert(close(out[i], a[i] * b[i]));
+
+			for (float t : { 0.0f, 0.3f, 1.0f })
+			{
+				nlerp(a.data(), b.data(), t, out.data(), count);
+				for (size_t i = 0; i < count; ++i)
+					assert(close(out[i], Versor::nlerp(a[i], b[i], t)));
+
+				slerp(a.data(), b.data(), t, out.data(), count);
+				for (size_t i = 0; i < count; ++i)
+					assert(close(out[i], Versor::slerp(a[i], b[i], t)));
+			}
+
+			for (size_t i = 0; i < count; ++i)
+				out[i] = a[i] * 3.0f;
+			normalize(out.data(), out.data(), count);
+			for (size_t i = 0; i < count; ++i)
+				assert(close(out[i], a[i]));
+		}
+	}
+#endif
+}
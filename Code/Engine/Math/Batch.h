@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Matrix4.h"
+#include "Versor.h"
+
+#include <cstddef>
+
+namespace eae6320
+{
+	// structure-of-arrays points: point i is (x[i], y[i], z[i])
+	struct Vector3SoA
+	{
+		float * x;
+		float * y;
+		float * z;
+	};
+
+	// whole-array versions of the Vector3 transforms, 4 points per iteration under SSE
+	// (8 for SoA under AVX). out may be the same array as in, but must not partly overlap it.
+	namespace Batch
+	{
+		// out[i] = (in[i], 1) * m, the row-vector convention of Matrix4::predot1
+		void transform_points(const Matrix4 & m, const Vector3 * in, Vector3 * out, size_t count);
+		void transform_points(const Matrix4 & m, Vector3SoA in, Vector3SoA out, size_t count);
+
+		// out[i] = (in[i], 0) * m, ignoring translation
+		void transform_vectors(const Matrix4 & m, const Vector3 * in, Vector3 * out, size_t count);
+		void transform_vectors(const Matrix4 & m, Vector3SoA in, Vector3SoA out, size_t count);
+
+		// out[i] = in[i].scale(s)
+		void scale(Vector3 s, const Vector3 * in, Vector3 * out, size_t count);
+		void scale(Vector3 s, Vector3SoA in, Vector3SoA out, size_t count);
+
+		// out[i] = q.rotate(in[i])
+		void rotate(const Versor & q, const Vector3 * in, Vector3 * out, size_t count);
+		void rotate(const Versor & q, Vector3SoA in, Vector3SoA out, size_t count);
+
+		// arrays of Versors, 4 per iteration under SSE
+
+		// out[i] = q[i].rotate(in[i])
+		void rotate(const Versor * q, const Vector3 * in, Vector3 * out, size_t count);
+		// out[i] = lhs[i] * rhs[i]
+		void compose(const Versor * lhs, const Versor * rhs, Versor * out, size_t count);
+		// out[i] = in[i] at unit length
+		void normalize(const Versor * in, Versor * out, size_t count);
+		// out[i] = Versor::nlerp(a[i], b[i], t), and likewise for slerp
+		void nlerp(const Versor * a, const Versor * b, float t, Versor * out, size_t count);
+		void slerp(const Versor * a, const Versor * b, float t, Versor * out, size_t count);
+
+		// compares every kernel against the single-vector math
+#ifdef _DEBUG
+		void test();
+#else
+		inline void test() {}
+#endif
+	}
+}
@@ -0,0 +1,313 @@
+#include "FastMath.h"
+
+#ifdef _DEBUG
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+#endif
+
+namespace eae6320
+{
+#if defined(EAE6320_SSE)
+	namespace
+	{
+		inline __m128 select(__m128 mask, __m128 a, __m128 b)
+		{
+			return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+		}
+
+		template <FastMath::Tier T>
+		inline __m128 rsqrt4(__m128 x)
+		{
+			if (T == FastMath::Exact)
+				return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(x));
+
+			__m128 r = _mm_rsqrt_ps(x);
+			if (T == FastMath::Medium)
+				r = _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), x), _mm_mul_ps(r, r))));
+			return r;
+		}
+
+		template <FastMath::Tier T>
+		inline void sincos4(__m128 radians, __m128 & s, __m128 & c)
+		{
+			__m128i q = _mm_cvtps_epi32(_mm_mul_ps(radians, _mm_set1_ps(0.636619772f)));
+			__m128 k = _mm_cvtepi32_ps(q);
+			__m128 r = _mm_sub_ps(radians, _mm_mul_ps(k, _mm_set1_ps(1.5703125f)));
+			r = _mm_sub_ps(r, _mm_mul_ps(k, _mm_set1_ps(4.837512969970703125e-4f)));
+			r = _mm_sub_ps(r, _mm_mul_ps(k, _mm_set1_ps(7.54978995489188216e-8f)));
+			__m128 r2 = _mm_mul_ps(r, r);
+
+			__m128 ps, pc;
+			if (T == FastMath::Coarse)
+			{
+				ps = Simd::madd(r2, _mm_set1_ps(0.00833333333f), _mm_set1_ps(-0.166666667f));
+				ps = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), ps));
+				pc = Simd::madd(r2, _mm_set1_ps(0.0416666667f), _mm_set1_ps(-0.5f));
+				pc = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(r2, pc));
+			}
+			else
+			{
+				ps = Simd::madd(_mm_set1_ps(-1.9515295891e-4f), r2, _mm_set1_ps(8.3321608736e-3f));
+				ps = _mm_sub_ps(_mm_mul_ps(ps, r2), _mm_set1_ps(1.6666654611e-1f));
+				ps = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), ps));
+				pc = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), r2), _mm_set1_ps(1.388731625493765e-3f));
+				pc = Simd::madd(pc, r2, _mm_set1_ps(4.166664568298827e-2f));
+				pc = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_mul_ps(_mm_mul_ps(r2, r2), pc));
+			}
+
+			__m128 odd = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+			__m128 s_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+			__m128 c_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+			s = _mm_xor_ps(select(odd, pc, ps), s_sign);
+			c = _mm_xor_ps(select(odd, ps, pc), c_sign);
+		}
+
+		template <FastMath::Tier T>
+		inline __m128 atan24(__m128 y, __m128 x)
+		{
+			const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+			__m128 ax = Simd::abs(x), ay = Simd::abs(y);
+			__m128 lo = _mm_min_ps(ax, ay), hi = _mm_max_ps(ax, ay);
+			__m128 z = select(_mm_cmpgt_ps(hi, zero), _mm_div_ps(lo, hi), zero);
+
+			__m128 r;
+			if (T == FastMath::Coarse)
+			{
+				r = Simd::madd(_mm_sub_ps(one, z), Simd::madd(_mm_set1_ps(0.0663f), z, _mm_set1_ps(0.2447f)), _mm_set1_ps(0.785398163f));
+				r = _mm_mul_ps(z, r);
+			}
+			else
+			{
+				__m128 upper = _mm_cmpgt_ps(z, _mm_set1_ps(0.414213562f));
+				__m128 w = select(upper, _mm_div_ps(_mm_sub_ps(z, one), _mm_add_ps(z, one)), z);
+				__m128 w2 = _mm_mul_ps(w, w);
+				r = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(8.05374449538e-2f), w2), _mm_set1_ps(1.38776856032e-1f));
+				r = Simd::madd(r, w2, _mm_set1_ps(1.99777106478e-1f));
+				r = _mm_sub_ps(_mm_mul_ps(r, w2), _mm_set1_ps(3.33329491539e-1f));
+				r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r, w2), w), w);
+				r = _mm_add_ps(r, _mm_and_ps(upper, _mm_set1_ps(0.785398163f)));
+			}
+
+			r = select(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(1.57079633f), r), r);
+			__m128 negative = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(x), 31));
+			r = select(negative, _mm_sub_ps(_mm_set1_ps(3.14159265f), r), r);
+			__m128 sign = _mm_set1_ps(-0.0f);
+			return _mm_or_ps(_mm_andnot_ps(sign, r), _mm_and_ps(sign, y));
+		}
+	}
+#endif
+
+	template <FastMath::Tier T>
+	void FastMath::rsqrt(const float * in, float * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_ps(out + i, rsqrt4<T>(_mm_loadu_ps(in + i)));
+#endif
+		for (; i < count; ++i)
+			out[i] = rsqrt<T>(in[i]);
+	}
+
+	template <FastMath::Tier T>
+	void FastMath::normalize(const Vector3 * in, Vector3 * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x, y, z;
+			Simd::load_xyz4(&in[i].x, x, y, z);
+			__m128 n2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+			__m128 zero = _mm_cmpeq_ps(n2, _mm_setzero_ps());
+			if (T == Exact)
+			{
+				// divides, as Vector3::normalize does
+				__m128 n = select(zero, _mm_set1_ps(1.0f), _mm_sqrt_ps(n2));
+				x = _mm_div_ps(x, n);
+				y = _mm_div_ps(y, n);
+				z = _mm_div_ps(z, n);
+			}
+			else
+			{
+				__m128 scale = select(zero, _mm_set1_ps(1.0f), rsqrt4<T>(n2));
+				x = _mm_mul_ps(x, scale);
+				y = _mm_mul_ps(y, scale);
+				z = _mm_mul_ps(z, scale);
+			}
+			Simd::store_xyz4(&out[i].x, x, y, z);
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = normalize<T>(in[i]);
+	}
+
+	template <FastMath::Tier T>
+	void FastMath::sincos(const float * radians, float * s, float * c, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		if (T != Exact)
+		{
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 s4, c4;
+				sincos4<T>(_mm_loadu_ps(radians + i), s4, c4);
+				_mm_storeu_ps(s + i, s4);
+				_mm_storeu_ps(c + i, c4);
+			}
+		}
+#endif
+		for (; i < count; ++i)
+			sincos<T>(radians[i], s[i], c[i]);
+	}
+
+	template <FastMath::Tier T>
+	void FastMath::atan2(const float * y, const float * x, float * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		if (T != Exact)
+		{
+			for (; i + 4 <= count; i += 4)
+				_mm_storeu_ps(out + i, atan24<T>(_mm_loadu_ps(y + i), _mm_loadu_ps(x + i)));
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = atan2<T>(y[i], x[i]);
+	}
+
+	template void FastMath::rsqrt<FastMath::Coarse>(const float *, float *, size_t);
+	template void FastMath::rsqrt<FastMath::Medium>(const float *, float *, size_t);
+	template void FastMath::rsqrt<FastMath::Exact>(const float *, float *, size_t);
+	template void FastMath::normalize<FastMath::Coarse>(const Vector3 *, Vector3 *, size_t);
+	template void FastMath::normalize<FastMath::Medium>(const Vector3 *, Vector3 *, size_t);
+	template void FastMath::normalize<FastMath::Exact>(const Vector3 *, Vector3 *, size_t);
+	template void FastMath::sincos<FastMath::Coarse>(const float *, float *, float *, size_t);
+	template void FastMath::sincos<FastMath::Medium>(const float *, float *, float *, size_t);
+	template void FastMath::sincos<FastMath::Exact>(const float *, float *, float *, size_t);
+	template void FastMath::atan2<FastMath::Coarse>(const float *, const float *, float *, size_t);
+	template void FastMath::atan2<FastMath::Medium>(const float *, const float *, float *, size_t);
+	template void FastMath::atan2<FastMath::Exact>(const float *, const float *, float *, size_t);
+
+#ifdef _DEBUG
+	namespace
+	{
+		const size_t N = 4099;
+
+		float random_float(float lo, float hi)
+		{
+			return lo + (hi - lo) * rand() / RAND_MAX;
+		}
+
+		bool same(float a, float b)
+		{
+			return memcmp(&a, &b, sizeof(a)) == 0;
+		}
+
+		// worst error of each single version against double precision <cmath>,
+		// with the arrays checked against the single versions along the way
+		template <FastMath::Tier T>
+		float rsqrt_error(const std::vector<float> & positive)
+		{
+			std::vector<float> out(N);
+			FastMath::rsqrt<T>(positive.data(), out.data(), N);
+			float worst = 0.0f;
+			for (size_t i = 0; i < N; ++i)
+			{
+				assert(same(out[i], FastMath::rsqrt<T>(positive[i])));
+				double exact = 1.0 / std::sqrt(static_cast<double>(positive[i]));
+				worst = std::max(worst, static_cast<float>(std::fabs(out[i] - exact) / exact));
+			}
+			return worst;
+		}
+
+		template <FastMath::Tier T>
+		float sincos_error(const std::vector<float> & angles)
+		{
+			std::vector<float> s(N), c(N);
+			FastMath::sincos<T>(angles.data(), s.data(), c.data(), N);
+			float worst = 0.0f;
+			for (size_t i = 0; i < N; ++i)
+			{
+				float s1, c1;
+				FastMath::sincos<T>(angles[i], s1, c1);
+				assert(same(s[i], s1) && same(c[i], c1));
+				worst = std::max(worst, static_cast<float>(std::fabs(s[i] - std::sin(static_cast<double>(angles[i])))));
+				worst = std::max(worst, static_cast<float>(std::fabs(c[i] - std::cos(static_cast<double>(angles[i])))));
+			}
+			return worst;
+		}
+
+		template <FastMath::Tier T>
+		float atan2_error(const std::vector<float> & y, const std::vector<float> & x)
+		{
+			std::vector<float> out(N);
+			FastMath::atan2<T>(y.data(), x.data(), out.data(), N);
+			float worst = 0.0f;
+			for (size_t i = 0; i < N; ++i)
+			{
+				assert(same(out[i], FastMath::atan2<T>(y[i], x[i])));
+				double exact = std::atan2(static_cast<double>(y[i]), static_cast<double>(x[i]));
+				worst = std::max(worst, static_cast<float>(std::fabs(out[i] - exact)));
+			}
+			return worst;
+		}
+
+		template <FastMath::Tier T>
+		float normalize_error(const std::vector<Vector3> & vectors)
+		{
+			std::vector<Vector3> out(N);
+			FastMath::normalize<T>(vectors.data(), out.data(), N);
+			float worst = 0.0f;
+			for (size_t i = 0; i < N; ++i)
+			{
+				Vector3 n = FastMath::normalize<T>(vectors[i]);
+				assert(same(out[i].x, n.x) && same(out[i].y, n.y) && same(out[i].z, n.z));
+				if (vectors[i].norm_sq() == 0.0f)
+					assert(n.x == 0.0f && n.y == 0.0f && n.z == 0.0f);
+				else
+					worst = std::max(worst, fabsf(n.norm() - 1.0f));
+			}
+			return worst;
+		}
+	}
+
+	void FastMath::test()
+	{
+		// rsqrt over many octaves, the rest over their whole documented ranges
+		std::vector<float> positive(N), angles(N), y(N), x(N);
+		std::vector<Vector3> vectors(N);
+		for (size_t i = 0; i < N; ++i)
+		{
+			positive[i] = ldexpf(random_float(1.0f, 2.0f), rand() % 80 - 40);
+			angles[i] = i < N / 2 ? random_float(-8.0f, 8.0f) : random_float(-8192.0f, 8192.0f);
+			y[i] = random_float(-1.0f, 1.0f) * positive[i];
+			x[i] = random_float(-1.0f, 1.0f) * positive[i];
+			vectors[i] = Vector3(random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f)) * ldexpf(1.0f, rand() % 40 - 20);
+		}
+		// the axes, and the edges between quadrants and octants
+		const float edges[] = { 0.0f, -0.0f, 1.0f, -1.0f };
+		for (size_t i = 0; i < 16; ++i)
+		{
+			y[i] = edges[i % 4];
+			x[i] = edges[i / 4];
+			angles[i] = 0.785398163f * (static_cast<float>(i) - 8.0f);
+		}
+		vectors[0] = Vector3(0.0f, 0.0f, 0.0f);
+
+		assert(rsqrt_error<Coarse>(positive) <= 2e-3f);
+		assert(rsqrt_error<Medium>(positive) <= 5e-6f);
+		assert(rsqrt_error<Exact>(positive) <= 1e-7f);
+		assert(normalize_error<Coarse>(vectors) <= 2e-3f);
+		assert(normalize_error<Medium>(vectors) <= 5e-6f);
+		assert(normalize_error<Exact>(vectors) <= 5e-7f);
+		assert(sincos_error<Coarse>(angles) <= 4e-4f);
+		assert(sincos_error<Medium>(angles) <= 1e-6f);
+		assert(atan2_error<Coarse>(y, x) <= 2e-3f);
+		assert(atan2_error<Medium>(y, x) <= 1e-6f);
+	}
+#endif
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Simd.h"
+#include "Vector3.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace eae6320
+{
+	// <cmath> replacements at a chosen accuracy, for hot code that can give up digits for speed.
+	// every function takes its tier as a template argument: FastMath::sincos<FastMath::Medium>(a, s, c).
+	// the array versions give exactly what the single versions give, 4 values per iteration under SSE
+	namespace FastMath
+	{
+		enum Tier
+		{
+			// about 3 significant digits
+			Coarse,
+			// about 6, within a few float ulps of Exact
+			Medium,
+			// the <cmath> functions themselves
+			Exact,
+		};
+
+		// 1 / sqrt(x) for x > 0. relative error:
+		//   Coarse 2e-3, Medium 5e-6 (better under SSE: 4e-4 and 2e-7)
+		template <Tier T> float rsqrt(float x);
+
+		// v at unit length, as Vector3::normalize, with rsqrt's relative error. zero stays zero
+		template <Tier T> Vector3 normalize(const Vector3 & v);
+
+		// absolute error for |radians| <= 8192 (beyond that the range reduction degrades):
+		//   Coarse 4e-4, Medium 1e-6
+		template <Tier T> void sincos(float radians, float & s, float & c);
+		template <Tier T> float sin(float radians);
+		template <Tier T> float cos(float radians);
+
+		// as atan2f, in [-pi, pi]; atan2(0, 0) is 0. absolute error in radians:
+		//   Coarse 2e-3, Medium 1e-6
+		template <Tier T> float atan2(float y, float x);
+
+		// out[i] = rsqrt(in[i]), and so on
+		template <Tier T> void rsqrt(const float * in, float * out, size_t count);
+		template <Tier T> void normalize(const Vector3 * in, Vector3 * out, size_t count);
+		template <Tier T> void sincos(const float * radians, float * s, float * c, size_t count);
+		template <Tier T> void atan2(const float * y, const float * x, float * out, size_t count);
+
+		// measures each tier's worst error against its bound above,
+		// and checks the arrays against the single versions
+#ifdef _DEBUG
+		void test();
+#else
+		inline void test() {}
+#endif
+	}
+
+#include "FastMath.inl"
+}
@@ -0,0 +1,132 @@
+// the kernels below have SSE twins in FastMath.cpp that must do the same operations in the same order
+
+template <FastMath::Tier T>
+inline float FastMath::rsqrt(float x)
+{
+	if (T == Exact)
+		return 1.0f / sqrtf(x);
+
+#if defined(EAE6320_SSE)
+	__m128 v = _mm_set_ss(x);
+	__m128 r = _mm_rsqrt_ss(v);
+	// one Newton step doubles the 12 bits rsqrtss gives
+	if (T == Medium)
+		r = _mm_mul_ss(r, _mm_sub_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_mul_ss(_mm_set_ss(0.5f), v), _mm_mul_ss(r, r))));
+	return _mm_cvtss_f32(r);
+#else
+	// the bit-level first guess, within 3.5%
+	uint32_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	bits = 0x5f375a86 - (bits >> 1);
+	float r;
+	memcpy(&r, &bits, sizeof(r));
+	float h = 0.5f * x;
+	r = r * (1.5f - h * (r * r));
+	if (T == Medium)
+		r = r * (1.5f - h * (r * r));
+	return r;
+#endif
+}
+
+template <FastMath::Tier T>
+inline Vector3 FastMath::normalize(const Vector3 & v)
+{
+	Vector3 n(v);
+	if (T == Exact)
+		return n.normalize();
+
+	float n2 = v.dot(v);
+	if (n2 == 0.0f)
+		return n;
+	return n * rsqrt<T>(n2);
+}
+
+template <FastMath::Tier T>
+inline void FastMath::sincos(float radians, float & s, float & c)
+{
+	if (T == Exact)
+	{
+		s = sinf(radians);
+		c = cosf(radians);
+		return;
+	}
+
+	// radians = q pi/2 + r with |r| <= pi/4. pi/2 is split in three so that the first
+	// two products are exact for the quadrants up to 8192 radians
+	int32_t q = static_cast<int32_t>(lrintf(radians * 0.636619772f));
+	float k = static_cast<float>(q);
+	float r = ((radians - k * 1.5703125f) - k * 4.837512969970703125e-4f) - k * 7.54978995489188216e-8f;
+	float r2 = r * r;
+
+	float ps, pc;
+	if (T == Coarse)
+	{
+		// Taylor series, to r^5 and r^4
+		ps = r + r * r2 * (-0.166666667f + r2 * 0.00833333333f);
+		pc = 1.0f + r2 * (-0.5f + r2 * 0.0416666667f);
+	}
+	else
+	{
+		// minimax polynomials from Cephes' sinf and cosf
+		ps = r + r * r2 * ((-1.9515295891e-4f * r2 + 8.3321608736e-3f) * r2 - 1.6666654611e-1f);
+		pc = (1.0f - 0.5f * r2) + r2 * r2 * ((2.443315711809948e-5f * r2 - 1.388731625493765e-3f) * r2 + 4.166664568298827e-2f);
+	}
+
+	// odd quadrants swap sine and cosine, and the signs follow the quadrant
+	s = q & 1 ? pc : ps;
+	c = q & 1 ? ps : pc;
+	if (q & 2)
+		s = -s;
+	if ((q + 1) & 2)
+		c = -c;
+}
+
+template <FastMath::Tier T>
+inline float FastMath::sin(float radians)
+{
+	float s, c;
+	sincos<T>(radians, s, c);
+	return s;
+}
+
+template <FastMath::Tier T>
+inline float FastMath::cos(float radians)
+{
+	float s, c;
+	sincos<T>(radians, s, c);
+	return c;
+}
+
+template <FastMath::Tier T>
+inline float FastMath::atan2(float y, float x)
+{
+	if (T == Exact)
+		return atan2f(y, x);
+
+	// atan of a ratio in [0, 1], then reflected into the right octant
+	float ax = fabsf(x), ay = fabsf(y);
+	float lo = ax < ay ? ax : ay, hi = ax < ay ? ay : ax;
+	float z = hi > 0.0f ? lo / hi : 0.0f;
+
+	float r;
+	if (T == Coarse)
+	{
+		r = z * (0.785398163f + (1.0f - z) * (0.2447f + 0.0663f * z));
+	}
+	else
+	{
+		// Cephes' atanf: past tan(pi/8), atan(z) = pi/4 + atan((z - 1) / (z + 1))
+		bool upper = z > 0.414213562f;
+		float w = upper ? (z - 1.0f) / (z + 1.0f) : z;
+		float w2 = w * w;
+		r = (((8.05374449538e-2f * w2 - 1.38776856032e-1f) * w2 + 1.99777106478e-1f) * w2 - 3.33329491539e-1f) * w2 * w + w;
+		r += upper ? 0.785398163f : 0.0f;
+	}
+
+	if (ay > ax)
+		r = 1.57079633f - r;
+	// -0 counts as negative, as in atan2f
+	if (std::signbit(x))
+		r = 3.14159265f - r;
+	return copysignf(r, y);
+}
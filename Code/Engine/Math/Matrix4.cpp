@@ -1,11 +1,16 @@
 #include "Matrix4.h"
 #include <cmath>
 
+#ifdef _DEBUG
+#include <cassert>
+#include <cstdlib>
+#endif
+
 namespace eae6320
 {
 	const Matrix4 Matrix4::Zero = Matrix4(0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0);
 	const Matrix4 Matrix4::Identity = Matrix4(1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1);
-	
+
 // SKIP(i,n) equivalent to ( n<i ? n : n+1 )
 #define SKIP(i,n) ((n)+((i)<=(n)))
 // MINOR(i,j) equal to the determinant of the minor of m[i][j] for 4x4 array m
@@ -20,29 +25,152 @@ namespace eae6320
 		( m[SKIP(i,1)][SKIP(j,0)] * m[SKIP(i,2)][SKIP(j,1)] \
 		- m[SKIP(i,2)][SKIP(j,0)] * m[SKIP(i,1)][SKIP(j,1)] ) )
 
-	float Matrix4::determinant()
+	namespace
+	{
+#if !defined(EAE6320_SSE) || defined(_DEBUG)
+		// the adjoint over the determinant; the scalar path and the reference for test()
+		Matrix4 cofactor_inverse(const float (&m)[4][4])
+		{
+			Matrix4 adjoint(
+				+MINOR(0,0), -MINOR(1,0), +MINOR(2,0), -MINOR(3,0),
+				-MINOR(0,1), +MINOR(1,1), -MINOR(2,1), +MINOR(3,1),
+				+MINOR(0,2), -MINOR(1,2), +MINOR(2,2), -MINOR(3,2),
+				-MINOR(0,3), +MINOR(1,3), -MINOR(2,3), +MINOR(3,3)
+			);
+
+			float determinant =
+				  m[0][0] * adjoint.m[0][0] + m[0][1] * adjoint.m[1][0]
+				+ m[0][2] * adjoint.m[2][0] + m[0][3] * adjoint.m[3][0];
+
+			return (1.0f / determinant) * adjoint;
+		}
+#endif
+
+#if defined(EAE6320_SSE)
+		// 2x2 matrices packed as (m00, m01, m10, m11); # is the adjugate
+
+		// A * B
+		inline __m128 mat2_dot(__m128 a, __m128 b)
+		{
+			return _mm_add_ps(_mm_mul_ps(a, EAE6320_SWIZZLE(b, 0, 3, 0, 3)),
+				_mm_mul_ps(EAE6320_SWIZZLE(a, 1, 0, 3, 2), EAE6320_SWIZZLE(b, 2, 1, 2, 1)));
+		}
+
+		// A# * B
+		inline __m128 mat2_adj_dot(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(EAE6320_SWIZZLE(a, 3, 3, 0, 0), b),
+				_mm_mul_ps(EAE6320_SWIZZLE(a, 1, 1, 2, 2), EAE6320_SWIZZLE(b, 2, 3, 0, 1)));
+		}
+
+		// A * B#
+		inline __m128 mat2_dot_adj(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(a, EAE6320_SWIZZLE(b, 3, 0, 3, 0)),
+				_mm_mul_ps(EAE6320_SWIZZLE(a, 1, 0, 3, 2), EAE6320_SWIZZLE(b, 2, 1, 2, 1)));
+		}
+#endif
+	}
+
+	float Matrix4::determinant() const
 	{
 		float min00 = MINOR(0,0), min01 = MINOR(0,1), min02 = MINOR(0,2), min03 = MINOR(0,3);
 
 		return m[0][0]*min00 - m[0][1]*min01 + m[0][2]*min02 - m[0][3]*min03;
 	}
 
-	Matrix4 Matrix4::inverse()
+	Matrix4 Matrix4::inverse() const
+	{
+#if defined(EAE6320_SSE)
+		// blockwise inverse of | A B |
+		//                      | C D | with 2x2 blocks
+		__m128 r0 = _mm_loadu_ps(m[0]), r1 = _mm_loadu_ps(m[1]), r2 = _mm_loadu_ps(m[2]), r3 = _mm_loadu_ps(m[3]);
+		__m128 A = _mm_movelh_ps(r0, r1), B = _mm_movehl_ps(r1, r0);
+		__m128 C = _mm_movelh_ps(r2, r3), D = _mm_movehl_ps(r3, r2);
+
+		// (|A|, |B|, |C|, |D|)
+		__m128 det_sub = _mm_sub_ps(
+			_mm_mul_ps(EAE6320_SHUFFLE(r0, r2, 0, 2, 0, 2), EAE6320_SHUFFLE(r1, r3, 1, 3, 1, 3)),
+			_mm_mul_ps(EAE6320_SHUFFLE(r0, r2, 1, 3, 1, 3), EAE6320_SHUFFLE(r1, r3, 0, 2, 0, 2)));
+		__m128 det_A = EAE6320_SWIZZLE(det_sub, 0, 0, 0, 0);
+		__m128 det_B = EAE6320_SWIZZLE(det_sub, 1, 1, 1, 1);
+		__m128 det_C = EAE6320_SWIZZLE(det_sub, 2, 2, 2, 2);
+		__m128 det_D = EAE6320_SWIZZLE(det_sub, 3, 3, 3, 3);
+
+		__m128 D_C = mat2_adj_dot(D, C);
+		__m128 A_B = mat2_adj_dot(A, B);
+
+		// the inverse is | X Y | / |M|, computed here as adjugates of each block
+		//                | Z W |
+		__m128 X_ = _mm_sub_ps(_mm_mul_ps(det_D, A), mat2_dot(B, D_C));
+		__m128 W_ = _mm_sub_ps(_mm_mul_ps(det_A, D), mat2_dot(C, A_B));
+		__m128 Y_ = _mm_sub_ps(_mm_mul_ps(det_B, C), mat2_dot_adj(D, A_B));
+		__m128 Z_ = _mm_sub_ps(_mm_mul_ps(det_C, B), mat2_dot_adj(A, D_C));
+
+		// |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+		__m128 trace = Simd::sum(_mm_mul_ps(A_B, EAE6320_SWIZZLE(D_C, 0, 2, 1, 3)));
+		__m128 det_M = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_A, det_D), _mm_mul_ps(det_B, det_C)), trace);
+
+		__m128 rdet_M = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det_M);
+		X_ = _mm_mul_ps(X_, rdet_M);
+		Y_ = _mm_mul_ps(Y_, rdet_M);
+		Z_ = _mm_mul_ps(Z_, rdet_M);
+		W_ = _mm_mul_ps(W_, rdet_M);
+
+		// undo the adjugates while interleaving the blocks back into rows
+		Matrix4 result;
+		_mm_storeu_ps(result.m[0], EAE6320_SHUFFLE(X_, Y_, 3, 1, 3, 1));
+		_mm_storeu_ps(result.m[1], EAE6320_SHUFFLE(X_, Y_, 2, 0, 2, 0));
+		_mm_storeu_ps(result.m[2], EAE6320_SHUFFLE(Z_, W_, 3, 1, 3, 1));
+		_mm_storeu_ps(result.m[3], EAE6320_SHUFFLE(Z_, W_, 2, 0, 2, 0));
+		return result;
+#else
+		return cofactor_inverse(m);
+#endif
+	}
+
+	Matrix4 Matrix4::inverse_affine() const
 	{
-		Matrix4 adjoint(
-			+MINOR(0,0), -MINOR(1,0), +MINOR(2,0), -MINOR(3,0),
-			-MINOR(0,1), +MINOR(1,1), -MINOR(2,1), +MINOR(3,1),
-			+MINOR(0,2), -MINOR(1,2), +MINOR(2,2), -MINOR(3,2),
-			-MINOR(0,3), +MINOR(1,3), -MINOR(2,3), +MINOR(3,3)
-		);
+		// rows of the linear part's inverse are the columns of its cofactor matrix,
+		// and the translation is carried back through it
+#if defined(EAE6320_SSE)
+		__m128 r0 = _mm_loadu_ps(m[0]), r1 = _mm_loadu_ps(m[1]), r2 = _mm_loadu_ps(m[2]);
+		__m128 c0 = Simd::cross(r1, r2), c1 = Simd::cross(r2, r0), c2 = Simd::cross(r0, r1);
+		__m128 rdet = _mm_div_ps(_mm_set1_ps(1.0f), Simd::sum(_mm_mul_ps(r0, c0)));
 
-		float determinant =
-			  m[0][0] * adjoint.m[0][0] + m[0][1] * adjoint.m[1][0]
-			+ m[0][2] * adjoint.m[2][0] + m[0][3] * adjoint.m[3][0];
+		__m128 c3 = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		c0 = _mm_mul_ps(c0, rdet);
+		c1 = _mm_mul_ps(c1, rdet);
+		c2 = _mm_mul_ps(c2, rdet);
 
-		return (1.0f / determinant) * adjoint;
+		__m128 t = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f),
+			Simd::predot(_mm_setr_ps(m[3][0], m[3][1], m[3][2], 0.0f), c0, c1, c2, c3));
+
+		Matrix4 result;
+		_mm_storeu_ps(result.m[0], c0);
+		_mm_storeu_ps(result.m[1], c1);
+		_mm_storeu_ps(result.m[2], c2);
+		_mm_storeu_ps(result.m[3], t);
+		return result;
+#else
+		Vector3 r0(m[0][0], m[0][1], m[0][2]), r1(m[1][0], m[1][1], m[1][2]), r2(m[2][0], m[2][1], m[2][2]);
+		Vector3 c0 = r1.cross(r2), c1 = r2.cross(r0), c2 = r0.cross(r1);
+		float rdet = 1.0f / r0.dot(c0);
+		c0 *= rdet;
+		c1 *= rdet;
+		c2 *= rdet;
+
+		Matrix4 result(
+			c0.x, c1.x, c2.x, 0,
+			c0.y, c1.y, c2.y, 0,
+			c0.z, c1.z, c2.z, 0,
+			0, 0, 0, 1);
+		result.vec(3) = result.predot1(-Vector3(m[3][0], m[3][1], m[3][2]));
+		return result;
+#endif
 	}
-	
+
 	Matrix4 Matrix4::rotation_zyx(Vector3 const & r)
 	{
 		return rotation_z(r.z) * rotation_y(r.y) * rotation_x(r.x);
@@ -52,4 +180,98 @@ namespace eae6320
 	{
 		return rotation_x(r.x) * rotation_y(r.y) * rotation_z(r.z);
 	}
+
+#ifdef _DEBUG
+	namespace
+	{
+		float random_unit()
+		{
+			return 2.0f * rand() / RAND_MAX - 1.0f;
+		}
+
+		bool close(float a, float b, float tolerance)
+		{
+			return fabsf(a - b) <= tolerance * (1.0f + fabsf(a) + fabsf(b));
+		}
+
+		bool close(Vector4 const & a, Vector4 const & b, float tolerance)
+		{
+			return close(a.x, b.x, tolerance) && close(a.y, b.y, tolerance)
+				&& close(a.z, b.z, tolerance) && close(a.w, b.w, tolerance);
+		}
+
+		bool close(Matrix4 const & a, Matrix4 const & b, float tolerance)
+		{
+			for (size_t i = 0; i < 4; ++i)
+				for (size_t j = 0; j < 4; ++j)
+					if (!close(a.m[i][j], b.m[i][j], tolerance))
+						return false;
+			return true;
+		}
+	}
+
+	void Matrix4::test()
+	{
+		const float tolerance = 1e-5f;
+
+		for (int n = 0; n < 1000; ++n)
+		{
+			Matrix4 a, b;
+			for (size_t i = 0; i < 4; ++i)
+				for (size_t j = 0; j < 4; ++j)
+				{
+					a.m[i][j] = random_unit();
+					b.m[i][j] = random_unit();
+				}
+			Vector4 v(random_unit(), random_unit(), random_unit(), random_unit());
+			Vector3 v3 = v.xyz();
+
+			Matrix4 ab;
+			for (size_t i = 0; i < 4; ++i)
+				for (size_t j = 0; j < 4; ++j)
+					for (size_t k = 0; k < 4; ++k)
+						ab.m[i][j] += a.m[i][k] * b.m[k][j];
+			assert(close(a.dot(b), ab, tolerance));
+
+			Matrix4 at = a.transpose();
+			for (size_t i = 0; i < 4; ++i)
+				for (size_t j = 0; j < 4; ++j)
+					assert(at.m[i][j] == a.m[j][i]);
+
+			Vector4 va = Vector4::Zero, av = Vector4::Zero;
+			for (size_t i = 0; i < 4; ++i)
+				for (size_t k = 0; k < 4; ++k)
+				{
+					(&va.x)[i] += (&v.x)[k] * a.m[k][i];
+					(&av.x)[i] += a.m[i][k] * (&v.x)[k];
+				}
+			assert(close(a.predot(v), va, tolerance));
+			assert(close(a.postdot(v), av, tolerance));
+
+			Vector4 va0 = va - v.w * Vector4(a.m[3][0], a.m[3][1], a.m[3][2], a.m[3][3]);
+			Vector4 av0 = av - v.w * Vector4(a.m[0][3], a.m[1][3], a.m[2][3], a.m[3][3]);
+			Vector4 va1 = va0 + Vector4(a.m[3][0], a.m[3][1], a.m[3][2], a.m[3][3]);
+			Vector4 av1 = av0 + Vector4(a.m[0][3], a.m[1][3], a.m[2][3], a.m[3][3]);
+			va0.w = av0.w = 0;
+			va1.w = av1.w = 1;
+			assert(close(a.predot0(v3), va0, tolerance));
+			assert(close(a.predot1(v3), va1, tolerance));
+			assert(close(a.postdot0(v3), av0, tolerance));
+			assert(close(a.postdot1(v3), av1, tolerance));
+
+			// skip the nearly singular draws, where neither path is accurate
+			if (fabsf(a.determinant()) > 0.05f)
+				assert(close(a.inverse(), cofactor_inverse(a.m), 1e-3f));
+
+			Versor q = Versor(v).unit();
+			Matrix4 affine = Matrix4::rotation_q(q).dot(Matrix4::scale(1.0f + fabsf(v.x), 0.5f, 2.0f));
+			affine.vec3(3) = Vector3(b.m[0][0], b.m[0][1], b.m[0][2]) * 10.0f;
+			assert(close(affine.inverse_affine(), cofactor_inverse(affine.m), 1e-4f));
+			assert(close(affine.inverse_affine().dot(affine), Matrix4::Identity, 1e-4f));
+		}
+
+		assert(close(Matrix4::Identity.inverse(), Matrix4::Identity, 0.0f));
+		assert(close(Matrix4::Identity.inverse_affine(), Matrix4::Identity, 0.0f));
+	}
+#endif
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Simd.h"
 #include "Vector3.h"
 #include "Vector4.h"
 #include "Versor.h"
@@ -52,9 +53,19 @@ namespace eae6320
 		Vector4 postdot0(Vector3 const & rhs) const;
 		Vector4 postdot1(Vector3 const & rhs) const;
 
-		float determinant();
-		Matrix4 inverse();
-		Matrix4 transpose();
+		float determinant() const;
+		Matrix4 inverse() const;
+		// only for matrices whose last column is (0, 0, 0, 1): rotation, scale, shear and translation
+		Matrix4 inverse_affine() const;
+		Matrix4 transpose() const;
+
+		// compares the SSE/AVX kernels against plain scalar math
+		static void test()
+#ifdef _DEBUG
+		;
+#else
+		{}
+#endif
 
 		float m[4][4];
 	};
@@ -66,15 +66,15 @@ inline Matrix4 Matrix4::rotation_z(float radians)
 
 inline Matrix4 Matrix4::rotation_q(Versor const & q)
 {
+	// row i is where q.rotate takes axis i
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
 	return Matrix4(
-		q.w, q.z, -q.y, q.x,
-		-q.z, q.w, q.x, q.y,
-		q.y, -q.x, q.w, q.z,
-		-q.x, -q.y, -q.z, q.w).dot(Matrix4(
-			q.w, q.z, -q.y, -q.x,
-			-q.z, q.w, q.x, -q.y,
-			q.y, -q.x, q.w, -q.z,
-			q.x, q.y, q.z, q.w));
+		1 - 2 * (yy + zz), 2 * (xy + wz), 2 * (xz - wy), 0,
+		2 * (xy - wz), 1 - 2 * (xx + zz), 2 * (yz + wx), 0,
+		2 * (xz + wy), 2 * (yz - wx), 1 - 2 * (xx + yy), 0,
+		0, 0, 0, 1);
 }
 
 inline Matrix4 Matrix4::create_RT(Versor const & q, Vector3 const & p)
@@ -87,17 +87,28 @@ inline Matrix4 Matrix4::create_RT(Versor const & q, Vector3 const & p)
 inline Matrix4 Matrix4::inverse_RT(Versor const & q, Vector3 const & p)
 {
 	Matrix4 irt = rotation_q(q).transpose();
-	irt.vec(3) = irt.predot1(p);
+	irt.vec(3) = irt.predot1(-p);
 	return irt;
 }
 
-inline Matrix4 Matrix4::transpose()
+inline Matrix4 Matrix4::transpose() const
 {
+#if defined(EAE6320_SSE)
+	__m128 r0 = _mm_loadu_ps(m[0]), r1 = _mm_loadu_ps(m[1]), r2 = _mm_loadu_ps(m[2]), r3 = _mm_loadu_ps(m[3]);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	Matrix4 result;
+	_mm_storeu_ps(result.m[0], r0);
+	_mm_storeu_ps(result.m[1], r1);
+	_mm_storeu_ps(result.m[2], r2);
+	_mm_storeu_ps(result.m[3], r3);
+	return result;
+#else
 	return Matrix4(
 		m[0][0], m[1][0], m[2][0], m[3][0],
 		m[0][1], m[1][1], m[2][1], m[3][1],
 		m[0][2], m[1][2], m[2][2], m[3][2],
 		m[0][3], m[1][3], m[2][3], m[3][3]);
+#endif
 }
 
 inline Vector4 & Matrix4::vec(size_t i)
@@ -114,65 +125,132 @@ inline Matrix4 Matrix4::dot(Matrix4 const & rhs) const
 {
 	Matrix4 result;
 
+#if defined(EAE6320_AVX)
+	// two rows at a time; each 128-bit lane broadcasts its own row's coefficients
+	__m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(rhs.m[0]));
+	__m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(rhs.m[1]));
+	__m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(rhs.m[2]));
+	__m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(rhs.m[3]));
+	for (size_t i = 0; i < 4; i += 2)
+	{
+		__m256 a = _mm256_loadu_ps(m[i]);
+		__m256 r = _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x00), b0);
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x55), b1));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xAA), b2));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xFF), b3));
+		_mm256_storeu_ps(result.m[i], r);
+	}
+#elif defined(EAE6320_SSE)
+	__m128 b0 = _mm_loadu_ps(rhs.m[0]), b1 = _mm_loadu_ps(rhs.m[1]), b2 = _mm_loadu_ps(rhs.m[2]), b3 = _mm_loadu_ps(rhs.m[3]);
+	for (size_t i = 0; i < 4; ++i)
+		_mm_storeu_ps(result.m[i], Simd::predot(_mm_loadu_ps(m[i]), b0, b1, b2, b3));
+#else
 	for (size_t i = 0; i < 4; ++i)
 		for (size_t j = 0; j < 4; ++j)
 			for (size_t k = 0; k < 4; ++k)
 				result.m[i][j] += m[i][k] * rhs.m[k][j];
+#endif
 
 	return result;
 }
 
 inline Vector4 Matrix4::predot(Vector4 const & lhs) const
 {
+#if defined(EAE6320_SSE)
+	Vector4 result;
+	_mm_storeu_ps(&result.x, Simd::predot(_mm_loadu_ps(&lhs.x),
+		_mm_loadu_ps(m[0]), _mm_loadu_ps(m[1]), _mm_loadu_ps(m[2]), _mm_loadu_ps(m[3])));
+	return result;
+#else
 	return Vector4(
 		lhs.x*m[0][0] + lhs.y*m[1][0] + lhs.z*m[2][0] + lhs.w*m[3][0],
 		lhs.x*m[0][1] + lhs.y*m[1][1] + lhs.z*m[2][1] + lhs.w*m[3][1],
 		lhs.x*m[0][2] + lhs.y*m[1][2] + lhs.z*m[2][2] + lhs.w*m[3][2],
 		lhs.x*m[0][3] + lhs.y*m[1][3] + lhs.z*m[2][3] + lhs.w*m[3][3]);
+#endif
 }
 
 inline Vector4 Matrix4::predot0(Vector3 const & lhs) const
 {
+#if defined(EAE6320_SSE)
+	Vector4 result;
+	_mm_storeu_ps(&result.x, Simd::predot(_mm_setr_ps(lhs.x, lhs.y, lhs.z, 0.0f),
+		_mm_loadu_ps(m[0]), _mm_loadu_ps(m[1]), _mm_loadu_ps(m[2]), _mm_loadu_ps(m[3])));
+	result.w = 0.0f;
+	return result;
+#else
 	return Vector4(
 		lhs.x*m[0][0] + lhs.y*m[1][0] + lhs.z*m[2][0],
 		lhs.x*m[0][1] + lhs.y*m[1][1] + lhs.z*m[2][1],
 		lhs.x*m[0][2] + lhs.y*m[1][2] + lhs.z*m[2][2],
 		0);
+#endif
 }
 
 inline Vector4 Matrix4::predot1(Vector3 const & lhs) const
 {
+#if defined(EAE6320_SSE)
+	Vector4 result;
+	_mm_storeu_ps(&result.x, Simd::predot(_mm_setr_ps(lhs.x, lhs.y, lhs.z, 1.0f),
+		_mm_loadu_ps(m[0]), _mm_loadu_ps(m[1]), _mm_loadu_ps(m[2]), _mm_loadu_ps(m[3])));
+	result.w = 1.0f;
+	return result;
+#else
 	return Vector4(
 		lhs.x*m[0][0] + lhs.y*m[1][0] + lhs.z*m[2][0] + m[3][0],
 		lhs.x*m[0][1] + lhs.y*m[1][1] + lhs.z*m[2][1] + m[3][1],
 		lhs.x*m[0][2] + lhs.y*m[1][2] + lhs.z*m[2][2] + m[3][2],
 		1);
+#endif
 }
 
 inline Vector4 Matrix4::postdot(Vector4 const & rhs) const
 {
+#if defined(EAE6320_SSE)
+	Vector4 result;
+	_mm_storeu_ps(&result.x, Simd::postdot(_mm_loadu_ps(&rhs.x),
+		_mm_loadu_ps(m[0]), _mm_loadu_ps(m[1]), _mm_loadu_ps(m[2]), _mm_loadu_ps(m[3])));
+	return result;
+#else
 	return Vector4(
 		m[0][0]*rhs.x + m[0][1]*rhs.y + m[0][2]*rhs.z + m[0][3]*rhs.w,
 		m[1][0]*rhs.x + m[1][1]*rhs.y + m[1][2]*rhs.z + m[1][3]*rhs.w,
 		m[2][0]*rhs.x + m[2][1]*rhs.y + m[2][2]*rhs.z + m[2][3]*rhs.w,
 		m[3][0]*rhs.x + m[3][1]*rhs.y + m[3][2]*rhs.z + m[3][3]*rhs.w);
+#endif
 }
 
 inline Vector4 Matrix4::postdot0(Vector3 const & rhs) const
 {
+#if defined(EAE6320_SSE)
+	Vector4 result;
+	_mm_storeu_ps(&result.x, Simd::postdot(_mm_setr_ps(rhs.x, rhs.y, rhs.z, 0.0f),
+		_mm_loadu_ps(m[0]), _mm_loadu_ps(m[1]), _mm_loadu_ps(m[2]), _mm_loadu_ps(m[3])));
+	result.w = 0.0f;
+	return result;
+#else
 	return Vector4(
 		m[0][0]*rhs.x + m[0][1]*rhs.y + m[0][2]*rhs.z,
 		m[1][0]*rhs.x + m[1][1]*rhs.y + m[1][2]*rhs.z,
 		m[2][0]*rhs.x + m[2][1]*rhs.y + m[2][2]*rhs.z,
 		0);
+#endif
 }
 inline Vector4 Matrix4::postdot1(Vector3 const & rhs) const
 {
+#if defined(EAE6320_SSE)
+	Vector4 result;
+	_mm_storeu_ps(&result.x, Simd::postdot(_mm_setr_ps(rhs.x, rhs.y, rhs.z, 1.0f),
+		_mm_loadu_ps(m[0]), _mm_loadu_ps(m[1]), _mm_loadu_ps(m[2]), _mm_loadu_ps(m[3])));
+	result.w = 1.0f;
+	return result;
+#else
 	return Vector4(
 		m[0][0]*rhs.x + m[0][1]*rhs.y + m[0][2]*rhs.z + m[0][3],
 		m[1][0]*rhs.x + m[1][1]*rhs.y + m[1][2]*rhs.z + m[1][3],
 		m[2][0]*rhs.x + m[2][1]*rhs.y + m[2][2]*rhs.z + m[2][3],
 		1);
+#endif
 }
 
 inline bool operator==(Matrix4 const & lhs, Matrix4 const & rhs)
@@ -0,0 +1,557 @@
+#include "Pack.h"
+#include "Simd.h"
+
+#include <cmath>
+#include <cstring>
+
+#ifdef _DEBUG
+#include <cassert>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+#endif
+
+namespace eae6320
+{
+	namespace
+	{
+		const float SQRT2 = 1.41421356f;
+		const uint32_t SMALLEST3_MAX = (1u << 10) - 1;
+
+		uint32_t float_bits(float f)
+		{
+			uint32_t u;
+			memcpy(&u, &f, sizeof(u));
+			return u;
+		}
+
+		float bits_float(uint32_t u)
+		{
+			float f;
+			memcpy(&f, &u, sizeof(f));
+			return f;
+		}
+
+		// as the SSE min/max pair: NaN goes to lo
+		float clamp(float f, float lo, float hi)
+		{
+			return f > lo ? (f < hi ? f : hi) : lo;
+		}
+
+		// the fold's sign, as (u < 0 ? -1 : 1) so that -0 folds like +0
+		float fold(float a, float b)
+		{
+			return (1.0f - fabsf(b)) * (a < 0 ? -1.0f : 1.0f);
+		}
+
+#if defined(EAE6320_SSE)
+		inline __m128 select(__m128 mask, __m128 a, __m128 b)
+		{
+			return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+		}
+
+		inline __m128 fold(__m128 a, __m128 b)
+		{
+			__m128 negative = _mm_and_ps(_mm_cmplt_ps(a, _mm_setzero_ps()), _mm_set1_ps(-0.0f));
+			return _mm_or_ps(_mm_sub_ps(_mm_set1_ps(1.0f), Simd::abs(b)), negative);
+		}
+
+		// to_snorm16 in each 32-bit lane
+		inline __m128i snorm16(__m128 f)
+		{
+			f = _mm_min_ps(_mm_max_ps(f, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+			return _mm_cvtps_epi32(_mm_mul_ps(f, _mm_set1_ps(static_cast<float>(INT16_MAX))));
+		}
+
+		// from_snorm16 of each 32-bit lane
+		inline __m128 unsnorm16(__m128i s)
+		{
+			__m128 f = _mm_div_ps(_mm_cvtepi32_ps(s), _mm_set1_ps(static_cast<float>(INT16_MAX)));
+			return _mm_max_ps(f, _mm_set1_ps(-1.0f));
+		}
+
+#if !defined(EAE6320_F16C)
+		// the scalar to_half's steps, with selects for its branches
+		inline __m128i half4(__m128 f)
+		{
+			const __m128i f16max = _mm_set1_epi32((127 + 16) << 23);
+			const __m128i min_normal = _mm_set1_epi32((127 - 14) << 23);
+			const __m128i denorm_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+			const __m128i normal_bias = _mm_set1_epi32(static_cast<int>((static_cast<uint32_t>(15 - 127) << 23) + 0xfff));
+
+			__m128 sign = _mm_and_ps(f, _mm_set1_ps(-0.0f));
+			__m128 abs_f = _mm_xor_ps(f, sign);
+			__m128i abs_bits = _mm_castps_si128(abs_f);
+
+			__m128i nan = _mm_castps_si128(_mm_cmpunord_ps(abs_f, abs_f));
+			__m128i special = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(nan, _mm_set1_epi32(0x200)));
+
+			__m128i denormal = _mm_sub_epi32(
+				_mm_castps_si128(_mm_add_ps(abs_f, _mm_castsi128_ps(denorm_magic))), denorm_magic);
+
+			__m128i odd = _mm_and_si128(_mm_srli_epi32(abs_bits, 13), _mm_set1_epi32(1));
+			__m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(abs_bits, normal_bias), odd), 13);
+
+			__m128i is_denormal = _mm_cmpgt_epi32(min_normal, abs_bits);
+			__m128i finite = _mm_or_si128(_mm_and_si128(is_denormal, denormal), _mm_andnot_si128(is_denormal, normal));
+			__m128i in_range = _mm_cmpgt_epi32(f16max, abs_bits);
+			__m128i h = _mm_or_si128(_mm_and_si128(in_range, finite), _mm_andnot_si128(in_range, special));
+			return _mm_or_si128(h, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+		}
+
+		// the low 16 bits of each 32-bit lane, which is a half in half4's output
+		inline __m128 unhalf4(__m128i h)
+		{
+			const __m128i exp_mant = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+			const __m128i sign = _mm_slli_epi32(_mm_xor_si128(_mm_and_si128(h, _mm_set1_epi32(0xffff)), exp_mant), 16);
+			// moving the bits up and multiplying by 2^112 rebias normals and denormals alike
+			__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(exp_mant, 13)), _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+			__m128i inf_nan = _mm_and_si128(_mm_cmpgt_epi32(exp_mant, _mm_set1_epi32(0x7bff)), _mm_set1_epi32(255 << 23));
+			return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, inf_nan)));
+		}
+#endif
+#endif
+	}
+
+	// after Fabian Giesen's float_to_half_fast3_rtne and half_to_float_fast5
+	uint16_t Pack::to_half(float f)
+	{
+		const uint32_t f32infty = 255u << 23;
+		const uint32_t f16max = (127u + 16) << 23;
+		const uint32_t denorm_magic = ((127u - 15) + (23 - 10) + 1) << 23;
+
+		uint32_t bits = float_bits(f);
+		uint32_t sign = bits & 0x80000000u;
+		bits ^= sign;
+
+		uint16_t h;
+		if (bits >= f16max)
+		{
+			h = bits > f32infty ? 0x7e00 : 0x7c00;
+		}
+		else if (bits < (113u << 23))
+		{
+			// the float add does the denormal rounding
+			h = static_cast<uint16_t>(float_bits(bits_float(bits) + bits_float(denorm_magic)) - denorm_magic);
+		}
+		else
+		{
+			uint32_t odd = (bits >> 13) & 1;
+			bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xfff;
+			bits += odd;
+			h = static_cast<uint16_t>(bits >> 13);
+		}
+		return static_cast<uint16_t>(h | sign >> 16);
+	}
+
+	float Pack::from_half(uint16_t h)
+	{
+		const uint32_t shifted_exp = 0x7c00u << 13;
+
+		uint32_t bits = (h & 0x7fffu) << 13;
+		uint32_t exp = shifted_exp & bits;
+		bits += (127u - 15) << 23;
+		if (exp == shifted_exp)
+		{
+			bits += (128u - 16) << 23;
+		}
+		else if (exp == 0)
+		{
+			bits += 1u << 23;
+			bits = float_bits(bits_float(bits) - bits_float(113u << 23));
+		}
+		return bits_float(bits | (h & 0x8000u) << 16);
+	}
+
+	int16_t Pack::to_snorm16(float f)
+	{
+		return static_cast<int16_t>(lrintf(clamp(f, -1.0f, 1.0f) * INT16_MAX));
+	}
+
+	float Pack::from_snorm16(int16_t s)
+	{
+		float f = s / static_cast<float>(INT16_MAX);
+		return f > -1.0f ? f : -1.0f;
+	}
+
+	uint8_t Pack::to_unorm8(float f)
+	{
+		return static_cast<uint8_t>(lrintf(clamp(f, 0.0f, 1.0f) * UINT8_MAX));
+	}
+
+	float Pack::from_unorm8(uint8_t u)
+	{
+		return u / static_cast<float>(UINT8_MAX);
+	}
+
+	Pack::Octahedral Pack::to_octahedral(const Vector3 & n)
+	{
+		float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+		float u = n.x / l1, v = n.z / l1;
+		// fold the lower hemisphere over the diagonals
+		if (n.y < 0)
+		{
+			float fu = fold(u, v);
+			v = fold(v, u);
+			u = fu;
+		}
+		Octahedral e;
+		e.u = to_snorm16(u);
+		e.v = to_snorm16(v);
+		return e;
+	}
+
+	Vector3 Pack::from_octahedral(Octahedral e)
+	{
+		float u = from_snorm16(e.u), v = from_snorm16(e.v);
+		Vector3 n(u, 1.0f - fabsf(u) - fabsf(v), v);
+		if (n.y < 0)
+		{
+			n.x = fold(u, v);
+			n.z = fold(v, u);
+		}
+		return n.normalize();
+	}
+
+	uint32_t Pack::to_smallest3(const Versor & q)
+	{
+		float c[4] = { q.x, q.y, q.z, q.w };
+		uint32_t largest = 0;
+		for (uint32_t i = 1; i < 4; ++i)
+			if (fabsf(c[i]) > fabsf(c[largest]))
+				largest = i;
+
+		// the other three are within +-1/sqrt(2)
+		float sign = c[largest] < 0 ? -1.0f : 1.0f;
+		uint32_t bits = largest << 30;
+		uint32_t shift = 20;
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			if (i == largest)
+				continue;
+			float f = clamp((sign * c[i] * SQRT2 + 1.0f) * 0.5f, 0.0f, 1.0f);
+			bits |= static_cast<uint32_t>(lrintf(f * SMALLEST3_MAX)) << shift;
+			shift -= 10;
+		}
+		return bits;
+	}
+
+	Versor Pack::from_smallest3(uint32_t bits)
+	{
+		uint32_t largest = bits >> 30;
+		float c[4];
+		float sum = 0.0f;
+		uint32_t shift = 20;
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			if (i == largest)
+				continue;
+			float f = ((bits >> shift) & SMALLEST3_MAX) / static_cast<float>(SMALLEST3_MAX);
+			c[i] = (f * 2.0f - 1.0f) / SQRT2;
+			sum += c[i] * c[i];
+			shift -= 10;
+		}
+		c[largest] = sqrtf(sum < 1.0f ? 1.0f - sum : 0.0f);
+		return Versor(c[0], c[1], c[2], c[3]);
+	}
+
+	void Pack::to_half(const float * in, uint16_t * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_F16C)
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), h);
+		}
+#elif defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			// sign extending first keeps the signed saturation of packs from clipping
+			__m128i h = half4(_mm_loadu_ps(in + i));
+			h = _mm_srai_epi32(_mm_slli_epi32(h, 16), 16);
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(h, h));
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = to_half(in[i]);
+	}
+
+	void Pack::from_half(const uint16_t * in, float * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_F16C)
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i))));
+#elif defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i h = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i));
+			_mm_storeu_ps(out + i, unhalf4(_mm_unpacklo_epi16(h, _mm_setzero_si128())));
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = from_half(in[i]);
+	}
+
+	void Pack::to_snorm16(const float * in, int16_t * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i s = snorm16(_mm_loadu_ps(in + i));
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(s, s));
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = to_snorm16(in[i]);
+	}
+
+	void Pack::from_snorm16(const int16_t * in, float * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i s = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i));
+			_mm_storeu_ps(out + i, unsnorm16(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)));
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = from_snorm16(in[i]);
+	}
+
+	void Pack::to_unorm8(const float * in, uint8_t * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 f = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+			__m128i u = _mm_cvtps_epi32(_mm_mul_ps(f, _mm_set1_ps(static_cast<float>(UINT8_MAX))));
+			u = _mm_packs_epi32(u, u);
+			int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(u, u));
+			memcpy(out + i, &bytes, sizeof(bytes));
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = to_unorm8(in[i]);
+	}
+
+	void Pack::from_unorm8(const uint8_t * in, float * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			int32_t bytes;
+			memcpy(&bytes, in + i, sizeof(bytes));
+			__m128i u = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), _mm_setzero_si128());
+			u = _mm_unpacklo_epi16(u, _mm_setzero_si128());
+			_mm_storeu_ps(out + i, _mm_div_ps(_mm_cvtepi32_ps(u), _mm_set1_ps(static_cast<float>(UINT8_MAX))));
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = from_unorm8(in[i]);
+	}
+
+	void Pack::to_octahedral(const Vector3 * in, Octahedral * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x, y, z;
+			Simd::load_xyz4(&in[i].x, x, y, z);
+			__m128 l1 = _mm_add_ps(_mm_add_ps(Simd::abs(x), Simd::abs(y)), Simd::abs(z));
+			__m128 u = _mm_div_ps(x, l1), v = _mm_div_ps(z, l1);
+			__m128 lower = _mm_cmplt_ps(y, _mm_setzero_ps());
+			__m128 fu = fold(u, v);
+			v = select(lower, fold(v, u), v);
+			u = select(lower, fu, u);
+
+			__m128i su = snorm16(u), sv = snorm16(v);
+			__m128i uv = _mm_packs_epi32(_mm_unpacklo_epi32(su, sv), _mm_unpackhi_epi32(su, sv));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), uv);
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = to_octahedral(in[i]);
+	}
+
+	void Pack::from_octahedral(const Octahedral * in, Vector3 * out, size_t count)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i uv = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+			__m128 u = unsnorm16(_mm_srai_epi32(_mm_slli_epi32(uv, 16), 16));
+			__m128 v = unsnorm16(_mm_srai_epi32(uv, 16));
+			__m128 y = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), Simd::abs(u)), Simd::abs(v));
+			__m128 lower = _mm_cmplt_ps(y, _mm_setzero_ps());
+			__m128 x = select(lower, fold(u, v), u);
+			__m128 z = select(lower, fold(v, u), v);
+
+			// never zero: the octahedron has |x| + |y| + |z| = 1
+			__m128 n = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+			Simd::store_xyz4(&out[i].x, _mm_div_ps(x, n), _mm_div_ps(y, n), _mm_div_ps(z, n));
+		}
+#endif
+		for (; i < count; ++i)
+			out[i] = from_octahedral(in[i]);
+	}
+
+	void Pack::to_smallest3(const Versor * in, uint32_t * out, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			out[i] = to_smallest3(in[i]);
+	}
+
+	void Pack::from_smallest3(const uint32_t * in, Versor * out, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			out[i] = from_smallest3(in[i]);
+	}
+
+#ifdef _DEBUG
+	namespace
+	{
+		uint32_t random_bits()
+		{
+			return static_cast<uint32_t>(rand()) << 30 ^ static_cast<uint32_t>(rand()) << 15 ^ static_cast<uint32_t>(rand());
+		}
+
+		float random_float(float lo, float hi)
+		{
+			return lo + (hi - lo) * rand() / RAND_MAX;
+		}
+
+		Vector3 random_direction()
+		{
+			Vector3 d;
+			do
+				d = Vector3(random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f));
+			while (d.norm_sq() > 1.0f || d.norm_sq() < 1e-4f);
+			return d.normalize();
+		}
+
+		float angle(const Vector3 & a, const Vector3 & b)
+		{
+			return atan2f(a.cross(b).norm(), a.dot(b));
+		}
+
+		bool same_bits(float a, float b)
+		{
+			return float_bits(a) == float_bits(b) || (a != a && b != b);
+		}
+
+		bool same_half(uint16_t a, uint16_t b)
+		{
+			bool a_nan = (a & 0x7fff) > 0x7c00, b_nan = (b & 0x7fff) > 0x7c00;
+			return a == b || (a_nan && b_nan);
+		}
+	}
+
+	void Pack::test()
+	{
+		const size_t N = 1003;
+
+		// every half survives the round trip, and the edges of the range land where they should
+		for (uint32_t h = 0; h <= 0xffff; ++h)
+			assert(same_half(to_half(from_half(static_cast<uint16_t>(h))), static_cast<uint16_t>(h)));
+		assert(to_half(1.0f) == 0x3c00 && to_half(-2.0f) == 0xc000);
+		assert(to_half(65504.0f) == 0x7bff && to_half(65520.0f) == 0x7c00);
+		assert(to_half(ldexpf(1.0f, -24)) == 0x0001 && to_half(ldexpf(1.0f, -26)) == 0);
+		assert(from_half(0x0001) == ldexpf(1.0f, -24) && from_half(0x7c00) == std::numeric_limits<float>::infinity());
+
+		float max_half = 0.0f, max_snorm = 0.0f, max_unorm = 0.0f, max_octahedral = 0.0f, max_smallest3 = 0.0f;
+		std::vector<float> floats(N), unit(N), back(N);
+		std::vector<uint16_t> halves(N);
+		for (size_t i = 0; i < N; ++i)
+		{
+			float f = ldexpf(random_float(1.0f, 2.0f), static_cast<int>(rand() % 29) - 14);
+			floats[i] = rand() % 2 ? f : -f;
+			unit[i] = random_float(-1.1f, 1.1f);
+			float r = fabsf(from_half(to_half(floats[i])) - floats[i]) / fabsf(floats[i]);
+			max_half = r > max_half ? r : max_half;
+		}
+		assert(max_half <= ldexpf(1.0f, -11));
+
+		// the arrays match on arbitrary bits, NaNs and denormals included
+		for (size_t i = 0; i < N; ++i)
+		{
+			uint32_t bits = random_bits();
+			floats[i] = bits_float(i % 4 ? bits : bits & 0x807fffff);
+			halves[i] = static_cast<uint16_t>(bits);
+		}
+		to_half(floats.data(), halves.data(), N);
+		for (size_t i = 0; i < N; ++i)
+			assert(same_half(halves[i], to_half(floats[i])));
+		for (size_t i = 0; i < N; ++i)
+			halves[i] = static_cast<uint16_t>(random_bits());
+		from_half(halves.data(), back.data(), N);
+		for (size_t i = 0; i < N; ++i)
+			assert(same_bits(back[i], from_half(halves[i])));
+
+		std::vector<int16_t> snorms(N);
+		to_snorm16(unit.data(), snorms.data(), N);
+		from_snorm16(snorms.data(), back.data(), N);
+		for (size_t i = 0; i < N; ++i)
+		{
+			assert(snorms[i] == to_snorm16(unit[i]) && back[i] == from_snorm16(snorms[i]));
+			float e = fabsf(back[i] - clamp(unit[i], -1.0f, 1.0f));
+			max_snorm = e > max_snorm ? e : max_snorm;
+		}
+		assert(max_snorm <= 0.5f / INT16_MAX + 1e-7f);
+		assert(from_snorm16(INT16_MIN) == -1.0f);
+
+		std::vector<uint8_t> unorms(N);
+		to_unorm8(unit.data(), unorms.data(), N);
+		from_unorm8(unorms.data(), back.data(), N);
+		for (size_t i = 0; i < N; ++i)
+		{
+			assert(unorms[i] == to_unorm8(unit[i]) && back[i] == from_unorm8(unorms[i]));
+			float e = fabsf(back[i] - clamp(unit[i], 0.0f, 1.0f));
+			max_unorm = e > max_unorm ? e : max_unorm;
+		}
+		assert(max_unorm <= 0.5f / UINT8_MAX + 1e-7f);
+
+		// including the axes and the fold's edges
+		std::vector<Vector3> normals(N), decoded(N);
+		for (size_t i = 0; i < N; ++i)
+			normals[i] = random_direction();
+		normals[0] = Vector3(0.0f, -1.0f, 0.0f);
+		normals[1] = Vector3(-1.0f, 0.0f, 0.0f);
+		normals[2] = Vector3(0.0f, 0.0f, 1.0f);
+		normals[3] = Vector3(-0.0f, -1.0f, -0.0f);
+		normals[4] = Vector3(1.0f, -1.0f, 0.0f).normalize();
+		std::vector<Octahedral> octahedrals(N);
+		to_octahedral(normals.data(), octahedrals.data(), N);
+		from_octahedral(octahedrals.data(), decoded.data(), N);
+		for (size_t i = 0; i < N; ++i)
+		{
+			Octahedral e = to_octahedral(normals[i]);
+			assert(octahedrals[i].u == e.u && octahedrals[i].v == e.v);
+			Vector3 n = from_octahedral(e);
+			assert(decoded[i].x == n.x && decoded[i].y == n.y && decoded[i].z == n.z);
+			float a = angle(n, normals[i]);
+			max_octahedral = a > max_octahedral ? a : max_octahedral;
+		}
+		assert(max_octahedral <= 1e-4f);
+
+		for (size_t i = 0; i < N; ++i)
+		{
+			Vector4 q(random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f));
+			q = q * (1.0f / q.norm());
+			Versor decoded_q = from_smallest3(to_smallest3(q));
+			assert(fabsf(decoded_q.norm() - 1.0f) < 1e-5f);
+			float d = fabsf(decoded_q.dot(q));
+			float a = 2.0f * acosf(d < 1.0f ? d : 1.0f);
+			max_smallest3 = a > max_smallest3 ? a : max_smallest3;
+		}
+		assert(max_smallest3 <= 0.004f);
+	}
+#endif
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Vector3.h"
+#include "Versor.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace eae6320
+{
+	// lossy packing for vertex buffers, baked files and network messages.
+	// the array versions give exactly what the single versions give, 4 values per iteration
+	// under SSE (half floats 8 under F16C). snorm and unorm round half to even.
+	namespace Pack
+	{
+		// a unit vector projected onto the octahedron |x| + |y| + |z| = 1, with the
+		// lower hemisphere folded over the diagonals; each axis snorm16
+		struct Octahedral
+		{
+			int16_t u, v;
+		};
+
+		// IEEE binary16, rounded to nearest even. out of range goes to infinity,
+		// NaN stays NaN. relative error is at most 2^-11 over the normal range
+		uint16_t to_half(float f);
+		float from_half(uint16_t h);
+
+		// [-1, 1] to [-INT16_MAX, INT16_MAX] and [0, 1] to [0, 255]; inputs are clamped
+		// first and NaN goes to the bottom of the range
+		int16_t to_snorm16(float f);
+		float from_snorm16(int16_t s);
+		uint8_t to_unorm8(float f);
+		float from_unorm8(uint8_t u);
+
+		// the decoded normal is within 0.0001 radians of the original
+		Octahedral to_octahedral(const Vector3 & n);
+		Vector3 from_octahedral(Octahedral e);
+
+		// smallest three: the largest component is dropped (and made positive, since q and -q
+		// are the same rotation) and rebuilt from unit length. its index goes in the top
+		// 2 bits, and the other three 10 bits each. within 0.004 radians of the original
+		uint32_t to_smallest3(const Versor & q);
+		Versor from_smallest3(uint32_t bits);
+
+		// out[i] = to_half(in[i]), and so on for each conversion above
+		void to_half(const float * in, uint16_t * out, size_t count);
+		void from_half(const uint16_t * in, float * out, size_t count);
+		void to_snorm16(const float * in, int16_t * out, size_t count);
+		void from_snorm16(const int16_t * in, float * out, size_t count);
+		void to_unorm8(const float * in, uint8_t * out, size_t count);
+		void from_unorm8(const uint8_t * in, float * out, size_t count);
+		void to_octahedral(const Vector3 * in, Octahedral * out, size_t count);
+		void from_octahedral(const Octahedral * in, Vector3 * out, size_t count);
+		void to_smallest3(const Versor * in, uint32_t * out, size_t count);
+		void from_smallest3(const uint32_t * in, Versor * out, size_t count);
+
+		// measures each format's worst error against its bound above,
+		// and checks the arrays against the single versions
+#ifdef _DEBUG
+		void test();
+#else
+		inline void test() {}
+#endif
+	}
+}
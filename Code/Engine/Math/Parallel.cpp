@@ -0,0 +1,132 @@
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eae6320
+{
+	namespace
+	{
+		typedef std::function<void(size_t)> Work;
+
+		// one call's work at a time. a call fills in the job and bumps generation; each
+		// worker that sees a new generation takes indices from next until they run out
+		struct Pool
+		{
+			// set by the call using the workers
+			std::atomic<bool> busy;
+
+			std::mutex mutex;
+			std::condition_variable wake, finished;
+			const Work * work;
+			size_t count;
+			std::atomic<size_t> next;
+			// workers between taking up a job and running out of its indices
+			size_t running;
+			uint64_t generation;
+			bool stopping;
+
+			std::vector<std::thread> workers;
+
+			Pool()
+				: busy(false), work(NULL), count(0), next(0), running(0), generation(0), stopping(false)
+			{
+				size_t hardware = std::max(std::thread::hardware_concurrency(), 1u);
+				for (size_t i = 0; i + 1 < hardware; ++i)
+					workers.push_back(std::thread(&Pool::serve, this));
+			}
+
+			~Pool()
+			{
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stopping = true;
+				}
+				wake.notify_all();
+				for (std::thread & worker : workers)
+					worker.join();
+			}
+
+			void drain(const Work & work, size_t count)
+			{
+				for (size_t i = next++; i < count; i = next++)
+					work(i);
+			}
+
+			void serve()
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				uint64_t seen = generation;
+				for (;;)
+				{
+					wake.wait(lock, [&] { return stopping || generation != seen; });
+					if (stopping)
+						return;
+					seen = generation;
+					// woken too late: the call already ran every index and returned
+					if (!work)
+						continue;
+					const Work & job = *work;
+					size_t job_count = count;
+
+					++running;
+					lock.unlock();
+					drain(job, job_count);
+					lock.lock();
+					if (--running == 0)
+						finished.notify_one();
+				}
+			}
+
+			void run(const Work & job, size_t job_count)
+			{
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					work = &job;
+					count = job_count;
+					next = 0;
+					++generation;
+				}
+				wake.notify_all();
+
+				drain(job, job_count);
+
+				// every index is taken once next passes count, and every worker still running
+				// one is counted in running
+				std::unique_lock<std::mutex> lock(mutex);
+				finished.wait(lock, [&] { return running == 0; });
+				work = NULL;
+			}
+		};
+
+		Pool & pool()
+		{
+			static Pool s_pool;
+			return s_pool;
+		}
+	}
+
+	void parallel(size_t count, const Work & work)
+	{
+		Pool & shared = pool();
+		bool idle = false;
+		if (count > 1 && !shared.workers.empty() && shared.busy.compare_exchange_strong(idle, true))
+		{
+			shared.run(work, count);
+			shared.busy = false;
+			return;
+		}
+		for (size_t i = 0; i < count; ++i)
+			work(i);
+	}
+
+	size_t parallel_threads()
+	{
+		return pool().workers.size() + 1;
+	}
+}
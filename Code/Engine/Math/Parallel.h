@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace eae6320
+{
+	// runs work(0) .. work(count - 1) and returns when all are done. the calling thread takes
+	// part; the rest go to worker threads that are started once, on first use, one fewer than
+	// the hardware has, and then kept waiting between calls.
+	// indices are handed out as threads come free, so one thread may run several, and work
+	// must not depend on which thread runs it. a call made while the workers are busy, as from
+	// inside work or from a second thread, runs all of its indices on the calling thread.
+	void parallel(size_t count, const std::function<void(size_t)> & work);
+
+	// how many threads parallel() can spread work over, the calling one included
+	size_t parallel_threads();
+}
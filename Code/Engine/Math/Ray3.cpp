@@ -0,0 +1,194 @@
+#include "Ray3.h"
+#include <cmath>
+
+#ifdef _DEBUG
+#include <cassert>
+#include <cstdlib>
+#endif
+
+namespace eae6320
+{
+	void AABB3x4::set(size_t i, const AABB3 & box)
+	{
+		for (size_t axis = 0; axis < 3; ++axis)
+		{
+			vmin[axis][i] = box.vmin[axis];
+			vmax[axis][i] = box.vmax[axis];
+		}
+	}
+
+	void AABB3x8::set(size_t i, const AABB3 & box)
+	{
+		for (size_t axis = 0; axis < 3; ++axis)
+		{
+			vmin[axis][i] = box.vmin[axis];
+			vmax[axis][i] = box.vmax[axis];
+		}
+	}
+
+	Ray3::Ray3(Vector3 o, Vector3 dir) : o(o), dir(dir), sign(0)
+	{
+		// a zero component would give 0 * infinity = NaN for a ray lying in a slab's plane.
+		// 1e-30 keeps the reciprocal finite, with room to spare when multiplied by distances
+		float inv[3];
+		for (size_t i = 0; i < 3; ++i)
+		{
+			float d = dir[i];
+			if (fabsf(d) < 1e-30f)
+				d = d < 0.0f ? -1e-30f : 1e-30f;
+			if (d < 0.0f)
+				sign |= 1 << i;
+			inv[i] = 1.0f / d;
+		}
+		inv_dir = Vector3A(inv[0], inv[1], inv[2]);
+	}
+
+	namespace
+	{
+		// lo and hi are the per axis arrays holding each box's entry and exit planes,
+		// width floats starting at offset; returns one bit per box
+#if !defined(EAE6320_SSE)
+		uint32_t slab(const Ray3 & ray, const float * const lo[3], const float * const hi[3], size_t offset, size_t width, float t_max)
+		{
+			uint32_t hits = 0;
+			for (size_t i = 0; i < width; ++i)
+			{
+				float t_enter = 0.0f, t_exit = t_max;
+				for (size_t axis = 0; axis < 3; ++axis)
+				{
+					float near_t = (lo[axis][offset + i] - ray.o[axis]) * ray.inv_dir[axis];
+					float far_t = (hi[axis][offset + i] - ray.o[axis]) * ray.inv_dir[axis];
+					t_enter = near_t > t_enter ? near_t : t_enter;
+					t_exit = far_t < t_exit ? far_t : t_exit;
+				}
+				if (t_enter <= t_exit)
+					hits |= 1 << i;
+			}
+			return hits;
+		}
+#else
+		uint32_t slab4(const Ray3 & ray, const float * const lo[3], const float * const hi[3], size_t offset, float t_max)
+		{
+			__m128 t_enter = _mm_setzero_ps(), t_exit = _mm_set1_ps(t_max);
+			for (size_t axis = 0; axis < 3; ++axis)
+			{
+				__m128 o = _mm_set1_ps(ray.o[axis]), inv = _mm_set1_ps(ray.inv_dir[axis]);
+				t_enter = _mm_max_ps(t_enter, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(lo[axis] + offset), o), inv));
+				t_exit = _mm_min_ps(t_exit, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(hi[axis] + offset), o), inv));
+			}
+			return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(t_enter, t_exit)));
+		}
+#endif
+
+#if defined(EAE6320_AVX)
+		uint32_t slab8(const Ray3 & ray, const float * const lo[3], const float * const hi[3], float t_max)
+		{
+			__m256 t_enter = _mm256_setzero_ps(), t_exit = _mm256_set1_ps(t_max);
+			for (size_t axis = 0; axis < 3; ++axis)
+			{
+				__m256 o = _mm256_set1_ps(ray.o[axis]), inv = _mm256_set1_ps(ray.inv_dir[axis]);
+				t_enter = _mm256_max_ps(t_enter, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(lo[axis]), o), inv));
+				t_exit = _mm256_min_ps(t_exit, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(hi[axis]), o), inv));
+			}
+			return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(t_enter, t_exit, _CMP_LE_OQ)));
+		}
+#endif
+	}
+
+	// the sign bits pick each axis' entry plane for all the boxes at once, so no min/max is needed
+
+	uint32_t Ray3::intersects(const AABB3x4 & boxes, float t_max) const
+	{
+		const float * lo[3], * hi[3];
+		for (size_t axis = 0; axis < 3; ++axis)
+		{
+			bool negative = (sign >> axis & 1) != 0;
+			lo[axis] = negative ? boxes.vmax[axis] : boxes.vmin[axis];
+			hi[axis] = negative ? boxes.vmin[axis] : boxes.vmax[axis];
+		}
+#if defined(EAE6320_SSE)
+		return slab4(*this, lo, hi, 0, t_max);
+#else
+		return slab(*this, lo, hi, 0, 4, t_max);
+#endif
+	}
+
+	uint32_t Ray3::intersects(const AABB3x8 & boxes, float t_max) const
+	{
+		const float * lo[3], * hi[3];
+		for (size_t axis = 0; axis < 3; ++axis)
+		{
+			bool negative = (sign >> axis & 1) != 0;
+			lo[axis] = negative ? boxes.vmax[axis] : boxes.vmin[axis];
+			hi[axis] = negative ? boxes.vmin[axis] : boxes.vmax[axis];
+		}
+#if defined(EAE6320_AVX)
+		return slab8(*this, lo, hi, t_max);
+#elif defined(EAE6320_SSE)
+		return slab4(*this, lo, hi, 0, t_max) | slab4(*this, lo, hi, 4, t_max) << 4;
+#else
+		return slab(*this, lo, hi, 0, 8, t_max);
+#endif
+	}
+
+#ifdef _DEBUG
+	namespace
+	{
+		Vector3 random_point()
+		{
+			return Vector3(
+				20.0f * rand() / RAND_MAX - 10.0f,
+				20.0f * rand() / RAND_MAX - 10.0f,
+				20.0f * rand() / RAND_MAX - 10.0f);
+		}
+	}
+
+	void Ray3::test()
+	{
+		int misses = 0;
+		for (int n = 0; n < 1000; ++n)
+		{
+			Vector3 a = random_point(), b = random_point();
+			// some axis aligned segments, which take the clamped reciprocal
+			if (n % 4 == 0)
+				b.y = a.y;
+			if (n % 8 == 0)
+				b.z = a.z;
+			Segment3 segment(a, b);
+			Ray3 ray(segment);
+
+			AABB3x8 boxes;
+			AABB3x4 first;
+			uint32_t expected = 0;
+			for (size_t i = 0; i < 8; ++i)
+			{
+				Vector3 p = random_point(), q = random_point();
+				AABB3 box(Vector3::min3(p, q), Vector3::max3(p, q));
+				boxes.set(i, box);
+				if (i < 4)
+					first.set(i, box);
+
+				float t_enter, t_exit;
+				bool hit = ray.intersect(AABB3A(box), t_enter, t_exit);
+				assert(hit == box.intersects(segment));
+				if (hit)
+				{
+					expected |= 1 << i;
+					assert(0.0f <= t_enter && t_enter <= t_exit && t_exit <= 1.0f);
+					// both ends lie on the box, allowing for rounding
+					AABB3 grown(box.vmin - Vector3(1e-3f, 1e-3f, 1e-3f), box.vmax + Vector3(1e-3f, 1e-3f, 1e-3f));
+					assert(grown.contains(AABB3(a + t_enter * (b - a), a + t_enter * (b - a))));
+					assert(grown.contains(AABB3(a + t_exit * (b - a), a + t_exit * (b - a))));
+				}
+				else
+					++misses;
+			}
+
+			assert(ray.intersects(boxes) == expected);
+			assert(ray.intersects(first) == (expected & 0xF));
+		}
+		// the draws should exercise both outcomes
+		assert(misses > 0 && misses < 8000);
+	}
+#endif
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "AABB3A.h"
+
+#include <cstdint>
+
+namespace eae6320
+{
+	// boxes stored one array per bound per axis, so that a Ray3 tests all of them in one SIMD pass.
+	// box i is (vmin[0][i], vmin[1][i], vmin[2][i]) to (vmax[0][i], vmax[1][i], vmax[2][i])
+	struct AABB3x4
+	{
+		float vmin[3][4], vmax[3][4];
+
+		void set(size_t i, const AABB3 & box);
+	};
+
+	struct AABB3x8
+	{
+		float vmin[3][8], vmax[3][8];
+
+		void set(size_t i, const AABB3 & box);
+	};
+
+	// o + t dir, keeping what the slab test needs: the reciprocal direction and its signs.
+	// built once per query, then tested against many boxes
+	struct Ray3
+	{
+		Vector3A o, dir, inv_dir;
+		// bit i is set when dir[i] is negative
+		uint8_t sign;
+
+		Ray3() {}
+		Ray3(Vector3 o, Vector3 dir);
+		// t in [0, 1] covers the segment
+		explicit Ray3(const Segment3 & segment) : Ray3(segment.a, segment.b - segment.a) {}
+
+		// the part of [t_min, t_max] inside the box, as [t_enter, t_exit]; false if there is none
+		bool intersect(const AABB3A & box, float & t_enter, float & t_exit, float t_min = 0.0f, float t_max = 1.0f) const;
+		bool intersects(const AABB3A & box, float t_max = 1.0f) const;
+		// bit i is set when box i is hit for some t in [0, t_max]
+		uint32_t intersects(const AABB3x4 & boxes, float t_max = 1.0f) const;
+		uint32_t intersects(const AABB3x8 & boxes, float t_max = 1.0f) const;
+
+		// compares against AABB3's segment test, and the packets against single boxes
+		static void test()
+#ifdef _DEBUG
+		;
+#else
+		{}
+#endif
+	};
+
+	// the single box test is inline, like AABB3A's
+
+	inline bool Ray3::intersect(const AABB3A & box, float & t_enter, float & t_exit, float t_min, float t_max) const
+	{
+#if defined(EAE6320_SSE)
+		__m128 t0 = _mm_mul_ps(_mm_sub_ps(box.vmin.v, o.v), inv_dir.v);
+		__m128 t1 = _mm_mul_ps(_mm_sub_ps(box.vmax.v, o.v), inv_dir.v);
+		// w repeats x so that it takes no part in the reductions
+		__m128 lo = EAE6320_SWIZZLE(_mm_min_ps(t0, t1), 0, 1, 2, 0);
+		__m128 hi = EAE6320_SWIZZLE(_mm_max_ps(t0, t1), 0, 1, 2, 0);
+		lo = _mm_max_ps(lo, EAE6320_SWIZZLE(lo, 1, 0, 3, 2));
+		hi = _mm_min_ps(hi, EAE6320_SWIZZLE(hi, 1, 0, 3, 2));
+		lo = _mm_max_ss(_mm_max_ps(lo, EAE6320_SWIZZLE(lo, 2, 3, 0, 1)), _mm_set_ss(t_min));
+		hi = _mm_min_ss(_mm_min_ps(hi, EAE6320_SWIZZLE(hi, 2, 3, 0, 1)), _mm_set_ss(t_max));
+		t_enter = _mm_cvtss_f32(lo);
+		t_exit = _mm_cvtss_f32(hi);
+#else
+		// the sign bits say which side of each slab is entered first
+		t_enter = t_min;
+		t_exit = t_max;
+		for (size_t i = 0; i < 3; ++i)
+		{
+			bool negative = (sign >> i & 1) != 0;
+			float near_t = ((negative ? box.vmax : box.vmin)[i] - o[i]) * inv_dir[i];
+			float far_t = ((negative ? box.vmin : box.vmax)[i] - o[i]) * inv_dir[i];
+			t_enter = near_t > t_enter ? near_t : t_enter;
+			t_exit = far_t < t_exit ? far_t : t_exit;
+		}
+#endif
+		return t_enter <= t_exit;
+	}
+
+	inline bool Ray3::intersects(const AABB3A & box, float t_max) const
+	{
+		float t_enter, t_exit;
+		return intersect(box, t_enter, t_exit, 0.0f, t_max);
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+// picks the widest instruction set the compiler is targeting.
+// define EAE6320_MATH_NO_SIMD to force the scalar paths everywhere.
+//   EAE6320_SSE: SSE2, which every x64 build and the default Win32 build have
+//   EAE6320_AVX: AVX, only with /arch:AVX (or -mavx)
+//   EAE6320_BMI2: the bit deposit/extract instructions, which come with /arch:AVX2 (or -mbmi2)
+//   EAE6320_F16C: the half-float conversions, likewise with /arch:AVX2 (or -mf16c)
+
+#if !defined(EAE6320_MATH_NO_SIMD)
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define EAE6320_SSE 1
+#endif
+#if defined(EAE6320_SSE) && defined(__AVX__)
+#define EAE6320_AVX 1
+#endif
+// MSVC has no BMI2 macro, but every AVX2 processor has the instructions
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define EAE6320_BMI2 1
+#endif
+#if defined(EAE6320_SSE) && (defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__)))
+#define EAE6320_F16C 1
+#endif
+#endif
+
+#if defined(EAE6320_AVX) || defined(EAE6320_BMI2) || defined(EAE6320_F16C)
+#include <immintrin.h>
+#elif defined(EAE6320_SSE)
+#include <emmintrin.h>
+#endif
+
+#if defined(EAE6320_SSE)
+// _mm_shuffle_ps(v, v, ...) with lanes named in memory order
+#define EAE6320_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps((v), (v), _MM_SHUFFLE((w), (z), (y), (x)))
+#define EAE6320_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps((a), (b), _MM_SHUFFLE((w), (z), (y), (x)))
+
+namespace eae6320
+{
+namespace Simd
+{
+	// a * b + c
+	inline __m128 madd(__m128 a, __m128 b, __m128 c)
+	{
+		return _mm_add_ps(_mm_mul_ps(a, b), c);
+	}
+
+#if defined(EAE6320_AVX)
+	inline __m256 madd(__m256 a, __m256 b, __m256 c)
+	{
+		return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+	}
+#endif
+
+	// a Vector3 into x, y, z with w zero, without reading past it.
+	// the 64-bit integer moves, unlike _mm_load_sd, may alias floats and need no alignment
+	inline __m128 load3(const float * p)
+	{
+		__m128 xy = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+		return _mm_movelh_ps(xy, _mm_load_ss(p + 2));
+	}
+
+	inline void store3(float * p, __m128 v)
+	{
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_castps_si128(v));
+		_mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+	}
+
+	inline __m128 abs(__m128 v)
+	{
+		return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+	}
+
+	// four packed Vector3s (12 floats) to one register per component
+	inline void load_xyz4(const float * p, __m128 & x, __m128 & y, __m128 & z)
+	{
+		__m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p + 4), c = _mm_loadu_ps(p + 8);
+		__m128 yz01 = EAE6320_SHUFFLE(a, b, 1, 2, 0, 1);
+		__m128 xyz2 = EAE6320_SHUFFLE(b, c, 2, 3, 0, 1);
+		__m128 yy23 = EAE6320_SHUFFLE(b, c, 3, 3, 2, 2);
+		x = EAE6320_SHUFFLE(a, xyz2, 0, 3, 0, 3);
+		y = EAE6320_SHUFFLE(yz01, yy23, 0, 2, 0, 2);
+		z = EAE6320_SHUFFLE(yz01, c, 1, 3, 0, 3);
+	}
+
+	// the inverse of load_xyz4
+	inline void store_xyz4(float * p, __m128 x, __m128 y, __m128 z)
+	{
+		__m128 a = EAE6320_SHUFFLE(EAE6320_SHUFFLE(x, y, 0, 1, 0, 1), EAE6320_SHUFFLE(z, x, 0, 0, 1, 1), 0, 2, 0, 2);
+		__m128 b = EAE6320_SHUFFLE(EAE6320_SHUFFLE(y, z, 1, 1, 1, 1), EAE6320_SHUFFLE(x, y, 2, 2, 2, 2), 0, 2, 0, 2);
+		__m128 c = EAE6320_SHUFFLE(EAE6320_SHUFFLE(z, x, 2, 2, 3, 3), EAE6320_SHUFFLE(y, z, 3, 3, 3, 3), 0, 2, 0, 2);
+		_mm_storeu_ps(p, a);
+		_mm_storeu_ps(p + 4, b);
+		_mm_storeu_ps(p + 8, c);
+	}
+
+	// the row vector v times the matrix with rows r0..r3
+	inline __m128 predot(__m128 v, __m128 r0, __m128 r1, __m128 r2, __m128 r3)
+	{
+		__m128 r = _mm_mul_ps(EAE6320_SWIZZLE(v, 0, 0, 0, 0), r0);
+		r = _mm_add_ps(r, _mm_mul_ps(EAE6320_SWIZZLE(v, 1, 1, 1, 1), r1));
+		r = _mm_add_ps(r, _mm_mul_ps(EAE6320_SWIZZLE(v, 2, 2, 2, 2), r2));
+		return _mm_add_ps(r, _mm_mul_ps(EAE6320_SWIZZLE(v, 3, 3, 3, 3), r3));
+	}
+
+	// the matrix with rows r0..r3 times the column vector v
+	inline __m128 postdot(__m128 v, __m128 r0, __m128 r1, __m128 r2, __m128 r3)
+	{
+		r0 = _mm_mul_ps(r0, v);
+		r1 = _mm_mul_ps(r1, v);
+		r2 = _mm_mul_ps(r2, v);
+		r3 = _mm_mul_ps(r3, v);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		return _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3));
+	}
+
+	// xyz cross product; w is left zero
+	inline __m128 cross(__m128 a, __m128 b)
+	{
+		return _mm_sub_ps(
+			_mm_mul_ps(EAE6320_SWIZZLE(a, 1, 2, 0, 3), EAE6320_SWIZZLE(b, 2, 0, 1, 3)),
+			_mm_mul_ps(EAE6320_SWIZZLE(a, 2, 0, 1, 3), EAE6320_SWIZZLE(b, 1, 2, 0, 3)));
+	}
+
+	// sum of all lanes, in every lane
+	inline __m128 sum(__m128 v)
+	{
+		v = _mm_add_ps(v, EAE6320_SWIZZLE(v, 1, 0, 3, 2));
+		return _mm_add_ps(v, EAE6320_SWIZZLE(v, 2, 3, 0, 1));
+	}
+}
+}
+#endif
@@ -0,0 +1,454 @@
+#include "SpatialKey.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef _DEBUG
+#include <cassert>
+#include <cstdlib>
+#endif
+
+namespace eae6320
+{
+	namespace
+	{
+		// the low 10 bits of v, moved to every third bit
+		uint32_t spread10(uint32_t v)
+		{
+#if defined(EAE6320_BMI2)
+			return _pdep_u32(v, 0x09249249);
+#else
+			v &= 0x3ff;
+			v = (v | v << 16) & 0x030000ff;
+			v = (v | v << 8) & 0x0300f00f;
+			v = (v | v << 4) & 0x030c30c3;
+			v = (v | v << 2) & 0x09249249;
+			return v;
+#endif
+		}
+
+		uint32_t compact10(uint32_t v)
+		{
+#if defined(EAE6320_BMI2)
+			return _pext_u32(v, 0x09249249);
+#else
+			v &= 0x09249249;
+			v = (v ^ v >> 2) & 0x030c30c3;
+			v = (v ^ v >> 4) & 0x0300f00f;
+			v = (v ^ v >> 8) & 0xff0000ff;
+			v = (v ^ v >> 16) & 0x000003ff;
+			return v;
+#endif
+		}
+
+		// _pdep_u64 is only in 64-bit builds
+#if defined(EAE6320_BMI2) && (defined(_M_X64) || defined(__x86_64__))
+#define EAE6320_BMI2_64 1
+#endif
+
+		uint64_t spread21(uint64_t v)
+		{
+#if defined(EAE6320_BMI2_64)
+			return _pdep_u64(v, 0x1249249249249249ull);
+#else
+			v &= 0x1fffff;
+			v = (v | v << 32) & 0x001f00000000ffffull;
+			v = (v | v << 16) & 0x001f0000ff0000ffull;
+			v = (v | v << 8) & 0x100f00f00f00f00full;
+			v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+			v = (v | v << 2) & 0x1249249249249249ull;
+			return v;
+#endif
+		}
+
+		uint32_t compact21(uint64_t v)
+		{
+#if defined(EAE6320_BMI2_64)
+			return static_cast<uint32_t>(_pext_u64(v, 0x1249249249249249ull));
+#else
+			v &= 0x1249249249249249ull;
+			v = (v ^ v >> 2) & 0x10c30c30c30c30c3ull;
+			v = (v ^ v >> 4) & 0x100f00f00f00f00full;
+			v = (v ^ v >> 8) & 0x001f0000ff0000ffull;
+			v = (v ^ v >> 16) & 0x001f00000000ffffull;
+			v = (v ^ v >> 32) & 0x1fffff;
+			return static_cast<uint32_t>(v);
+#endif
+		}
+
+		// Skilling's "Programming the Hilbert curve" (2004): turns cell coordinates into the
+		// Hilbert key with its bits transposed, so that interleaving X gives the key
+		void axes_to_transpose(uint32_t (&X)[3], uint32_t bits)
+		{
+			uint32_t M = 1u << (bits - 1);
+
+			// inverse undo
+			for (uint32_t Q = M; Q > 1; Q >>= 1)
+			{
+				uint32_t P = Q - 1;
+				for (size_t i = 0; i < 3; ++i)
+				{
+					if (X[i] & Q)
+						X[0] ^= P;
+					else
+					{
+						uint32_t t = (X[0] ^ X[i]) & P;
+						X[0] ^= t;
+						X[i] ^= t;
+					}
+				}
+			}
+
+			// Gray encode
+			for (size_t i = 1; i < 3; ++i)
+				X[i] ^= X[i - 1];
+			uint32_t t = 0;
+			for (uint32_t Q = M; Q > 1; Q >>= 1)
+				if (X[2] & Q)
+					t ^= Q - 1;
+			for (size_t i = 0; i < 3; ++i)
+				X[i] ^= t;
+		}
+
+		void transpose_to_axes(uint32_t (&X)[3], uint32_t bits)
+		{
+			uint32_t N = 2u << (bits - 1);
+
+			// Gray decode
+			uint32_t t = X[2] >> 1;
+			for (size_t i = 2; i > 0; --i)
+				X[i] ^= X[i - 1];
+			X[0] ^= t;
+
+			// undo excess work
+			for (uint32_t Q = 2; Q != N; Q <<= 1)
+			{
+				uint32_t P = Q - 1;
+				for (size_t i = 3; i-- > 0;)
+				{
+					if (X[i] & Q)
+						X[0] ^= P;
+					else
+					{
+						uint32_t t = (X[0] ^ X[i]) & P;
+						X[0] ^= t;
+						X[i] ^= t;
+					}
+				}
+			}
+		}
+	}
+
+	uint32_t SpatialKey::morton30(uint32_t x, uint32_t y, uint32_t z)
+	{
+		return spread10(x) | spread10(y) << 1 | spread10(z) << 2;
+	}
+
+	uint64_t SpatialKey::morton63(uint32_t x, uint32_t y, uint32_t z)
+	{
+		return spread21(x) | spread21(y) << 1 | spread21(z) << 2;
+	}
+
+	void SpatialKey::decode_morton30(uint32_t key, uint32_t & x, uint32_t & y, uint32_t & z)
+	{
+		x = compact10(key);
+		y = compact10(key >> 1);
+		z = compact10(key >> 2);
+	}
+
+	void SpatialKey::decode_morton63(uint64_t key, uint32_t & x, uint32_t & y, uint32_t & z)
+	{
+		x = compact21(key);
+		y = compact21(key >> 1);
+		z = compact21(key >> 2);
+	}
+
+	// the transposed key puts X[0] in the highest bit of each triple
+
+	uint32_t SpatialKey::hilbert30(uint32_t x, uint32_t y, uint32_t z)
+	{
+		uint32_t X[3] = { x & 0x3ff, y & 0x3ff, z & 0x3ff };
+		axes_to_transpose(X, 10);
+		return morton30(X[2], X[1], X[0]);
+	}
+
+	uint64_t SpatialKey::hilbert63(uint32_t x, uint32_t y, uint32_t z)
+	{
+		uint32_t X[3] = { x & 0x1fffff, y & 0x1fffff, z & 0x1fffff };
+		axes_to_transpose(X, 21);
+		return morton63(X[2], X[1], X[0]);
+	}
+
+	void SpatialKey::decode_hilbert30(uint32_t key, uint32_t & x, uint32_t & y, uint32_t & z)
+	{
+		uint32_t X[3];
+		decode_morton30(key, X[2], X[1], X[0]);
+		transpose_to_axes(X, 10);
+		x = X[0];
+		y = X[1];
+		z = X[2];
+	}
+
+	void SpatialKey::decode_hilbert63(uint64_t key, uint32_t & x, uint32_t & y, uint32_t & z)
+	{
+		uint32_t X[3];
+		decode_morton63(key, X[2], X[1], X[0]);
+		transpose_to_axes(X, 21);
+		x = X[0];
+		y = X[1];
+		z = X[2];
+	}
+
+	void SpatialKey::quantize(const Vector3 & p, const AABB3 & box, uint32_t bits, uint32_t & x, uint32_t & y, uint32_t & z)
+	{
+		float cells = static_cast<float>(1u << bits), top = cells - 1.0f;
+		Vector3 extent = box.vmax - box.vmin;
+		uint32_t * out[3] = { &x, &y, &z };
+		for (size_t i = 0; i < 3; ++i)
+		{
+			float scale = extent[i] > 0.0f ? cells / extent[i] : 0.0f;
+			float cell = (p[i] - box.vmin[i]) * scale;
+			*out[i] = static_cast<uint32_t>(std::min(std::max(cell, 0.0f), top));
+		}
+	}
+
+	uint32_t SpatialKey::morton30(const Vector3 & p, const AABB3 & box)
+	{
+		uint32_t x, y, z;
+		quantize(p, box, 10, x, y, z);
+		return morton30(x, y, z);
+	}
+
+	uint64_t SpatialKey::morton63(const Vector3 & p, const AABB3 & box)
+	{
+		uint32_t x, y, z;
+		quantize(p, box, 21, x, y, z);
+		return morton63(x, y, z);
+	}
+
+	uint32_t SpatialKey::hilbert30(const Vector3 & p, const AABB3 & box)
+	{
+		uint32_t x, y, z;
+		quantize(p, box, 10, x, y, z);
+		return hilbert30(x, y, z);
+	}
+
+	uint64_t SpatialKey::hilbert63(const Vector3 & p, const AABB3 & box)
+	{
+		uint32_t x, y, z;
+		quantize(p, box, 21, x, y, z);
+		return hilbert63(x, y, z);
+	}
+
+	void SpatialKey::morton30(const Vector3 * points, size_t count, const AABB3 & box, uint32_t * keys)
+	{
+		size_t i = 0;
+#if defined(EAE6320_SSE)
+		Vector3 extent = box.vmax - box.vmin;
+		__m128 vmin[3] = { _mm_set1_ps(box.vmin.x), _mm_set1_ps(box.vmin.y), _mm_set1_ps(box.vmin.z) };
+		__m128 scale[3];
+		for (size_t axis = 0; axis < 3; ++axis)
+			scale[axis] = _mm_set1_ps(extent[axis] > 0.0f ? 1024.0f / extent[axis] : 0.0f);
+		__m128 top = _mm_set1_ps(1023.0f);
+
+		// spread10's shifts and masks, on four lanes at once
+		const __m128i masks[5] = {
+			_mm_set1_epi32(0x3ff), _mm_set1_epi32(0x030000ff), _mm_set1_epi32(0x0300f00f),
+			_mm_set1_epi32(0x030c30c3), _mm_set1_epi32(0x09249249) };
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 p[3];
+			Simd::load_xyz4(&points[i].x, p[0], p[1], p[2]);
+
+			__m128i key = _mm_setzero_si128();
+			for (size_t axis = 0; axis < 3; ++axis)
+			{
+				__m128 cell = _mm_mul_ps(_mm_sub_ps(p[axis], vmin[axis]), scale[axis]);
+				__m128i v = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(cell, _mm_setzero_ps()), top));
+				v = _mm_and_si128(v, masks[0]);
+				v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 16)), masks[1]);
+				v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 8)), masks[2]);
+				v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 4)), masks[3]);
+				v = _mm_and_si128(_mm_or_si128(v, _mm_slli_epi32(v, 2)), masks[4]);
+				key = _mm_or_si128(key, _mm_sll_epi32(v, _mm_cvtsi32_si128(static_cast<int>(axis))));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(keys + i), key);
+		}
+#endif
+		for (; i < count; ++i)
+			keys[i] = morton30(points[i], box);
+	}
+
+	namespace
+	{
+		// below this, handing out the work costs more than it saves
+		const size_t PARALLEL_SORT_SIZE = 1 << 16;
+
+		// least significant digit first, 8 bits per pass. each thread counts and then
+		// scatters its own slice, so each pass is stable and needs no locks
+		template <typename Key>
+		void radix_sort(Key * keys, uint32_t * values, size_t count)
+		{
+			size_t threads = 1;
+			if (count >= PARALLEL_SORT_SIZE)
+				threads = std::min<size_t>(parallel_threads(), 8);
+			size_t slice = (count + threads - 1) / threads;
+
+			std::vector<Key> key_buffer(count);
+			std::vector<uint32_t> value_buffer(count);
+			Key * key_from = keys, * key_to = key_buffer.data();
+			uint32_t * value_from = values, * value_to = value_buffer.data();
+			std::vector<size_t> offsets(threads * 256);
+
+			for (uint32_t shift = 0; shift < sizeof(Key) * 8; shift += 8)
+			{
+				std::fill(offsets.begin(), offsets.end(), 0);
+				parallel(threads, [&](size_t t)
+				{
+					size_t * counts = &offsets[t * 256];
+					for (size_t i = t * slice; i < std::min(count, (t + 1) * slice); ++i)
+						++counts[key_from[i] >> shift & 0xff];
+				});
+
+				// digit by digit, and within a digit thread by thread, so equal keys keep their order
+				size_t total = 0;
+				bool all_one_digit = false;
+				for (size_t digit = 0; digit < 256; ++digit)
+				{
+					size_t start = total;
+					for (size_t t = 0; t < threads; ++t)
+					{
+						size_t n = offsets[t * 256 + digit];
+						offsets[t * 256 + digit] = total;
+						total += n;
+					}
+					if (total - start == count)
+						all_one_digit = true;
+				}
+				if (all_one_digit)
+					continue;
+
+				parallel(threads, [&](size_t t)
+				{
+					size_t * next = &offsets[t * 256];
+					for (size_t i = t * slice; i < std::min(count, (t + 1) * slice); ++i)
+					{
+						size_t to = next[key_from[i] >> shift & 0xff]++;
+						key_to[to] = key_from[i];
+						value_to[to] = value_from[i];
+					}
+				});
+				std::swap(key_from, key_to);
+				std::swap(value_from, value_to);
+			}
+
+			if (key_from != keys)
+			{
+				std::copy(key_from, key_from + count, keys);
+				std::copy(value_from, value_from + count, values);
+			}
+		}
+	}
+
+	void SpatialKey::sort(uint32_t * keys, uint32_t * values, size_t count)
+	{
+		radix_sort(keys, values, count);
+	}
+
+	void SpatialKey::sort(uint64_t * keys, uint32_t * values, size_t count)
+	{
+		radix_sort(keys, values, count);
+	}
+
+#ifdef _DEBUG
+	namespace
+	{
+		uint32_t random_bits(uint32_t bits)
+		{
+			uint32_t r = static_cast<uint32_t>(rand()) << 16 ^ static_cast<uint32_t>(rand());
+			return r & ((1u << bits) - 1);
+		}
+
+		// consecutive Hilbert keys are one step apart along one axis
+		bool neighbors(uint32_t ax, uint32_t ay, uint32_t az, uint32_t bx, uint32_t by, uint32_t bz)
+		{
+			uint32_t dx = ax > bx ? ax - bx : bx - ax;
+			uint32_t dy = ay > by ? ay - by : by - ay;
+			uint32_t dz = az > bz ? az - bz : bz - az;
+			return dx + dy + dz == 1;
+		}
+
+		template <typename Key>
+		void test_sort(size_t count, Key mask)
+		{
+			std::vector<Key> keys(count);
+			std::vector<uint32_t> values(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				uint64_t bits = static_cast<uint64_t>(random_bits(30)) << 32 ^ random_bits(30);
+				keys[i] = static_cast<Key>(bits) & mask;
+				// and every other one from a few repeated keys, so that stability shows
+				if (i % 2)
+					keys[i] = static_cast<Key>(bits % 64) << 20;
+				values[i] = static_cast<uint32_t>(i);
+			}
+			std::vector<Key> expected(keys);
+			std::sort(expected.begin(), expected.end());
+
+			SpatialKey::sort(keys.data(), values.data(), count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				assert(keys[i] == expected[i]);
+				if (i > 0 && keys[i] == keys[i - 1])
+					assert(values[i] > values[i - 1]);
+			}
+		}
+	}
+
+	void SpatialKey::test()
+	{
+		for (int n = 0; n < 10000; ++n)
+		{
+			uint32_t x = random_bits(10), y = random_bits(10), z = random_bits(10), dx, dy, dz;
+			decode_morton30(morton30(x, y, z), dx, dy, dz);
+			assert(dx == x && dy == y && dz == z);
+			decode_hilbert30(hilbert30(x, y, z), dx, dy, dz);
+			assert(dx == x && dy == y && dz == z);
+
+			uint32_t X = random_bits(21), Y = random_bits(21), Z = random_bits(21);
+			decode_morton63(morton63(X, Y, Z), dx, dy, dz);
+			assert(dx == X && dy == Y && dz == Z);
+			decode_hilbert63(hilbert63(X, Y, Z), dx, dy, dz);
+			assert(dx == X && dy == Y && dz == Z);
+
+			uint32_t key = random_bits(30) % ((1u << 30) - 1), ax, ay, az, bx, by, bz;
+			decode_hilbert30(key, ax, ay, az);
+			decode_hilbert30(key + 1, bx, by, bz);
+			assert(neighbors(ax, ay, az, bx, by, bz));
+
+			uint64_t key63 = static_cast<uint64_t>(random_bits(30)) << 30 | random_bits(30);
+			decode_hilbert63(key63, ax, ay, az);
+			decode_hilbert63(key63 + 1, bx, by, bz);
+			assert(neighbors(ax, ay, az, bx, by, bz));
+		}
+
+		// the batch matches the single version, including points outside the box
+		AABB3 box(Vector3(-10.0f, 0.0f, 5.0f), Vector3(10.0f, 1.0f, 5.0f));
+		std::vector<Vector3> points(19);
+		for (Vector3 & p : points)
+			p = Vector3(30.0f * rand() / RAND_MAX - 15.0f, 2.0f * rand() / RAND_MAX - 0.5f, 7.0f);
+		std::vector<uint32_t> keys(points.size());
+		morton30(points.data(), points.size(), box, keys.data());
+		for (size_t i = 0; i < points.size(); ++i)
+			assert(keys[i] == morton30(points[i], box));
+
+		test_sort<uint32_t>(1000, 0x3fffffff);
+		test_sort<uint64_t>(1000, 0x7fffffffffffffffull);
+		test_sort<uint32_t>(PARALLEL_SORT_SIZE * 2, 0x3fffffff);
+		test_sort<uint64_t>(PARALLEL_SORT_SIZE * 2, 0x7fffffffffffffffull);
+	}
+#endif
+}
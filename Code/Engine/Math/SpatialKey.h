@@ -0,0 +1,50 @@
+#pragma once
+
+#include "AABB3.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace eae6320
+{
+	// space filling curve keys: points near each other in space get nearby keys,
+	// so sorting by key groups them. 30-bit keys take 10 bits per axis, 63-bit keys 21.
+	// cell coordinates above the key's width are cut to it.
+	namespace SpatialKey
+	{
+		// x, y and z bits alternate from bit 0 up: ... z1 y1 x1 z0 y0 x0
+		uint32_t morton30(uint32_t x, uint32_t y, uint32_t z);
+		uint64_t morton63(uint32_t x, uint32_t y, uint32_t z);
+		void decode_morton30(uint32_t key, uint32_t & x, uint32_t & y, uint32_t & z);
+		void decode_morton63(uint64_t key, uint32_t & x, uint32_t & y, uint32_t & z);
+
+		// consecutive keys are always neighboring cells, which Morton keys are not
+		uint32_t hilbert30(uint32_t x, uint32_t y, uint32_t z);
+		uint64_t hilbert63(uint32_t x, uint32_t y, uint32_t z);
+		void decode_hilbert30(uint32_t key, uint32_t & x, uint32_t & y, uint32_t & z);
+		void decode_hilbert63(uint64_t key, uint32_t & x, uint32_t & y, uint32_t & z);
+
+		// the cell of p in a grid of 2^bits cells per axis over box; points outside are clamped
+		void quantize(const Vector3 & p, const AABB3 & box, uint32_t bits, uint32_t & x, uint32_t & y, uint32_t & z);
+
+		uint32_t morton30(const Vector3 & p, const AABB3 & box);
+		uint64_t morton63(const Vector3 & p, const AABB3 & box);
+		uint32_t hilbert30(const Vector3 & p, const AABB3 & box);
+		uint64_t hilbert63(const Vector3 & p, const AABB3 & box);
+
+		// keys[i] = morton30(points[i], box), 4 points per iteration under SSE
+		void morton30(const Vector3 * points, size_t count, const AABB3 & box, uint32_t * keys);
+
+		// sorts keys ascending, moving values[i] along with keys[i]; stable.
+		// large arrays are split across threads
+		void sort(uint32_t * keys, uint32_t * values, size_t count);
+		void sort(uint64_t * keys, uint32_t * values, size_t count);
+
+		// round trips, the Hilbert neighbor property, and the sort
+#ifdef _DEBUG
+		void test();
+#else
+		inline void test() {}
+#endif
+	}
+}
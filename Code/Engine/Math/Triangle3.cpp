@@ -1,8 +1,14 @@
 #include "Triangle3.h"
 #include "AABB3.h"
+#include "Simd.h"
+#include <cmath>
 #include <limits>
 #include <assert.h>
 
+#ifdef _DEBUG
+#include <cstdlib>
+#endif
+
 namespace eae6320
 {
 	Triangle3::Triangle3(Vector3 a, Vector3 b, Vector3 c, Vector3 normal)
@@ -11,6 +17,12 @@ namespace eae6320
 	{}
 
 	float Triangle3::intersect_ray(Vector3 o, Vector3 dir) const
+	{
+		return intersect_ray(a, b, c, normal, o, dir);
+	}
+
+	float Triangle3::intersect_ray(const Vector3 & a, const Vector3 & b, const Vector3 & c,
+		const Vector3 & normal, Vector3 o, Vector3 dir)
 	{
 		float diverge = std::numeric_limits<float>::infinity();
 		Vector3 ab = b - a;
@@ -24,7 +36,7 @@ namespace eae6320
 			return diverge;
 		t /= d;
 
-		Vector3 w = ao + dir * t;
+		Vector3 w = Vector3::madd(ao, dir, t);
 		float uu, uv, vv, wu, wv, D;
 
 		uu = ab.dot(ab);
@@ -44,4 +56,412 @@ namespace eae6320
 
 		return t;
 	}
-}
\ No newline at end of file
+
+	namespace
+	{
+		// smallest t in [0, 1] where |o + t*dir - v| = r
+		float sweep_point(Vector3 o, Vector3 dir, Vector3 v, float r)
+		{
+			float diverge = std::numeric_limits<float>::infinity();
+			Vector3 m = o - v;
+			float c = m.dot(m) - r * r;
+			if (c <= 0)
+				return 0;
+			float a = dir.dot(dir), b = m.dot(dir);
+			float disc = b * b - a * c;
+			if (a < 1e-12f || b >= 0 || disc < 0)
+				return diverge;
+			float t = (-b - sqrtf(disc)) / a;
+			return t <= 1 ? t : diverge;
+		}
+
+		// smallest t in [0, 1] where o + t*dir is r away from the segment pq, ignoring its ends
+		float sweep_edge(Vector3 o, Vector3 dir, Vector3 p, Vector3 q, float r)
+		{
+			float diverge = std::numeric_limits<float>::infinity();
+			Vector3 e = q - p;
+			float ee = e.dot(e);
+			if (ee < 1e-12f)
+				return diverge;
+
+			// work in the plane perpendicular to the edge
+			Vector3 m = o - p;
+			Vector3 mp = m - e * (m.dot(e) / ee);
+			Vector3 dp = dir - e * (dir.dot(e) / ee);
+			float a = dp.dot(dp), b = mp.dot(dp), c = mp.dot(mp) - r * r;
+
+			float t;
+			if (c <= 0)
+				t = 0;
+			else
+			{
+				float disc = b * b - a * c;
+				if (a < 1e-12f || b >= 0 || disc < 0)
+					return diverge;
+				t = (-b - sqrtf(disc)) / a;
+				if (t > 1)
+					return diverge;
+			}
+
+			float s = Vector3::madd(m, dir, t).dot(e) / ee;
+			return s >= 0 && s <= 1 ? t : diverge;
+		}
+
+		bool contains(const Vector3 & a, const Vector3 & b, const Vector3 & c, const Vector3 & n, Vector3 p)
+		{
+			return (b - a).cross(p - a).dot(n) >= 0
+				&& (c - b).cross(p - b).dot(n) >= 0
+				&& (a - c).cross(p - c).dot(n) >= 0;
+		}
+	}
+
+	Vector3 Triangle3::closest_point(const Vector3 & a, const Vector3 & b, const Vector3 & c, Vector3 p,
+		Feature * feature)
+	{
+		// find the voronoi region of p, after Ericson's Real-Time Collision Detection 5.1.5
+		Feature region;
+		if (!feature)
+			feature = &region;
+
+		Vector3 ab = b - a, ac = c - a, ap = p - a;
+		float d1 = ab.dot(ap), d2 = ac.dot(ap);
+		if (d1 <= 0 && d2 <= 0)
+		{
+			*feature = CORNER_A;
+			return a;
+		}
+
+		Vector3 bp = p - b;
+		float d3 = ab.dot(bp), d4 = ac.dot(bp);
+		if (d3 >= 0 && d4 <= d3)
+		{
+			*feature = CORNER_B;
+			return b;
+		}
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0 && d1 >= 0 && d3 <= 0)
+		{
+			*feature = EDGE_AB;
+			return a + ab * (d1 / (d1 - d3));
+		}
+
+		Vector3 cp = p - c;
+		float d5 = ab.dot(cp), d6 = ac.dot(cp);
+		if (d6 >= 0 && d5 <= d6)
+		{
+			*feature = CORNER_C;
+			return c;
+		}
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0 && d2 >= 0 && d6 <= 0)
+		{
+			*feature = EDGE_CA;
+			return a + ac * (d2 / (d2 - d6));
+		}
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+		{
+			*feature = EDGE_BC;
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		}
+
+		*feature = FACE;
+		float denom = 1.0f / (va + vb + vc);
+		return a + ab * (vb * denom) + ac * (vc * denom);
+	}
+
+	float Triangle3::sweep_sphere(const Vector3 & a, const Vector3 & b, const Vector3 & c,
+		Vector3 center, float radius, Vector3 dir)
+	{
+		float diverge = std::numeric_limits<float>::infinity();
+		Vector3 n = (b - a).cross(c - a);
+		if (n.norm_sq() < 1e-12f)
+			return diverge;
+		n.normalize();
+
+		// face: the sphere's leading point meets the plane inside the triangle
+		float dist = (center - a).dot(n);
+		float side = dist < 0 ? -1.0f : 1.0f;
+		if (dist * side <= radius)
+		{
+			if (contains(a, b, c, n, Vector3::madd(center, n, -dist)))
+				return 0;
+		}
+		else
+		{
+			float approach = -dir.dot(n) * side;
+			if (approach > 0)
+			{
+				float t = (dist * side - radius) / approach;
+				if (t <= 1 && contains(a, b, c, n, Vector3::madd2(center, dir, t, n, -(radius * side))))
+					return t;
+			}
+		}
+
+		// otherwise the first contact is on an edge or a corner
+		float t = diverge;
+		t = fminf(t, sweep_edge(center, dir, a, b, radius));
+		t = fminf(t, sweep_edge(center, dir, b, c, radius));
+		t = fminf(t, sweep_edge(center, dir, c, a, radius));
+		t = fminf(t, sweep_point(center, dir, a, radius));
+		t = fminf(t, sweep_point(center, dir, b, radius));
+		t = fminf(t, sweep_point(center, dir, c, radius));
+		return t;
+	}
+
+	namespace
+	{
+		// Triangle3x4 and Triangle3x8 differ only in width
+
+		template <typename Group>
+		void set_lane(Group & group, size_t i, const Vector3 & a, const Vector3 & b, const Vector3 & c, const Vector3 & normal)
+		{
+			// intersect_ray's barycentric solve, with the parts that only depend on the triangle folded
+			// into two vectors: si = w . u and ti = w . v
+			Vector3 ab = b - a, ac = c - a;
+			float uu = ab.dot(ab), uv = ab.dot(ac), vv = ac.dot(ac);
+			float D = uv * uv - uu * vv;
+			if (D == 0.0f)
+			{
+				// degenerate, where intersect_ray would divide by zero
+				group.clear(i);
+				return;
+			}
+			Vector3 u = (uv * ac - vv * ab) / D, v = (uv * ab - uu * ac) / D;
+
+			for (size_t axis = 0; axis < 3; ++axis)
+			{
+				group.a[axis][i] = a[axis];
+				group.n[axis][i] = normal[axis];
+				group.u[axis][i] = u[axis];
+				group.v[axis][i] = v[axis];
+			}
+		}
+
+		template <typename Group>
+		void clear_lane(Group & group, size_t i)
+		{
+			// a zero normal fails the facing test
+			for (size_t axis = 0; axis < 3; ++axis)
+				group.a[axis][i] = group.n[axis][i] = group.u[axis][i] = group.v[axis][i] = 0.0f;
+		}
+
+		// the same steps as intersect_ray, for lane i
+		template <typename Group>
+		float intersect_lane(const Group & group, size_t i, Vector3 o, Vector3 dir)
+		{
+			float diverge = std::numeric_limits<float>::infinity();
+			Vector3 n(group.n[0][i], group.n[1][i], group.n[2][i]);
+			float d = -n.dot(dir);
+			if (d < 1e-9f)
+				return diverge;
+			Vector3 ao = o - Vector3(group.a[0][i], group.a[1][i], group.a[2][i]);
+			float t = n.dot(ao);
+			if (t < 0 || t > d)
+				return diverge;
+			t /= d;
+
+			Vector3 w = Vector3::madd(ao, dir, t);
+			float si = w.dot(Vector3(group.u[0][i], group.u[1][i], group.u[2][i]));
+			float ti = w.dot(Vector3(group.v[0][i], group.v[1][i], group.v[2][i]));
+			if (si < 0 || si > 1 || ti < 0 || si + ti > 1 || t <= 0)
+				return diverge;
+			return t;
+		}
+
+#if defined(EAE6320_SSE)
+		// intersect_lane for lanes [offset, offset + 4), with infinity for the misses
+		template <typename Group>
+		__m128 intersect4(const Group & group, size_t offset, const __m128 (&o)[3], const __m128 (&dir)[3])
+		{
+			__m128 ao[3], d = _mm_setzero_ps(), t = _mm_setzero_ps();
+			for (size_t axis = 0; axis < 3; ++axis)
+			{
+				__m128 n = _mm_loadu_ps(group.n[axis] + offset);
+				ao[axis] = _mm_sub_ps(o[axis], _mm_loadu_ps(group.a[axis] + offset));
+				d = _mm_sub_ps(d, _mm_mul_ps(n, dir[axis]));
+				t = Simd::madd(n, ao[axis], t);
+			}
+			__m128 hit = _mm_and_ps(_mm_cmpge_ps(d, _mm_set1_ps(1e-9f)),
+				_mm_and_ps(_mm_cmpge_ps(t, _mm_setzero_ps()), _mm_cmple_ps(t, d)));
+			t = _mm_div_ps(t, d);
+
+			__m128 si = _mm_setzero_ps(), ti = _mm_setzero_ps();
+			for (size_t axis = 0; axis < 3; ++axis)
+			{
+				__m128 w = Simd::madd(dir[axis], t, ao[axis]);
+				si = Simd::madd(w, _mm_loadu_ps(group.u[axis] + offset), si);
+				ti = Simd::madd(w, _mm_loadu_ps(group.v[axis] + offset), ti);
+			}
+			__m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+			hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(si, zero), _mm_cmpge_ps(ti, zero)));
+			hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmple_ps(_mm_add_ps(si, ti), one), _mm_cmpgt_ps(t, zero)));
+			hit = _mm_and_ps(hit, _mm_cmple_ps(si, one));
+			return _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, _mm_set1_ps(std::numeric_limits<float>::infinity())));
+		}
+#endif
+
+#if defined(EAE6320_AVX)
+		__m256 intersect8(const Triangle3x8 & group, const __m256 (&o)[3], const __m256 (&dir)[3])
+		{
+			__m256 ao[3], d = _mm256_setzero_ps(), t = _mm256_setzero_ps();
+			for (size_t axis = 0; axis < 3; ++axis)
+			{
+				__m256 n = _mm256_loadu_ps(group.n[axis]);
+				ao[axis] = _mm256_sub_ps(o[axis], _mm256_loadu_ps(group.a[axis]));
+				d = _mm256_sub_ps(d, _mm256_mul_ps(n, dir[axis]));
+				t = Simd::madd(n, ao[axis], t);
+			}
+			__m256 hit = _mm256_and_ps(_mm256_cmp_ps(d, _mm256_set1_ps(1e-9f), _CMP_GE_OQ),
+				_mm256_and_ps(_mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(t, d, _CMP_LE_OQ)));
+			t = _mm256_div_ps(t, d);
+
+			__m256 si = _mm256_setzero_ps(), ti = _mm256_setzero_ps();
+			for (size_t axis = 0; axis < 3; ++axis)
+			{
+				__m256 w = Simd::madd(dir[axis], t, ao[axis]);
+				si = Simd::madd(w, _mm256_loadu_ps(group.u[axis]), si);
+				ti = Simd::madd(w, _mm256_loadu_ps(group.v[axis]), ti);
+			}
+			__m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+			hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(si, zero, _CMP_GE_OQ), _mm256_cmp_ps(ti, zero, _CMP_GE_OQ)));
+			hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(si, ti), one, _CMP_LE_OQ), _mm256_cmp_ps(t, zero, _CMP_GT_OQ)));
+			hit = _mm256_and_ps(hit, _mm256_cmp_ps(si, one, _CMP_LE_OQ));
+			return _mm256_blendv_ps(_mm256_set1_ps(std::numeric_limits<float>::infinity()), t, hit);
+		}
+#endif
+
+		// the smallest of ts[0, count), or infinity
+		float closest(const float * ts, size_t count, uint32_t & lane)
+		{
+			float t = std::numeric_limits<float>::infinity();
+			for (size_t i = 0; i < count; ++i)
+				if (ts[i] < t)
+				{
+					t = ts[i];
+					lane = static_cast<uint32_t>(i);
+				}
+			return t;
+		}
+	}
+
+	void Triangle3x4::set(size_t i, const Vector3 & a, const Vector3 & b, const Vector3 & c, const Vector3 & normal)
+	{
+		set_lane(*this, i, a, b, c, normal);
+	}
+
+	void Triangle3x4::clear(size_t i)
+	{
+		clear_lane(*this, i);
+	}
+
+	float Triangle3x4::intersect_ray(Vector3 o, Vector3 dir, uint32_t & lane) const
+	{
+		float ts[4];
+#if defined(EAE6320_SSE)
+		__m128 o4[3] = { _mm_set1_ps(o.x), _mm_set1_ps(o.y), _mm_set1_ps(o.z) };
+		__m128 dir4[3] = { _mm_set1_ps(dir.x), _mm_set1_ps(dir.y), _mm_set1_ps(dir.z) };
+		_mm_storeu_ps(ts, intersect4(*this, 0, o4, dir4));
+#else
+		for (size_t i = 0; i < 4; ++i)
+			ts[i] = intersect_lane(*this, i, o, dir);
+#endif
+		return closest(ts, 4, lane);
+	}
+
+	void Triangle3x8::set(size_t i, const Vector3 & a, const Vector3 & b, const Vector3 & c, const Vector3 & normal)
+	{
+		set_lane(*this, i, a, b, c, normal);
+	}
+
+	void Triangle3x8::clear(size_t i)
+	{
+		clear_lane(*this, i);
+	}
+
+	float Triangle3x8::intersect_ray(Vector3 o, Vector3 dir, uint32_t & lane) const
+	{
+		float ts[8];
+#if defined(EAE6320_AVX)
+		__m256 o8[3] = { _mm256_set1_ps(o.x), _mm256_set1_ps(o.y), _mm256_set1_ps(o.z) };
+		__m256 dir8[3] = { _mm256_set1_ps(dir.x), _mm256_set1_ps(dir.y), _mm256_set1_ps(dir.z) };
+		_mm256_storeu_ps(ts, intersect8(*this, o8, dir8));
+#elif defined(EAE6320_SSE)
+		__m128 o4[3] = { _mm_set1_ps(o.x), _mm_set1_ps(o.y), _mm_set1_ps(o.z) };
+		__m128 dir4[3] = { _mm_set1_ps(dir.x), _mm_set1_ps(dir.y), _mm_set1_ps(dir.z) };
+		_mm_storeu_ps(ts, intersect4(*this, 0, o4, dir4));
+		_mm_storeu_ps(ts + 4, intersect4(*this, 4, o4, dir4));
+#else
+		for (size_t i = 0; i < 8; ++i)
+			ts[i] = intersect_lane(*this, i, o, dir);
+#endif
+		return closest(ts, 8, lane);
+	}
+
+#ifdef _DEBUG
+	namespace
+	{
+		Vector3 random_point()
+		{
+			return Vector3(
+				2.0f * rand() / RAND_MAX - 1.0f,
+				2.0f * rand() / RAND_MAX - 1.0f,
+				2.0f * rand() / RAND_MAX - 1.0f);
+		}
+	}
+
+	void Triangle3::test()
+	{
+		// hits within rounding of an edge may go either way
+		int disagreements = 0, hits = 0;
+		for (int n = 0; n < 4000; ++n)
+		{
+			Vector3 o = random_point() * 2.0f, dir = random_point() * 4.0f;
+			Triangle3x4 group4;
+			Triangle3x8 group8;
+			float expected = std::numeric_limits<float>::infinity();
+			for (size_t i = 0; i < 8; ++i)
+			{
+				Vector3 a = random_point(), b = random_point(), c = random_point();
+				Vector3 normal = (b - a).cross(c - a).normalize();
+				group8.set(i, a, b, c, normal);
+				if (i < 4)
+					group4.set(i, a, b, c, normal);
+
+				float t = intersect_ray(a, b, c, normal, o, dir);
+				if (t > 0 && t < expected)
+					expected = t;
+				if (i == 3)
+				{
+					uint32_t lane = 4;
+					float t4 = group4.intersect_ray(o, dir, lane);
+					if ((t4 < 1e9f) != (expected < 1e9f))
+						++disagreements;
+					else if (expected < 1e9f)
+						assert(fabsf(t4 - expected) < 1e-4f && lane < 4);
+				}
+			}
+
+			uint32_t lane = 8;
+			float t8 = group8.intersect_ray(o, dir, lane);
+			if ((t8 < 1e9f) != (expected < 1e9f))
+				++disagreements;
+			else if (expected < 1e9f)
+			{
+				++hits;
+				assert(fabsf(t8 - expected) < 1e-4f && lane < 8);
+
+				// a cleared lane never hits
+				uint32_t hit_lane = lane;
+				group8.clear(hit_lane);
+				if (group8.intersect_ray(o, dir, lane) < 1e9f)
+					assert(lane != hit_lane);
+			}
+		}
+		assert(hits > 0 && disagreements <= 2);
+	}
+#endif
+}
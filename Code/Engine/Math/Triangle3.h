@@ -2,6 +2,8 @@
 #include "Vector3.h"
 #include "AABB3.h"
 
+#include <cstdint>
+
 namespace eae6320
 {
 	struct Triangle3
@@ -17,6 +19,18 @@ namespace eae6320
 		~Triangle3() {}
 
 		float intersect_ray(Vector3 p, Vector3 q) const;
+		// for callers that keep vertices elsewhere, e.g. indexed geometry
+		static float intersect_ray(const Vector3 & a, const Vector3 & b, const Vector3 & c,
+			const Vector3 & normal, Vector3 p, Vector3 q);
+		// first contact of a sphere moving from center to center + dir, as a fraction of dir,
+		// or infinity. 0 if it starts out touching
+		static float sweep_sphere(const Vector3 & a, const Vector3 & b, const Vector3 & c,
+			Vector3 center, float radius, Vector3 dir);
+		// what the nearest point lies on
+		enum Feature : uint8_t { CORNER_A, CORNER_B, CORNER_C, EDGE_AB, EDGE_BC, EDGE_CA, FACE };
+		// point on the triangle nearest to p
+		static Vector3 closest_point(const Vector3 & a, const Vector3 & b, const Vector3 & c, Vector3 p,
+			Feature * feature = NULL);
 
 		Triangle3 scale(const Vector3 & rhs) const
 		{
@@ -27,5 +41,38 @@ namespace eae6320
 			copy.box = copy.box.scale(rhs);
 			return copy;
 		}
+
+		// compares Triangle3x4 and Triangle3x8 against intersect_ray
+		static void test()
+#ifdef _DEBUG
+		;
+#else
+		{}
+#endif
+	};
+
+	// intersect_ray for a group of triangles, with everything that depends only on the
+	// triangle worked out ahead and stored per component, so one ray meets the whole group
+	// in a SIMD pass. each triangle keeps a vertex, its normal, and the two vectors whose
+	// dot products with (hit - a) are the barycentric coordinates.
+	// intersect_ray: closest hit along o + t*dir for t in (0, 1], or infinity; sets lane on a hit
+	struct Triangle3x4
+	{
+		float a[3][4], n[3][4], u[3][4], v[3][4];
+
+		// lane i takes the triangle, with Triangle3::intersect_ray's contract
+		void set(size_t i, const Vector3 & a, const Vector3 & b, const Vector3 & c, const Vector3 & normal);
+		// lane i never hits
+		void clear(size_t i);
+		float intersect_ray(Vector3 o, Vector3 dir, uint32_t & lane) const;
+	};
+
+	struct Triangle3x8
+	{
+		float a[3][8], n[3][8], u[3][8], v[3][8];
+
+		void set(size_t i, const Vector3 & a, const Vector3 & b, const Vector3 & c, const Vector3 & normal);
+		void clear(size_t i);
+		float intersect_ray(Vector3 o, Vector3 dir, uint32_t & lane) const;
 	};
 }
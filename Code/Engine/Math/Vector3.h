@@ -37,6 +37,13 @@ namespace eae6320
 		static Vector3 max3(Vector3 const & u, Vector3 const & v);
 		float max_dim() const;
 
+		// compound expressions in one call and no temporaries, which is what debug builds
+		// pay for. each gives the same bits as the operators written out in the same order
+		static Vector3 madd(Vector3 const & u, Vector3 const & v, float s);                          // u + v * s
+		static Vector3 madd2(Vector3 const & u, Vector3 const & v, float s, Vector3 const & w, float t); // u + v * s + w * t
+		static Vector3 midpoint(Vector3 const & u, Vector3 const & v);                               // (u + v) / 2
+		static Vector3 lerp(Vector3 const & u, Vector3 const & v, float t);                          // u + (v - u) * t
+
 		union { float x, r; };
 		union { float y, g; };
 		union { float z, b; };
@@ -29,7 +29,7 @@ inline float Vector3::dot(Vector3 const & rhs) const
 
 inline Vector3 Vector3::cross(Vector3 const & rhs) const
 {
-	return Vector3(y*rhs.z - z*rhs.y, x*rhs.z - z*rhs.x, x*rhs.y - y*rhs.x);
+	return Vector3(y*rhs.z - z*rhs.y, z*rhs.x - x*rhs.z, x*rhs.y - y*rhs.x);
 }
 
 inline Vector3 Vector3::scale(Vector3 const & rhs) const
@@ -111,6 +111,26 @@ inline float Vector3::max_dim() const
 	return fmaxf(fmaxf(x, y), z);
 }
 
+inline Vector3 Vector3::madd(Vector3 const & u, Vector3 const & v, float s)
+{
+	return Vector3(u.x + v.x * s, u.y + v.y * s, u.z + v.z * s);
+}
+
+inline Vector3 Vector3::madd2(Vector3 const & u, Vector3 const & v, float s, Vector3 const & w, float t)
+{
+	return Vector3(u.x + v.x * s + w.x * t, u.y + v.y * s + w.y * t, u.z + v.z * s + w.z * t);
+}
+
+inline Vector3 Vector3::midpoint(Vector3 const & u, Vector3 const & v)
+{
+	return Vector3((u.x + v.x) / 2, (u.y + v.y) / 2, (u.z + v.z) / 2);
+}
+
+inline Vector3 Vector3::lerp(Vector3 const & u, Vector3 const & v, float t)
+{
+	return Vector3(u.x + (v.x - u.x) * t, u.y + (v.y - u.y) * t, u.z + (v.z - u.z) * t);
+}
+
 /* writing all these makes me feel quite sycophantic */
 
 inline bool operator==(Vector3 const & lhs, Vector3 const & rhs)
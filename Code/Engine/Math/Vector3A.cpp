@@ -0,0 +1,10 @@
+#include "Vector3A.h"
+
+namespace eae6320
+{
+	const Vector3A Vector3A::Zero = Vector3A(0, 0, 0);
+	const Vector3A Vector3A::One = Vector3A(1, 1, 1);
+	const Vector3A Vector3A::I = Vector3A(1, 0, 0);
+	const Vector3A Vector3A::J = Vector3A(0, 1, 0);
+	const Vector3A Vector3A::K = Vector3A(0, 0, 1);
+}
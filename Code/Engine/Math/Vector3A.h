@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Simd.h"
+#include "Vector3.h"
+
+namespace eae6320
+{
+	// Vector3 padded out to one SIMD register, for math that stays in registers.
+	// w is always zero. Stored data (Mesh::Vertex, file formats) keeps Vector3;
+	// convert at the edges. Heap arrays of these need aligned allocation on Win32.
+	struct alignas(16) Vector3A
+	{
+		static const Vector3A Zero, One, I, J, K;
+
+		Vector3A();
+		Vector3A(float x, float y, float z);
+		Vector3A(Vector3A const & v);
+		explicit Vector3A(Vector3 const & v);
+		explicit operator Vector3() const;
+#if defined(EAE6320_SSE)
+		explicit Vector3A(__m128 v);
+#endif
+
+		Vector3A & operator=(Vector3A const & rhs);
+
+		Vector3A operator+() const;
+		Vector3A operator-() const;
+		float operator[](size_t i) const;
+
+		float dot(Vector3A const & rhs) const;
+		Vector3A cross(Vector3A const & rhs) const;
+		Vector3A scale(Vector3A const & rhs) const;
+
+		float norm() const;
+		float norm_sq() const;
+		Vector3A & normalize();
+		Vector3A unit() const;
+		Vector3A abs() const;
+
+		static Vector3A min3(Vector3A const & u, Vector3A const & v);
+		static Vector3A max3(Vector3A const & u, Vector3A const & v);
+		float max_dim() const;
+
+		union
+		{
+#if defined(EAE6320_SSE)
+			__m128 v;
+#endif
+			struct { float x, y, z, w; };
+		};
+	};
+
+	inline bool operator==(Vector3A const & lhs, Vector3A const & rhs);
+	inline bool operator!=(Vector3A const & lhs, Vector3A const & rhs);
+	inline Vector3A operator+(Vector3A const & lhs, Vector3A const & rhs);
+	inline Vector3A & operator+=(Vector3A & lhs, Vector3A const & rhs);
+	inline Vector3A operator-(Vector3A const & lhs, Vector3A const & rhs);
+	inline Vector3A & operator-=(Vector3A & lhs, Vector3A const & rhs);
+	inline Vector3A operator*(Vector3A const & lhs, float const rhs);
+	inline Vector3A operator*(float lhs, Vector3A const & rhs);
+	inline Vector3A & operator*=(Vector3A & lhs, float rhs);
+	inline Vector3A operator/(Vector3A const & lhs, float rhs);
+	inline Vector3A & operator/=(Vector3A & lhs, float rhs);
+
+#include "Vector3A.inl"
+}
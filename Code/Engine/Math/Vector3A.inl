@@ -0,0 +1,239 @@
+#if defined(EAE6320_SSE)
+
+inline Vector3A::Vector3A() : v(_mm_setzero_ps()) {}
+inline Vector3A::Vector3A(float x, float y, float z) : v(_mm_setr_ps(x, y, z, 0.0f)) {}
+inline Vector3A::Vector3A(Vector3A const & other) : v(other.v) {}
+inline Vector3A::Vector3A(Vector3 const & other) : v(Simd::load3(&other.x)) {}
+inline Vector3A::Vector3A(__m128 v) : v(v) {}
+
+inline Vector3A::operator Vector3() const
+{
+	Vector3 result;
+	Simd::store3(&result.x, v);
+	return result;
+}
+
+inline Vector3A & Vector3A::operator=(Vector3A const & rhs)
+{
+	v = rhs.v;
+	return *this;
+}
+
+inline Vector3A Vector3A::operator-() const
+{
+	return Vector3A(_mm_sub_ps(_mm_setzero_ps(), v));
+}
+
+inline float Vector3A::dot(Vector3A const & rhs) const
+{
+	return _mm_cvtss_f32(Simd::sum(_mm_mul_ps(v, rhs.v)));
+}
+
+inline Vector3A Vector3A::cross(Vector3A const & rhs) const
+{
+	return Vector3A(Simd::cross(v, rhs.v));
+}
+
+inline Vector3A Vector3A::scale(Vector3A const & rhs) const
+{
+	return Vector3A(_mm_mul_ps(v, rhs.v));
+}
+
+inline Vector3A Vector3A::abs() const
+{
+	return Vector3A(Simd::abs(v));
+}
+
+inline Vector3A Vector3A::min3(Vector3A const & u, Vector3A const & v)
+{
+	return Vector3A(_mm_min_ps(u.v, v.v));
+}
+
+inline Vector3A Vector3A::max3(Vector3A const & u, Vector3A const & v)
+{
+	return Vector3A(_mm_max_ps(u.v, v.v));
+}
+
+inline float Vector3A::max_dim() const
+{
+	__m128 m = _mm_max_ps(v, EAE6320_SWIZZLE(v, 1, 2, 0, 3));
+	return _mm_cvtss_f32(_mm_max_ps(m, EAE6320_SWIZZLE(v, 2, 0, 1, 3)));
+}
+
+inline bool operator==(Vector3A const & lhs, Vector3A const & rhs)
+{
+	return (_mm_movemask_ps(_mm_cmpeq_ps(lhs.v, rhs.v)) & 0x7) == 0x7;
+}
+
+inline Vector3A operator+(Vector3A const & lhs, Vector3A const & rhs)
+{
+	return Vector3A(_mm_add_ps(lhs.v, rhs.v));
+}
+
+inline Vector3A operator-(Vector3A const & lhs, Vector3A const & rhs)
+{
+	return Vector3A(_mm_sub_ps(lhs.v, rhs.v));
+}
+
+inline Vector3A operator*(Vector3A const & lhs, float const rhs)
+{
+	return Vector3A(_mm_mul_ps(lhs.v, _mm_set1_ps(rhs)));
+}
+
+inline Vector3A operator/(Vector3A const & lhs, float rhs)
+{
+	return Vector3A(_mm_div_ps(lhs.v, _mm_set1_ps(rhs)));
+}
+
+#else
+
+inline Vector3A::Vector3A() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+inline Vector3A::Vector3A(float x, float y, float z) : x(x), y(y), z(z), w(0.0f) {}
+inline Vector3A::Vector3A(Vector3A const & other) : x(other.x), y(other.y), z(other.z), w(0.0f) {}
+inline Vector3A::Vector3A(Vector3 const & other) : x(other.x), y(other.y), z(other.z), w(0.0f) {}
+
+inline Vector3A::operator Vector3() const
+{
+	return Vector3(x, y, z);
+}
+
+inline Vector3A & Vector3A::operator=(Vector3A const & rhs)
+{
+	x = rhs.x; y = rhs.y; z = rhs.z; w = 0.0f;
+	return *this;
+}
+
+inline Vector3A Vector3A::operator-() const
+{
+	return Vector3A(-x, -y, -z);
+}
+
+inline float Vector3A::dot(Vector3A const & rhs) const
+{
+	return x*rhs.x + y*rhs.y + z*rhs.z;
+}
+
+inline Vector3A Vector3A::cross(Vector3A const & rhs) const
+{
+	return Vector3A(y*rhs.z - z*rhs.y, z*rhs.x - x*rhs.z, x*rhs.y - y*rhs.x);
+}
+
+inline Vector3A Vector3A::scale(Vector3A const & rhs) const
+{
+	return Vector3A(x * rhs.x, y * rhs.y, z * rhs.z);
+}
+
+inline Vector3A Vector3A::abs() const
+{
+	return Vector3A(fabsf(x), fabsf(y), fabsf(z));
+}
+
+inline Vector3A Vector3A::min3(Vector3A const & u, Vector3A const & v)
+{
+	return Vector3A(fminf(u.x, v.x), fminf(u.y, v.y), fminf(u.z, v.z));
+}
+
+inline Vector3A Vector3A::max3(Vector3A const & u, Vector3A const & v)
+{
+	return Vector3A(fmaxf(u.x, v.x), fmaxf(u.y, v.y), fmaxf(u.z, v.z));
+}
+
+inline float Vector3A::max_dim() const
+{
+	return fmaxf(fmaxf(x, y), z);
+}
+
+inline bool operator==(Vector3A const & lhs, Vector3A const & rhs)
+{
+	return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+}
+
+inline Vector3A operator+(Vector3A const & lhs, Vector3A const & rhs)
+{
+	return Vector3A(lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z);
+}
+
+inline Vector3A operator-(Vector3A const & lhs, Vector3A const & rhs)
+{
+	return Vector3A(lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z);
+}
+
+inline Vector3A operator*(Vector3A const & lhs, float const rhs)
+{
+	return Vector3A(lhs.x * rhs, lhs.y * rhs, lhs.z * rhs);
+}
+
+inline Vector3A operator/(Vector3A const & lhs, float rhs)
+{
+	return Vector3A(lhs.x / rhs, lhs.y / rhs, lhs.z / rhs);
+}
+
+#endif
+
+// shared by both paths
+
+inline Vector3A Vector3A::operator+() const
+{
+	return *this;
+}
+
+inline float Vector3A::operator[](size_t i) const
+{
+	return i < 3 ? (&x)[i] : std::numeric_limits<float>::signaling_NaN();
+}
+
+inline float Vector3A::norm() const
+{
+	return sqrt(norm_sq());
+}
+
+inline float Vector3A::norm_sq() const
+{
+	return dot(*this);
+}
+
+inline Vector3A & Vector3A::normalize()
+{
+	float n = norm();
+	if (n == 0.0f)
+		return *this;
+	return *this /= n;
+}
+
+inline Vector3A Vector3A::unit() const
+{
+	float n = norm();
+	if (n == 0.0f)
+		return Vector3A::Zero;
+	return *this / n;
+}
+
+inline bool operator!=(Vector3A const & lhs, Vector3A const & rhs)
+{
+	return !(lhs == rhs);
+}
+
+inline Vector3A & operator+=(Vector3A & lhs, Vector3A const & rhs)
+{
+	return lhs = lhs + rhs;
+}
+
+inline Vector3A & operator-=(Vector3A & lhs, Vector3A const & rhs)
+{
+	return lhs = lhs - rhs;
+}
+
+inline Vector3A operator*(float lhs, Vector3A const & rhs)
+{
+	return rhs * lhs;
+}
+
+inline Vector3A & operator*=(Vector3A & lhs, float rhs)
+{
+	return lhs = lhs * rhs;
+}
+
+inline Vector3A & operator/=(Vector3A & lhs, float rhs)
+{
+	return lhs = lhs / rhs;
+}
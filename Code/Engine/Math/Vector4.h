@@ -27,6 +27,10 @@ namespace eae6320
 		Vector4 & normalize();
 		Vector4 unit() const;
 
+		// as Vector3's: one call, no temporaries, the same bits as the operators
+		static Vector4 madd(Vector4 const & u, Vector4 const & v, float s);  // u + v * s
+		static Vector4 lerp(Vector4 const & u, Vector4 const & v, float t);  // u + (v - u) * t
+
 		union { float x, r; };
 		union { float y, g; };
 		union { float z, b; };
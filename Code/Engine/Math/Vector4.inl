@@ -43,6 +43,16 @@ inline Vector4 Vector4::unit() const
 	return Vector4(x / n, y / n, z / n, w / n);
 }
 
+inline Vector4 Vector4::madd(Vector4 const & u, Vector4 const & v, float s)
+{
+	return Vector4(u.x + v.x * s, u.y + v.y * s, u.z + v.z * s, u.w + v.w * s);
+}
+
+inline Vector4 Vector4::lerp(Vector4 const & u, Vector4 const & v, float t)
+{
+	return Vector4(u.x + (v.x - u.x) * t, u.y + (v.y - u.y) * t, u.z + (v.z - u.z) * t, u.w + (v.w - u.w) * t);
+}
+
 
 /* writing all these makes me feel quite sycophantic */
 
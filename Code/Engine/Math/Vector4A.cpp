@@ -0,0 +1,11 @@
+#include "Vector4A.h"
+
+namespace eae6320
+{
+	const Vector4A Vector4A::Zero = Vector4A(0, 0, 0, 0);
+	const Vector4A Vector4A::One = Vector4A(1, 1, 1, 1);
+	const Vector4A Vector4A::I = Vector4A(1, 0, 0, 0);
+	const Vector4A Vector4A::J = Vector4A(0, 1, 0, 0);
+	const Vector4A Vector4A::K = Vector4A(0, 0, 1, 0);
+	const Vector4A Vector4A::L = Vector4A(0, 0, 0, 1);
+}
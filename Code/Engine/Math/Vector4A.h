@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Simd.h"
+#include "Vector3A.h"
+#include "Vector4.h"
+
+namespace eae6320
+{
+	// Vector4 kept in one SIMD register; see Vector3A
+	struct alignas(16) Vector4A
+	{
+		static const Vector4A Zero, One, I, J, K, L;
+
+		Vector4A();
+		Vector4A(float x, float y, float z, float w);
+		Vector4A(Vector4A const & v);
+		Vector4A(Vector3A const & v, float w);
+		explicit Vector4A(Vector4 const & v);
+		explicit operator Vector4() const;
+#if defined(EAE6320_SSE)
+		explicit Vector4A(__m128 v);
+#endif
+
+		Vector4A & operator=(Vector4A const & rhs);
+
+		Vector3A xyz() const;
+
+		Vector4A operator+() const;
+		Vector4A operator-() const;
+
+		float dot(Vector4A const & rhs) const;
+
+		float norm() const;
+		Vector4A & normalize();
+		Vector4A unit() const;
+
+		union
+		{
+#if defined(EAE6320_SSE)
+			__m128 v;
+#endif
+			struct { float x, y, z, w; };
+		};
+	};
+
+	inline bool operator==(Vector4A const & lhs, Vector4A const & rhs);
+	inline bool operator!=(Vector4A const & lhs, Vector4A const & rhs);
+	inline Vector4A operator+(Vector4A const & lhs, Vector4A const & rhs);
+	inline Vector4A & operator+=(Vector4A & lhs, Vector4A const & rhs);
+	inline Vector4A operator-(Vector4A const & lhs, Vector4A const & rhs);
+	inline Vector4A & operator-=(Vector4A & lhs, Vector4A const & rhs);
+	inline Vector4A operator*(Vector4A const & lhs, float const rhs);
+	inline Vector4A operator*(float lhs, Vector4A const & rhs);
+	inline Vector4A & operator*=(Vector4A & lhs, float rhs);
+	inline Vector4A operator/(Vector4A const & lhs, float rhs);
+	inline Vector4A & operator/=(Vector4A & lhs, float rhs);
+
+#include "Vector4A.inl"
+}
@@ -0,0 +1,180 @@
+#if defined(EAE6320_SSE)
+
+inline Vector4A::Vector4A() : v(_mm_setzero_ps()) {}
+inline Vector4A::Vector4A(float x, float y, float z, float w) : v(_mm_setr_ps(x, y, z, w)) {}
+inline Vector4A::Vector4A(Vector4A const & other) : v(other.v) {}
+inline Vector4A::Vector4A(Vector3A const & other, float w)
+	: v(_mm_add_ps(other.v, _mm_setr_ps(0.0f, 0.0f, 0.0f, w))) {}
+inline Vector4A::Vector4A(Vector4 const & other) : v(_mm_loadu_ps(&other.x)) {}
+inline Vector4A::Vector4A(__m128 v) : v(v) {}
+
+inline Vector4A::operator Vector4() const
+{
+	Vector4 result;
+	_mm_storeu_ps(&result.x, v);
+	return result;
+}
+
+inline Vector4A & Vector4A::operator=(Vector4A const & rhs)
+{
+	v = rhs.v;
+	return *this;
+}
+
+inline Vector3A Vector4A::xyz() const
+{
+	// clear w, which Vector3A keeps zero
+	return Vector3A(_mm_castsi128_ps(_mm_srli_si128(_mm_slli_si128(_mm_castps_si128(v), 4), 4)));
+}
+
+inline Vector4A Vector4A::operator-() const
+{
+	return Vector4A(_mm_sub_ps(_mm_setzero_ps(), v));
+}
+
+inline float Vector4A::dot(Vector4A const & rhs) const
+{
+	return _mm_cvtss_f32(Simd::sum(_mm_mul_ps(v, rhs.v)));
+}
+
+inline bool operator==(Vector4A const & lhs, Vector4A const & rhs)
+{
+	return _mm_movemask_ps(_mm_cmpeq_ps(lhs.v, rhs.v)) == 0xF;
+}
+
+inline Vector4A operator+(Vector4A const & lhs, Vector4A const & rhs)
+{
+	return Vector4A(_mm_add_ps(lhs.v, rhs.v));
+}
+
+inline Vector4A operator-(Vector4A const & lhs, Vector4A const & rhs)
+{
+	return Vector4A(_mm_sub_ps(lhs.v, rhs.v));
+}
+
+inline Vector4A operator*(Vector4A const & lhs, float const rhs)
+{
+	return Vector4A(_mm_mul_ps(lhs.v, _mm_set1_ps(rhs)));
+}
+
+inline Vector4A operator/(Vector4A const & lhs, float rhs)
+{
+	return Vector4A(_mm_div_ps(lhs.v, _mm_set1_ps(rhs)));
+}
+
+#else
+
+inline Vector4A::Vector4A() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+inline Vector4A::Vector4A(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+inline Vector4A::Vector4A(Vector4A const & other) : x(other.x), y(other.y), z(other.z), w(other.w) {}
+inline Vector4A::Vector4A(Vector3A const & other, float w) : x(other.x), y(other.y), z(other.z), w(w) {}
+inline Vector4A::Vector4A(Vector4 const & other) : x(other.x), y(other.y), z(other.z), w(other.w) {}
+
+inline Vector4A::operator Vector4() const
+{
+	return Vector4(x, y, z, w);
+}
+
+inline Vector4A & Vector4A::operator=(Vector4A const & rhs)
+{
+	x = rhs.x; y = rhs.y; z = rhs.z; w = rhs.w;
+	return *this;
+}
+
+inline Vector3A Vector4A::xyz() const
+{
+	return Vector3A(x, y, z);
+}
+
+inline Vector4A Vector4A::operator-() const
+{
+	return Vector4A(-x, -y, -z, -w);
+}
+
+inline float Vector4A::dot(Vector4A const & rhs) const
+{
+	return x*rhs.x + y*rhs.y + z*rhs.z + w*rhs.w;
+}
+
+inline bool operator==(Vector4A const & lhs, Vector4A const & rhs)
+{
+	return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z && lhs.w == rhs.w;
+}
+
+inline Vector4A operator+(Vector4A const & lhs, Vector4A const & rhs)
+{
+	return Vector4A(lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z, lhs.w + rhs.w);
+}
+
+inline Vector4A operator-(Vector4A const & lhs, Vector4A const & rhs)
+{
+	return Vector4A(lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z, lhs.w - rhs.w);
+}
+
+inline Vector4A operator*(Vector4A const & lhs, float const rhs)
+{
+	return Vector4A(lhs.x * rhs, lhs.y * rhs, lhs.z * rhs, lhs.w * rhs);
+}
+
+inline Vector4A operator/(Vector4A const & lhs, float rhs)
+{
+	return Vector4A(lhs.x / rhs, lhs.y / rhs, lhs.z / rhs, lhs.w / rhs);
+}
+
+#endif
+
+// shared by both paths
+
+inline Vector4A Vector4A::operator+() const
+{
+	return *this;
+}
+
+inline float Vector4A::norm() const
+{
+	return sqrt(dot(*this));
+}
+
+inline Vector4A & Vector4A::normalize()
+{
+	float n = norm();
+	if (n == 0.0f)
+		return *this;
+	return *this /= n;
+}
+
+inline Vector4A Vector4A::unit() const
+{
+	float n = norm();
+	return *this / n;
+}
+
+inline bool operator!=(Vector4A const & lhs, Vector4A const & rhs)
+{
+	return !(lhs == rhs);
+}
+
+inline Vector4A & operator+=(Vector4A & lhs, Vector4A const & rhs)
+{
+	return lhs = lhs + rhs;
+}
+
+inline Vector4A & operator-=(Vector4A & lhs, Vector4A const & rhs)
+{
+	return lhs = lhs - rhs;
+}
+
+inline Vector4A operator*(float lhs, Vector4A const & rhs)
+{
+	return rhs * lhs;
+}
+
+inline Vector4A & operator*=(Vector4A & lhs, float rhs)
+{
+	return lhs = lhs * rhs;
+}
+
+inline Vector4A & operator/=(Vector4A & lhs, float rhs)
+{
+	return lhs = lhs / rhs;
+}
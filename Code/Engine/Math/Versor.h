@@ -16,6 +16,10 @@ namespace eae6320
 		Versor rotate_by(Versor rotation) const;
 		Vector3 rotate(Vector3 direction) const;
 
+		// shortest-path blends from a (t = 0) to b (t = 1)
+		static Versor nlerp(Versor const & a, Versor const & b, float t);
+		static Versor slerp(Versor const & a, Versor const & b, float t);
+
 		static Versor rotation_x(float radians);
 		static Versor rotation_y(float radians);
 		static Versor rotation_z(float radians);
@@ -24,7 +24,32 @@ inline Versor Versor::rotate_by(Versor rotation) const
 
 inline Vector3 Versor::rotate(Vector3 direction) const
 {
-	return Versor(Vector4(direction, 0.0f)).rotate_by(*this).xyz();
+	// q v q^-1 expanded for a unit q: v + w t + u x t, with u = xyz and t = 2 u x v
+	Vector3 u(x, y, z);
+	Vector3 t = 2.0f * u.cross(direction);
+	return direction + w * t + u.cross(t);
+}
+
+inline Versor Versor::nlerp(Versor const & a, Versor const & b, float t)
+{
+	// q and -q are the same rotation; head for whichever is nearer
+	Vector4 to = a.dot(b) < 0.0f ? -b : Vector4(b);
+	Vector4 q = a + (to - a) * t;
+	return q.normalize();
+}
+
+inline Versor Versor::slerp(Versor const & a, Versor const & b, float t)
+{
+	float d = a.dot(b);
+	Vector4 to = d < 0.0f ? -b : Vector4(b);
+	d = fabsf(d);
+
+	// nearly the same rotation: sin(theta) vanishes, and nlerp is as good
+	if (d > 0.9995f)
+		return nlerp(a, to, t);
+
+	float theta = acos(d), s = sin(theta);
+	return a * (sin((1.0f - t) * theta) / s) + to * (sin(t * theta) / s);
 }
 
 inline Versor Versor::rotation_x(float radians)
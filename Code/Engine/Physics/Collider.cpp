@@ -18,7 +18,7 @@ bool Collider::move(Vector3 s, const Terrain & terrain)
 	Vector3 n;
 	bool grounded = false;
 
-	Vector3 o = position - height * Vector3::J;
+	Vector3 o = Vector3::madd(position, Vector3::J, -height);
 	/**
 	if (s != Vector3::Zero)
 	{
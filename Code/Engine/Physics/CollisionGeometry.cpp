@@ -0,0 +1,20 @@
+#include "stdafx.h"
+#include "CollisionGeometry.h"
+
+#include <utility>
+
+namespace eae6320
+{
+namespace Physics
+{
+
+CollisionGeometry::CollisionGeometry(CollisionMesh && mesh)
+	: bounds(mesh.bounds)
+	, positions(std::move(mesh.positions))
+	, indices(std::move(mesh.indices))
+	, normals(std::move(mesh.normals))
+{
+}
+
+}
+}
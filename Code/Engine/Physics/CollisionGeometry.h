@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CollisionMesh.h"
+#include "../Math/Triangle3.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace eae6320
+{
+namespace Physics
+{
+	// indexed triangle store for collision queries.
+	// triangles reference a shared, deduplicated position array,
+	// and boxes are derived on demand rather than cached per triangle,
+	// so each triangle costs 24 bytes plus its share of positions.
+	struct CollisionGeometry
+	{
+		AABB3 bounds;
+		std::vector<Vector3> positions;
+		// 3 per triangle, into positions
+		std::vector<uint32_t> indices;
+		// 1 per triangle
+		std::vector<Vector3> normals;
+
+		explicit CollisionGeometry(CollisionMesh && mesh);
+
+		uint32_t num_triangles() const { return static_cast<uint32_t>(normals.size()); }
+
+		const Vector3 & vertex(uint32_t id, uint8_t corner) const
+		{
+			return positions[indices[id * 3 + corner]];
+		}
+
+		AABB3 box(uint32_t id) const
+		{
+			const Vector3 & a = vertex(id, 0), & b = vertex(id, 1), & c = vertex(id, 2);
+			return AABB3(Vector3::min3(Vector3::min3(a, b), c), Vector3::max3(Vector3::max3(a, b), c));
+		}
+
+		// expanded copy, for debug drawing
+		Triangle3 triangle(uint32_t id) const
+		{
+			return Triangle3(vertex(id, 0), vertex(id, 1), vertex(id, 2), normals[id]);
+		}
+
+		// same contract as Triangle3::intersect_ray
+		float intersect_ray(uint32_t id, Vector3 o, Vector3 dir) const
+		{
+			return Triangle3::intersect_ray(vertex(id, 0), vertex(id, 1), vertex(id, 2), normals[id], o, dir);
+		}
+	};
+}
+}
@@ -0,0 +1,85 @@
+#include "stdafx.h"
+#include "CollisionMesh.h"
+
+#include "../Debug_Runtime/UserOutput.h"
+#include "../Math/Batch.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace eae6320
+{
+namespace Physics
+{
+
+CollisionMesh * CollisionMesh::FromBinFile(const char * path, Vector3 scale)
+{
+	std::ifstream infile(path, std::ifstream::binary);
+
+	if (infile.fail())
+	{
+		std::stringstream errstr;
+		errstr << "Could not open path " << path;
+		UserOutput::Print(errstr.str(), __FILE__);
+		return NULL;
+	}
+
+	Header header;
+	infile.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+	std::vector<Position> packed_positions(header.num_positions);
+	std::vector<Normal> packed_normals(header.num_triangles);
+
+	CollisionMesh * mesh = new CollisionMesh();
+	mesh->indices.resize(3 * header.num_triangles);
+
+	infile.read(reinterpret_cast<char *>(packed_positions.data()),
+		header.num_positions * sizeof(Position));
+	infile.read(reinterpret_cast<char *>(mesh->indices.data()),
+		3 * header.num_triangles * sizeof(uint32_t));
+	infile.read(reinterpret_cast<char *>(packed_normals.data()),
+		header.num_triangles * sizeof(Normal));
+
+	infile.close();
+
+	if (infile.fail())
+	{
+		std::stringstream errstr;
+		errstr << "Read error from path " << path;
+		UserOutput::Print(errstr.str(), __FILE__);
+		delete mesh;
+		return NULL;
+	}
+
+	// the triangles are only ever walked through these, so one check here covers every query
+	for (uint32_t index : mesh->indices)
+	{
+		if (index >= header.num_positions)
+		{
+			std::stringstream errstr;
+			errstr << "Triangle index " << index << " is past the " << header.num_positions << " positions in " << path;
+			UserOutput::Print(errstr.str(), __FILE__);
+			delete mesh;
+			return NULL;
+		}
+	}
+
+	mesh->bounds = header.bounds.scale(scale);
+
+	// dequantize and scale together as one affine map over the whole array
+	mesh->positions.reserve(header.num_positions);
+	for (const Position & q : packed_positions)
+		mesh->positions.push_back(Vector3(q.x, q.y, q.z));
+	Vector3 step = (header.bounds.vmax - header.bounds.vmin) / static_cast<float>(UINT16_MAX);
+	Matrix4 unpack = Matrix4::scale(step.scale(scale));
+	unpack.vec3(3) = mesh->bounds.vmin;
+	Batch::transform_points(unpack, mesh->positions.data(), mesh->positions.data(), mesh->positions.size());
+
+	mesh->normals.resize(header.num_triangles);
+	Pack::from_octahedral(packed_normals.data(), mesh->normals.data(), mesh->normals.size());
+
+	return mesh;
+}
+
+}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "../Math/AABB3.h"
+#include "../Math/Pack.h"
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+namespace eae6320
+{
+namespace Physics
+{
+	// position-only collision geometry (see MeshBuilder's "collision" mode).
+	// positions are welded and quantized to 16 bits per axis within bounds,
+	// and each triangle carries its own octahedral-encoded normal.
+	struct CollisionMesh
+	{
+		struct Position
+		{
+			uint16_t x, y, z;
+		};
+
+		// octahedral projection, each axis snorm16
+		typedef Pack::Octahedral Normal;
+
+		// THIS IS THE FORMAT DEFINITION
+		// 24 bytes bounds (AABB)
+		// 4 bytes num_positions (P)
+		// 4 bytes num_triangles (T)
+		// 3*2*P bytes quantized positions
+		// 3*4*T bytes indices
+		// 2*2*T bytes triangle normals
+		struct Header
+		{
+			AABB3 bounds;
+			uint32_t num_positions;
+			uint32_t num_triangles;
+		};
+
+		// decoded and scaled on load
+		AABB3 bounds;
+		std::vector<Vector3> positions;
+		std::vector<uint32_t> indices;
+		std::vector<Vector3> normals;
+
+		uint32_t num_triangles() const { return static_cast<uint32_t>(normals.size()); }
+
+		static CollisionMesh * FromBinFile(const char * path, Vector3 scale);
+
+		// shared with the builder, which does not link Physics
+
+		static Position quantize(Vector3 p, const AABB3 & bounds)
+		{
+			Vector3 extent = bounds.vmax - bounds.vmin;
+			Position q;
+			q.x = quantize_axis(p.x - bounds.vmin.x, extent.x);
+			q.y = quantize_axis(p.y - bounds.vmin.y, extent.y);
+			q.z = quantize_axis(p.z - bounds.vmin.z, extent.z);
+			return q;
+		}
+
+		static Vector3 dequantize(Position q, const AABB3 & bounds)
+		{
+			Vector3 step = (bounds.vmax - bounds.vmin) / static_cast<float>(UINT16_MAX);
+			return bounds.vmin + Vector3(q.x, q.y, q.z).scale(step);
+		}
+
+		static Normal encode_normal(Vector3 n)
+		{
+			return Pack::to_octahedral(n);
+		}
+
+		static Vector3 decode_normal(Normal e)
+		{
+			return Pack::from_octahedral(e);
+		}
+
+	private:
+		static uint16_t quantize_axis(float offset, float extent)
+		{
+			if (extent <= 0)
+				return 0;
+			float q = roundf(offset / extent * UINT16_MAX);
+			return static_cast<uint16_t>(q < 0 ? 0 : q > UINT16_MAX ? UINT16_MAX : q);
+		}
+	};
+}
+}
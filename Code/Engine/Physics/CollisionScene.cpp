@@ -0,0 +1,357 @@
+#include "stdafx.h"
+#include "CollisionScene.h"
+
+#include "../Math/Affine3.h"
+#include "../Math/Ray3.h"
+
+#include <limits>
+#include <algorithm>
+
+#ifdef _DEBUG
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#endif
+
+namespace eae6320
+{
+namespace Physics
+{
+
+namespace
+{
+	AABB3 merge(const AABB3 & a, const AABB3 & b)
+	{
+		return AABB3(Vector3::min3(a.vmin, b.vmin), Vector3::max3(a.vmax, b.vmax));
+	}
+
+	// matches Graphics::DrawModel
+	Affine3 local2world(const CollisionScene::Instance & instance)
+	{
+		return Affine3::create_RST(instance.rotation, instance.scale, instance.position);
+	}
+}
+
+uint32_t CollisionScene::add(const CollisionShape & shape, Vector3 position, Versor rotation, Vector3 scale)
+{
+	Instance instance;
+	instance.shape = &shape;
+	instance.position = position;
+	instance.rotation = rotation;
+	instance.scale = scale;
+	refresh_box(instance);
+
+	instances.push_back(instance);
+	rebuild_needed = true;
+
+	return static_cast<uint32_t>(instances.size() - 1);
+}
+
+void CollisionScene::move(uint32_t id, Vector3 position, Versor rotation)
+{
+	Instance & instance = instances[id];
+	instance.position = position;
+	instance.rotation = rotation;
+	refresh_box(instance);
+	refit_needed = true;
+}
+
+void CollisionScene::move(uint32_t id, const Graphics::Model & model)
+{
+	instances[id].scale = model.scale;
+	move(id, model.position, model.rotation);
+}
+
+void CollisionScene::refresh_box(Instance & instance) const
+{
+	Affine3 transform = local2world(instance);
+	const AABB3 & local = instance.shape->geometry.bounds;
+
+	float infty = std::numeric_limits<float>::infinity();
+	instance.box = AABB3(Vector3(infty, infty, infty), -Vector3(infty, infty, infty));
+	for (uint8_t i = 0; i < 8; ++i)
+	{
+		Vector3 corner(
+			i & 1 ? local.vmax.x : local.vmin.x,
+			i & 2 ? local.vmax.y : local.vmin.y,
+			i & 4 ? local.vmax.z : local.vmin.z);
+		Vector3 world = transform.transform_point(corner);
+		instance.box = merge(instance.box, AABB3(world, world));
+	}
+}
+
+void CollisionScene::update()
+{
+	if (rebuild_needed)
+	{
+		order.resize(instances.size());
+		for (uint32_t i = 0; i < order.size(); ++i)
+			order[i] = i;
+
+		nodes.clear();
+		if (!instances.empty())
+		{
+			nodes.push_back(Node());
+			build_node(0, 0, static_cast<uint32_t>(order.size()));
+		}
+	}
+	else if (refit_needed)
+	{
+		refit();
+	}
+
+	rebuild_needed = refit_needed = false;
+}
+
+void CollisionScene::build_node(uint32_t node, uint32_t begin, uint32_t end)
+{
+	AABB3 box = instances[order[begin]].box;
+	AABB3 centers(box.vmin + box.vmax, box.vmin + box.vmax);
+	for (uint32_t i = begin + 1; i < end; ++i)
+	{
+		const AABB3 & child = instances[order[i]].box;
+		box = merge(box, child);
+		Vector3 center = child.vmin + child.vmax;
+		centers = merge(centers, AABB3(center, center));
+	}
+
+	if (end - begin <= LEAF_SIZE)
+	{
+		nodes[node].box = box;
+		nodes[node].first = begin;
+		nodes[node].count = end - begin;
+		return;
+	}
+
+	// median split along the widest spread of centers
+	Vector3 spread = centers.vmax - centers.vmin;
+	size_t axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : spread.y >= spread.z ? 1 : 2;
+	uint32_t mid = (begin + end) / 2;
+	std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+		[this, axis](uint32_t a, uint32_t b)
+		{
+			const AABB3 & box_a = instances[a].box, & box_b = instances[b].box;
+			return (box_a.vmin + box_a.vmax)[axis] < (box_b.vmin + box_b.vmax)[axis];
+		});
+
+	uint32_t children = static_cast<uint32_t>(nodes.size());
+	nodes.resize(children + 2);
+	nodes[node].box = box;
+	nodes[node].first = children;
+	nodes[node].count = 0;
+
+	build_node(children, begin, mid);
+	build_node(children + 1, mid, end);
+}
+
+void CollisionScene::refit()
+{
+	// children always follow their parent, so one backward pass suffices
+	for (size_t i = nodes.size(); i > 0; --i)
+	{
+		Node & node = nodes[i - 1];
+		if (node.count > 0)
+		{
+			node.box = instances[order[node.first]].box;
+			for (uint32_t j = 1; j < node.count; ++j)
+				node.box = merge(node.box, instances[order[node.first + j]].box);
+		}
+		else
+		{
+			node.box = merge(nodes[node.first].box, nodes[node.first + 1].box);
+		}
+	}
+}
+
+float CollisionScene::intersect_ray(Vector3 o, Vector3 dir, Vector3 * n, uint32_t * hit_instance) const
+{
+	float t = std::numeric_limits<float>::infinity();
+	if (nodes.empty())
+		return t;
+
+	Ray3 ray(o, dir);
+	std::vector<uint32_t> stack(1, 0);
+
+	while (!stack.empty())
+	{
+		const Node & node = nodes[stack.back()];
+		stack.pop_back();
+
+		// boxes entered only beyond the closest hit so far can be skipped
+		if (!ray.intersects(AABB3A(node.box), std::min(t, 1.0f)))
+			continue;
+
+		if (node.count == 0)
+		{
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i)
+		{
+			const Instance & instance = instances[order[i]];
+			if (!ray.intersects(AABB3A(instance.box), std::min(t, 1.0f)))
+				continue;
+
+			// an affine map keeps the segment parameter, so t needs no conversion
+			Affine3 world2local = local2world(instance).inverse();
+			Vector3 local_o = world2local.transform_point(o);
+			Vector3 local_dir = world2local.transform_vector(dir);
+
+			Vector3 local_n;
+			float t_i = instance.shape->intersect_ray(local_o, local_dir, &local_n);
+			if (t_i < t)
+			{
+				t = t_i;
+				// normals take the inverse transpose: (n R) S^-1
+				Vector3 inv_scale(1.0f / instance.scale.x, 1.0f / instance.scale.y, 1.0f / instance.scale.z);
+				if (n) *n = instance.rotation.rotate(local_n).scale(inv_scale).normalize();
+				if (hit_instance) *hit_instance = order[i];
+			}
+		}
+	}
+
+	return t;
+}
+
+#ifdef _DEBUG
+void CollisionScene::draw(Graphics::Wireframe & wireframe) const
+{
+	for (const Node & node : nodes)
+		wireframe.addAABB(node.box, node.count > 0 ? Graphics::Color(0.2f, 1.0f, 0.4f, 1.0f) : Graphics::Color(0.2f, 0.4f, 1.0f, 1.0f));
+}
+
+namespace
+{
+	float random_unit()
+	{
+		return 2.0f * rand() / RAND_MAX - 1.0f;
+	}
+
+	Vector3 random_point()
+	{
+		return Vector3(random_unit(), random_unit(), random_unit());
+	}
+
+	Versor random_rotation()
+	{
+		return Versor::rotation_x(3.0f * random_unit()) * Versor::rotation_y(3.0f * random_unit()) * Versor::rotation_z(3.0f * random_unit());
+	}
+
+	// every triangle of every instance, moved to world space and tested one by one
+	float brute_force_ray(const CollisionScene & scene, Vector3 o, Vector3 dir, Vector3 & n, uint32_t & hit_instance)
+	{
+		float t = std::numeric_limits<float>::infinity();
+		for (uint32_t i = 0; i < scene.instances.size(); ++i)
+		{
+			const CollisionGeometry & geometry = scene.instances[i].shape->geometry;
+			Affine3 transform = local2world(scene.instances[i]);
+			for (uint32_t id = 0; id < geometry.num_triangles(); ++id)
+			{
+				Vector3 a = transform.transform_point(geometry.vertex(id, 0));
+				Vector3 b = transform.transform_point(geometry.vertex(id, 1));
+				Vector3 c = transform.transform_point(geometry.vertex(id, 2));
+				// the test shape winds its normals this way, and positive scales keep the winding
+				Vector3 normal = (b - a).cross(c - a).normalize();
+				float t_i = Triangle3::intersect_ray(a, b, c, normal, o, dir);
+				if (t_i < t)
+				{
+					t = t_i;
+					n = normal;
+					hit_instance = i;
+				}
+			}
+		}
+		return t;
+	}
+
+	// hits within rounding of an edge may go either way; returns how many did
+	int compare_rays(const CollisionScene & scene, int & hits)
+	{
+		int disagreements = 0;
+		for (int r = 0; r < 2000; ++r)
+		{
+			Vector3 o = random_point() * 12.0f, dir = random_point() * 24.0f;
+
+			Vector3 n, expected_n;
+			uint32_t instance = UINT32_MAX, expected_instance = UINT32_MAX;
+			float t = scene.intersect_ray(o, dir, &n, &instance);
+			float expected = brute_force_ray(scene, o, dir, expected_n, expected_instance);
+
+			if ((t < 1e9f) != (expected < 1e9f))
+			{
+				++disagreements;
+			}
+			else if (expected < 1e9f)
+			{
+				++hits;
+				if (fabsf(t - expected) > 1e-4f || instance != expected_instance)
+				{
+					++disagreements;
+					continue;
+				}
+				assert(n.dot(expected_n) > 0.999f);
+			}
+		}
+		return disagreements;
+	}
+}
+
+void CollisionScene::test()
+{
+	// a shape of random triangles in the unit cube, wound to face their normals
+	CollisionMesh mesh;
+	mesh.bounds = AABB3(-Vector3::One, Vector3::One);
+	for (uint32_t id = 0; id < 48; ++id)
+	{
+		Vector3 a = random_point(), b = random_point(), c = random_point();
+		for (Vector3 p : { a, b, c })
+		{
+			mesh.indices.push_back(static_cast<uint32_t>(mesh.positions.size()));
+			mesh.positions.push_back(p);
+		}
+		mesh.normals.push_back((b - a).cross(c - a).normalize());
+	}
+	CollisionShape shape(std::move(mesh));
+
+	CollisionScene scene;
+	for (int i = 0; i < 24; ++i)
+	{
+		Vector3 scale(1.5f + random_unit(), 1.5f + random_unit(), 1.5f + random_unit());
+		scene.add(shape, random_point() * 8.0f, random_rotation(), scale);
+	}
+	scene.update();
+
+	int hits = 0;
+	int disagreements = compare_rays(scene, hits);
+
+	// moves only refit the tree it was built with
+	size_t built_nodes = scene.nodes.size();
+	std::vector<uint32_t> built_order = scene.order;
+	for (uint32_t i = 0; i < scene.instances.size(); i += 2)
+		scene.move(i, random_point() * 8.0f, random_rotation());
+	scene.update();
+	assert(scene.nodes.size() == built_nodes && scene.order == built_order);
+
+	// every leaf box still holds its instances, and every branch box its children
+	auto contains = [](const AABB3 & outer, const AABB3 & inner)
+	{
+		return outer.vmin.x <= inner.vmin.x && outer.vmin.y <= inner.vmin.y && outer.vmin.z <= inner.vmin.z
+			&& outer.vmax.x >= inner.vmax.x && outer.vmax.y >= inner.vmax.y && outer.vmax.z >= inner.vmax.z;
+	};
+	for (const Node & node : scene.nodes)
+	{
+		if (node.count == 0)
+			assert(contains(node.box, scene.nodes[node.first].box) && contains(node.box, scene.nodes[node.first + 1].box));
+		for (uint32_t i = node.first; node.count > 0 && i < node.first + node.count; ++i)
+			assert(contains(node.box, scene.instances[scene.order[i]].box));
+	}
+
+	disagreements += compare_rays(scene, hits);
+	assert(hits > 100 && disagreements <= 4);
+}
+#endif
+
+}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "CollisionShape.h"
+#include "../Graphics/Model.h"
+#include "../Graphics/Wireframe.h"
+#include "../Math/Versor.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace eae6320
+{
+namespace Physics
+{
+	// top level over placed CollisionShapes (TLAS over BLAS).
+	// a binary tree of instance boxes is built when instances are added,
+	// and only refit when they move; rays are taken into each instance's
+	// space instead of ever transforming triangles.
+	struct CollisionScene
+	{
+		struct Instance
+		{
+			// reference only
+			const CollisionShape * shape;
+			Vector3 position;
+			Versor rotation;
+			Vector3 scale;
+			// world space, refreshed by update()
+			AABB3 box;
+		};
+
+		std::vector<Instance> instances;
+
+		CollisionScene() : rebuild_needed(false), refit_needed(false) {}
+
+		// returns the instance id
+		uint32_t add(const CollisionShape & shape, Vector3 position,
+			Versor rotation = Versor::Identity, Vector3 scale = Vector3::One);
+		void move(uint32_t instance, Vector3 position, Versor rotation);
+		// follow a Model so that what is drawn is what collides
+		void move(uint32_t instance, const Graphics::Model & model);
+
+		// call once after a batch of adds and moves, before querying
+		void update();
+
+		// same contract as Terrain::intersect_ray, in world space
+		float intersect_ray(Vector3 o, Vector3 dir, Vector3 * n = NULL, uint32_t * instance = NULL) const;
+
+		// draw the top-level boxes
+		void draw(Graphics::Wireframe &) const
+#ifdef _DEBUG
+		;
+#else
+		{}
+#endif
+
+		// compares intersect_ray, before and after a refit, against every triangle transformed to world space
+		static void test()
+#ifdef _DEBUG
+		;
+#else
+		{}
+#endif
+
+	private:
+		static const uint32_t LEAF_SIZE = 2;
+
+		// leaves (count > 0) cover order[first, first + count);
+		// branches have children at first and first + 1, always after the parent
+		struct Node
+		{
+			AABB3 box;
+			uint32_t first;
+			uint32_t count;
+		};
+
+		std::vector<Node> nodes;
+		std::vector<uint32_t> order;
+		bool rebuild_needed;
+		bool refit_needed;
+
+		void build_node(uint32_t node, uint32_t begin, uint32_t end);
+		void refit();
+		void refresh_box(Instance &) const;
+	};
+}
+}
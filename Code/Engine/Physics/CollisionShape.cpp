@@ -0,0 +1,44 @@
+#include "stdafx.h"
+#include "CollisionShape.h"
+
+#include <limits>
+#include <utility>
+
+namespace eae6320
+{
+namespace Physics
+{
+
+CollisionShape::CollisionShape(CollisionMesh && mesh)
+	: geometry(std::move(mesh))
+	, octree(geometry.bounds.square())
+{
+	octree.populate(geometry);
+	octree.group(geometry);
+}
+
+CollisionShape * CollisionShape::FromBinFile(const char * collision_mesh_path)
+{
+	CollisionMesh * mesh = CollisionMesh::FromBinFile(collision_mesh_path, Vector3::One);
+	if (mesh == NULL)
+		return NULL;
+
+	CollisionShape * shape = new CollisionShape(std::move(*mesh));
+	delete mesh;
+
+	return shape;
+}
+
+float CollisionShape::intersect_ray(Vector3 o, Vector3 dir, Vector3 * n) const
+{
+	uint32_t hit_id;
+	float t = octree.intersect_ray(geometry, o, dir, hit_id);
+
+	if (n && t < std::numeric_limits<float>::infinity())
+		*n = geometry.normals[hit_id];
+
+	return t;
+}
+
+}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Terrain.h"
+
+namespace eae6320
+{
+namespace Physics
+{
+	// bottom level of a CollisionScene: one collision mesh and its octree,
+	// in the mesh's own space, shared by every instance placed from it.
+	// transforms live on the instances, so moving one never touches this.
+	struct CollisionShape
+	{
+		const CollisionGeometry geometry;
+		Terrain::Octree octree;
+
+		// load unscaled; instances carry the scale
+		static CollisionShape * FromBinFile(const char * collision_mesh_path);
+		explicit CollisionShape(CollisionMesh && mesh);
+
+		// same contract as Terrain::intersect_ray, in shape space
+		float intersect_ray(Vector3 o, Vector3 dir, Vector3 * n = NULL) const;
+	};
+}
+}
@@ -0,0 +1,221 @@
+#include "stdafx.h"
+#include "DistanceField.h"
+
+#include "../Debug_Runtime/UserOutput.h"
+#include "../Math/Triangle3.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+
+#ifdef _DEBUG
+#include <cassert>
+#include <cstdlib>
+#include <limits>
+#endif
+
+namespace eae6320
+{
+namespace Physics
+{
+
+DistanceField * DistanceField::FromBinFile(const char * sdf_path, float scale)
+{
+	std::ifstream infile(sdf_path, std::ifstream::binary);
+
+	if (infile.fail())
+	{
+		std::stringstream errstr;
+		errstr << "Could not open path " << sdf_path;
+		UserOutput::Print(errstr.str(), __FILE__);
+		return NULL;
+	}
+
+	DistanceField * field = new DistanceField();
+	field->scale = scale;
+
+	infile.read(reinterpret_cast<char *>(&field->header), sizeof(field->header));
+
+	const Header & header = field->header;
+	field->bricks.resize(header.dims[0] * header.dims[1] * header.dims[2]);
+	field->samples.resize(header.num_bricks * SAMPLES_PER_BRICK);
+
+	infile.read(reinterpret_cast<char *>(field->bricks.data()),
+		field->bricks.size() * sizeof(uint32_t));
+	infile.read(reinterpret_cast<char *>(field->samples.data()),
+		field->samples.size() * sizeof(int16_t));
+
+	infile.close();
+
+	if (infile.fail())
+	{
+		std::stringstream errstr;
+		errstr << "Read error from path " << sdf_path;
+		UserOutput::Print(errstr.str(), __FILE__);
+		delete field;
+		return NULL;
+	}
+
+	// lookups index samples through these unchecked
+	for (uint32_t brick : field->bricks)
+	{
+		if (brick != EMPTY_BRICK && brick >= header.num_bricks)
+		{
+			std::stringstream errstr;
+			errstr << "Brick index " << brick << " is past the " << header.num_bricks << " bricks in " << sdf_path;
+			UserOutput::Print(errstr.str(), __FILE__);
+			delete field;
+			return NULL;
+		}
+	}
+
+	return field;
+}
+
+float DistanceField::distance(Vector3 p, Vector3 * gradient) const
+{
+	if (gradient) *gradient = Vector3::Zero;
+
+	// to grid cells
+	Vector3 cell = (p / scale - header.bounds.vmin) / header.cell_size;
+	if (cell.x < 0 || cell.y < 0 || cell.z < 0)
+		return band();
+
+	uint32_t ix = static_cast<uint32_t>(cell.x);
+	uint32_t iy = static_cast<uint32_t>(cell.y);
+	uint32_t iz = static_cast<uint32_t>(cell.z);
+	uint32_t bx = ix / BRICK_CELLS, by = iy / BRICK_CELLS, bz = iz / BRICK_CELLS;
+	if (bx >= header.dims[0] || by >= header.dims[1] || bz >= header.dims[2])
+		return band();
+
+	uint32_t brick = bricks[(bz * header.dims[1] + by) * header.dims[0] + bx];
+	if (brick == EMPTY_BRICK)
+		return band();
+
+	// corner sample and fraction within the cell
+	uint32_t x = ix % BRICK_CELLS, y = iy % BRICK_CELLS, z = iz % BRICK_CELLS;
+	float fx = cell.x - ix, fy = cell.y - iy, fz = cell.z - iz;
+
+	const int16_t * s = &samples[brick * SAMPLES_PER_BRICK + (z * BRICK_SAMPLES + y) * BRICK_SAMPLES + x];
+	const uint32_t dy = BRICK_SAMPLES, dz = BRICK_SAMPLES * BRICK_SAMPLES;
+	float c000 = s[0], c100 = s[1], c010 = s[dy], c110 = s[dy + 1];
+	float c001 = s[dz], c101 = s[dz + 1], c011 = s[dz + dy], c111 = s[dz + dy + 1];
+
+	float c00 = c000 + (c100 - c000) * fx, c10 = c010 + (c110 - c010) * fx;
+	float c01 = c001 + (c101 - c001) * fx, c11 = c011 + (c111 - c011) * fx;
+	float c0 = c00 + (c10 - c00) * fy, c1 = c01 + (c11 - c01) * fy;
+
+	// from snorm16 to world units
+	const float unit = band() / INT16_MAX;
+
+	if (gradient)
+	{
+		// analytic derivative of the trilinear blend, per world unit
+		float ddx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * fy;
+		float ddx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * fy;
+		float ddy0 = c10 - c00, ddy1 = c11 - c01;
+		*gradient = Vector3(
+			ddx0 + (ddx1 - ddx0) * fz,
+			ddy0 + (ddy1 - ddy0) * fz,
+			c1 - c0) * (unit / (header.cell_size * scale));
+	}
+
+	return (c0 + (c1 - c0) * fz) * unit;
+}
+
+float DistanceField::march(Vector3 o, Vector3 dir) const
+{
+	float length = dir.norm();
+	if (length == 0)
+		return 1;
+
+	// each step covers the distance to the nearest surface, so it can't pass one
+	const float min_step = 0.25f * header.cell_size * scale;
+	const uint32_t MAX_STEPS = 64;
+	float t = 0;
+	for (uint32_t i = 0; i < MAX_STEPS && t < 1; ++i)
+	{
+		float d = distance(Vector3::madd(o, dir, t));
+		if (d < min_step)
+			return t;
+		t += d / length;
+	}
+	return std::min(t, 1.0f);
+}
+
+#ifdef _DEBUG
+namespace
+{
+	float random_unit()
+	{
+		return 2.0f * rand() / RAND_MAX - 1.0f;
+	}
+}
+
+void DistanceField::test(const CollisionGeometry & geometry) const
+{
+	const float cell = header.cell_size * scale;
+
+	// points scattered within the band around random points on the surface
+	double error_sum = 0;
+	uint32_t samples = 0, signed_samples = 0, sign_errors = 0;
+	for (int n = 0; n < 500; ++n)
+	{
+		uint32_t id = rand() % geometry.num_triangles();
+		float u = 0.5f + 0.5f * random_unit(), v = 0.5f + 0.5f * random_unit();
+		if (u + v > 1)
+		{
+			u = 1 - u;
+			v = 1 - v;
+		}
+		const Vector3 & a = geometry.vertex(id, 0);
+		Vector3 on_surface = a + (geometry.vertex(id, 1) - a) * u + (geometry.vertex(id, 2) - a) * v;
+		Vector3 p = on_surface + Vector3(random_unit(), random_unit(), random_unit()) * band();
+
+		float expected = std::numeric_limits<float>::infinity();
+		float expected_sign = 0;
+		for (uint32_t i = 0; i < geometry.num_triangles(); ++i)
+		{
+			Triangle3::Feature feature;
+			Vector3 offset = p - Triangle3::closest_point(geometry.vertex(i, 0), geometry.vertex(i, 1), geometry.vertex(i, 2), p, &feature);
+			float d = offset.norm();
+			if (d < expected)
+			{
+				expected = d;
+				// only a face has one side to be on
+				expected_sign = feature == Triangle3::FACE ? (offset.dot(geometry.normals[i]) < 0 ? -1.0f : 1.0f) : 0;
+			}
+		}
+
+		float d = distance(p);
+
+		// the sign can blend away within a cell of the surface; past it every corner of the lookup
+		// is on the same side, and in a brick
+		if (expected_sign != 0 && expected > cell && expected < band() - cell)
+		{
+			++signed_samples;
+			if ((d < 0) != (expected_sign < 0))
+				++sign_errors;
+		}
+
+		// two cells short of the band, so that no corner of the lookup saturates
+		if (expected > band() - 2 * cell)
+			continue;
+
+		// any point that close must be in a brick
+		assert(fabsf(d) < band());
+
+		error_sum += fabsf(fabsf(d) - expected);
+		++samples;
+	}
+
+	// trilinear lookups of 16-bit samples stay within a fraction of a cell on average
+	assert(samples > 100 && error_sum / samples < 0.2f * cell);
+	// the level isn't closed, so near its open edges either side can be called inside
+	assert(sign_errors <= signed_samples / 20);
+}
+#endif
+
+}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CollisionGeometry.h"
+#include "../Math/AABB3.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace eae6320
+{
+namespace Physics
+{
+	// signed distance to the collision mesh (see MeshBuilder's "sdf" mode),
+	// kept only in bricks near surfaces. negative is behind a surface.
+	// answers proximity queries with one trilinear lookup instead of rays.
+	struct DistanceField
+	{
+		// cells per brick edge; a brick stores BRICK_SAMPLES samples per edge,
+		// repeating its neighbors' border so lookups never cross bricks
+		static const uint32_t BRICK_CELLS = 8;
+		static const uint32_t BRICK_SAMPLES = BRICK_CELLS + 1;
+		static const uint32_t SAMPLES_PER_BRICK = BRICK_SAMPLES * BRICK_SAMPLES * BRICK_SAMPLES;
+		static const uint32_t EMPTY_BRICK = ~0u;
+
+		// THIS IS THE FORMAT DEFINITION
+		// 24 bytes bounds (AABB), the grid starts at vmin
+		// 4 bytes cell_size
+		// 4 bytes band, the distance at which samples saturate
+		// 3*4 bytes dims (X, Y, Z), in bricks
+		// 4 bytes num_bricks (B)
+		// 4*X*Y*Z bytes brick per grid cell (x fastest), or EMPTY_BRICK
+		// 2*9*9*9*B bytes samples, snorm16 of distance / band (x fastest)
+		struct Header
+		{
+			AABB3 bounds;
+			float cell_size;
+			float band;
+			uint32_t dims[3];
+			uint32_t num_bricks;
+		};
+
+		Header header;
+		// only uniform scales keep distances meaningful
+		float scale;
+
+		std::vector<uint32_t> bricks;
+		std::vector<int16_t> samples;
+
+		static DistanceField * FromBinFile(const char * sdf_path, float scale);
+
+		// distance from p to the nearest surface, clamped to the band.
+		// gradient, if given, points away from the surface (zero outside every brick)
+		float distance(Vector3 p, Vector3 * gradient = NULL) const;
+
+		// sphere traces o + t*dir for t in [0, 1], returning the first t within a quarter cell
+		// of a surface, or 1. as exact as the field, so walls thinner than a cell can be missed
+		float march(Vector3 o, Vector3 dir) const;
+
+		float band() const { return header.band * scale; }
+
+		// compares lookups near the surface against the distance to the closest triangle,
+		// for the geometry the field was baked from, at the same scale
+		void test(const CollisionGeometry & geometry) const
+#ifdef _DEBUG
+		;
+#else
+		{}
+#endif
+	};
+}
+}
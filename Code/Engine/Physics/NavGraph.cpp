@@ -0,0 +1,200 @@
+#include "stdafx.h"
+#include "NavGraph.h"
+
+#include "../Debug_Runtime/UserOutput.h"
+
+#include <fstream>
+#include <sstream>
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include <functional>
+
+namespace eae6320
+{
+namespace Physics
+{
+
+NavGraph * NavGraph::FromBinFile(const char * nav_path, Vector3 scale)
+{
+	std::ifstream infile(nav_path, std::ifstream::binary);
+
+	if (infile.fail())
+	{
+		std::stringstream errstr;
+		errstr << "Could not open path " << nav_path;
+		UserOutput::Print(errstr.str(), __FILE__);
+		return NULL;
+	}
+
+	NavGraph * graph = new NavGraph();
+	graph->scale = scale;
+
+	infile.read(reinterpret_cast<char *>(&graph->header), sizeof(graph->header));
+
+	graph->nodes.resize(graph->header.num_nodes);
+	graph->edge_offsets.resize(graph->header.num_nodes + 1);
+	graph->edges.resize(graph->header.num_edges);
+
+	infile.read(reinterpret_cast<char *>(graph->nodes.data()),
+		graph->header.num_nodes * sizeof(Node));
+	infile.read(reinterpret_cast<char *>(graph->edge_offsets.data()),
+		(graph->header.num_nodes + 1) * sizeof(uint32_t));
+	infile.read(reinterpret_cast<char *>(graph->edges.data()),
+		graph->header.num_edges * sizeof(uint32_t));
+
+	infile.close();
+
+	if (infile.fail())
+	{
+		std::stringstream errstr;
+		errstr << "Read error from path " << nav_path;
+		UserOutput::Print(errstr.str(), __FILE__);
+		delete graph;
+		return NULL;
+	}
+
+	graph->index_columns();
+
+	return graph;
+}
+
+void NavGraph::index_columns()
+{
+	uint32_t num_columns = header.dims[0] * header.dims[2];
+	column_offsets.assign(num_columns + 1, 0);
+
+	// nodes are sorted by column, so count then prefix-sum
+	for (const Node & node : nodes)
+		++column_offsets[node.z * header.dims[0] + node.x + 1];
+	for (uint32_t i = 0; i < num_columns; ++i)
+		column_offsets[i + 1] += column_offsets[i];
+}
+
+Vector3 NavGraph::position(uint32_t id) const
+{
+	const Node & node = nodes[id];
+	Vector3 voxel(node.x + 0.5f, static_cast<float>(node.y), node.z + 0.5f);
+	return (header.bounds.vmin + voxel * header.voxel_size).scale(scale);
+}
+
+uint32_t NavGraph::column_nearest(int32_t x, int32_t z, float y) const
+{
+	if (x < 0 || z < 0
+		|| x >= static_cast<int32_t>(header.dims[0])
+		|| z >= static_cast<int32_t>(header.dims[2]))
+		return INVALID_NODE;
+
+	uint32_t column = z * header.dims[0] + x;
+	uint32_t found = INVALID_NODE;
+
+	// highest node not above the point, allowing one voxel of slop
+	for (uint32_t i = column_offsets[column]; i < column_offsets[column + 1]; ++i)
+		if (nodes[i].y <= y + 1.0f)
+			found = i;
+
+	return found;
+}
+
+uint32_t NavGraph::nearest(Vector3 point) const
+{
+	Vector3 unscale(1.0f / scale.x, 1.0f / scale.y, 1.0f / scale.z);
+	Vector3 voxel = (point.scale(unscale) - header.bounds.vmin) / header.voxel_size;
+	int32_t x = static_cast<int32_t>(floorf(voxel.x));
+	int32_t z = static_cast<int32_t>(floorf(voxel.z));
+
+	uint32_t found = column_nearest(x, z, voxel.y);
+	if (found != INVALID_NODE)
+		return found;
+
+	// standing on an edge: settle for the closest neighboring column
+	float best = std::numeric_limits<float>::infinity();
+	for (int32_t dz = -1; dz <= 1; ++dz)
+		for (int32_t dx = -1; dx <= 1; ++dx)
+		{
+			uint32_t id = column_nearest(x + dx, z + dz, voxel.y);
+			if (id == INVALID_NODE)
+				continue;
+			float d = (position(id) - point).norm_sq();
+			if (d < best)
+			{
+				best = d;
+				found = id;
+			}
+		}
+
+	return found;
+}
+
+bool NavGraph::find_path(Vector3 start, Vector3 goal, std::vector<Vector3> & path) const
+{
+	path.clear();
+
+	uint32_t from = nearest(start), to = nearest(goal);
+	if (from == INVALID_NODE || to == INVALID_NODE)
+		return false;
+
+	typedef std::pair<float, uint32_t> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+	std::vector<float> cost(nodes.size(), std::numeric_limits<float>::infinity());
+	std::vector<uint32_t> came_from(nodes.size(), INVALID_NODE);
+
+	Vector3 target = position(to);
+	cost[from] = 0;
+	open.push(Entry((position(from) - target).norm(), from));
+
+	while (!open.empty())
+	{
+		uint32_t current = open.top().second;
+		open.pop();
+
+		if (current == to)
+			break;
+
+		Vector3 p = position(current);
+		for (uint32_t e = edge_offsets[current]; e < edge_offsets[current + 1]; ++e)
+		{
+			uint32_t next = edges[e];
+			Vector3 q = position(next);
+			float g = cost[current] + (q - p).norm();
+			if (g < cost[next])
+			{
+				cost[next] = g;
+				came_from[next] = current;
+				open.push(Entry(g + (q - target).norm(), next));
+			}
+		}
+	}
+
+	if (from != to && came_from[to] == INVALID_NODE)
+		return false;
+
+	for (uint32_t id = to; id != INVALID_NODE; id = came_from[id])
+		path.push_back(position(id));
+	std::reverse(path.begin(), path.end());
+
+	return true;
+}
+
+#ifdef _DEBUG
+void NavGraph::draw(Vector3 center, float radius, Graphics::Wireframe & wireframe) const
+{
+	Graphics::Color walkable(0.2f, 0.8f, 1.0f, 1.0f);
+	float radius_sq = radius * radius;
+
+	for (uint32_t i = 0; i < nodes.size(); ++i)
+	{
+		Vector3 p = position(i);
+		if ((p - center).norm_sq() > radius_sq)
+			continue;
+
+		// each edge is stored in both directions; draw it once
+		for (uint32_t e = edge_offsets[i]; e < edge_offsets[i + 1]; ++e)
+			if (edges[e] > i)
+				wireframe.addLine(p, walkable, position(edges[e]), walkable);
+	}
+}
+#endif
+
+}
+}
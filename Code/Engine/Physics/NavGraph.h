@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../Graphics/Wireframe.h"
+#include "../Math/AABB3.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace eae6320
+{
+namespace Physics
+{
+	// walkable space baked from the collision mesh (see MeshBuilder's "navmesh" mode).
+	// every node is an empty voxel standing on top of a walkable surface,
+	// and edges connect neighboring nodes that an agent can step between.
+	struct NavGraph
+	{
+		static const uint32_t INVALID_NODE = ~0u;
+
+		// voxel coordinates, relative to bounds.vmin
+		struct Node
+		{
+			uint16_t x, y, z;
+		};
+
+		// THIS IS THE FORMAT DEFINITION
+		// 24 bytes bounds (AABB)
+		// 4 bytes voxel_size
+		// 3*4 bytes dims (X, Y, Z)
+		// 4 bytes num_nodes (N)
+		// 4 bytes num_edges (E)
+		// 3*2*N bytes nodes, sorted by column (z * X + x) then by y
+		// 4*(N+1) bytes edge offsets
+		// 4*E bytes edges
+		struct Header
+		{
+			AABB3 bounds;
+			float voxel_size;
+			uint32_t dims[3];
+			uint32_t num_nodes;
+			uint32_t num_edges;
+		};
+
+		Header header;
+		Vector3 scale;
+
+		std::vector<Node> nodes;
+		// edges of node i are edges[edge_offsets[i]] up to edges[edge_offsets[i+1]]
+		std::vector<uint32_t> edge_offsets;
+		std::vector<uint32_t> edges;
+		// nodes of column (x, z) are nodes[column_offsets[z * X + x]] up to the next column's
+		std::vector<uint32_t> column_offsets;
+
+		static NavGraph * FromBinFile(const char * nav_path, Vector3 scale);
+
+		// world-space point an agent stands on at this node
+		Vector3 position(uint32_t node) const;
+
+		// the node an agent at this point is standing on, or INVALID_NODE
+		uint32_t nearest(Vector3 point) const;
+
+		// A* over the graph; path is filled with world-space waypoints from start to goal
+		bool find_path(Vector3 start, Vector3 goal, std::vector<Vector3> & path) const;
+
+		// draw edges of nodes near center
+		void draw(Vector3 center, float radius, Graphics::Wireframe &) const
+#ifdef _DEBUG
+		;
+#else
+		{}
+#endif
+
+	private:
+		void index_columns();
+		uint32_t column_nearest(int32_t x, int32_t z, float y) const;
+	};
+}
+}
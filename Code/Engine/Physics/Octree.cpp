@@ -3,6 +3,7 @@
 #include "Terrain.h"
 
 #include <queue>
+#include <limits>
 
 
 namespace eae6320
@@ -10,73 +11,160 @@ namespace eae6320
 namespace Physics
 {
 
-void Terrain::Octree::populate(const Triangle3 * triangles, uint32_t num_triangles)
+void Terrain::Octree::populate(const CollisionGeometry & geometry)
 {
-	for (uint32_t i = 0; i < num_triangles; ++i)
-		insert(i, triangles[i]);
+	for (uint32_t i = 0; i < geometry.num_triangles(); ++i)
+		insert(i, geometry.box(i));
 
-	propagate_all(triangles, num_triangles);
+	propagate_all(geometry);
 
-	//optimize(triangles, num_triangles);
+	//optimize(geometry);
 }
 
-void Terrain::Octree::insert(uint32_t id, const Triangle3 & triangle)
+void Terrain::Octree::pack(const CollisionGeometry & geometry)
 {
-	Octree *node;
-	Vector3 tri2center = triangle.box.vmin + triangle.box.vmax;
+	if (!is_leaf())
+	{
+		for (uint8_t i = 0; i < 8; ++i)
+			branch[i]->pack(geometry);
+		return;
+	}
+
+	packed.clear();
+	if (object_ids.empty()) return;
 
-	for ( node = this
-		; node->max_depth > 0 && node->bounds.contains(triangle.box)
-		; node = node->branch[(tri2center - node->bounds.vmin - node->bounds.vmax).octant()])
+	packed_bounds = geometry.box(object_ids[0]);
+	for (uint32_t id : object_ids)
+	{
+		AABB3 box = geometry.box(id);
+		packed_bounds.vmin = Vector3::min3(packed_bounds.vmin, box.vmin);
+		packed_bounds.vmax = Vector3::max3(packed_bounds.vmax, box.vmax);
+	}
+
+	packed.reserve(object_ids.size());
+	for (uint32_t id : object_ids)
+	{
+		PackedTriangle triangle;
+		for (uint8_t corner = 0; corner < 3; ++corner)
+			triangle.v[corner] = CollisionMesh::quantize(geometry.vertex(id, corner), packed_bounds);
+		packed.push_back(triangle);
+	}
+}
+
+void Terrain::Octree::group(const CollisionGeometry & geometry)
+{
+	if (!is_leaf())
+	{
+		for (uint8_t i = 0; i < 8; ++i)
+			branch[i]->group(geometry);
+		return;
+	}
+
+	groups.clear();
+	groups.resize((object_ids.size() + 7) / 8);
+	for (size_t i = 0; i < groups.size() * 8; ++i)
+	{
+		if (i < object_ids.size())
+		{
+			uint32_t id = object_ids[i];
+			groups[i / 8].set(i % 8, geometry.vertex(id, 0), geometry.vertex(id, 1), geometry.vertex(id, 2), geometry.normals[id]);
+		}
+		else
+			groups[i / 8].clear(i % 8);
+	}
+}
+
+void Terrain::Octree::insert(uint32_t id, const AABB3 & box)
+{
+	Octree *node = this;
+	Vector3 tri2center = box.vmin + box.vmax;
+
+	// descend only while the child still contains the whole box
+	while (node->max_depth > 0)
 	{
 		if (node->is_leaf())
 			node->branch_out();
+
+		Octree *child = node->branch[(tri2center - node->bounds.vmin - node->bounds.vmax).octant()];
+		if (!child->bounds.contains(box))
+			break;
+		node = child;
 	}
 
 	node->object_ids.push_back(id);
 }
 
-void Terrain::Octree::propagate_all(const Triangle3 * triangles, uint32_t num_triangles)
+void Terrain::Octree::propagate_all(const CollisionGeometry & geometry)
 {
 	if (is_leaf()) return;
 
 	for (uint32_t id : object_ids)
-		propagate(id, triangles[id]);
+		propagate(id, geometry.box(id));
 
 	object_ids.clear();
 
 	for (uint8_t i = 0; i < 8; ++i)
-		branch[i]->propagate_all(triangles, num_triangles);
+		branch[i]->propagate_all(geometry);
 }
 
-void Terrain::Octree::propagate(uint32_t id, const Triangle3 & triangle)
+void Terrain::Octree::propagate(uint32_t id, const AABB3 & box)
 {
-	if (!triangle.box.intersects(bounds)) return;
+	if (!box.intersects(bounds)) return;
 
 	if (is_leaf())
 		object_ids.push_back(id);
 	else
 		for (uint8_t i = 0; i < 8; ++i)
-			branch[i]->propagate(id, triangle);
+			branch[i]->propagate(id, box);
 }
 
-void Terrain::Octree::optimize(const Triangle3 * triangles, uint32_t num_triangles)
+void Terrain::Octree::optimize(const CollisionGeometry & geometry)
 {
 	if (object_ids.size() / (float)(MAX_DEPTH - max_depth) > FILL_DEPTH_RATIO)
 	{
 		branch_out();
-		propagate_all(triangles, num_triangles);
+		propagate_all(geometry);
 	}
 
 	if (is_leaf()) return;
 
 	for (uint8_t i = 0; i < 8; ++i)
-		branch[i]->optimize(triangles, num_triangles);
+		branch[i]->optimize(geometry);
 }
 
 size_t Terrain::Octree::intersect(Segment3 segment, std::queue<const Octree *> & boxes) const
 {
-	if (!bounds.intersects(segment))
+	return intersect(Ray3(segment), boxes);
+}
+
+size_t Terrain::Octree::intersect(const Ray3 & ray, std::queue<const Octree *> & boxes) const
+{
+	if (!ray.intersects(AABB3A(bounds)))
+		return 0;
+
+	return intersect_branches(ray, boxes);
+}
+
+size_t Terrain::Octree::intersect_branches(const Ray3 & ray, std::queue<const Octree *> & boxes) const
+{
+	if (is_leaf())
+	{
+		boxes.push(this);
+		return 1;
+	}
+
+	// all 8 children in one slab test, descending only into the hits
+	uint32_t hits = ray.intersects(branch_bounds);
+	size_t count = 0;
+	for (uint8_t i = 0; i < 8; ++i)
+		if (hits >> i & 1)
+			count += branch[i]->intersect_branches(ray, boxes);
+	return count;
+}
+
+size_t Terrain::Octree::overlap(const AABB3 & box, std::queue<const Octree *> & boxes) const
+{
+	if (!bounds.intersects(box))
 		return 0;
 
 	if (is_leaf())
@@ -87,10 +175,65 @@ size_t Terrain::Octree::intersect(Segment3 segment, std::queue<const Octree *> &
 
 	size_t count = 0;
 	for (uint8_t i = 0; i < 8; ++i)
-		count += branch[i]->intersect(segment, boxes);
+		count += branch[i]->overlap(box, boxes);
 	return count;
 }
 
+float Terrain::Octree::intersect_ray(const CollisionGeometry & geometry, Vector3 o, Vector3 dir, uint32_t & hit_id) const
+{
+	float t = std::numeric_limits<float>::infinity();
+
+	std::queue<const Octree *> hitboxes;
+	const Octree * node;
+
+	intersect(Ray3(o, dir), hitboxes);
+
+	while (!hitboxes.empty())
+	{
+		node = hitboxes.front();
+		hitboxes.pop();
+
+		if (!node->groups.empty())
+		{
+			for (size_t i = 0; i < node->groups.size(); ++i)
+			{
+				uint32_t lane;
+				float t_i = node->groups[i].intersect_ray(o, dir, lane);
+				if (t_i < t)
+				{
+					t = t_i;
+					hit_id = node->object_ids[8 * i + lane];
+				}
+			}
+			continue;
+		}
+
+		for (size_t i = 0; i < node->object_ids.size(); ++i)
+		{
+			uint32_t id = node->object_ids[i];
+			float t_i;
+			if (node->packed.empty())
+				t_i = geometry.intersect_ray(id, o, dir);
+			else
+			{
+				const PackedTriangle & packed = node->packed[i];
+				t_i = Triangle3::intersect_ray(
+					CollisionMesh::dequantize(packed.v[0], node->packed_bounds),
+					CollisionMesh::dequantize(packed.v[1], node->packed_bounds),
+					CollisionMesh::dequantize(packed.v[2], node->packed_bounds),
+					geometry.normals[id], o, dir);
+			}
+			if (t_i > 0 && t_i < t)
+			{
+				t = t_i;
+				hit_id = id;
+			}
+		}
+	}
+
+	return t;
+}
+
 size_t Terrain::Octree::find(uint32_t id, std::queue<const Octree *> & boxes) const
 {
 	size_t count = 0;
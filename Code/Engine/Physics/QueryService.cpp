@@ -0,0 +1,208 @@
+#include "stdafx.h"
+#include "QueryService.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+namespace eae6320
+{
+namespace Physics
+{
+
+QueryService::QueryService(const Terrain & terrain, unsigned num_threads)
+	: terrain(terrain)
+	, stopping(false)
+{
+	if (num_threads == 0)
+		num_threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	for (unsigned i = 0; i < num_threads; ++i)
+		workers.push_back(std::thread(&QueryService::work, this));
+}
+
+QueryService::~QueryService()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobs_mutex);
+		stopping = true;
+	}
+	jobs_ready.notify_all();
+
+	for (std::thread & worker : workers)
+		worker.join();
+}
+
+void QueryService::work()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(jobs_mutex);
+			jobs_ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+			// drain what was submitted before shutting down so no future is left unsatisfied
+			if (jobs.empty())
+				return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+void QueryService::enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(jobs_mutex);
+		jobs.push_back(std::move(job));
+	}
+	jobs_ready.notify_one();
+}
+
+void QueryService::dispatch()
+{
+	std::vector<std::function<void()>> ready;
+	{
+		std::lock_guard<std::mutex> lock(completed_mutex);
+		ready.swap(completed);
+	}
+
+	for (std::function<void()> & callback : ready)
+		callback();
+}
+
+QueryService::Hits QueryService::run(const std::vector<Ray> & batch) const
+{
+	Hits hits(batch.size());
+	for (size_t i = 0; i < batch.size(); ++i)
+		hits[i].t = terrain.trace_ray(batch[i].o, batch[i].dir, &hits[i].normal);
+	return hits;
+}
+
+QueryService::Hits QueryService::run(const std::vector<Sweep> & batch) const
+{
+	Hits hits(batch.size());
+	for (size_t i = 0; i < batch.size(); ++i)
+		hits[i].t = terrain.sweep_sphere(batch[i].center, batch[i].radius, batch[i].dir, &hits[i].normal);
+	return hits;
+}
+
+QueryService::Overlaps QueryService::run(const std::vector<Overlap> & batch) const
+{
+	Overlaps overlaps(batch.size());
+	for (size_t i = 0; i < batch.size(); ++i)
+		terrain.overlap(batch[i].box, overlaps[i]);
+	return overlaps;
+}
+
+// std::function must be copyable, so move-only state rides in a shared_ptr
+
+template <typename Query, typename Result>
+std::future<Result> QueryService::submit_future(std::vector<Query> && batch)
+{
+	auto task = std::make_shared<std::packaged_task<Result()>>(
+		std::bind(static_cast<Result (QueryService::*)(const std::vector<Query> &) const>(&QueryService::run),
+			this, std::move(batch)));
+	std::future<Result> result = task->get_future();
+	enqueue([task] { (*task)(); });
+	return result;
+}
+
+template <typename Query, typename Result>
+void QueryService::submit_callback(std::vector<Query> && batch, std::function<void(const Result &)> && on_complete)
+{
+	auto shared_batch = std::make_shared<std::vector<Query>>(std::move(batch));
+	auto callback = std::make_shared<std::function<void(const Result &)>>(std::move(on_complete));
+
+	enqueue([this, shared_batch, callback]
+	{
+		auto result = std::make_shared<Result>(run(*shared_batch));
+		std::lock_guard<std::mutex> lock(completed_mutex);
+		completed.push_back([callback, result] { (*callback)(*result); });
+	});
+}
+
+std::future<QueryService::Hits> QueryService::submit(std::vector<Ray> batch)
+{
+	return submit_future<Ray, Hits>(std::move(batch));
+}
+
+std::future<QueryService::Hits> QueryService::submit(std::vector<Sweep> batch)
+{
+	return submit_future<Sweep, Hits>(std::move(batch));
+}
+
+std::future<QueryService::Overlaps> QueryService::submit(std::vector<Overlap> batch)
+{
+	return submit_future<Overlap, Overlaps>(std::move(batch));
+}
+
+void QueryService::submit(std::vector<Ray> batch, std::function<void(const Hits &)> on_complete)
+{
+	submit_callback<Ray, Hits>(std::move(batch), std::move(on_complete));
+}
+
+void QueryService::submit(std::vector<Sweep> batch, std::function<void(const Hits &)> on_complete)
+{
+	submit_callback<Sweep, Hits>(std::move(batch), std::move(on_complete));
+}
+
+void QueryService::submit(std::vector<Overlap> batch, std::function<void(const Overlaps &)> on_complete)
+{
+	submit_callback<Overlap, Overlaps>(std::move(batch), std::move(on_complete));
+}
+
+#ifdef _DEBUG
+void QueryService::test()
+{
+	const AABB3 & bounds = terrain.geometry.bounds;
+	Vector3 center = Vector3::midpoint(bounds.vmin, bounds.vmax);
+	Vector3 extent = bounds.vmax - bounds.vmin;
+
+	// a fan of downward rays and sweeps across the level
+	std::vector<Ray> rays;
+	std::vector<Sweep> sweeps;
+	for (int i = -4; i <= 4; ++i)
+		for (int j = -4; j <= 4; ++j)
+		{
+			Vector3 o = center + Vector3(extent.x * i / 10, 0, extent.z * j / 10);
+			Ray ray = { o, Vector3(0, -extent.y, 0) };
+			Sweep sweep = { o, 0.25f, Vector3(0, -extent.y, 0) };
+			rays.push_back(ray);
+			sweeps.push_back(sweep);
+		}
+	std::vector<Overlap> overlaps(1);
+	overlaps[0].box = AABB3(center - extent / 8, center + extent / 8);
+
+	std::future<Hits> ray_hits = submit(rays);
+	std::future<Hits> sweep_hits = submit(sweeps);
+	std::future<Overlaps> overlap_ids = submit(overlaps);
+
+	bool called = false;
+	submit(rays, [&called](const Hits &) { called = true; });
+
+	Hits r = ray_hits.get(), s = sweep_hits.get();
+	for (size_t i = 0; i < rays.size(); ++i)
+	{
+		assert(r[i].t == terrain.trace_ray(rays[i].o, rays[i].dir));
+		// a sphere can only touch sooner than its center's ray
+		assert(s[i].t <= r[i].t);
+	}
+
+	std::vector<uint32_t> ids;
+	terrain.overlap(overlaps[0].box, ids);
+	assert(overlap_ids.get()[0] == ids);
+
+	// callbacks only run from dispatch
+	assert(!called);
+	while (!called)
+	{
+		std::this_thread::yield();
+		dispatch();
+	}
+}
+#endif
+
+}
+}
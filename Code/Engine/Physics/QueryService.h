@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Terrain.h"
+
+#include <vector>
+#include <deque>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace eae6320
+{
+namespace Physics
+{
+	// runs batches of terrain queries on worker threads.
+	// submit from any thread; results come back either through a future,
+	// or through a callback that dispatch() runs on the game thread next tick.
+	struct QueryService
+	{
+		struct Ray
+		{
+			Vector3 o, dir;
+		};
+
+		struct Sweep
+		{
+			Vector3 center;
+			float radius;
+			Vector3 dir;
+		};
+
+		struct Overlap
+		{
+			AABB3 box;
+		};
+
+		// t is infinity on a miss
+		struct Hit
+		{
+			float t;
+			Vector3 normal;
+		};
+
+		typedef std::vector<Hit> Hits;
+		typedef std::vector<std::vector<uint32_t>> Overlaps;
+
+		// 0 threads means one fewer than the hardware has, leaving the game thread its core
+		QueryService(const Terrain & terrain, unsigned num_threads = 0);
+		~QueryService();
+
+		std::future<Hits> submit(std::vector<Ray> batch);
+		std::future<Hits> submit(std::vector<Sweep> batch);
+		std::future<Overlaps> submit(std::vector<Overlap> batch);
+
+		void submit(std::vector<Ray> batch, std::function<void(const Hits &)> on_complete);
+		void submit(std::vector<Sweep> batch, std::function<void(const Hits &)> on_complete);
+		void submit(std::vector<Overlap> batch, std::function<void(const Overlaps &)> on_complete);
+
+		// run the callbacks of batches finished since the last call. game thread only
+		void dispatch();
+
+		// compare batched results against direct calls
+		void test()
+#ifdef _DEBUG
+		;
+#else
+		{}
+#endif
+
+	private:
+		const Terrain & terrain;
+
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> jobs;
+		std::mutex jobs_mutex;
+		std::condition_variable jobs_ready;
+		bool stopping;
+
+		std::vector<std::function<void()>> completed;
+		std::mutex completed_mutex;
+
+		void work();
+		void enqueue(std::function<void()> job);
+
+		Hits run(const std::vector<Ray> & batch) const;
+		Hits run(const std::vector<Sweep> & batch) const;
+		Overlaps run(const std::vector<Overlap> & batch) const;
+
+		template <typename Query, typename Result>
+		std::future<Result> submit_future(std::vector<Query> && batch);
+		template <typename Query, typename Result>
+		void submit_callback(std::vector<Query> && batch, std::function<void(const Result &)> && on_complete);
+	};
+}
+}
@@ -11,88 +11,117 @@ namespace Physics
 
 const float Terrain::Octree::FILL_DEPTH_RATIO = 1.5f;
 
-Triangle3 * cache_triangles(const Graphics::Mesh::Data & mesh_data, Vector3 scale)
-{
-	Triangle3 * triangles = new Triangle3[mesh_data.num_triangles];
-
-	for (uint32_t i = 0; i < mesh_data.num_triangles; ++i)
-	{
-		Graphics::Mesh::Index i_a = mesh_data.indices[i * 3];
-		Graphics::Mesh::Index i_b = mesh_data.indices[i * 3 + 1];
-		Graphics::Mesh::Index i_c = mesh_data.indices[i * 3 + 2];
-		Graphics::Mesh::Vertex * a = &mesh_data.vertices[i_a];
-		Graphics::Mesh::Vertex * b = &mesh_data.vertices[i_b];
-		Graphics::Mesh::Vertex * c = &mesh_data.vertices[i_c];
-		triangles[i] = Triangle3(a->position, b->position, c->position, b->normal).scale(scale);
-	}
-
-	return triangles;
-}
-
-Terrain::Terrain(const Graphics::Mesh::Data & mesh_data, Vector3 scale, Graphics::Wireframe & wireframe)
-	: triangles(cache_triangles(mesh_data, scale))
-	, num_triangles(mesh_data.num_triangles)
-	, octree(mesh_data.bounds.scale(scale).square())
+Terrain::Terrain(CollisionMesh && mesh, Graphics::Wireframe & wireframe)
+	: geometry(std::move(mesh))
+	, octree(geometry.bounds.square())
 	, wireframe(wireframe)
 {
 }
 
 Terrain * Terrain::FromBinFile(const char * collision_mesh_path, Vector3 scale, Graphics::Wireframe & wireframe)
 {
-	Graphics::Mesh::Data * mesh_data = Graphics::Mesh::Data::FromBinFile(collision_mesh_path);
-	Terrain * terrain = new Terrain(*mesh_data, scale, wireframe);
-	delete mesh_data;
+	CollisionMesh * mesh = CollisionMesh::FromBinFile(collision_mesh_path, scale);
+	if (mesh == NULL)
+		return NULL;
+
+	Terrain * terrain = new Terrain(std::move(*mesh), wireframe);
+	delete mesh;
 	terrain->init_octree();
 
 	return terrain;
 }
 
 
-float Terrain::intersect_ray(Vector3 o, Vector3 dir, Vector3 * n) const
+float Terrain::trace_ray(Vector3 o, Vector3 dir, Vector3 * n, uint32_t * hit_id) const
 {
 	float t = std::numeric_limits<float>::infinity();
-	size_t hit_i;
+	uint32_t hit_i;
 
-	/**
-	std::queue<const Octree *> hitboxes;
-	const Octree * node;
+	/**/
+	t = octree.intersect_ray(geometry, o, dir, hit_i);
+
+	/*/ // naive impl, check entire triangle list
+	for (uint32_t i = 0; i < geometry.num_triangles(); ++i)
+	{
+		float t_i = geometry.intersect_ray(i, o, dir);
+		if (t_i > 0 && t_i < t)
+		{
+			t = t_i;
+			hit_i = i;
+		}
+	}
+	/**/
+
+	if (t < std::numeric_limits<float>::infinity())
+	{
+		if (n) *n = geometry.normals[hit_i];
+		if (hit_id) *hit_id = hit_i;
+	}
 
-	octree.intersect(Segment3(o, o + dir), hitboxes);
+	return t;
+}
+
+float Terrain::sweep_sphere(Vector3 center, float radius, Vector3 dir, Vector3 * n) const
+{
+	float t = std::numeric_limits<float>::infinity();
+
+	Vector3 end = center + dir;
+	Vector3 reach(radius, radius, radius);
+	AABB3 swept(Vector3::min3(center, end) - reach, Vector3::max3(center, end) + reach);
+
+	std::queue<const Octree *> hitboxes;
+	octree.overlap(swept, hitboxes);
 
 	while (!hitboxes.empty())
 	{
-		node = hitboxes.front();
+		const Octree * node = hitboxes.front();
 		hitboxes.pop();
 
 		for (uint32_t id : node->object_ids)
 		{
-			Vector3 n_i = triangles[id].normal;
-			float t_i = triangles[id].intersect_ray(o, dir);
-			if (t_i > 0 && t_i < t)
+			float t_i = Triangle3::sweep_sphere(geometry.vertex(id, 0), geometry.vertex(id, 1),
+				geometry.vertex(id, 2), center, radius, dir);
+			if (t_i < t)
 			{
 				t = t_i;
-				if (n) *n = triangles[id].normal;
+				if (n) *n = geometry.normals[id];
 			}
 		}
 	}
 
-	/*/ // naive impl, check entire triangle list
-	for (size_t i = 0; i < num_triangles; ++i)
+	return t;
+}
+
+void Terrain::overlap(const AABB3 & box, std::vector<uint32_t> & ids) const
+{
+	ids.clear();
+
+	std::queue<const Octree *> hitboxes;
+	octree.overlap(box, hitboxes);
+
+	while (!hitboxes.empty())
 	{
-		Vector3 n_i = triangles[i].normal;
-		float t_i = triangles[i].intersect_ray(o, dir);
-		if (t_i > 0 && t_i < t)
-		{
-			t = t_i;
-			if (n) *n = triangles[i].normal;
-			hit_i = i;
-		}
+		const Octree * node = hitboxes.front();
+		hitboxes.pop();
+
+		for (uint32_t id : node->object_ids)
+			if (box.intersects(geometry.box(id)) && box.intersects(geometry.triangle(id)))
+				ids.push_back(id);
 	}
-	/**/
+
+	// triangles spanning leaves were found once per leaf
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+float Terrain::intersect_ray(Vector3 o, Vector3 dir, Vector3 * n) const
+{
+	uint32_t hit_i;
+	float t = trace_ray(o, dir, n, &hit_i);
 
 	if (t < std::numeric_limits<float>::infinity())
 	{
-		wireframe.addTriangle(triangles[hit_i], Graphics::Color::White);
+		wireframe.addTriangle(geometry.triangle(hit_i), Graphics::Color::White);
 	}
 
 	/*
@@ -123,7 +152,7 @@ void Terrain::draw_raycast(Segment3 segment, Graphics::Wireframe & wireframe)
 		node->draw(wireframe);
 
 		for (uint32_t id : node->object_ids)
-			wireframe.addTriangle(triangles[id], Graphics::Color::White);
+			wireframe.addTriangle(geometry.triangle(id), Graphics::Color::White);
 	}
 
 	Segment3 drop(Vector3(0,0,0),Vector3(0,-30,0));
@@ -133,13 +162,40 @@ void Terrain::draw_raycast(Segment3 segment, Graphics::Wireframe & wireframe)
 
 void Terrain::test_octree()
 {
-	std::vector<bool> triangle_inventory(num_triangles, false);
+	std::vector<bool> triangle_inventory(geometry.num_triangles(), false);
 
 	octree.take_inventory(triangle_inventory);
 
-	for (size_t i = 0; i < num_triangles; ++i)
+	for (size_t i = 0; i < geometry.num_triangles(); ++i)
 		assert(triangle_inventory[i]);
 
+	// packed leaves must reproduce their triangles to within one quantum
+	std::queue<const Octree *> nodes;
+	nodes.push(&octree);
+	while (!nodes.empty())
+	{
+		const Octree * node = nodes.front();
+		nodes.pop();
+
+		if (!node->is_leaf())
+		{
+			for (uint8_t i = 0; i < 8; ++i)
+				nodes.push(node->branch[i]);
+			continue;
+		}
+
+		float quantum = (node->packed_bounds.vmax - node->packed_bounds.vmin).max_dim() / UINT16_MAX;
+		for (size_t i = 0; i < node->packed.size(); ++i)
+			for (uint8_t corner = 0; corner < 3; ++corner)
+			{
+				Vector3 error = CollisionMesh::dequantize(node->packed[i].v[corner], node->packed_bounds)
+					- geometry.vertex(node->object_ids[i], corner);
+				assert(error.abs().max_dim() <= quantum);
+			}
+
+		assert(node->groups.empty() || node->groups.size() == (node->object_ids.size() + 7) / 8);
+	}
+
 	std::queue<const Octree *> boxes_with_4;
 	octree.find(4, boxes_with_4);
 
@@ -1,8 +1,9 @@
 #pragma once
 
-#include "../Graphics/Mesh.h"
+#include "CollisionGeometry.h"
 #include "../Graphics/Wireframe.h"
 #include "../Math/Triangle3.h"
+#include "../Math/Ray3.h"
 
 #include <vector>
 #include <queue>
@@ -22,11 +23,26 @@ namespace Physics
 			Octree * branch[8] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
 			// invariant: children's bounds are strictly smaller than parent's
 			AABB3 bounds;
+			// the children's bounds, set by branch_out, for testing all 8 in one pass
+			AABB3x8 branch_bounds;
 			// invariant: children's max_depth is 1 less than parent's
 			uint8_t max_depth;
-			// object_ids are indices into the Terrain's triangles array
+			// object_ids are indices into the Terrain's geometry
 			std::vector<uint32_t> object_ids;
 
+			// optional copy of a leaf's triangles, parallel to object_ids,
+			// quantized relative to packed_bounds so the leaf is one small contiguous block
+			struct PackedTriangle
+			{
+				CollisionMesh::Position v[3];
+			};
+			std::vector<PackedTriangle> packed;
+			// union of the boxes of the leaf's triangles
+			AABB3 packed_bounds;
+			// optional ray test records for a leaf's triangles, object_ids[8 * i + lane]
+			// in lane of groups[i], with the last group's spare lanes cleared
+			std::vector<Triangle3x8> groups;
+
 
 			Octree(AABB3 bounds, uint8_t max_depth = MAX_DEPTH) : bounds(bounds), max_depth(max_depth) {}
 			~Octree()
@@ -42,25 +58,40 @@ namespace Physics
 			{
 				if (max_depth > 0)
 					for (uint8_t i = 0; i < 8; ++i)
+					{
 						branch[i] = new Octree(bounds.octant(i), max_depth - 1);
+						branch_bounds.set(i, branch[i]->bounds);
+					}
 			}
 
-			void populate(const Triangle3 * triangles, uint32_t num_triangles);
+			void populate(const CollisionGeometry & geometry);
+			// fill packed in every non-empty leaf
+			void pack(const CollisionGeometry & geometry);
+			// fill groups in every non-empty leaf
+			void group(const CollisionGeometry & geometry);
 
 			// used by populate:
 
 			// put the triangle in the largest containing box
-			void insert(uint32_t, const Triangle3 &);
+			void insert(uint32_t, const AABB3 & box);
 			// push the triangle id to all intersecting leaves
-			void propagate(uint32_t, const Triangle3 &);
+			void propagate(uint32_t, const AABB3 & box);
 			// push all triangles to leaves while leaving branch nodes empty
-			void propagate_all(const Triangle3 * triangles, uint32_t num_triangles);
+			void propagate_all(const CollisionGeometry & geometry);
 			// ensure 
-			void optimize(const Triangle3 * triangles, uint32_t num_triangles);
+			void optimize(const CollisionGeometry & geometry);
 
 			size_t intersect(Segment3 segment, std::queue<const Octree *> & hitboxes) const;
+			// as above for t in [0, 1] of the ray
+			size_t intersect(const Ray3 & ray, std::queue<const Octree *> & hitboxes) const;
+			size_t overlap(const AABB3 & box, std::queue<const Octree *> & hitboxes) const;
+			// closest hit along o + t*dir for t in [0, 1], or infinity; sets hit_id on a hit
+			float intersect_ray(const CollisionGeometry & geometry, Vector3 o, Vector3 dir, uint32_t & hit_id) const;
 			size_t find(uint32_t id, std::queue<const Octree *> & hitboxes) const;
 
+			// used by intersect: the descent below a node the ray is known to hit
+			size_t intersect_branches(const Ray3 & ray, std::queue<const Octree *> & hitboxes) const;
+
 			void take_inventory(std::vector<bool> & inventory) const
 #ifdef _DEBUG
 			;
@@ -77,8 +108,7 @@ namespace Physics
 #endif
 		};
 
-		const Triangle3 * triangles;
-		const uint32_t num_triangles;
+		const CollisionGeometry geometry;
 
 		Octree octree;
 		Graphics::Wireframe & wireframe;
@@ -86,10 +116,17 @@ namespace Physics
 		bool debug_octree = false;
 
 		static Terrain * FromBinFile(const char * collision_mesh_path, Vector3 scale, Graphics::Wireframe & wireframe);
-		Terrain(const Graphics::Mesh::Data &, Vector3 scale, Graphics::Wireframe & wireframe);
-		~Terrain() { delete[] triangles; }
+		Terrain(CollisionMesh &&, Graphics::Wireframe & wireframe);
 
-		void init_octree() { octree.populate(triangles, num_triangles); }
+		// packed leaves trade ray speed for memory
+		void init_octree(bool pack_leaves = false)
+		{
+			octree.populate(geometry);
+			if (pack_leaves)
+				octree.pack(geometry);
+			else
+				octree.group(geometry);
+		}
 
 		void draw_octree(Graphics::Wireframe & wireframe)
 #ifdef _DEBUG
@@ -113,6 +150,16 @@ namespace Physics
 #endif
 
 
+		// these queries touch nothing shared, so any thread may run them
+
+		// closest hit along o + t*dir for t in [0, 1], or infinity
+		float trace_ray(Vector3 o, Vector3 dir, Vector3 * n = NULL, uint32_t * hit_id = NULL) const;
+		// first contact of a sphere moving from center to center + dir, as above
+		float sweep_sphere(Vector3 center, float radius, Vector3 dir, Vector3 * n = NULL) const;
+		// every triangle touching the box, without duplicates
+		void overlap(const AABB3 & box, std::vector<uint32_t> & ids) const;
+
+		// trace_ray, and highlight the triangle hit. game thread only
 		float intersect_ray(Vector3 o, Vector3 dir, Vector3 * n = NULL) const;
 	};
 }
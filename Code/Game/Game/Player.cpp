@@ -1,5 +1,7 @@
 #include "Player.h"
 
+#include "../../Engine/Math/FastMath.h"
+
 #include <cassert>
 
 
@@ -38,7 +40,7 @@ void Player::update(Controls controls, float dt)
 		Vector3 target_dir = float_cam.rotation.rotate(joy_dir);
 		target_dir.y = 0;
 		target_dir.normalize();
-		float target_yaw = -atan2f(target_dir.x, -target_dir.z);
+		float target_yaw = -FastMath::atan2<FastMath::Medium>(target_dir.x, -target_dir.z);
 		float pi = 3.1415926f, tau = pi * 2;
 		float yaw_diff = target_yaw - yaw;
 		if (yaw_diff < 0) yaw_diff += tau;
@@ -50,7 +52,7 @@ void Player::update(Controls controls, float dt)
 		dir = head_cam.rotation.rotate(-Vector3::K);
 	}
 
-	grounded = move((dir * speed + velocity) * dt, *terrain);
+	grounded = move(Vector3::madd(velocity, dir, speed) * dt, *terrain);
 	if (grounded)
 		velocity.y = 0;
 
@@ -59,7 +61,7 @@ void Player::update(Controls controls, float dt)
 	disp.y = 0;
 	if (dir.z != 0 && dir.x != 0)
 	{
-		yaw = -atan2f(dir.x, -dir.z);
+		yaw = -FastMath::atan2<FastMath::Medium>(dir.x, -dir.z);
 	}
 
 	// cameras
@@ -87,7 +89,10 @@ void Player::remote_update(const Vector3 & pos, float rot)
 void Player::update_cam()
 {
 	head_cam.position = position;
-	head_cam.rotation = Versor::rotation_y(yaw);
+	// Versor::rotation_y with the fast sine, since this runs every frame for every player
+	float s, c;
+	FastMath::sincos<FastMath::Medium>(yaw * 0.5f, s, c);
+	head_cam.rotation = Versor(0.0f, s, 0.0f, c);
 }
 
 #ifdef _DEBUG
@@ -99,11 +104,11 @@ void Player::draw_debug(Graphics::Wireframe & wireframe)
 
 	Vector3 dir = head_cam.rotation.rotate(-Vector3::K);
 	Vector3 perp = dir.cross(Vector3::J);
-	Vector3 carrot_base = position + dir * (height / 5);
-	Vector3 carrot_tip = position + dir * (height / 2);
+	Vector3 carrot_base = Vector3::madd(position, dir, height / 5);
+	Vector3 carrot_tip = Vector3::madd(position, dir, height / 2);
 	Graphics::Color carrot_orange(1.0f, 0.7f, 0.2f, 1.0f);
 
-	wireframe.addLine(carrot_base + Vector3::J * (height / 16), carrot_orange, carrot_tip, carrot_orange);
+	wireframe.addLine(Vector3::madd(carrot_base, Vector3::J, height / 16), carrot_orange, carrot_tip, carrot_orange);
 	wireframe.addLine(carrot_base + perp * (height / 16), carrot_orange, carrot_tip, carrot_orange);
 	wireframe.addLine(carrot_base - perp * (height / 16), carrot_orange, carrot_tip, carrot_orange);
 }
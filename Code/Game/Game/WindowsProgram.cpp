@@ -19,8 +19,19 @@ This file contains all of the function definitions for this example program
 // Graphics.h contains engine functions that perform all necessary
 // graphics API calls during gameplay
 #include "../../Engine/Graphics/Graphics.h"
-
+#include "../../Engine/Graphics/RenderQueue.h"
+#include "../../Engine/Graphics/Rasterizer.h"
+
+#include "../../Engine/Math/Affine3.h"
+#include "../../Engine/Math/Batch.h"
+#include "../../Engine/Math/Pack.h"
+#include "../../Engine/Math/FastMath.h"
+#include "../../Engine/Math/SpatialKey.h"
 #include "../../Engine/Physics/Terrain.h"
+#include "../../Engine/Physics/NavGraph.h"
+#include "../../Engine/Physics/DistanceField.h"
+#include "../../Engine/Physics/QueryService.h"
+#include "../../Engine/Physics/CollisionScene.h"
 #include "../../Engine/Time/Time.h"
 #include "../../Engine/UserInput/UserInput.h"
 
@@ -67,7 +78,9 @@ namespace
 
 	Sprite::Rect standardUV = { 0.0f, 0.0f, 1.0f, 1.0f };
 
-	const char * terrain_file = "data/ctf_collision.vib";
+	const char * terrain_file = "data/ctf_collision.cib";
+	const char * nav_file = "data/ctf_collision.nvb";
+	const char * sdf_file = "data/ctf_collision.sdb";
 	const char * mesh_files[] =
 	{ "data/ctf_ceiling.vib"
 	, "data/ctf_cement.vib"
@@ -103,9 +116,13 @@ namespace
 	Material ** materials;
 	Model ** models;
 	size_t num_models;
+	Graphics::RenderQueue * render_queue;
 	Sprite ** sprites;
 	size_t num_sprites;
 	Physics::Terrain * terrain;
+	Physics::NavGraph * nav_graph;
+	Physics::DistanceField * distance_field;
+	Physics::QueryService * queries;
 
 	FlyCam * fly_cam;
 	GameState * game_state;
@@ -121,6 +138,7 @@ namespace
 
 	std::string * fps_display;
 	std::string * pos_display;
+	std::string * state_display;
 
 	struct {
 		const float radius_min = 1.0f;
@@ -145,6 +163,24 @@ namespace
 		}
 	} debug_ray;
 
+	struct {
+		const float radius = 8.0f;
+		bool active;
+		// shows the graph around the camera, and the path from the local player to the fly cam
+		void draw(Wireframe & wireframe)
+		{
+			if (!active || nav_graph == NULL) return;
+			nav_graph->draw(active_cam->position, radius, wireframe);
+
+			if (!game_state->active()) return;
+			std::vector<Vector3> path;
+			Color color(1.0f, 0.2f, 0.8f, 1.0f);
+			if (nav_graph->find_path(game_state->local_player()->position, fly_cam->fly_cam.position, path))
+				for (size_t i = 1; i < path.size(); ++i)
+					wireframe.addLine(path[i - 1], color, path[i], color);
+		}
+	} debug_nav;
+
 	void debug_sphere_reset() { debug_sphere.reset(); }
 	void camera_reset()
 	{
@@ -290,13 +326,38 @@ bool CreateMainWindow(const HINSTANCE i_thisInstanceOfTheProgram, const int i_in
 		materials = LoadMaterials(material_files);
 		models = BuildModels(model_specs, meshes, materials, num_models);
 		sprites = BuildSprites(sprite_specs, materials, num_sprites);
+		render_queue = new Graphics::RenderQueue();
 
 		wireframe = new Wireframe(materials[0]);
 		eae6320::Graphics::InitWireframe(*wireframe);
 
 		terrain = Physics::Terrain::FromBinFile(terrain_file, cm, *wireframe);
+		if (terrain == NULL)
+		{
+			goto OnError;
+		}
 
+		Matrix4::test();
+		Affine3::test();
+		Batch::test();
+		AABB3A::test();
+		Ray3::test();
+		Triangle3::test();
+		SpatialKey::test();
+		Pack::test();
+		FastMath::test();
+		Graphics::RenderQueue::test();
+		Graphics::Rasterizer::test();
 		terrain->test_octree();
+		Physics::CollisionScene::test();
+
+		queries = new Physics::QueryService(*terrain);
+		queries->test();
+
+		nav_graph = Physics::NavGraph::FromBinFile(nav_file, cm);
+		distance_field = Physics::DistanceField::FromBinFile(sdf_file, cm.x);
+		if (distance_field != NULL)
+			distance_field->test(terrain->geometry);
 
 		fly_cam = new FlyCam(Vector3(1.f, 1.f, 1.01f), 3.14159265f, camera_track_speed, camera_pan_speed);
 
@@ -312,10 +373,12 @@ bool CreateMainWindow(const HINSTANCE i_thisInstanceOfTheProgram, const int i_in
 
 		fps_display = new std::string;
 		pos_display = new std::string;
+		state_display = new std::string;
 
 		debug_menu = new DebugMenu();
 		debug_menu->add_text("fps", *fps_display);
 		debug_menu->add_text("fly_cam.position", *pos_display);
+		debug_menu->add_text("graphics.state_calls", *state_display);
 		debug_menu->add_button("fly_cam.reset", camera_reset);
 		debug_menu->add_checkbox("debug_sphere.active", debug_sphere.active);
 		debug_menu->add_slider("debug_sphere.radius",
@@ -323,6 +386,7 @@ bool CreateMainWindow(const HINSTANCE i_thisInstanceOfTheProgram, const int i_in
 		debug_menu->add_button("debug_sphere.reset", debug_sphere_reset);
 		debug_menu->add_checkbox("terrain.debug_octree", terrain->debug_octree);
 		debug_menu->add_checkbox("debug_ray.active", debug_ray.active);
+		debug_menu->add_checkbox("debug_nav.active", debug_nav.active);
 
 		return true;
 
@@ -589,7 +653,10 @@ bool CleanupMainWindow()
 			return false;
 		}
 
+		delete queries;
 		delete terrain;
+		delete nav_graph;
+		delete distance_field;
 
 		for (size_t i = countof(model_specs); i > 0; --i)
 			delete models[i - 1];
@@ -597,6 +664,7 @@ bool CleanupMainWindow()
 		delete[] materials;
 		delete[] meshes;
 		delete[] sprites;
+		delete render_queue;
 
 		delete wireframe;
 		delete debug_menu;
@@ -730,14 +798,12 @@ void Render()
 	BeginFrame();
 
 	for (size_t i = 0; i < num_models; ++i)
-		if (!models[i]->mat->effect->render_state.alpha)
-			DrawModel(*models[i], *active_cam);
-	for (size_t i = 0; i < num_models; ++i)
-		if (models[i]->mat->effect->render_state.alpha)
-			DrawModel(*models[i], *active_cam);
+		render_queue->add(*models[i]);
+	render_queue->submit(*active_cam);
 
 	debug_sphere.draw(*wireframe);
 	debug_ray.draw(*wireframe);
+	debug_nav.draw(*wireframe);
 	terrain->draw_octree(*wireframe);
 
 	for (size_t i = 0; i < game_state->max_players; ++i)
@@ -753,6 +819,13 @@ void Render()
 
 	fps_display->swap(std::to_string(Time::GetFramesPerSecond()));
 
+	{
+		const Graphics::StateCache::Counters & calls = Graphics::GetStateCache().last_frame;
+		std::ostringstream oss;
+		oss << calls.issued << " issued, " << calls.skipped << " skipped";
+		state_display->swap(oss.str());
+	}
+
 	if (game_state->local_player() != NULL)
 	{
 		std::ostringstream oss;
@@ -809,6 +882,9 @@ bool WaitForMainWindowToClose(int& o_exitCode)
 			Time::OnNewFrame();
 			float dt = Time::GetSecondsElapsedThisFrame();
 
+			// results of last tick's asynchronous queries
+			queries->dispatch();
+
 			Vector2 joy_left = Vector2::Zero;
 			Vector2 joy_right = Vector2::Zero;
 			if (UserInput::IsKeyPressed('W')) joy_left += Vector2::J;
@@ -827,6 +903,7 @@ bool WaitForMainWindowToClose(int& o_exitCode)
 					if (game_state->active())
 					{
 						game_state->local_player()->terrain = terrain;
+						game_state->local_player()->float_cam.field = distance_field;
 						active_cam = &game_state->local_player()->float_cam;
 						active_controller = game_state->local_player();
 					}
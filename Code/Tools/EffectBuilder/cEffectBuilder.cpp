@@ -115,6 +115,18 @@ bool LoadFXT(const char * in_path, Effect::Spec &spec)
 		spec.fragment_shd_path = lua_tostring(luaState, -1);
 		lua_pop(luaState, 1); // pop fragment shader path
 
+		// optional vertex shader for instanced draws
+		lua_getfield(luaState, -1, "instanced");
+		if (lua_isstring(luaState, -1))
+			spec.instanced_vertex_shd_path = lua_tostring(luaState, -1);
+		else if (!lua_isnil(luaState, -1))
+		{
+			eae6320::UserOutput::Print("'instanced' must be a path\n");
+			lua_pop(luaState, 2);
+			return false;
+		}
+		lua_pop(luaState, 1); // pop instanced shader path
+
 		lua_getfield(luaState, -1, "flags");
 
 		//default render state
@@ -174,6 +186,12 @@ bool SaveFXB(const char * out_path, const Effect::Spec & spec)
 	outfile.write(spec.vertex_shd_path.c_str(), vertex_path_len);
 	outfile.write(spec.fragment_shd_path.c_str(), fragment_path_len);
 
+	// 0 when the effect has no instanced vertex shader
+	uint16_t instanced_path_len = spec.instanced_vertex_shd_path.empty()
+		? 0 : static_cast<uint16_t>(spec.instanced_vertex_shd_path.size() + 1);
+	outfile.write(reinterpret_cast<const char *>(&instanced_path_len), sizeof(uint16_t));
+	outfile.write(spec.instanced_vertex_shd_path.c_str(), instanced_path_len);
+
 	outfile.close();
 
 	if (outfile.fail())
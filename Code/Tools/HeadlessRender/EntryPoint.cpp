@@ -0,0 +1,496 @@
+/*
+	Runs the render path on the null graphics backend (EAE6320_PLATFORM_NULL): no window, no GPU
+
+	First it draws a known scene through RenderQueue and CommandBuffer and checks the commands
+	the NullDevice recorded and its counters against what that scene has to produce: one
+	instanced draw for the many copies of one material and mesh, the alpha models back to
+	front, and nothing the StateCache should have skipped in the frames after the first.
+	The exit code is the number of failed checks, so it can gate a build.
+	Then it times submit() over a larger scene of several materials and meshes.
+
+	The shaders, effects, materials and texture it draws with are written to the working
+	directory as it starts, in the formats the builders write, so no built assets are needed.
+	In Visual Studio, build the HeadlessRender project. On Linux, the CMakeLists.txt at the
+	root of the repository builds it, and ctest runs its checks:
+		cmake -S . -B build && cmake --build build -j && ctest --test-dir build
+	Built for Debug, it also runs RenderQueue's and Rasterizer's own tests and asserts.
+
+	usage: HeadlessRender [--frames n] [--models n] [--raster widthxheight] [--tga path]
+	--raster also draws every frame with the software Rasterizer, and checks what it drew
+	--tga writes the rasterizer's last frame
+*/
+
+// Header Files
+//=============
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../../Engine/Debug_Runtime/UserOutput.h"
+#include "../../Engine/Graphics/Graphics.h"
+#include "../../Engine/Graphics/Material.h"
+#include "../../Engine/Graphics/NullDevice.h"
+#include "../../Engine/Graphics/Rasterizer.h"
+#include "../../Engine/Graphics/RenderQueue.h"
+
+// Helper Function Declarations
+//=============================
+
+namespace
+{
+	using namespace eae6320;
+	using namespace eae6320::Graphics;
+
+	// the scene the checks expect
+	const uint32_t CHECK_CUBES = 3000, CHECK_GLASS = 4;
+	const uint32_t CUBE_TRIANGLES = 12, QUAD_TRIANGLES = 2;
+
+	struct Options
+	{
+		unsigned frames;
+		unsigned models;
+		uint32_t width, height;
+		const char * tga;
+	};
+
+	// what the scenes draw with
+	struct Assets
+	{
+		Mesh cube, quad;
+		// red and green use the opaque effect, glass the alpha one
+		Material * red, * green, * glass;
+	};
+
+	// counts the failures, in release builds too
+	unsigned s_failures;
+
+	void Check(bool i_condition, const char * i_what);
+	bool ParseOptions(int i_argumentCount, char ** i_arguments, Options & o_options);
+
+	// fixtures
+	void WriteFixtures();
+	void WriteEffect(const char * i_path, Effect::RenderState i_state, const char * i_instancedShader);
+	void WriteMaterial(const char * i_path, const char * i_effect, const char * i_name, const float * i_vec,
+		uint8_t i_length, const char * i_texture);
+	void WriteDds(const char * i_path);
+	void WritePath(std::ofstream & io_file, const char * i_path);
+	void MakeMesh(Mesh & o_mesh, const float (* i_positions)[3], uint32_t i_vertexCount,
+		const Mesh::Index * i_indices, uint32_t i_triangleCount);
+	bool LoadAssets(Assets & o_assets);
+
+	void CheckScene(Assets & i_assets, Rasterizer * i_rasterizer);
+	void CheckFrame(const std::vector<NullDevice::Command> & i_commands, const Assets & i_assets,
+		const RenderQueue & i_queue);
+	double BenchmarkSubmit(Assets & i_assets, const Options & i_options);
+	uint32_t Count(const std::vector<NullDevice::Command> & i_commands, NullDevice::Op i_op);
+	uint64_t Hash(const Rasterizer & i_rasterizer);
+}
+
+// the engine reports errors through this; a console tool prints them
+void eae6320::UserOutput::Print(std::string i_output, std::string i_fileName)
+{
+	fprintf(stderr, "%s: %s\n", i_fileName.c_str(), i_output.c_str());
+}
+
+// Entry Point
+//============
+
+int main(int i_argumentCount, char ** i_arguments)
+{
+	Options options = { 100, 10000, 0, 0, NULL };
+	if (!ParseOptions(i_argumentCount, i_arguments, options))
+	{
+		fprintf(stderr, "usage: HeadlessRender [--frames n] [--models n] [--raster widthxheight] [--tga path]\n");
+		return -1;
+	}
+
+	RenderQueue::test();
+	Rasterizer::test();
+
+	// attached before the assets load, so that the texture is decoded for it
+	Rasterizer * rasterizer = options.width ? new Rasterizer(options.width, options.height) : NULL;
+	NullDevice & device = GetNullDevice();
+	device.rasterizer = rasterizer;
+
+	WriteFixtures();
+	Initialize(NULL);
+	Assets assets = {};
+	if (!LoadAssets(assets))
+	{
+		fprintf(stderr, "couldn't load the fixtures\n");
+		return -1;
+	}
+
+	CheckScene(assets, rasterizer);
+	if (rasterizer && options.tga && !rasterizer->WriteTga(options.tga))
+		Check(false, "the rasterizer's frame couldn't be written");
+
+	double ms = BenchmarkSubmit(assets, options);
+	printf("%u models, %u frames: %.3f ms per frame, %u draws, %u instances, %u uniforms, %u textures per frame\n",
+		options.models, options.frames, ms, device.counters.draws / options.frames,
+		device.counters.instances / options.frames, device.counters.uniforms / options.frames,
+		device.counters.textures / options.frames);
+
+	delete assets.red;
+	delete assets.green;
+	delete assets.glass;
+	ShutDown();
+	device.rasterizer = NULL;
+	delete rasterizer;
+
+	if (s_failures)
+		printf("%u checks failed\n", s_failures);
+	else
+		printf("all checks passed\n");
+	return static_cast<int>(s_failures);
+}
+
+// Helper Function Definitions
+//============================
+
+namespace
+{
+	void Check(bool i_condition, const char * i_what)
+	{
+		if (i_condition)
+			return;
+		fprintf(stderr, "FAILED: %s\n", i_what);
+		++s_failures;
+	}
+
+	bool ParseOptions(int i_argumentCount, char ** i_arguments, Options & o_options)
+	{
+		for (int i = 1; i < i_argumentCount; ++i)
+		{
+			const char * argument = i_arguments[i];
+			const char * value = i + 1 < i_argumentCount ? i_arguments[i + 1] : NULL;
+			if (!value)
+				return false;
+			++i;
+
+			if (strcmp(argument, "--frames") == 0)
+				o_options.frames = static_cast<unsigned>(strtoul(value, NULL, 10));
+			else if (strcmp(argument, "--models") == 0)
+				o_options.models = static_cast<unsigned>(strtoul(value, NULL, 10));
+			else if (strcmp(argument, "--tga") == 0)
+				o_options.tga = value;
+			else if (strcmp(argument, "--raster") == 0)
+			{
+				unsigned width = 0, height = 0;
+				if (sscanf(value, "%ux%u", &width, &height) != 2)
+					return false;
+				o_options.width = width;
+				o_options.height = height;
+				if (width == 0 || height == 0 || width > Rasterizer::MAXSIZE || height > Rasterizer::MAXSIZE)
+					return false;
+			}
+			else
+				return false;
+		}
+		return o_options.frames > 0;
+	}
+
+	void WriteFixtures()
+	{
+		// the null backend only looks through shaders for the transform uniforms' names
+		std::ofstream("headless_vertex.shb") << "g_local2world g_world2view g_view2screen";
+		std::ofstream("headless_instanced.shb") << "g_world2view g_view2screen";
+		std::ofstream("headless_fragment.shb") << "g_tint g_alpha g_tex";
+
+		Effect::RenderState opaque = {}, alpha = {};
+		opaque.z_test = opaque.z_write = opaque.cull_back = true;
+		alpha.alpha = alpha.z_test = alpha.cull_back = true;
+		WriteEffect("headless_opaque.fxb", opaque, "headless_instanced.shb");
+		WriteEffect("headless_alpha.fxb", alpha, NULL);
+
+		const float red[] = { 1.0f, 0.2f, 0.2f }, green[] = { 0.2f, 1.0f, 0.2f }, half[] = { 0.5f };
+		WriteMaterial("headless_red.mtb", "headless_opaque.fxb", "g_tint", red, 3, NULL);
+		WriteMaterial("headless_green.mtb", "headless_opaque.fxb", "g_tint", green, 3, NULL);
+		WriteMaterial("headless_glass.mtb", "headless_alpha.fxb", "g_alpha", half, 1, "headless_glass.dds");
+		WriteDds("headless_glass.dds");
+	}
+
+	// as EffectBuilder: the render state, the vertex and fragment shader paths, then the instanced one
+	void WriteEffect(const char * i_path, Effect::RenderState i_state, const char * i_instancedShader)
+	{
+		std::ofstream file(i_path, std::ofstream::binary);
+		const char * vertex = "headless_vertex.shb", * fragment = "headless_fragment.shb";
+		file.write(reinterpret_cast<const char *>(&i_state), sizeof(i_state));
+		uint16_t lengths[] = { static_cast<uint16_t>(strlen(vertex) + 1), static_cast<uint16_t>(strlen(fragment) + 1) };
+		file.write(reinterpret_cast<const char *>(lengths), sizeof(lengths));
+		file.write(vertex, lengths[0]);
+		file.write(fragment, lengths[1]);
+		WritePath(file, i_instancedShader ? i_instancedShader : "");
+	}
+
+	// as MaterialBuilder: the effect, one vec parameter, and one texture if there is one.
+	// a parameter's handle is the offset of its name in the strings after the parameters
+	void WriteMaterial(const char * i_path, const char * i_effect, const char * i_name, const float * i_vec,
+		uint8_t i_length, const char * i_texture)
+	{
+		std::ofstream file(i_path, std::ofstream::binary);
+		uint16_t header[] = { static_cast<uint16_t>(strlen(i_effect) + 1), static_cast<uint16_t>(i_texture ? 2 : 1) };
+		file.write(reinterpret_cast<const char *>(header), sizeof(header));
+		file.write(i_effect, header[0]);
+
+		std::string names = std::string(i_name) + '\0';
+		Material::UniformParameter params[2] = {};
+		params[0].shaderType = Effect::Fragment;
+		std::copy(i_vec, i_vec + i_length, params[0].vec);
+		params[0].vec_length = i_length;
+		if (i_texture)
+		{
+			params[1].handle = static_cast<Effect::UniformHandle>(names.size());
+			params[1].shaderType = Effect::Fragment;
+			names += std::string("g_tex") + '\0' + i_texture + '\0';
+		}
+		file.write(reinterpret_cast<const char *>(params), header[1] * sizeof(Material::UniformParameter));
+		file.write(names.data(), names.size());
+	}
+
+	// one 4x4 DXT1 block: a pale blue top half over a white bottom half
+	void WriteDds(const char * i_path)
+	{
+		uint32_t header[32] = {};
+		memcpy(&header[0], "DDS ", 4);
+		header[1] = 124;
+		header[2] = 0x1007;		// caps, height, width, pixel format
+		header[3] = header[4] = 4;
+		header[19] = 32;
+		header[20] = 0x4;		// the four CC is set
+		memcpy(&header[21], "DXT1", 4);
+		header[27] = 0x1000;	// a texture
+		const uint16_t colors[] = { 0xffff, 0xa65f };
+		const uint32_t indices = 0x00005555;
+		std::ofstream file(i_path, std::ofstream::binary);
+		file.write(reinterpret_cast<const char *>(header), sizeof(header));
+		file.write(reinterpret_cast<const char *>(colors), sizeof(colors));
+		file.write(reinterpret_cast<const char *>(&indices), sizeof(indices));
+	}
+
+	void WritePath(std::ofstream & io_file, const char * i_path)
+	{
+		uint16_t length = static_cast<uint16_t>(strlen(i_path) + (*i_path ? 1 : 0));
+		io_file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+		io_file.write(i_path, length);
+	}
+
+	void MakeMesh(Mesh & o_mesh, const float (* i_positions)[3], uint32_t i_vertexCount,
+		const Mesh::Index * i_indices, uint32_t i_triangleCount)
+	{
+		// Data owns and frees its arrays
+		Mesh::Data data;
+		data.vertices = new Mesh::Vertex[i_vertexCount]();
+		data.indices = new Mesh::Index[3 * i_triangleCount];
+		data.num_vertices = i_vertexCount;
+		data.num_triangles = i_triangleCount;
+		for (uint32_t i = 0; i < i_vertexCount; ++i)
+		{
+			Mesh::Vertex & vertex = data.vertices[i];
+			vertex.position = Vector3(i_positions[i][0], i_positions[i][1], i_positions[i][2]);
+			vertex.u = i_positions[i][0] + 0.5f;
+			vertex.v = 0.5f - i_positions[i][1];
+			vertex.r = vertex.g = vertex.b = vertex.a = 255;
+		}
+		std::copy(i_indices, i_indices + 3 * i_triangleCount, data.indices);
+		LoadMesh(o_mesh, data);
+	}
+
+	bool LoadAssets(Assets & o_assets)
+	{
+		// a unit cube and a unit quad facing +z, counterclockwise seen from outside
+		const float cube[8][3] = {
+			{ -0.5f, -0.5f, -0.5f }, { 0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, -0.5f }, { -0.5f, 0.5f, -0.5f },
+			{ -0.5f, -0.5f, 0.5f }, { 0.5f, -0.5f, 0.5f }, { 0.5f, 0.5f, 0.5f }, { -0.5f, 0.5f, 0.5f },
+		};
+		const Mesh::Index cubeIndices[3 * CUBE_TRIANGLES] = {
+			4, 5, 6, 4, 6, 7,	1, 0, 3, 1, 3, 2,
+			5, 1, 2, 5, 2, 6,	0, 4, 7, 0, 7, 3,
+			7, 6, 2, 7, 2, 3,	0, 1, 5, 0, 5, 4,
+		};
+		const float quad[4][3] = {
+			{ -0.5f, -0.5f, 0.0f }, { 0.5f, -0.5f, 0.0f }, { 0.5f, 0.5f, 0.0f }, { -0.5f, 0.5f, 0.0f },
+		};
+		const Mesh::Index quadIndices[3 * QUAD_TRIANGLES] = { 0, 1, 2, 0, 2, 3 };
+		MakeMesh(o_assets.cube, cube, 8, cubeIndices, CUBE_TRIANGLES);
+		MakeMesh(o_assets.quad, quad, 4, quadIndices, QUAD_TRIANGLES);
+
+		o_assets.red = Material::FromFile("headless_red.mtb", GetDevice());
+		o_assets.green = Material::FromFile("headless_green.mtb", GetDevice());
+		o_assets.glass = Material::FromFile("headless_glass.mtb", GetDevice());
+		return o_assets.red && o_assets.green && o_assets.glass && o_assets.red->effect->instanced;
+	}
+
+	// CHECK_CUBES red cubes in a wall, one green cube in front of it, and CHECK_GLASS glass quads
+	// in front of that, one behind the other
+	void CheckScene(Assets & i_assets, Rasterizer * i_rasterizer)
+	{
+		std::vector<Model> models;
+		models.reserve(CHECK_CUBES + 1 + CHECK_GLASS);
+		for (uint32_t i = 0; i < CHECK_CUBES; ++i)
+			models.push_back(Model(i_assets.cube, *i_assets.red,
+				Vector3(static_cast<float>(i % 60) - 29.5f, static_cast<float>(i / 60) - 24.5f, -40.0f)));
+		models.push_back(Model(i_assets.cube, *i_assets.green, Vector3(0.0f, 0.0f, -10.0f)));
+		// added nearest first, so the queue has to reverse them
+		for (uint32_t i = 0; i < CHECK_GLASS; ++i)
+			models.push_back(Model(i_assets.quad, *i_assets.glass,
+				Vector3(0.2f * i, 0.0f, -5.0f - static_cast<float>(i)), Vector3(4.0f, 4.0f, 1.0f)));
+
+		NullDevice & device = GetNullDevice();
+		RenderQueue queue;
+		Camera camera(Vector3::Zero);
+		std::vector<NullDevice::Command> frames[3];
+		uint64_t hashes[3] = {};
+		device.recording = true;
+		for (unsigned frame = 0; frame < 3; ++frame)
+		{
+			device.clear();
+			Clear();
+			BeginFrame();
+			for (Model & model : models)
+				queue.add(model);
+			queue.submit(camera);
+			EndFrame();
+
+			frames[frame] = device.commands;
+			CheckFrame(frames[frame], i_assets, queue);
+			Check(device.counters.frames == 1, "one frame counted");
+			Check(device.counters.draws == 6, "6 draws: the red cubes, the green cube and each glass quad");
+			Check(device.counters.instances == CHECK_CUBES, "the red cubes counted as instances");
+			Check(device.counters.triangles == (CHECK_CUBES + 1) * CUBE_TRIANGLES + CHECK_GLASS * QUAD_TRIANGLES,
+				"every triangle counted");
+			Check(device.counters.textures == (frame == 0 ? 1u : 0u), "the glass texture bound once");
+			if (i_rasterizer)
+				hashes[frame] = Hash(*i_rasterizer);
+		}
+		device.recording = false;
+		device.clear();
+
+		// the state cache carries across frames: once the constant uniforms are set, later
+		// frames set only what changes between draws, and all of them set the same
+		Check(Count(frames[1], NullDevice::SetUniform) < Count(frames[0], NullDevice::SetUniform),
+			"the cache skipped the uniforms the first frame already set");
+		bool same = frames[1].size() == frames[2].size();
+		for (size_t i = 0; same && i < frames[1].size(); ++i)
+			same = frames[1][i].op == frames[2][i].op && frames[1][i].object == frames[2][i].object
+				&& frames[1][i].count == frames[2][i].count;
+		Check(same, "the second and third frames recorded the same commands");
+
+		if (i_rasterizer)
+		{
+			const Rasterizer::Stats & stats = i_rasterizer->stats;
+			Check(stats.pixels > 0, "the rasterizer drew");
+			Check(stats.culled > 0, "the rasterizer culled the cubes' back faces");
+			Check(hashes[0] == hashes[1] && hashes[1] == hashes[2], "the rasterizer drew the same frame each time");
+			// the green cube hides the middle of the wall
+			Check(!i_rasterizer->visible(AABB3(Vector3(-0.1f, -0.1f, -40.5f), Vector3(0.1f, 0.1f, -39.5f)), device.world2screen),
+				"the wall behind the green cube hidden");
+			Check(i_rasterizer->visible(AABB3(Vector3(-0.1f, -0.1f, -9.6f), Vector3(0.1f, 0.1f, -9.4f)), device.world2screen),
+				"the green cube's front visible");
+		}
+	}
+
+	void CheckFrame(const std::vector<NullDevice::Command> & i_commands, const Assets & i_assets,
+		const RenderQueue & i_queue)
+	{
+		Check(!i_commands.empty() && i_commands.front().op == NullDevice::Clear, "the frame starts with Clear");
+		Check(i_commands.size() > 1 && i_commands[1].op == NullDevice::BeginFrame, "then BeginFrame");
+		Check(!i_commands.empty() && i_commands.back().op == NullDevice::EndFrame, "and ends with EndFrame");
+
+		// the draws, in order: the opaque pass, red before green as the queue first saw them,
+		// then the glass from the farthest in
+		std::vector<NullDevice::Command> draws;
+		for (const NullDevice::Command & command : i_commands)
+			if (command.op == NullDevice::DrawMesh || command.op == NullDevice::DrawMeshInstanced)
+				draws.push_back(command);
+		bool order = draws.size() == 2 + CHECK_GLASS
+			&& draws[0].op == NullDevice::DrawMeshInstanced && draws[0].object == i_assets.cube.null_id
+			&& draws[0].count == CHECK_CUBES
+			&& draws[1].op == NullDevice::DrawMesh && draws[1].object == i_assets.cube.null_id
+			&& draws[1].count == CUBE_TRIANGLES;
+		for (size_t i = 2; order && i < draws.size(); ++i)
+			order = draws[i].op == NullDevice::DrawMesh && draws[i].object == i_assets.quad.null_id;
+		Check(order, "the instanced red cubes, the green cube, then the glass quads");
+
+		// each material loads its own copy of its effect, and the red cubes draw with the instanced variant of theirs
+		std::vector<uint32_t> effects;
+		for (const NullDevice::Command & command : i_commands)
+			if (command.op == NullDevice::SetEffect)
+				effects.push_back(command.object);
+		Check(effects.size() == 3 && effects[0] == i_assets.red->effect->instanced->parent
+			&& effects[1] == i_assets.green->effect->parent && effects[2] == i_assets.glass->effect->parent,
+			"the red instanced, green and glass effects set once each");
+		// the first frame starts from no state, and the later ones from the alpha pass's
+		Check(Count(i_commands, NullDevice::SetRenderState) == 2,
+			"the render state set for the opaque pass and for the alpha pass");
+
+		const RenderQueue::Stats & stats = i_queue.stats;
+		Check(stats.draws == 2 + CHECK_GLASS && stats.instances == CHECK_CUBES, "the queue's draw stats");
+		Check(stats.effects == 3 && stats.materials == 3 && stats.meshes == 2, "the queue's state change stats");
+	}
+
+	// options.models models over the three materials and two meshes, in a grid around the camera,
+	// so that the queue sorts, instances and records on as many threads as it takes
+	double BenchmarkSubmit(Assets & i_assets, const Options & i_options)
+	{
+		Material * materials[] = { i_assets.red, i_assets.green, i_assets.glass };
+		Mesh * meshes[] = { &i_assets.cube, &i_assets.quad };
+		std::vector<Model> models;
+		models.reserve(i_options.models);
+		uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(i_options.models))));
+		for (uint32_t i = 0; i < i_options.models; ++i)
+		{
+			Vector3 position(static_cast<float>(i % side), static_cast<float>(i / side % side),
+				-static_cast<float>(i / (side * side)));
+			models.push_back(Model(*meshes[i / 7 % 2], *materials[i % 3],
+				position * 2.0f - Vector3(static_cast<float>(side), static_cast<float>(side), 2.0f)));
+		}
+
+		NullDevice & device = GetNullDevice();
+		RenderQueue queue;
+		Camera camera(Vector3::Zero);
+		device.clear();
+		typedef std::chrono::high_resolution_clock Clock;
+		Clock::time_point start = Clock::now();
+		for (unsigned frame = 0; frame < i_options.frames; ++frame)
+		{
+			Clear();
+			BeginFrame();
+			for (Model & model : models)
+				queue.add(model);
+			queue.submit(camera);
+			EndFrame();
+		}
+		std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+		return elapsed.count() / i_options.frames;
+	}
+
+	uint32_t Count(const std::vector<NullDevice::Command> & i_commands, NullDevice::Op i_op)
+	{
+		uint32_t count = 0;
+		for (const NullDevice::Command & command : i_commands)
+			count += command.op == i_op;
+		return count;
+	}
+
+	// FNV-1a over the visible pixels, for comparing frames
+	uint64_t Hash(const Rasterizer & i_rasterizer)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (uint32_t y = 0; y < i_rasterizer.height; ++y)
+		{
+			const uint32_t * row = i_rasterizer.colors() + y * i_rasterizer.pitch();
+			for (uint32_t x = 0; x < i_rasterizer.width; ++x)
+				hash = (hash ^ row[x]) * 1099511628211ull;
+		}
+		return hash;
+	}
+}
@@ -0,0 +1,639 @@
+/*
+	Microbenchmarks for the Math library
+
+	Every benchmark runs in one or both of two modes:
+		latency: each call takes its input from the previous call's result, so this is one call's cost
+		throughput: independent calls over arrays, as fast as the core (and the SIMD width) allow
+	and reports ns per op and ops per TSC tick. The TSC counts at the nominal clock,
+	so with turbo on ops/tick overstates ops/cycle somewhat; compare runs on one machine.
+
+	The SIMD paths are picked at compile time (see Simd.h), so scalar and SIMD variants
+	are separate builds. In Visual Studio, build the MathBenchmark project in Release.
+	On Linux, the CMakeLists.txt at the root of the repository builds one per variant,
+	MathBenchmark_scalar, MathBenchmark_sse and MathBenchmark_avx (AVX2, BMI2 and F16C):
+		cmake -S . -B build && cmake --build build -j
+
+	usage: MathBenchmark [name filter] [--json path]
+	--json writes one result per line, in a fixed order, to diff between builds
+*/
+
+// Header Files
+//=============
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#include <malloc.h>
+#elif defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+
+#include "../../Engine/Math/Affine3.h"
+#include "../../Engine/Math/Batch.h"
+#include "../../Engine/Math/FastMath.h"
+#include "../../Engine/Math/Matrix4.h"
+#include "../../Engine/Math/Ray3.h"
+#include "../../Engine/Math/Triangle3.h"
+#include "../../Engine/Math/Versor.h"
+
+// Helper Function Declarations
+//=============================
+
+namespace
+{
+	using namespace eae6320;
+
+	// a power of two, so that latency chains can wrap indices with a mask
+	const size_t ARRAY_SIZE = 1024;
+	const size_t ARRAY_MASK = ARRAY_SIZE - 1;
+	const double MIN_TRIAL_SECONDS = 0.02;
+	const int TRIALS = 5;
+
+	struct Result
+	{
+		std::string name;
+		const char * mode;
+		double nsPerOp;
+		double opsPerTick;
+	};
+
+	// results feed this so that the optimizer keeps the work
+	volatile float s_sink;
+
+	// std::allocator ignores alignas before C++17, and the Win32 heap gives only 8 bytes,
+	// so the arrays of Vector3A-based types get their alignment here
+	template <typename T>
+	struct AlignedAllocator
+	{
+		typedef T value_type;
+
+		AlignedAllocator() {}
+		template <typename U>
+		AlignedAllocator( const AlignedAllocator<U> & ) {}
+
+		T * allocate( size_t i_count )
+		{
+			void * memory = NULL;
+#if defined( _MSC_VER )
+			memory = _aligned_malloc( i_count * sizeof( T ), alignof( T ) );
+#else
+			if ( posix_memalign( &memory, alignof( T ) < sizeof( void * ) ? sizeof( void * ) : alignof( T ), i_count * sizeof( T ) ) != 0 )
+				memory = NULL;
+#endif
+			if ( !memory )
+				throw std::bad_alloc();
+			return static_cast<T *>( memory );
+		}
+
+		void deallocate( T * i_memory, size_t )
+		{
+#if defined( _MSC_VER )
+			_aligned_free( i_memory );
+#else
+			free( i_memory );
+#endif
+		}
+	};
+	template <typename T, typename U>
+	bool operator==( const AlignedAllocator<T> &, const AlignedAllocator<U> & ) { return true; }
+	template <typename T, typename U>
+	bool operator!=( const AlignedAllocator<T> &, const AlignedAllocator<U> & ) { return false; }
+
+	const char * SimdName()
+	{
+#if defined( EAE6320_AVX )
+		return "avx";
+#elif defined( EAE6320_SSE )
+		return "sse";
+#else
+		return "scalar";
+#endif
+	}
+
+	uint64_t Ticks()
+	{
+#if defined( _MSC_VER ) || defined( __x86_64__ ) || defined( __i386__ )
+		return __rdtsc();
+#else
+		return 0;
+#endif
+	}
+
+	// i_body( reps ) does reps * i_opsPerRep ops and returns something depending on all of them.
+	// the rep count doubles until a trial is long enough to time, then the best of TRIALS counts
+	template <typename tBody>
+	Result Measure( const std::string & i_name, const char * i_mode, size_t i_opsPerRep, tBody i_body )
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		size_t reps = 1;
+		for ( ;; )
+		{
+			Clock::time_point start = Clock::now();
+			s_sink = s_sink + i_body( reps );
+			if ( std::chrono::duration<double>( Clock::now() - start ).count() >= MIN_TRIAL_SECONDS )
+				break;
+			reps *= 2;
+		}
+
+		double bestNs = 1e300, bestTicks = 1e300;
+		for ( int trial = 0; trial < TRIALS; ++trial )
+		{
+			Clock::time_point start = Clock::now();
+			uint64_t startTicks = Ticks();
+			s_sink = s_sink + i_body( reps );
+			uint64_t ticks = Ticks() - startTicks;
+			double ns = std::chrono::duration<double, std::nano>( Clock::now() - start ).count();
+			bestNs = std::min( bestNs, ns );
+			bestTicks = std::min( bestTicks, static_cast<double>( ticks ) );
+		}
+
+		double ops = static_cast<double>( reps ) * i_opsPerRep;
+		Result result;
+		result.name = i_name;
+		result.mode = i_mode;
+		result.nsPerOp = bestNs / ops;
+		result.opsPerTick = bestTicks > 0 ? ops / bestTicks : 0.0;
+		return result;
+	}
+
+	struct Data
+	{
+		std::vector<Matrix4> matrices, rotations;
+		std::vector<Affine3> affines;
+		std::vector<Versor> versors;
+		std::vector<Vector3> points, directions;
+		std::vector<AABB3> boxes, otherBoxes;
+		std::vector<AABB3A, AlignedAllocator<AABB3A> > alignedBoxes;
+		std::vector<AABB3x4> boxes4;
+		std::vector<AABB3x8> boxes8;
+		std::vector<Ray3, AlignedAllocator<Ray3> > rays;
+		std::vector<Triangle3> triangles;
+		std::vector<Triangle3x4> triangles4;
+		std::vector<Triangle3x8> triangles8;
+	};
+
+	void MakeData( Data & o_data );
+	void RunAll( const Data & i_data, const std::string & i_filter, std::vector<Result> & o_results );
+	bool WriteJson( const char * i_path, const std::vector<Result> & i_results );
+}
+
+// Entry Point
+//============
+
+int main( int i_argumentCount, char** i_arguments )
+{
+	std::string filter;
+	const char * jsonPath = NULL;
+	for ( int i = 1; i < i_argumentCount; ++i )
+	{
+		if ( strcmp( i_arguments[i], "--json" ) == 0 && i + 1 < i_argumentCount )
+			jsonPath = i_arguments[++i];
+		else
+			filter = i_arguments[i];
+	}
+
+	Data data;
+	MakeData( data );
+
+	std::vector<Result> results;
+	printf( "simd: %s\n%-32s %-10s %10s %10s\n", SimdName(), "benchmark", "mode", "ns/op", "ops/tick" );
+	RunAll( data, filter, results );
+
+	if ( jsonPath && !WriteJson( jsonPath, results ) )
+	{
+		fprintf( stderr, "Could not write %s\n", jsonPath );
+		return 1;
+	}
+	return 0;
+}
+
+// Helper Function Definitions
+//============================
+
+namespace
+{
+	void MakeData( Data & o_data )
+	{
+		std::mt19937 random( 1 );
+		std::uniform_real_distribution<float> unit( -1.0f, 1.0f );
+		std::uniform_real_distribution<float> coordinate( -10.0f, 10.0f );
+		std::uniform_real_distribution<float> extent( 0.1f, 4.0f );
+
+		for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+		{
+			Versor q = Versor( unit( random ), unit( random ), unit( random ), unit( random ) ).normalize();
+			Vector3 p( coordinate( random ), coordinate( random ), coordinate( random ) );
+			Vector3 s( extent( random ), extent( random ), extent( random ) );
+
+			o_data.versors.push_back( q );
+			o_data.points.push_back( p );
+			o_data.directions.push_back( Vector3( unit( random ), unit( random ), unit( random ) ) * 20.0f );
+			o_data.rotations.push_back( Matrix4::rotation_q( q ) );
+			o_data.affines.push_back( Affine3::create_RST( q, s, p ) );
+			o_data.matrices.push_back( Matrix4( o_data.affines.back() ) );
+
+			// about half of the box pairs overlap
+			o_data.boxes.push_back( AABB3( p, p + s ) );
+			Vector3 offset( coordinate( random ), coordinate( random ), coordinate( random ) );
+			o_data.otherBoxes.push_back( AABB3( p + offset * 0.25f, p + offset * 0.25f + s ) );
+			o_data.alignedBoxes.push_back( AABB3A( o_data.boxes.back() ) );
+
+			Vector3 a = p, b = p + Vector3( s.x, 0.0f, 0.0f ), c = p + Vector3( 0.0f, s.y, s.z );
+			o_data.triangles.push_back( Triangle3( a, b, c ) );
+		}
+
+		for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+			o_data.rays.push_back( Ray3( o_data.points[( i * 7 ) & ARRAY_MASK], o_data.directions[i] ) );
+
+		// the groups hold the same boxes and triangles, so per-box costs compare directly
+		o_data.boxes4.resize( ARRAY_SIZE / 4 );
+		o_data.triangles4.resize( ARRAY_SIZE / 4 );
+		o_data.boxes8.resize( ARRAY_SIZE / 8 );
+		o_data.triangles8.resize( ARRAY_SIZE / 8 );
+		for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+		{
+			const Triangle3 & t = o_data.triangles[i];
+			o_data.boxes4[i / 4].set( i % 4, o_data.boxes[i] );
+			o_data.boxes8[i / 8].set( i % 8, o_data.boxes[i] );
+			o_data.triangles4[i / 4].set( i % 4, t.a, t.b, t.c, t.normal );
+			o_data.triangles8[i / 8].set( i % 8, t.a, t.b, t.c, t.normal );
+		}
+	}
+
+	void RunAll( const Data & i_data, const std::string & i_filter, std::vector<Result> & o_results )
+	{
+		const Data & d = i_data;
+		std::vector<Matrix4> matrixOut( ARRAY_SIZE );
+		std::vector<Affine3> affineOut( ARRAY_SIZE );
+		std::vector<Vector3> vectorOut( ARRAY_SIZE );
+
+		auto run = [&]( const char * i_name, const char * i_mode, size_t i_opsPerRep, std::function<float( size_t )> i_body )
+		{
+			if ( !i_filter.empty() && std::string( i_name ).find( i_filter ) == std::string::npos )
+				return;
+			Result result = Measure( i_name, i_mode, i_opsPerRep, i_body );
+			printf( "%-32s %-10s %10.3f %10.3f\n", result.name.c_str(), result.mode, result.nsPerOp, result.opsPerTick );
+			fflush( stdout );
+			o_results.push_back( result );
+		};
+
+		// Matrix4 and Affine3
+		//--------------------
+
+		run( "matrix4.multiply", "latency", 1, [&]( size_t reps )
+		{
+			Matrix4 m = d.matrices[0];
+			for ( size_t r = 0; r < reps; ++r )
+				m = m * d.rotations[r & ARRAY_MASK];
+			return m.m[3][0];
+		} );
+		run( "matrix4.multiply", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			for ( size_t r = 0; r < reps; ++r )
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					matrixOut[i] = d.matrices[i] * d.rotations[( i + r ) & ARRAY_MASK];
+			return matrixOut[reps & ARRAY_MASK].m[3][0];
+		} );
+		run( "matrix4.inverse", "latency", 1, [&]( size_t reps )
+		{
+			Matrix4 m = d.matrices[0];
+			for ( size_t r = 0; r < reps; ++r )
+				m = m.inverse();
+			return m.m[3][0];
+		} );
+		run( "matrix4.inverse", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			for ( size_t r = 0; r < reps; ++r )
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					matrixOut[i] = d.matrices[i].inverse();
+			return matrixOut[reps & ARRAY_MASK].m[3][0];
+		} );
+		run( "matrix4.inverse_affine", "latency", 1, [&]( size_t reps )
+		{
+			Matrix4 m = d.matrices[0];
+			for ( size_t r = 0; r < reps; ++r )
+				m = m.inverse_affine();
+			return m.m[3][0];
+		} );
+		run( "matrix4.inverse_affine", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			for ( size_t r = 0; r < reps; ++r )
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					matrixOut[i] = d.matrices[i].inverse_affine();
+			return matrixOut[reps & ARRAY_MASK].m[3][0];
+		} );
+		run( "affine3.multiply", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			for ( size_t r = 0; r < reps; ++r )
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					affineOut[i] = d.affines[i] * d.affines[( i + r ) & ARRAY_MASK];
+			return affineOut[reps & ARRAY_MASK].m[0][3];
+		} );
+		run( "affine3.inverse", "latency", 1, [&]( size_t reps )
+		{
+			Affine3 m = d.affines[0];
+			for ( size_t r = 0; r < reps; ++r )
+				m = m.inverse();
+			return m.m[0][3];
+		} );
+		run( "affine3.inverse", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			for ( size_t r = 0; r < reps; ++r )
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					affineOut[i] = d.affines[i].inverse();
+			return affineOut[reps & ARRAY_MASK].m[0][3];
+		} );
+		run( "matrix4.predot1", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			const Matrix4 & m = d.matrices[0];
+			float sum = 0.0f;
+			for ( size_t r = 0; r < reps; ++r )
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					sum += m.predot1( d.points[i] ).x;
+			return sum;
+		} );
+		run( "batch.transform_points", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			for ( size_t r = 0; r < reps; ++r )
+				Batch::transform_points( d.matrices[r & ARRAY_MASK], d.points.data(), vectorOut.data(), ARRAY_SIZE );
+			return vectorOut[reps & ARRAY_MASK].x;
+		} );
+
+		// Versor
+		//-------
+
+		run( "versor.rotate", "latency", 1, [&]( size_t reps )
+		{
+			Vector3 v = d.points[0];
+			const Versor & q = d.versors[0];
+			for ( size_t r = 0; r < reps; ++r )
+				v = q.rotate( v );
+			return v.x;
+		} );
+		run( "versor.rotate", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			for ( size_t r = 0; r < reps; ++r )
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					vectorOut[i] = d.versors[i].rotate( d.points[i] );
+			return vectorOut[reps & ARRAY_MASK].x;
+		} );
+		run( "batch.rotate", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			for ( size_t r = 0; r < reps; ++r )
+				Batch::rotate( d.versors.data(), d.points.data(), vectorOut.data(), ARRAY_SIZE );
+			return vectorOut[reps & ARRAY_MASK].x;
+		} );
+
+		// Boxes
+		//------
+		// latency chains pick the next pair by the last answer, so each test waits on the one before
+
+		run( "aabb3.intersects", "latency", 1, [&]( size_t reps )
+		{
+			size_t i = 0;
+			for ( size_t r = 0; r < reps; ++r )
+				i = ( i + 1 + d.boxes[i].intersects( d.otherBoxes[i] ) ) & ARRAY_MASK;
+			return static_cast<float>( i );
+		} );
+		run( "aabb3.intersects", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			uint32_t hits = 0;
+			for ( size_t r = 0; r < reps; ++r )
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					hits += d.boxes[i].intersects( d.otherBoxes[( i + r ) & ARRAY_MASK] );
+			return static_cast<float>( hits );
+		} );
+		run( "aabb3a.intersects", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			uint32_t hits = 0;
+			for ( size_t r = 0; r < reps; ++r )
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					hits += d.alignedBoxes[i].intersects( d.alignedBoxes[( i + r + 1 ) & ARRAY_MASK] );
+			return static_cast<float>( hits );
+		} );
+		run( "ray3.intersects", "latency", 1, [&]( size_t reps )
+		{
+			size_t i = 0;
+			for ( size_t r = 0; r < reps; ++r )
+				i = ( i + 1 + d.rays[i].intersects( d.alignedBoxes[i] ) ) & ARRAY_MASK;
+			return static_cast<float>( i );
+		} );
+		run( "ray3.intersects", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			uint32_t hits = 0;
+			for ( size_t r = 0; r < reps; ++r )
+			{
+				const Ray3 & ray = d.rays[r & ARRAY_MASK];
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					hits += ray.intersects( d.alignedBoxes[i] );
+			}
+			return static_cast<float>( hits );
+		} );
+		// ops are boxes, not calls
+		run( "ray3.intersects_x4", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			uint32_t hits = 0;
+			for ( size_t r = 0; r < reps; ++r )
+			{
+				const Ray3 & ray = d.rays[r & ARRAY_MASK];
+				for ( size_t i = 0; i < ARRAY_SIZE / 4; ++i )
+					hits += ray.intersects( d.boxes4[i] );
+			}
+			return static_cast<float>( hits );
+		} );
+		run( "ray3.intersects_x8", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			uint32_t hits = 0;
+			for ( size_t r = 0; r < reps; ++r )
+			{
+				const Ray3 & ray = d.rays[r & ARRAY_MASK];
+				for ( size_t i = 0; i < ARRAY_SIZE / 8; ++i )
+					hits += ray.intersects( d.boxes8[i] );
+			}
+			return static_cast<float>( hits );
+		} );
+
+		// Triangles
+		//----------
+
+		run( "triangle3.intersect_ray", "latency", 1, [&]( size_t reps )
+		{
+			size_t i = 0;
+			for ( size_t r = 0; r < reps; ++r )
+				i = ( i + 1 + ( d.triangles[i].intersect_ray( d.points[( i * 7 ) & ARRAY_MASK], d.directions[i] ) <= 1.0f ) ) & ARRAY_MASK;
+			return static_cast<float>( i );
+		} );
+		run( "triangle3.intersect_ray", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			float closest = 1.0f;
+			for ( size_t r = 0; r < reps; ++r )
+			{
+				Vector3 o = d.points[r & ARRAY_MASK], dir = d.directions[r & ARRAY_MASK];
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					closest = std::min( closest, d.triangles[i].intersect_ray( o, dir ) );
+			}
+			return closest;
+		} );
+		run( "triangle3x4.intersect_ray", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			float closest = 1.0f;
+			uint32_t lane;
+			for ( size_t r = 0; r < reps; ++r )
+			{
+				Vector3 o = d.points[r & ARRAY_MASK], dir = d.directions[r & ARRAY_MASK];
+				for ( size_t i = 0; i < ARRAY_SIZE / 4; ++i )
+					closest = std::min( closest, d.triangles4[i].intersect_ray( o, dir, lane ) );
+			}
+			return closest;
+		} );
+		run( "triangle3x8.intersect_ray", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			float closest = 1.0f;
+			uint32_t lane;
+			for ( size_t r = 0; r < reps; ++r )
+			{
+				Vector3 o = d.points[r & ARRAY_MASK], dir = d.directions[r & ARRAY_MASK];
+				for ( size_t i = 0; i < ARRAY_SIZE / 8; ++i )
+					closest = std::min( closest, d.triangles8[i].intersect_ray( o, dir, lane ) );
+			}
+			return closest;
+		} );
+
+		// Octants
+		//--------
+
+		run( "vector3.octant", "latency", 1, [&]( size_t reps )
+		{
+			size_t i = 0;
+			for ( size_t r = 0; r < reps; ++r )
+				i = ( i + 1 + d.points[i].octant() ) & ARRAY_MASK;
+			return static_cast<float>( i );
+		} );
+		run( "vector3.octant", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			uint32_t sum = 0;
+			for ( size_t r = 0; r < reps; ++r )
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					sum += d.points[i].octant();
+			return static_cast<float>( sum );
+		} );
+		run( "aabb3.octant", "latency", 1, [&]( size_t reps )
+		{
+			size_t i = 0;
+			for ( size_t r = 0; r < reps; ++r )
+				i = ( i + 1 + ( d.boxes[i].octant( r & 7 ).vmin.x > 0.0f ) ) & ARRAY_MASK;
+			return static_cast<float>( i );
+		} );
+		run( "aabb3.octant", "throughput", ARRAY_SIZE, [&]( size_t reps )
+		{
+			float sum = 0.0f;
+			for ( size_t r = 0; r < reps; ++r )
+				for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+					sum += d.boxes[i].octant( ( i + r ) & 7 ).vmin.x;
+			return sum;
+		} );
+
+		// FastMath
+		//---------
+		// each function at each tier, one value at a time and then through the array versions
+
+		std::vector<float> angles( ARRAY_SIZE ), xs( ARRAY_SIZE ), ys( ARRAY_SIZE ), positives( ARRAY_SIZE );
+		std::vector<float> floatOut( ARRAY_SIZE ), otherOut( ARRAY_SIZE );
+		for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+		{
+			angles[i] = d.points[i].x;
+			xs[i] = d.directions[i].x;
+			ys[i] = d.directions[i].y;
+			positives[i] = d.points[i].norm_sq() + 0.01f;
+		}
+
+		const char * const tierNames[] = { "coarse", "medium", "exact" };
+		auto runTier = [&]( const char * i_function, FastMath::Tier i_tier, std::function<float( size_t )> i_single, std::function<float( size_t )> i_array )
+		{
+			std::string name = std::string( "fastmath." ) + i_function + "." + tierNames[i_tier];
+			run( name.c_str(), "throughput", ARRAY_SIZE, i_single );
+			run( ( name + "_array" ).c_str(), "throughput", ARRAY_SIZE, i_array );
+		};
+		auto runFunctions = [&]( auto i_tier )
+		{
+			constexpr FastMath::Tier T = decltype( i_tier )::value;
+			runTier( "rsqrt", T, [&]( size_t reps )
+			{
+				for ( size_t r = 0; r < reps; ++r )
+					for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+						floatOut[i] = FastMath::rsqrt<T>( positives[i] );
+				return floatOut[reps & ARRAY_MASK];
+			}, [&]( size_t reps )
+			{
+				for ( size_t r = 0; r < reps; ++r )
+					FastMath::rsqrt<T>( positives.data(), floatOut.data(), ARRAY_SIZE );
+				return floatOut[reps & ARRAY_MASK];
+			} );
+			runTier( "normalize", T, [&]( size_t reps )
+			{
+				for ( size_t r = 0; r < reps; ++r )
+					for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+						vectorOut[i] = FastMath::normalize<T>( d.directions[i] );
+				return vectorOut[reps & ARRAY_MASK].x;
+			}, [&]( size_t reps )
+			{
+				for ( size_t r = 0; r < reps; ++r )
+					FastMath::normalize<T>( d.directions.data(), vectorOut.data(), ARRAY_SIZE );
+				return vectorOut[reps & ARRAY_MASK].x;
+			} );
+			runTier( "sincos", T, [&]( size_t reps )
+			{
+				for ( size_t r = 0; r < reps; ++r )
+					for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+						FastMath::sincos<T>( angles[i], floatOut[i], otherOut[i] );
+				return floatOut[reps & ARRAY_MASK];
+			}, [&]( size_t reps )
+			{
+				for ( size_t r = 0; r < reps; ++r )
+					FastMath::sincos<T>( angles.data(), floatOut.data(), otherOut.data(), ARRAY_SIZE );
+				return floatOut[reps & ARRAY_MASK];
+			} );
+			runTier( "atan2", T, [&]( size_t reps )
+			{
+				for ( size_t r = 0; r < reps; ++r )
+					for ( size_t i = 0; i < ARRAY_SIZE; ++i )
+						floatOut[i] = FastMath::atan2<T>( ys[i], xs[i] );
+				return floatOut[reps & ARRAY_MASK];
+			}, [&]( size_t reps )
+			{
+				for ( size_t r = 0; r < reps; ++r )
+					FastMath::atan2<T>( ys.data(), xs.data(), floatOut.data(), ARRAY_SIZE );
+				return floatOut[reps & ARRAY_MASK];
+			} );
+		};
+		runFunctions( std::integral_constant<FastMath::Tier, FastMath::Coarse>() );
+		runFunctions( std::integral_constant<FastMath::Tier, FastMath::Medium>() );
+		runFunctions( std::integral_constant<FastMath::Tier, FastMath::Exact>() );
+	}
+
+	bool WriteJson( const char * i_path, const std::vector<Result> & i_results )
+	{
+		FILE * file = fopen( i_path, "w" );
+		if ( !file )
+			return false;
+		for ( const Result & result : i_results )
+		{
+			fprintf( file, "{\"name\": \"%s\", \"mode\": \"%s\", \"simd\": \"%s\", \"ns_per_op\": %.4f, \"ops_per_tick\": %.4f}\n",
+				result.name.c_str(), result.mode, SimdName(), result.nsPerOp, result.opsPerTick );
+		}
+		return fclose( file ) == 0;
+	}
+}
@@ -0,0 +1,95 @@
+// Header Files
+//=============
+
+#include "CollisionBaker.h"
+
+#include <limits>
+#include <unordered_map>
+#include <vector>
+#include "../../Engine/Physics/CollisionMesh.h"
+
+// Interface
+//==========
+
+bool eae6320::CollisionBaker::Bake( const Graphics::Mesh::Data & i_mesh, std::ostream & o_stream )
+{
+	using Physics::CollisionMesh;
+
+	// The render mesh's bounds aren't trusted; they are recomputed from the positions
+	CollisionMesh::Header header;
+	{
+		float infty = std::numeric_limits<float>::infinity();
+		header.bounds = AABB3( Vector3( infty, infty, infty ), -Vector3( infty, infty, infty ) );
+		for ( uint32_t i = 0; i < i_mesh.num_vertices; ++i )
+		{
+			header.bounds.vmin = Vector3::min3( header.bounds.vmin, i_mesh.vertices[i].position );
+			header.bounds.vmax = Vector3::max3( header.bounds.vmax, i_mesh.vertices[i].position );
+		}
+		if ( i_mesh.num_vertices == 0 )
+		{
+			header.bounds = AABB3( Vector3::Zero, Vector3::Zero );
+		}
+	}
+
+	// Weld
+	std::vector<CollisionMesh::Position> positions;
+	std::vector<uint32_t> remap( i_mesh.num_vertices );
+	{
+		std::unordered_map<uint64_t, uint32_t> welded;
+		for ( uint32_t i = 0; i < i_mesh.num_vertices; ++i )
+		{
+			CollisionMesh::Position q = CollisionMesh::quantize( i_mesh.vertices[i].position, header.bounds );
+			uint64_t key = ( static_cast<uint64_t>( q.x ) << 32 ) | ( static_cast<uint64_t>( q.y ) << 16 ) | q.z;
+
+			auto found = welded.find( key );
+			if ( found == welded.end() )
+			{
+				found = welded.insert( std::make_pair( key, static_cast<uint32_t>( positions.size() ) ) ).first;
+				positions.push_back( q );
+			}
+			remap[i] = found->second;
+		}
+	}
+
+	// Welding can collapse a triangle: two of its corners land on one position, or all
+	// three on a line. Those have no area and no normal, and a ray test against them
+	// divides by zero, so they are dropped
+	std::vector<uint32_t> indices;
+	std::vector<CollisionMesh::Normal> normals;
+	indices.reserve( 3 * i_mesh.num_triangles );
+	normals.reserve( i_mesh.num_triangles );
+	for ( uint32_t i = 0; i < i_mesh.num_triangles; ++i )
+	{
+		uint32_t a = remap[i_mesh.indices[i * 3 + 0]];
+		uint32_t b = remap[i_mesh.indices[i * 3 + 1]];
+		uint32_t c = remap[i_mesh.indices[i * 3 + 2]];
+		if ( a == b || b == c || c == a )
+		{
+			continue;
+		}
+		// exact on the quantized grid, so collinear corners give exactly zero
+		{
+			int64_t ab[3] = { positions[b].x - positions[a].x, positions[b].y - positions[a].y, positions[b].z - positions[a].z };
+			int64_t ac[3] = { positions[c].x - positions[a].x, positions[c].y - positions[a].y, positions[c].z - positions[a].z };
+			if ( ( ab[1] * ac[2] - ab[2] * ac[1] ) == 0 && ( ab[2] * ac[0] - ab[0] * ac[2] ) == 0 && ( ab[0] * ac[1] - ab[1] * ac[0] ) == 0 )
+			{
+				continue;
+			}
+		}
+		indices.push_back( a );
+		indices.push_back( b );
+		indices.push_back( c );
+		// the terrain has always used the middle vertex's normal for the face
+		normals.push_back( CollisionMesh::encode_normal( i_mesh.vertices[i_mesh.indices[i * 3 + 1]].normal ) );
+	}
+
+	header.num_positions = static_cast<uint32_t>( positions.size() );
+	header.num_triangles = static_cast<uint32_t>( normals.size() );
+
+	o_stream.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+	o_stream.write( reinterpret_cast<const char *>( positions.data() ), positions.size() * sizeof( CollisionMesh::Position ) );
+	o_stream.write( reinterpret_cast<const char *>( indices.data() ), indices.size() * sizeof( uint32_t ) );
+	o_stream.write( reinterpret_cast<const char *>( normals.data() ), normals.size() * sizeof( CollisionMesh::Normal ) );
+
+	return !o_stream.fail();
+}
@@ -0,0 +1,27 @@
+/*
+	Packs a mesh into the position-only format read by Physics::CollisionMesh
+*/
+
+#ifndef EAE6320_COLLISIONBAKER_H
+#define EAE6320_COLLISIONBAKER_H
+
+// Header Files
+//=============
+
+#include <ostream>
+#include "../../Engine/Graphics/Mesh.h"
+
+// Interface
+//==========
+
+namespace eae6320
+{
+	namespace CollisionBaker
+	{
+		// welds positions that quantize to the same 16-bit coordinates,
+		// then writes them with indices and per-triangle normals
+		bool Bake( const Graphics::Mesh::Data & i_mesh, std::ostream & o_stream );
+	}
+}
+
+#endif	// EAE6320_COLLISIONBAKER_H
@@ -0,0 +1,261 @@
+// Header Files
+//=============
+
+#include "NavBaker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <vector>
+#include "../../Engine/Math/Triangle3.h"
+#include "../../Engine/Physics/NavGraph.h"
+
+// Helper Function Declarations
+//=============================
+
+namespace
+{
+	using namespace eae6320;
+	using Physics::NavGraph;
+
+	enum : uint8_t
+	{
+		SOLID = 1 << 0,
+		WALKABLE = 1 << 1,
+	};
+
+	struct Grid
+	{
+		AABB3 bounds;
+		float voxel_size;
+		uint32_t dims[3];
+		std::vector<uint8_t> cells;
+
+		size_t index( uint32_t x, uint32_t y, uint32_t z ) const
+		{
+			return ( static_cast<size_t>( z ) * dims[1] + y ) * dims[0] + x;
+		}
+		uint8_t at( uint32_t x, uint32_t y, uint32_t z ) const
+		{
+			return y < dims[1] ? cells[index( x, y, z )] : 0;
+		}
+		AABB3 voxel( uint32_t x, uint32_t y, uint32_t z ) const
+		{
+			Vector3 vmin = bounds.vmin + Vector3( x, y, z ) * voxel_size;
+			return AABB3( vmin, vmin + Vector3::One * voxel_size );
+		}
+		uint32_t clamp( float coord, float origin, uint32_t dim ) const
+		{
+			float voxel = std::floor( ( coord - origin ) / voxel_size );
+			return static_cast<uint32_t>( std::min( std::max( voxel, 0.0f ), dim - 1.0f ) );
+		}
+	};
+
+	void VoxelizeSlab( Grid & grid, const std::vector<Triangle3> & triangles, float min_normal_y,
+		uint32_t z_begin, uint32_t z_end );
+	void ExtractNodes( const Grid & grid, uint32_t clearance, std::vector<NavGraph::Node> & o_nodes,
+		std::vector<uint32_t> & o_columnOffsets );
+	void ConnectNodes( const Grid & grid, uint32_t climb, const std::vector<NavGraph::Node> & nodes,
+		const std::vector<uint32_t> & columnOffsets,
+		std::vector<uint32_t> & o_edgeOffsets, std::vector<uint32_t> & o_edges );
+}
+
+// Interface
+//==========
+
+bool eae6320::NavBaker::Bake( const Graphics::Mesh::Data & i_mesh, const Settings & i_settings, std::ostream & o_stream )
+{
+	// Gather triangles, and bounds that leave room to stand on the highest surface
+	std::vector<Triangle3> triangles;
+	Grid grid;
+	{
+		float infty = std::numeric_limits<float>::infinity();
+		grid.bounds = AABB3( Vector3( infty, infty, infty ), -Vector3( infty, infty, infty ) );
+
+		triangles.reserve( i_mesh.num_triangles );
+		for ( uint32_t i = 0; i < i_mesh.num_triangles; ++i )
+		{
+			const Graphics::Mesh::Vertex & a = i_mesh.vertices[i_mesh.indices[i * 3]];
+			const Graphics::Mesh::Vertex & b = i_mesh.vertices[i_mesh.indices[i * 3 + 1]];
+			const Graphics::Mesh::Vertex & c = i_mesh.vertices[i_mesh.indices[i * 3 + 2]];
+			triangles.push_back( Triangle3( a.position, b.position, c.position, b.normal ) );
+			grid.bounds.vmin = Vector3::min3( grid.bounds.vmin, triangles.back().box.vmin );
+			grid.bounds.vmax = Vector3::max3( grid.bounds.vmax, triangles.back().box.vmax );
+		}
+		if ( triangles.empty() )
+		{
+			return false;
+		}
+
+		grid.voxel_size = i_settings.voxel_size;
+		grid.bounds.vmin -= Vector3::One * grid.voxel_size;
+		grid.bounds.vmax += Vector3::One * grid.voxel_size + Vector3::J * i_settings.agent_height;
+
+		Vector3 extents = ( grid.bounds.vmax - grid.bounds.vmin ) / grid.voxel_size;
+		grid.dims[0] = static_cast<uint32_t>( std::ceil( extents.x ) );
+		grid.dims[1] = static_cast<uint32_t>( std::ceil( extents.y ) );
+		grid.dims[2] = static_cast<uint32_t>( std::ceil( extents.z ) );
+		if ( grid.dims[0] > UINT16_MAX || grid.dims[1] > UINT16_MAX || grid.dims[2] > UINT16_MAX )
+		{
+			return false;
+		}
+		grid.cells.assign( static_cast<size_t>( grid.dims[0] ) * grid.dims[1] * grid.dims[2], 0 );
+	}
+
+	// Voxelize in parallel; each thread owns a slab of z so no cell is written twice
+	{
+		uint32_t threadCount = std::max( std::thread::hardware_concurrency(), 1u );
+		threadCount = std::min( threadCount, grid.dims[2] );
+		const float min_normal_y = std::cos( i_settings.max_slope );
+
+		std::vector<std::thread> threads;
+		for ( uint32_t i = 0; i < threadCount; ++i )
+		{
+			uint32_t z_begin = grid.dims[2] * i / threadCount;
+			uint32_t z_end = grid.dims[2] * ( i + 1 ) / threadCount;
+			threads.push_back( std::thread( VoxelizeSlab, std::ref( grid ), std::cref( triangles ),
+				min_normal_y, z_begin, z_end ) );
+		}
+		for ( std::thread & thread : threads )
+		{
+			thread.join();
+		}
+	}
+
+	// Walkable-region extraction
+	std::vector<NavGraph::Node> nodes;
+	std::vector<uint32_t> columnOffsets, edgeOffsets, edges;
+	{
+		uint32_t clearance = static_cast<uint32_t>( std::ceil( i_settings.agent_height / grid.voxel_size ) );
+		uint32_t climb = static_cast<uint32_t>( std::floor( i_settings.max_climb / grid.voxel_size ) );
+		ExtractNodes( grid, clearance, nodes, columnOffsets );
+		ConnectNodes( grid, climb, nodes, columnOffsets, edgeOffsets, edges );
+	}
+
+	NavGraph::Header header;
+	header.bounds = grid.bounds;
+	header.voxel_size = grid.voxel_size;
+	header.dims[0] = grid.dims[0];
+	header.dims[1] = grid.dims[1];
+	header.dims[2] = grid.dims[2];
+	header.num_nodes = static_cast<uint32_t>( nodes.size() );
+	header.num_edges = static_cast<uint32_t>( edges.size() );
+
+	o_stream.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+	o_stream.write( reinterpret_cast<const char *>( nodes.data() ), nodes.size() * sizeof( NavGraph::Node ) );
+	o_stream.write( reinterpret_cast<const char *>( edgeOffsets.data() ), edgeOffsets.size() * sizeof( uint32_t ) );
+	o_stream.write( reinterpret_cast<const char *>( edges.data() ), edges.size() * sizeof( uint32_t ) );
+
+	return !o_stream.fail();
+}
+
+// Helper Function Definitions
+//============================
+
+namespace
+{
+	void VoxelizeSlab( Grid & grid, const std::vector<Triangle3> & triangles, float min_normal_y,
+		uint32_t z_begin, uint32_t z_end )
+	{
+		const Vector3 & origin = grid.bounds.vmin;
+
+		for ( const Triangle3 & triangle : triangles )
+		{
+			uint32_t z0 = grid.clamp( triangle.box.vmin.z, origin.z, grid.dims[2] );
+			uint32_t z1 = grid.clamp( triangle.box.vmax.z, origin.z, grid.dims[2] );
+			z0 = std::max( z0, z_begin );
+			z1 = std::min( z1, z_end - 1 );
+			if ( z0 > z1 )
+			{
+				continue;
+			}
+
+			uint32_t x0 = grid.clamp( triangle.box.vmin.x, origin.x, grid.dims[0] );
+			uint32_t x1 = grid.clamp( triangle.box.vmax.x, origin.x, grid.dims[0] );
+			uint32_t y0 = grid.clamp( triangle.box.vmin.y, origin.y, grid.dims[1] );
+			uint32_t y1 = grid.clamp( triangle.box.vmax.y, origin.y, grid.dims[1] );
+
+			uint8_t flags = SOLID;
+			if ( triangle.normal.y >= min_normal_y )
+			{
+				flags |= WALKABLE;
+			}
+
+			for ( uint32_t z = z0; z <= z1; ++z )
+				for ( uint32_t y = y0; y <= y1; ++y )
+					for ( uint32_t x = x0; x <= x1; ++x )
+						if ( grid.voxel( x, y, z ).intersects( triangle ) )
+							grid.cells[grid.index( x, y, z )] |= flags;
+		}
+	}
+
+	void ExtractNodes( const Grid & grid, uint32_t clearance, std::vector<NavGraph::Node> & o_nodes,
+		std::vector<uint32_t> & o_columnOffsets )
+	{
+		o_columnOffsets.reserve( grid.dims[0] * grid.dims[2] + 1 );
+
+		// z, x, y order keeps nodes sorted by column then height
+		for ( uint32_t z = 0; z < grid.dims[2]; ++z )
+			for ( uint32_t x = 0; x < grid.dims[0]; ++x )
+			{
+				o_columnOffsets.push_back( static_cast<uint32_t>( o_nodes.size() ) );
+
+				for ( uint32_t y = 0; y + 1 < grid.dims[1]; ++y )
+				{
+					uint8_t cell = grid.at( x, y, z );
+					if ( !( cell & SOLID ) || !( cell & WALKABLE ) )
+					{
+						continue;
+					}
+
+					bool clear = true;
+					for ( uint32_t h = 1; h <= clearance && clear; ++h )
+					{
+						clear = !( grid.at( x, y + h, z ) & SOLID );
+					}
+					if ( clear )
+					{
+						NavGraph::Node node = { static_cast<uint16_t>( x ), static_cast<uint16_t>( y + 1 ), static_cast<uint16_t>( z ) };
+						o_nodes.push_back( node );
+					}
+				}
+			}
+
+		o_columnOffsets.push_back( static_cast<uint32_t>( o_nodes.size() ) );
+	}
+
+	void ConnectNodes( const Grid & grid, uint32_t climb, const std::vector<NavGraph::Node> & nodes,
+		const std::vector<uint32_t> & columnOffsets,
+		std::vector<uint32_t> & o_edgeOffsets, std::vector<uint32_t> & o_edges )
+	{
+		const int32_t neighbors[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+
+		o_edgeOffsets.reserve( nodes.size() + 1 );
+		for ( uint32_t i = 0; i < nodes.size(); ++i )
+		{
+			o_edgeOffsets.push_back( static_cast<uint32_t>( o_edges.size() ) );
+			const NavGraph::Node & node = nodes[i];
+
+			for ( const int32_t ( &d )[2] : neighbors )
+			{
+				int32_t x = node.x + d[0], z = node.z + d[1];
+				if ( x < 0 || z < 0 || x >= static_cast<int32_t>( grid.dims[0] ) || z >= static_cast<int32_t>( grid.dims[2] ) )
+				{
+					continue;
+				}
+
+				uint32_t column = z * grid.dims[0] + x;
+				for ( uint32_t j = columnOffsets[column]; j < columnOffsets[column + 1]; ++j )
+				{
+					int32_t dy = static_cast<int32_t>( nodes[j].y ) - node.y;
+					if ( static_cast<uint32_t>( std::abs( dy ) ) <= climb )
+					{
+						o_edges.push_back( j );
+					}
+				}
+			}
+		}
+		o_edgeOffsets.push_back( static_cast<uint32_t>( o_edges.size() ) );
+	}
+}
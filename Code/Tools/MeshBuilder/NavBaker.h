@@ -0,0 +1,36 @@
+/*
+	Bakes a collision mesh into the walkable-space graph read by Physics::NavGraph
+*/
+
+#ifndef EAE6320_NAVBAKER_H
+#define EAE6320_NAVBAKER_H
+
+// Header Files
+//=============
+
+#include <ostream>
+#include "../../Engine/Graphics/Mesh.h"
+
+// Interface
+//==========
+
+namespace eae6320
+{
+	namespace NavBaker
+	{
+		// all lengths are in the mesh's own units
+		struct Settings
+		{
+			float voxel_size;	// edge length of one voxel
+			float agent_height;	// empty space required above a walkable surface
+			float max_climb;	// tallest step between neighboring nodes
+			float max_slope;	// steepest walkable surface, in radians
+		};
+
+		// voxelizes the mesh across all hardware threads,
+		// then writes the graph of standable voxels in the NavGraph format
+		bool Bake( const Graphics::Mesh::Data & i_mesh, const Settings & i_settings, std::ostream & o_stream );
+	}
+}
+
+#endif	// EAE6320_NAVBAKER_H
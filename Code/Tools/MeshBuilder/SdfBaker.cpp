@@ -0,0 +1,271 @@
+// Header Files
+//=============
+
+#include "SdfBaker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../../Engine/Math/Pack.h"
+#include "../../Engine/Math/Triangle3.h"
+#include "../../Engine/Physics/CollisionMesh.h"
+#include "../../Engine/Physics/DistanceField.h"
+
+// Helper Function Declarations
+//=============================
+
+namespace
+{
+	using namespace eae6320;
+	using Physics::DistanceField;
+
+	struct Brick
+	{
+		uint32_t x, y, z;
+		std::vector<uint32_t> candidates;
+	};
+
+	// One per triangle, by Triangle3::Feature: the sign of a point's distance comes from the
+	// feature its closest point lies on. Corners and edges are shared with the neighbors,
+	// so they take the angle-weighted pseudonormal over every triangle that touches them
+	// (Baerentzen and Aanaes 2005); any one triangle's normal is wrong there on a convex
+	// or concave crease, depending on which triangle happens to win the tie
+	struct Pseudonormals
+	{
+		Vector3 feature[7];
+	};
+
+	void ComputePseudonormals( const Graphics::Mesh::Data & i_mesh, const AABB3 & i_bounds,
+		const std::vector<uint32_t> & i_triangleIds, const std::vector<Triangle3> & i_triangles,
+		std::vector<Pseudonormals> & o_pseudonormals );
+	void SampleBrick( const DistanceField::Header & header, const std::vector<Triangle3> & triangles,
+		const std::vector<Pseudonormals> & pseudonormals, const Brick & brick, int16_t * o_samples );
+}
+
+// Interface
+//==========
+
+bool eae6320::SdfBaker::Bake( const Graphics::Mesh::Data & i_mesh, const Settings & i_settings, std::ostream & o_stream )
+{
+	std::vector<Triangle3> triangles;
+	// into i_mesh, per triangle kept
+	std::vector<uint32_t> triangleIds;
+	std::vector<Pseudonormals> pseudonormals;
+	DistanceField::Header header;
+	{
+		float infty = std::numeric_limits<float>::infinity();
+		header.bounds = AABB3( Vector3( infty, infty, infty ), -Vector3( infty, infty, infty ) );
+
+		triangles.reserve( i_mesh.num_triangles );
+		triangleIds.reserve( i_mesh.num_triangles );
+		for ( uint32_t i = 0; i < i_mesh.num_triangles; ++i )
+		{
+			const Graphics::Mesh::Vertex & a = i_mesh.vertices[i_mesh.indices[i * 3]];
+			const Graphics::Mesh::Vertex & b = i_mesh.vertices[i_mesh.indices[i * 3 + 1]];
+			const Graphics::Mesh::Vertex & c = i_mesh.vertices[i_mesh.indices[i * 3 + 2]];
+			// the face normal, on the side the middle vertex's normal faces as the terrain has it.
+			// triangles with no area have no side, and their edges belong to their neighbors anyway
+			Vector3 normal = ( b.position - a.position ).cross( c.position - a.position );
+			if ( normal.norm_sq() == 0 )
+			{
+				continue;
+			}
+			normal = normal.normalize();
+			if ( normal.dot( b.normal ) < 0 )
+			{
+				normal = -normal;
+			}
+			triangles.push_back( Triangle3( a.position, b.position, c.position, normal ) );
+			triangleIds.push_back( i );
+			header.bounds.vmin = Vector3::min3( header.bounds.vmin, triangles.back().box.vmin );
+			header.bounds.vmax = Vector3::max3( header.bounds.vmax, triangles.back().box.vmax );
+		}
+		if ( triangles.empty() )
+		{
+			return false;
+		}
+		ComputePseudonormals( i_mesh, header.bounds, triangleIds, triangles, pseudonormals );
+
+		header.cell_size = i_settings.cell_size;
+		header.band = i_settings.band;
+		header.bounds.vmin -= Vector3::One * header.band;
+		header.bounds.vmax += Vector3::One * header.band;
+
+		float brick_size = header.cell_size * DistanceField::BRICK_CELLS;
+		Vector3 extents = ( header.bounds.vmax - header.bounds.vmin ) / brick_size;
+		header.dims[0] = static_cast<uint32_t>( std::ceil( extents.x ) );
+		header.dims[1] = static_cast<uint32_t>( std::ceil( extents.y ) );
+		header.dims[2] = static_cast<uint32_t>( std::ceil( extents.z ) );
+	}
+
+	// Keep the bricks that come within the band of a triangle, with the triangles that matter to each.
+	// a sample's closest triangle is never farther than band beyond the nearest one,
+	// so anything outside brick + 2 * band can't win
+	std::vector<uint32_t> gridBricks( header.dims[0] * header.dims[1] * header.dims[2], DistanceField::EMPTY_BRICK );
+	std::vector<Brick> bricks;
+	{
+		float brick_size = header.cell_size * DistanceField::BRICK_CELLS;
+		for ( uint32_t z = 0; z < header.dims[2]; ++z )
+			for ( uint32_t y = 0; y < header.dims[1]; ++y )
+				for ( uint32_t x = 0; x < header.dims[0]; ++x )
+				{
+					Vector3 vmin = header.bounds.vmin + Vector3( x, y, z ) * brick_size;
+					AABB3 box( vmin, vmin + Vector3::One * brick_size );
+					AABB3 nearBox( box.vmin - Vector3::One * header.band, box.vmax + Vector3::One * header.band );
+					AABB3 reachBox( box.vmin - Vector3::One * 2 * header.band, box.vmax + Vector3::One * 2 * header.band );
+
+					bool nearSurface = false;
+					Brick brick = { x, y, z };
+					for ( uint32_t i = 0; i < triangles.size(); ++i )
+					{
+						if ( !reachBox.intersects( triangles[i].box ) )
+						{
+							continue;
+						}
+						brick.candidates.push_back( i );
+						nearSurface = nearSurface || nearBox.intersects( triangles[i] );
+					}
+
+					if ( nearSurface )
+					{
+						gridBricks[( z * header.dims[1] + y ) * header.dims[0] + x] = static_cast<uint32_t>( bricks.size() );
+						bricks.push_back( std::move( brick ) );
+					}
+				}
+		header.num_bricks = static_cast<uint32_t>( bricks.size() );
+	}
+
+	// Sample in parallel; threads pull bricks off a shared counter since their costs vary widely
+	std::vector<int16_t> samples( bricks.size() * DistanceField::SAMPLES_PER_BRICK );
+	{
+		std::atomic<uint32_t> next( 0 );
+		auto work = [&]()
+		{
+			for ( uint32_t i = next++; i < bricks.size(); i = next++ )
+			{
+				SampleBrick( header, triangles, pseudonormals, bricks[i], &samples[i * DistanceField::SAMPLES_PER_BRICK] );
+			}
+		};
+
+		std::vector<std::thread> threads;
+		uint32_t threadCount = std::max( std::thread::hardware_concurrency(), 1u );
+		for ( uint32_t i = 0; i < threadCount; ++i )
+		{
+			threads.push_back( std::thread( work ) );
+		}
+		for ( std::thread & thread : threads )
+		{
+			thread.join();
+		}
+	}
+
+	o_stream.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+	o_stream.write( reinterpret_cast<const char *>( gridBricks.data() ), gridBricks.size() * sizeof( uint32_t ) );
+	o_stream.write( reinterpret_cast<const char *>( samples.data() ), samples.size() * sizeof( int16_t ) );
+
+	return !o_stream.fail();
+}
+
+// Helper Function Definitions
+//============================
+
+namespace
+{
+	void ComputePseudonormals( const Graphics::Mesh::Data & i_mesh, const AABB3 & i_bounds,
+		const std::vector<uint32_t> & i_triangleIds, const std::vector<Triangle3> & i_triangles,
+		std::vector<Pseudonormals> & o_pseudonormals )
+	{
+		// Render meshes split vertices at seams, so corners are welded the way the collision mesh welds them
+		std::vector<uint32_t> corners( 3 * i_triangles.size() );
+		uint32_t cornerCount = 0;
+		{
+			std::unordered_map<uint64_t, uint32_t> welded;
+			for ( size_t i = 0; i < corners.size(); ++i )
+			{
+				const Vector3 & position = i_mesh.vertices[i_mesh.indices[i_triangleIds[i / 3] * 3 + i % 3]].position;
+				Physics::CollisionMesh::Position q = Physics::CollisionMesh::quantize( position, i_bounds );
+				uint64_t key = ( static_cast<uint64_t>( q.x ) << 32 ) | ( static_cast<uint64_t>( q.y ) << 16 ) | q.z;
+				corners[i] = welded.insert( std::make_pair( key, cornerCount ) ).first->second;
+				if ( corners[i] == cornerCount )
+				{
+					++cornerCount;
+				}
+			}
+		}
+
+		const Triangle3::Feature edges[3] = { Triangle3::EDGE_AB, Triangle3::EDGE_BC, Triangle3::EDGE_CA };
+		auto EdgeKey = [&corners]( size_t i_triangle, uint32_t i_edge )
+		{
+			uint32_t u = corners[i_triangle * 3 + i_edge], v = corners[i_triangle * 3 + ( i_edge + 1 ) % 3];
+			return ( static_cast<uint64_t>( std::min( u, v ) ) << 32 ) | std::max( u, v );
+		};
+
+		// Each corner weighs a face normal by the face's angle there; each edge sums its faces
+		std::vector<Vector3> cornerNormals( cornerCount, Vector3::Zero );
+		std::unordered_map<uint64_t, Vector3> edgeNormals;
+		for ( size_t i = 0; i < i_triangles.size(); ++i )
+		{
+			const Triangle3 & triangle = i_triangles[i];
+			const Vector3 * vertices[3] = { &triangle.a, &triangle.b, &triangle.c };
+			for ( uint32_t j = 0; j < 3; ++j )
+			{
+				Vector3 toNext = ( *vertices[( j + 1 ) % 3] - *vertices[j] ).normalize();
+				Vector3 toPrevious = ( *vertices[( j + 2 ) % 3] - *vertices[j] ).normalize();
+				float angle = std::acos( std::max( -1.0f, std::min( 1.0f, toNext.dot( toPrevious ) ) ) );
+				cornerNormals[corners[i * 3 + j]] += triangle.normal * angle;
+
+				auto edge = edgeNormals.insert( std::make_pair( EdgeKey( i, j ), Vector3::Zero ) ).first;
+				edge->second += triangle.normal;
+			}
+		}
+
+		o_pseudonormals.resize( i_triangles.size() );
+		for ( size_t i = 0; i < i_triangles.size(); ++i )
+		{
+			Pseudonormals & pseudonormals = o_pseudonormals[i];
+			for ( uint32_t j = 0; j < 3; ++j )
+			{
+				pseudonormals.feature[Triangle3::CORNER_A + j] = cornerNormals[corners[i * 3 + j]];
+				pseudonormals.feature[edges[j]] = edgeNormals[EdgeKey( i, j )];
+			}
+			pseudonormals.feature[Triangle3::FACE] = i_triangles[i].normal;
+		}
+	}
+
+	void SampleBrick( const DistanceField::Header & header, const std::vector<Triangle3> & triangles,
+		const std::vector<Pseudonormals> & pseudonormals, const Brick & brick, int16_t * o_samples )
+	{
+		const uint32_t n = DistanceField::BRICK_SAMPLES;
+		Vector3 origin = header.bounds.vmin
+			+ Vector3( brick.x, brick.y, brick.z ) * ( header.cell_size * DistanceField::BRICK_CELLS );
+
+		for ( uint32_t z = 0; z < n; ++z )
+			for ( uint32_t y = 0; y < n; ++y )
+				for ( uint32_t x = 0; x < n; ++x )
+				{
+					Vector3 p = origin + Vector3( x, y, z ) * header.cell_size;
+
+					float best = header.band * header.band;
+					float sign = 1.0f;
+					for ( uint32_t id : brick.candidates )
+					{
+						const Triangle3 & triangle = triangles[id];
+						Triangle3::Feature feature;
+						Vector3 offset = p - Triangle3::closest_point( triangle.a, triangle.b, triangle.c, p, &feature );
+						float d = offset.norm_sq();
+						if ( d < best )
+						{
+							best = d;
+							sign = offset.dot( pseudonormals[id].feature[feature] ) < 0 ? -1.0f : 1.0f;
+						}
+					}
+
+					float distance = sign * std::sqrt( best ) / header.band;
+					o_samples[( z * n + y ) * n + x] = Pack::to_snorm16( distance );
+				}
+	}
+}
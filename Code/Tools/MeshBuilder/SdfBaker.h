@@ -0,0 +1,35 @@
+/*
+	Bakes a collision mesh into the sparse brick distance field read by Physics::DistanceField
+*/
+
+#ifndef EAE6320_SDFBAKER_H
+#define EAE6320_SDFBAKER_H
+
+// Header Files
+//=============
+
+#include <ostream>
+#include "../../Engine/Graphics/Mesh.h"
+
+// Interface
+//==========
+
+namespace eae6320
+{
+	namespace SdfBaker
+	{
+		// all lengths are in the mesh's own units
+		struct Settings
+		{
+			float cell_size;	// spacing between samples
+			float band;	// distance kept around surfaces; bricks farther than this are dropped
+		};
+
+		// samples bricks near the surface across all hardware threads,
+		// each sample taking the distance to its closest triangle, signed by the
+		// angle-weighted pseudonormal of the corner, edge or face it is closest to
+		bool Bake( const Graphics::Mesh::Data & i_mesh, const Settings & i_settings, std::ostream & o_stream );
+	}
+}
+
+#endif	// EAE6320_SDFBAKER_H
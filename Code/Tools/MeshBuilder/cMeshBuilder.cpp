@@ -8,6 +8,11 @@
 #include "../../Engine/Windows/WindowsFunctions.h"
 #include "../Debug_Buildtime/UserOutput.h"
 #include "../../Engine/Graphics/Mesh.h"
+#include "CollisionBaker.h"
+#include "NavBaker.h"
+#include "SdfBaker.h"
+
+#include <algorithm>
 
 // Interface
 //==========
@@ -16,9 +21,37 @@
 //------
 using namespace eae6320::Graphics;
 
-bool eae6320::cMeshBuilder::Build( const std::vector<std::string>& )
+namespace
+{
+	// meshes are authored in centimeters
+	const eae6320::NavBaker::Settings s_navSettings =
+	{
+		20.0f,	// voxel_size
+		150.0f,	// agent_height
+		40.0f,	// max_climb
+		0.785398f,	// max_slope (45 degrees)
+	};
+	const eae6320::SdfBaker::Settings s_sdfSettings =
+	{
+		20.0f,	// cell_size
+		60.0f,	// band
+	};
+
+	bool HasArgument( const std::vector<std::string>& i_arguments, const char * i_argument )
+	{
+		return std::find(i_arguments.begin(), i_arguments.end(), i_argument) != i_arguments.end();
+	}
+}
+
+bool eae6320::cMeshBuilder::Build( const std::vector<std::string>& i_optionalArguments )
 {
 	bool wereThereErrors = false;
+	// "navmesh" bakes walkable space instead of copying the render mesh
+	const bool bakeNavGraph = HasArgument(i_optionalArguments, "navmesh");
+	// "collision" keeps only welded, quantized positions
+	const bool packCollision = HasArgument(i_optionalArguments, "collision");
+	// "sdf" samples distance to the surface in bricks
+	const bool bakeDistanceField = HasArgument(i_optionalArguments, "sdf");
 
 	// Copy the source to the target
 	{
@@ -46,22 +79,61 @@ bool eae6320::cMeshBuilder::Build( const std::vector<std::string>& )
 			goto OnExit;
 		}
 
-		// THIS IS THE FORMAT DEFINITION
-		// 24 bytes bounds (AABB)
-		// 4 bytes num_vertices (V)
-		// 4 bytes num_triangles (T)
-		// 36*V bytes vertices
-		// 3*4*T bytes indices
-		outfile.write(reinterpret_cast<char *>(&(mesh_data->bounds)),
-			sizeof(mesh_data->bounds));
-		outfile.write(reinterpret_cast<char *>(&(mesh_data->num_vertices)),
-			sizeof(mesh_data->num_vertices));
-		outfile.write(reinterpret_cast<char *>(&(mesh_data->num_triangles)),
-			sizeof(mesh_data->num_triangles));
-		outfile.write(reinterpret_cast<char *>(mesh_data->vertices),
-			mesh_data->num_vertices * sizeof(Mesh::Vertex));
-		outfile.write(reinterpret_cast<char *>(mesh_data->indices),
-			3 * mesh_data->num_triangles * sizeof(Mesh::Index));
+		if (bakeNavGraph)
+		{
+			// format is defined in Physics/NavGraph.h
+			if (!NavBaker::Bake(*mesh_data, s_navSettings, outfile))
+			{
+				wereThereErrors = true;
+				std::stringstream decoratedErrorMessage;
+				decoratedErrorMessage << "Failed to bake a nav graph from " << m_path_source;
+				eae6320::UserOutput::Print(decoratedErrorMessage.str(), __FILE__);
+				goto OnExit;
+			}
+		}
+		else if (packCollision)
+		{
+			// format is defined in Physics/CollisionMesh.h
+			if (!CollisionBaker::Bake(*mesh_data, outfile))
+			{
+				wereThereErrors = true;
+				std::stringstream decoratedErrorMessage;
+				decoratedErrorMessage << "Failed to pack collision from " << m_path_source;
+				eae6320::UserOutput::Print(decoratedErrorMessage.str(), __FILE__);
+				goto OnExit;
+			}
+		}
+		else if (bakeDistanceField)
+		{
+			// format is defined in Physics/DistanceField.h
+			if (!SdfBaker::Bake(*mesh_data, s_sdfSettings, outfile))
+			{
+				wereThereErrors = true;
+				std::stringstream decoratedErrorMessage;
+				decoratedErrorMessage << "Failed to bake a distance field from " << m_path_source;
+				eae6320::UserOutput::Print(decoratedErrorMessage.str(), __FILE__);
+				goto OnExit;
+			}
+		}
+		else
+		{
+			// THIS IS THE FORMAT DEFINITION
+			// 24 bytes bounds (AABB)
+			// 4 bytes num_vertices (V)
+			// 4 bytes num_triangles (T)
+			// 36*V bytes vertices
+			// 3*4*T bytes indices
+			outfile.write(reinterpret_cast<char *>(&(mesh_data->bounds)),
+				sizeof(mesh_data->bounds));
+			outfile.write(reinterpret_cast<char *>(&(mesh_data->num_vertices)),
+				sizeof(mesh_data->num_vertices));
+			outfile.write(reinterpret_cast<char *>(&(mesh_data->num_triangles)),
+				sizeof(mesh_data->num_triangles));
+			outfile.write(reinterpret_cast<char *>(mesh_data->vertices),
+				mesh_data->num_vertices * sizeof(Mesh::Vertex));
+			outfile.write(reinterpret_cast<char *>(mesh_data->indices),
+				3 * mesh_data->num_triangles * sizeof(Mesh::Index));
+		}
 
 		outfile.close();
 
@@ -10,6 +10,29 @@ return
 		"ctf_metal",
 		"ctf_railing",
 		"ctf_walls",
+	},
+	collision = {
+		srcext = 'msh', dstext = 'cib',
+		tool = 'MeshBuilder.exe',
+		-- welded, quantized positions for Physics::Terrain
+		args = 'collision',
+
+		"ctf_collision",
+	},
+	navmeshes = {
+		srcext = 'msh', dstext = 'nvb',
+		tool = 'MeshBuilder.exe',
+		-- bakes walkable space instead of copying the mesh
+		args = 'navmesh',
+
+		"ctf_collision",
+	},
+	distancefields = {
+		srcext = 'msh', dstext = 'sdb',
+		tool = 'MeshBuilder.exe',
+		-- sparse signed distance bricks for proximity queries
+		args = 'sdf',
+
 		"ctf_collision",
 	},
 	shaders = {
@@ -24,6 +47,7 @@ return
 		"f_opaque",
 		"f_transparent",
 		"v_sprite",
+		"v_instanced",
 	},
 	effects = {
 		srcext = 'fxt', dstext = 'fxb',
@@ -40,7 +40,7 @@ end
 -- Function Definitions
 --=====================
 
-local function BuildAsset( i_relativeSrcPath, i_relativeDstPath, i_dependencies, i_builderFileName )
+local function BuildAsset( i_relativeSrcPath, i_relativeDstPath, i_dependencies, i_builderFileName, i_optionalArguments )
 	-- Get the absolute paths to the source and target
 	local path_source = s_AuthoredAssetDir .. i_relativeSrcPath
 	local path_target = s_BuiltAssetDir .. i_relativeDstPath
@@ -107,9 +107,10 @@ local function BuildAsset( i_relativeSrcPath, i_relativeDstPath, i_dependencies,
 			local command = "\"" .. path_builder .. "\""
 			-- The source and target path must always be passed in
 			local arguments = "\"" .. path_source .. "\" \"" .. path_target .. "\""
-			-- If you create a mechanism so that some asset types could include extra arguments
-			-- you would concatenate them here, something like:
-			-- arguments = arguments .. " " .. i_optionalArguments
+			-- Some asset types pass extra arguments (see "args" in AssetList.lua)
+			if type( i_optionalArguments ) == "string" then
+				arguments = arguments .. " " .. i_optionalArguments
+			end
 			-- IMPORTANT NOTE:
 			-- If you need to debug a builder you can put print statements here to
 			-- find out what the exact command line should be.
@@ -175,9 +176,10 @@ local function BuildAssets( i_assetsToBuild )
 		end
 
 		local deps = assets.deps
+		local args = assets.args
 		
 		for i, name in ipairs( assets ) do
-			if not BuildAsset( name .. srcext , name .. dstext, deps, tool ) then
+			if not BuildAsset( name .. srcext , name .. dstext, deps, tool, args ) then
 				-- If there's an error then the asset build should fail,
 				-- but we can still try to build any remaining assets
 				wereThereErrors = true